@@ -0,0 +1,420 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: steam_api configuration file. The file is a list of "key value" 
+//			pairs, one per line. Lines starting with // or # are comments.
+//
+//			// Example steam_api.cfg
+//			appid					10
+//			reconnect_mode			1
+//			pump_budget_us			2000
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "steam_api_pch.h"
+#include "apiconfig.h"
+#include "asynclog.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: Default configuration file, located in the working directory just
+//			like steam_appid.txt. Can be overridden by environment variable.
+//-----------------------------------------------------------------------------
+static const char* k_pszConfigFileName = "steam_api.cfg";
+static const char* k_pszConfigEnvVariable = "SteamAPIConfig";
+
+//-----------------------------------------------------------------------------
+// Purpose: Key descriptions
+//-----------------------------------------------------------------------------
+enum EConfigKeyType
+{
+	k_EConfigKeyBool,
+	k_EConfigKeyUint32,
+	k_EConfigKeyString,
+};
+
+struct ConfigKey_t
+{
+	const char*		m_pszName;
+	EConfigKeyType	m_eType;
+	size_t			m_nOffset;
+	size_t			m_cubSize;
+	bool			m_bRuntime;		// Safe to change on reload
+};
+
+#define CONFIG_KEY(name, type, member, runtime) \
+	{ name, type, offsetof(SteamAPIConfig_t, member), sizeof(((SteamAPIConfig_t*)0)->member), runtime }
+
+static const ConfigKey_t s_ConfigKeys[] = 
+{
+	// Startup settings
+	CONFIG_KEY("appid",						k_EConfigKeyUint32,	m_nAppId,						false),
+	CONFIG_KEY("steamclient_path",			k_EConfigKeyString,	m_szSteamClientPath,			false),
+	CONFIG_KEY("reconnect_mode",			k_EConfigKeyBool,	m_bReconnectMode,				false),
+	CONFIG_KEY("catch_callback_exceptions",	k_EConfigKeyBool,	m_bCatchExceptionsInCallbacks,	false),
+	CONFIG_KEY("minidump_filter",			k_EConfigKeyBool,	m_bMinidumpFilter,				false),
+	CONFIG_KEY("minidump_compress",			k_EConfigKeyBool,	m_bMinidumpCompress,			false),
+	CONFIG_KEY("minidump_dir",				k_EConfigKeyString,	m_szMinidumpDir,				false),
+	CONFIG_KEY("minidump_helper",			k_EConfigKeyString,	m_szMinidumpHelperPath,			false),
+	CONFIG_KEY("log_file",					k_EConfigKeyString,	m_szLogFile,					false),
+	CONFIG_KEY("live_stats",				k_EConfigKeyBool,	m_bLiveStats,					false),
+	CONFIG_KEY("callback_locking",			k_EConfigKeyBool,	m_bCallbackLocking,				false),
+	CONFIG_KEY("persona_cache",				k_EConfigKeyBool,	m_bPersonaCache,				false),
+	CONFIG_KEY("avatar_cache",				k_EConfigKeyBool,	m_bAvatarCache,					false),
+	CONFIG_KEY("lobby_cache",				k_EConfigKeyBool,	m_bLobbyCache,					false),
+
+	// Runtime knobs
+	CONFIG_KEY("pump_max_messages",			k_EConfigKeyUint32,	m_unPumpMaxMessages,			true),
+	CONFIG_KEY("pump_budget_us",			k_EConfigKeyUint32,	m_unPumpBudget,					true),
+	CONFIG_KEY("shutdown_drain_ms",			k_EConfigKeyUint32,	m_unShutdownDrainTimeout,		true),
+	CONFIG_KEY("config_reload_ms",			k_EConfigKeyUint32,	m_unReloadInterval,				true),
+	CONFIG_KEY("log_level",					k_EConfigKeyUint32,	m_unLogLevel,					true),
+	CONFIG_KEY("slow_call_ms",				k_EConfigKeyUint32,	m_unSlowCallThreshold,			true),
+	CONFIG_KEY("handler_warn_us",			k_EConfigKeyUint32,	m_unHandlerWarnTime,			true),
+	CONFIG_KEY("handler_limit_us",			k_EConfigKeyUint32,	m_unHandlerLimitTime,			true),
+	CONFIG_KEY("handler_strikes",			k_EConfigKeyUint32,	m_unHandlerStrikes,				true),
+	CONFIG_KEY("deferred_budget_us",		k_EConfigKeyUint32,	m_unDeferredBudget,				true),
+	CONFIG_KEY("idle_compact_ms",			k_EConfigKeyUint32,	m_unIdleCompactTime,			true),
+	CONFIG_KEY("auth_ticket_lifetime_s",	k_EConfigKeyUint32,	m_unAuthTicketLifetime,			true),
+};
+
+//-----------------------------------------------------------------------------
+// 
+// Configuration state
+// 
+//-----------------------------------------------------------------------------
+
+// Published configuration. Replaced as a whole on reload.
+static SteamAPIConfig_t* volatile	s_pConfig = nullptr;
+
+// Previous configurations. Somebody might still hold a pointer to them, so
+// these live until the process exits.
+static std::vector<SteamAPIConfig_t*>	s_RetiredConfigs;
+
+// Full path to the file and its last write time
+static char			s_szConfigPath[MAX_PATH] = { '\0' };
+static FILETIME		s_ConfigWriteTime = { 0 };
+
+// Next time we look at the file
+static DWORD		s_dwNextConfigCheckTime = 0;
+
+//-----------------------------------------------------------------------------
+// Purpose: Values used when the key isn't present in the file.
+//-----------------------------------------------------------------------------
+static void Config_SetDefaults(SteamAPIConfig_t *pConfig)
+{
+	memset(pConfig, 0, sizeof(SteamAPIConfig_t));
+
+	pConfig->m_nAppId = k_uAppIdInvalid;
+	pConfig->m_bReconnectMode = false;
+	pConfig->m_bCatchExceptionsInCallbacks = true;
+	pConfig->m_bMinidumpFilter = false;
+	pConfig->m_bMinidumpCompress = false;
+	strcpy(pConfig->m_szMinidumpDir, "minidumps");
+	pConfig->m_bLiveStats = false;
+	pConfig->m_bCallbackLocking = false;
+	pConfig->m_bPersonaCache = false;
+	pConfig->m_bAvatarCache = false;
+	pConfig->m_bLobbyCache = false;
+
+	pConfig->m_unPumpMaxMessages = 0;
+	pConfig->m_unPumpBudget = 0;
+	pConfig->m_unShutdownDrainTimeout = 250;
+	pConfig->m_unReloadInterval = 1000;
+	pConfig->m_unLogLevel = k_ESteamAPILogInfo;
+	pConfig->m_unSlowCallThreshold = 5000;
+	pConfig->m_unHandlerWarnTime = 5000;
+	pConfig->m_unHandlerLimitTime = 16000;
+	pConfig->m_unHandlerStrikes = 0;
+	pConfig->m_unDeferredBudget = 2000;
+	pConfig->m_unIdleCompactTime = 10000;
+	pConfig->m_unAuthTicketLifetime = 300;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Stores the value into the key's member.
+//-----------------------------------------------------------------------------
+static void Config_SetValue(SteamAPIConfig_t *pConfig, const ConfigKey_t *pKey, const char *pchValue, size_t cchValue)
+{
+	char	szValue[MAX_PATH];
+	uint8*	pMember;
+
+	cchValue = min(cchValue, sizeof(szValue) - 1);
+	memcpy(szValue, pchValue, cchValue);
+	szValue[cchValue] = '\0';
+
+	pMember = reinterpret_cast<uint8*>(pConfig) + pKey->m_nOffset;
+
+	switch (pKey->m_eType)
+	{
+		case k_EConfigKeyBool:
+			*reinterpret_cast<bool*>(pMember) = (atoi(szValue) != 0 || !stricmp(szValue, "true"));
+			break;
+
+		case k_EConfigKeyUint32:
+			*reinterpret_cast<uint32*>(pMember) = strtoul(szValue, nullptr, 0);
+			break;
+
+		case k_EConfigKeyString:
+			strncpy(reinterpret_cast<char*>(pMember), szValue, pKey->m_cubSize);
+			reinterpret_cast<char*>(pMember)[pKey->m_cubSize - 1] = '\0';
+			break;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Parses one "key value" line. Value may be put in double quotes.
+//-----------------------------------------------------------------------------
+static void Config_ParseLine(SteamAPIConfig_t *pConfig, const char *pchLine, const char *pchEnd, bool bRuntimeOnly)
+{
+	const char*	pchKey;
+	const char*	pchValue;
+	size_t		cchKey, cchValue;
+	char		szKey[64];
+
+	// Skip leading whitespace
+	while (pchLine < pchEnd && (*pchLine == ' ' || *pchLine == '\t'))
+		pchLine++;
+
+	// Trim trailing whitespace
+	while (pchEnd > pchLine && (pchEnd[-1] == ' ' || pchEnd[-1] == '\t' || pchEnd[-1] == '\r'))
+		pchEnd--;
+
+	if (pchLine == pchEnd || *pchLine == '#' || (pchEnd - pchLine >= 2 && pchLine[0] == '/' && pchLine[1] == '/'))
+		return;
+
+	pchKey = pchLine;
+
+	while (pchLine < pchEnd && *pchLine != ' ' && *pchLine != '\t')
+		pchLine++;
+
+	cchKey = pchLine - pchKey;
+
+	while (pchLine < pchEnd && (*pchLine == ' ' || *pchLine == '\t'))
+		pchLine++;
+
+	pchValue = pchLine;
+	cchValue = pchEnd - pchLine;
+
+	if (cchValue >= 2 && pchValue[0] == '"' && pchValue[cchValue - 1] == '"')
+	{
+		pchValue++;
+		cchValue -= 2;
+	}
+
+	for (int i = 0; i < Q_ARRAYSIZE(s_ConfigKeys); i++)
+	{
+		if (strlen(s_ConfigKeys[i].m_pszName) != cchKey || strnicmp(s_ConfigKeys[i].m_pszName, pchKey, cchKey))
+			continue;
+
+		// Startup settings stay as they were at init
+		if (bRuntimeOnly && !s_ConfigKeys[i].m_bRuntime)
+			return;
+
+		Config_SetValue(pConfig, &s_ConfigKeys[i], pchValue, cchValue);
+		return;
+	}
+
+	cchKey = min(cchKey, sizeof(szKey) - 1);
+	memcpy(szKey, pchKey, cchKey);
+	szKey[cchKey] = '\0';
+
+	AsyncLog(k_ESteamAPILogWarning, "[S_API] Unknown key '%s' in %s.\n", szKey, s_szConfigPath);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Maps the configuration file and parses it into pConfig. Returns 
+//			false if there's no file.
+//-----------------------------------------------------------------------------
+static bool Config_ParseFile(SteamAPIConfig_t *pConfig, bool bRuntimeOnly)
+{
+	HANDLE		hFile, hMapping;
+	DWORD		dwSize;
+	const char*	pchData;
+	const char*	pchLine;
+	const char*	pchEnd;
+
+	hFile = CreateFileA(s_szConfigPath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	GetFileTime(hFile, NULL, NULL, &s_ConfigWriteTime);
+
+	dwSize = GetFileSize(hFile, NULL);
+
+	// Empty file can't be mapped, but it's valid
+	if (dwSize == 0 || dwSize == INVALID_FILE_SIZE)
+	{
+		CloseHandle(hFile);
+		return true;
+	}
+
+	hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+
+	if (!hMapping)
+	{
+		CloseHandle(hFile);
+		return false;
+	}
+
+	pchData = reinterpret_cast<const char*>(MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0));
+
+	if (pchData)
+	{
+		pchEnd = pchData + dwSize;
+
+		for (pchLine = pchData; pchLine < pchEnd; )
+		{
+			const char* pchNewLine = reinterpret_cast<const char*>(memchr(pchLine, '\n', pchEnd - pchLine));
+
+			if (!pchNewLine)
+				pchNewLine = pchEnd;
+
+			Config_ParseLine(pConfig, pchLine, pchNewLine, bRuntimeOnly);
+			pchLine = pchNewLine + 1;
+		}
+
+		UnmapViewOfFile(pchData);
+	}
+
+	CloseHandle(hMapping);
+	CloseHandle(hFile);
+
+	return pchData != nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Publishes new configuration. The previous one is retired, but not
+//			freed.
+//-----------------------------------------------------------------------------
+static void Config_Publish(SteamAPIConfig_t *pConfig)
+{
+	SteamAPIConfig_t* pOldConfig;
+
+	pOldConfig = reinterpret_cast<SteamAPIConfig_t*>(InterlockedExchangePointer(reinterpret_cast<PVOID volatile*>(&s_pConfig), pConfig));
+
+	if (pOldConfig)
+		s_RetiredConfigs.push_back(pOldConfig);
+
+	AsyncLog_ApplyConfig(pConfig);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Locates and parses the configuration file.
+//-----------------------------------------------------------------------------
+static void Config_Load()
+{
+	SteamAPIConfig_t*	pConfig;
+	DWORD				dwLength;
+
+	dwLength = GetEnvironmentVariableA(k_pszConfigEnvVariable, s_szConfigPath, sizeof(s_szConfigPath));
+
+	if (dwLength == 0 || dwLength >= sizeof(s_szConfigPath))
+		strncpy(s_szConfigPath, k_pszConfigFileName, sizeof(s_szConfigPath));
+
+	s_szConfigPath[sizeof(s_szConfigPath) - 1] = '\0';
+
+	pConfig = new SteamAPIConfig_t;
+
+	Config_SetDefaults(pConfig);
+	Config_ParseFile(pConfig, false);
+
+	Config_Publish(pConfig);
+}
+
+//-----------------------------------------------------------------------------
+// 
+// Configuration C interface
+// 
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns current configuration, the file is parsed on first use.
+//-----------------------------------------------------------------------------
+const SteamAPIConfig_t* SteamAPIConfig()
+{
+	if (!s_pConfig)
+		Config_Load();
+
+	return s_pConfig;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Re-reads the file. Startup settings are kept from the current
+//			configuration, only runtime knobs are taken from the file.
+//-----------------------------------------------------------------------------
+bool Config_Reload()
+{
+	SteamAPIConfig_t* pConfig;
+
+	pConfig = new SteamAPIConfig_t;
+
+	// Start from what we have, so removed runtime keys fall back to defaults
+	// while the startup settings don't move.
+	Config_SetDefaults(pConfig);
+
+	for (int i = 0; i < Q_ARRAYSIZE(s_ConfigKeys); i++)
+	{
+		if (s_ConfigKeys[i].m_bRuntime)
+			continue;
+
+		memcpy(reinterpret_cast<uint8*>(pConfig) + s_ConfigKeys[i].m_nOffset,
+			   reinterpret_cast<const uint8*>(SteamAPIConfig()) + s_ConfigKeys[i].m_nOffset, 
+			   s_ConfigKeys[i].m_cubSize);
+	}
+
+	if (!Config_ParseFile(pConfig, true))
+	{
+		delete pConfig;
+		return false;
+	}
+
+	Config_Publish(pConfig);
+
+	AsyncLog(k_ESteamAPILogInfo, "[S_API] Configuration reloaded.\n");
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Called every frame. Reloads the file once it has been modified.
+//-----------------------------------------------------------------------------
+void Config_CheckForChanges()
+{
+	WIN32_FILE_ATTRIBUTE_DATA	FileData;
+	uint32						unInterval;
+	DWORD						dwTime;
+
+	unInterval = SteamAPIConfig()->m_unReloadInterval;
+
+	if (!unInterval)
+		return;
+
+	dwTime = GetTickCount();
+
+	if ((int)(dwTime - s_dwNextConfigCheckTime) < 0)
+		return;
+
+	s_dwNextConfigCheckTime = dwTime + unInterval;
+
+	if (!GetFileAttributesExA(s_szConfigPath, GetFileExInfoStandard, &FileData))
+		return;
+
+	if (CompareFileTime(&FileData.ftLastWriteTime, &s_ConfigWriteTime) == 0)
+		return;
+
+	Config_Reload();
+}
+
+//-----------------------------------------------------------------------------
+// 
+// Exported configuration API
+// 
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Purpose: See Config_Reload()
+//-----------------------------------------------------------------------------
+bool SteamAPI_ReloadConfig()
+{
+	return Config_Reload();
+}
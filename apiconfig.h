@@ -0,0 +1,120 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+#ifndef API_CONFIG_H
+#define API_CONFIG_H
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Purpose: Settings parsed from steam_api configuration file. Once published,
+//			the structure is never written to. Reload builds a new copy, in
+//			which only the runtime knobs may differ from the previous one.
+//-----------------------------------------------------------------------------
+struct SteamAPIConfig_t
+{
+	//
+	// Startup settings, read only once at init
+	//
+
+	// Used instead of steam_appid.txt when set
+	AppId_t		m_nAppId;
+
+	// Full path to steamclient.dll that should be used instead of the one
+	// that the registry points to
+	char		m_szSteamClientPath[MAX_PATH];
+
+	bool		m_bReconnectMode;
+	bool		m_bCatchExceptionsInCallbacks;
+
+	// Write region filtered dump instead of a full memory one, keep dumps in
+	// the directory and compress them on the next start. Both off by default
+	bool		m_bMinidumpFilter;
+	bool		m_bMinidumpCompress;
+	char		m_szMinidumpDir[MAX_PATH];
+
+	// Out-of-process minidump writer started along with breakpad, none when
+	// empty
+	char		m_szMinidumpHelperPath[MAX_PATH];
+
+	// Diagnostics go to this file instead of stdout and the debugger
+	char		m_szLogFile[MAX_PATH];
+
+	// Publish pump stats for steamapistat, see livestats.h. Off by default,
+	// it costs a named section per process
+	bool		m_bLiveStats;
+
+	// Serialize callback registration and dispatch, so they may be used from
+	// several threads
+	bool		m_bCallbackLocking;
+
+	// Keep personas of friends and seen users in process, see personacache.h.
+	// Off by default, filling it asks steamclient about every friend
+	bool		m_bPersonaCache;
+
+	// Keep avatars in shared atlases, see avatarcache.h. Off by default
+	bool		m_bAvatarCache;
+
+	// Keep the last lobby list and its data in process, see lobbycache.h. Off
+	// by default, every list is read in full when it arrives
+	bool		m_bLobbyCache;
+
+	//
+	// Runtime knobs, these are safe to change on reload
+	//
+
+	// Maximum number of messages and time in microseconds spent in one
+	// callback pump, the rest is left for the next frame. 0 means no limit.
+	uint32		m_unPumpMaxMessages;
+	uint32		m_unPumpBudget;
+
+	// Default drain time of fast shutdown in milliseconds
+	uint32		m_unShutdownDrainTimeout;
+
+	// How often to check the file for changes in milliseconds, 0 disables
+	uint32		m_unReloadInterval;
+
+	// Lowest severity logged, see ESteamAPILogSeverity
+	uint32		m_unLogLevel;
+
+	// API calls completing later than this many milliseconds are logged, 0
+	// disables
+	uint32		m_unSlowCallThreshold;
+
+	// Callback handlers running longer than the warn time in microseconds
+	// are logged. Handlers over the limit this many times are deferred to
+	// the end of the pump, where they run within the deferred budget, until
+	// they're fast again. 0 disables each, strikes are off by default so
+	// slow handlers are only reported.
+	uint32		m_unHandlerWarnTime;
+	uint32		m_unHandlerLimitTime;
+	uint32		m_unHandlerStrikes;
+	uint32		m_unDeferredBudget;
+
+	// Registries and pools are compacted once the pump hasn't dispatched
+	// anything for this many milliseconds, 0 disables
+	uint32		m_unIdleCompactTime;
+
+	// Prefetched auth tickets nobody took are cancelled after this many
+	// seconds, 0 disables prefetching
+	uint32		m_unAuthTicketLifetime;
+};
+
+//-----------------------------------------------------------------------------
+// 
+// Configuration C interface
+// 
+//-----------------------------------------------------------------------------
+
+extern const SteamAPIConfig_t* SteamAPIConfig();
+extern bool Config_Reload();
+extern void Config_CheckForChanges();
+
+//-----------------------------------------------------------------------------
+// Purpose: Re-reads the configuration file, applies only runtime knobs.
+//-----------------------------------------------------------------------------
+S_API bool SteamAPI_ReloadConfig();
+
+#endif
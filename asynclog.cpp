@@ -0,0 +1,494 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "steam_api_pch.h"
+#include "asynclog.h"
+#include "apiconfig.h"
+#include "memfootprint.h"
+
+//-----------------------------------------------------------------------------
+// 
+// Asynchronous logger
+// 
+//	Each thread writes compact binary records into its own ring, there's
+//	a single producer and a single consumer per ring, so no locks are taken.
+//	A background thread formats the records and writes them to the callback,
+//	the log file or stdout and the debugger, so a blocked pipe never stalls
+//	the game.
+// 
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Purpose: Record header, followed by the arguments and copied strings. 
+//			Records never wrap around the ring end, the space left there is
+//			skipped with a record without format.
+//-----------------------------------------------------------------------------
+struct LogRecord_t
+{
+	uint32			m_cubRecord;
+	uint8			m_eSeverity;
+	uint8			m_nArgs;
+	uint16			m_unPad;
+	DWORD			m_dwTime;
+	const char*		m_pszFormat;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Argument as stored in the record. Strings keep offset of their
+//			copy from the start of the record.
+//-----------------------------------------------------------------------------
+struct LogRecordArg_t
+{
+	uint32			m_eType;
+	uint32			m_unPad;
+	uint64			m_ullValue;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Ring of one thread. Rings are never freed, threads come and go 
+//			far less often than they log.
+//-----------------------------------------------------------------------------
+struct AsyncLogRing_t
+{
+	AsyncLogRing_t*		m_pNext;
+
+	// Total bytes written and consumed
+	volatile uint32		m_unHead;
+	volatile uint32		m_unTail;
+
+	// Records that didn't fit
+	volatile LONG		m_nDropped;
+
+	uint8				m_Buffer[ASYNCLOG_RING_SIZE];
+};
+
+volatile LONG						g_nAsyncLogLevel = k_ESteamAPILogInfo;
+
+static INIT_ONCE					s_AsyncLogInitOnce = INIT_ONCE_STATIC_INIT;
+static DWORD						s_dwRingTlsIndex = TLS_OUT_OF_INDEXES;
+static AsyncLogRing_t* volatile		s_pRings = nullptr;
+
+static SRWLOCK						s_DrainLock = SRWLOCK_INIT;
+static HANDLE						s_hDrainThread = NULL;
+
+static pfnSteamAPILogCallback_t volatile	s_pfnLogCallback = nullptr;
+
+// Log file from the configuration, opened by the drain thread
+static char							s_szLogFile[MAX_PATH] = { '\0' };
+static FILE*						s_pLogFile = nullptr;
+
+static DWORD WINAPI AsyncLog_DrainThread(LPVOID pvParam);
+
+//-----------------------------------------------------------------------------
+// Purpose: Allocates TLS slot and starts the drain thread, once.
+//-----------------------------------------------------------------------------
+static BOOL CALLBACK AsyncLog_Init(PINIT_ONCE pInitOnce, PVOID pvParam, PVOID *ppvContext)
+{
+	s_dwRingTlsIndex = TlsAlloc();
+	s_hDrainThread = CreateThread(NULL, 0, AsyncLog_DrainThread, NULL, 0, NULL);
+
+	return TRUE;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns ring of the calling thread, creates it on first use.
+//-----------------------------------------------------------------------------
+static AsyncLogRing_t* AsyncLog_GetThreadRing()
+{
+	AsyncLogRing_t* pRing;
+
+	InitOnceExecuteOnce(&s_AsyncLogInitOnce, AsyncLog_Init, NULL, NULL);
+
+	if (s_dwRingTlsIndex == TLS_OUT_OF_INDEXES)
+		return nullptr;
+
+	pRing = reinterpret_cast<AsyncLogRing_t*>(TlsGetValue(s_dwRingTlsIndex));
+
+	if (pRing)
+		return pRing;
+
+	pRing = reinterpret_cast<AsyncLogRing_t*>(calloc(1, sizeof(AsyncLogRing_t)));
+
+	if (!pRing)
+		return nullptr;
+
+	TlsSetValue(s_dwRingTlsIndex, pRing);
+
+	// Push it to the list the drain thread walks
+	do
+	{
+		pRing->m_pNext = s_pRings;
+	}
+	while (InterlockedCompareExchangePointer(reinterpret_cast<PVOID volatile*>(&s_pRings), pRing, pRing->m_pNext) != pRing->m_pNext);
+
+	return pRing;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Serializes message into the calling thread's ring.
+//-----------------------------------------------------------------------------
+void AsyncLog_Write(ESteamAPILogSeverity eSeverity, const char *pszFormat, const LogArg_t *pArgs, int nArgs)
+{
+	uint8				Record[ASYNCLOG_MAX_RECORD];
+	LogRecord_t*		pRecord;
+	LogRecordArg_t*		pRecordArgs;
+	AsyncLogRing_t*		pRing;
+	uint32				cubRecord, unHead, unOffset, cubSkip;
+	int					i, nStrings;
+
+	pRing = AsyncLog_GetThreadRing();
+
+	if (!pRing)
+		return;
+
+	nArgs = min(nArgs, ASYNCLOG_MAX_ARGS);
+
+	pRecord = reinterpret_cast<LogRecord_t*>(Record);
+	pRecordArgs = reinterpret_cast<LogRecordArg_t*>(pRecord + 1);
+
+	pRecord->m_eSeverity = (uint8)eSeverity;
+	pRecord->m_nArgs = (uint8)nArgs;
+	pRecord->m_unPad = 0;
+	pRecord->m_dwTime = GetTickCount();
+	pRecord->m_pszFormat = pszFormat;
+
+	cubRecord = sizeof(LogRecord_t) + nArgs * sizeof(LogRecordArg_t);
+
+	// Terminators of the strings not copied yet stay reserved, so that a long
+	// string can't push the following ones past the record
+	nStrings = 0;
+
+	for (i = 0; i < nArgs; i++)
+	{
+		if (pArgs[i].m_eType == k_ELogArgString)
+			nStrings++;
+	}
+
+	for (i = 0; i < nArgs; i++)
+	{
+		pRecordArgs[i].m_eType = pArgs[i].m_eType;
+		pRecordArgs[i].m_unPad = 0;
+		pRecordArgs[i].m_ullValue = pArgs[i].m_ullValue;
+
+		if (pArgs[i].m_eType != k_ELogArgString)
+			continue;
+
+		// Caller's string may be gone by the time we format, keep a copy
+		pRecordArgs[i].m_ullValue = cubRecord;
+
+		for (const char* pszIn = pArgs[i].m_pszValue ? pArgs[i].m_pszValue : "(null)"; *pszIn && cubRecord < sizeof(Record) - nStrings; )
+			Record[cubRecord++] = *pszIn++;
+
+		Record[cubRecord++] = '\0';
+		nStrings--;
+	}
+
+	cubRecord = min((cubRecord + 7) & ~7, (uint32)sizeof(Record));
+	pRecord->m_cubRecord = cubRecord;
+
+	unHead = pRing->m_unHead;
+	unOffset = unHead % ASYNCLOG_RING_SIZE;
+
+	// Doesn't fit before the end, skip the rest of the ring
+	cubSkip = (ASYNCLOG_RING_SIZE - unOffset < cubRecord) ? ASYNCLOG_RING_SIZE - unOffset : 0;
+
+	if (unHead + cubSkip + cubRecord - pRing->m_unTail > ASYNCLOG_RING_SIZE)
+	{
+		InterlockedIncrement(&pRing->m_nDropped);
+		return;
+	}
+
+	if (cubSkip)
+	{
+		// Too little space even for the header is skipped by the reader too
+		if (cubSkip >= sizeof(LogRecord_t))
+		{
+			LogRecord_t* pSkip = reinterpret_cast<LogRecord_t*>(&pRing->m_Buffer[unOffset]);
+
+			pSkip->m_cubRecord = cubSkip;
+			pSkip->m_pszFormat = nullptr;
+		}
+
+		unHead += cubSkip;
+		unOffset = 0;
+	}
+
+	memcpy(&pRing->m_Buffer[unOffset], Record, cubRecord);
+
+	_WriteBarrier();
+	pRing->m_unHead = unHead + cubRecord;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Formats record the printf way. Each conversion is formatted on its
+//			own, with the length modifier replaced to match the stored value.
+//-----------------------------------------------------------------------------
+static void AsyncLog_Format(const LogRecord_t *pRecord, char *pszOut, size_t cchOut)
+{
+	const LogRecordArg_t*	pRecordArgs;
+	const char*				pszFormat;
+	char*					pszEnd;
+	char					szSpec[32];
+	int						iArg, cchSpec, cchWritten;
+	char					chConversion;
+
+	pRecordArgs = reinterpret_cast<const LogRecordArg_t*>(pRecord + 1);
+	pszFormat = pRecord->m_pszFormat;
+	pszEnd = pszOut + cchOut - 1;
+	iArg = 0;
+
+	while (*pszFormat && pszOut < pszEnd)
+	{
+		if (*pszFormat != '%')
+		{
+			*pszOut++ = *pszFormat++;
+			continue;
+		}
+
+		if (pszFormat[1] == '%')
+		{
+			*pszOut++ = '%';
+			pszFormat += 2;
+			continue;
+		}
+
+		// Flags, width and precision are kept, length modifiers dropped. Width
+		// and precision passed as arguments ('*') aren't supported.
+		cchSpec = 0;
+		szSpec[cchSpec++] = *pszFormat++;
+
+		while (*pszFormat && strchr("-+ #0123456789.", *pszFormat) && cchSpec < (int)sizeof(szSpec) - 4)
+			szSpec[cchSpec++] = *pszFormat++;
+
+		while (*pszFormat && strchr("hlLqjztI3264", *pszFormat))
+			pszFormat++;
+
+		chConversion = *pszFormat;
+
+		if (!chConversion)
+			break;
+
+		pszFormat++;
+
+		if (iArg >= pRecord->m_nArgs)
+			continue;
+
+		const LogRecordArg_t* pArg = &pRecordArgs[iArg++];
+
+		switch (chConversion)
+		{
+			case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+				szSpec[cchSpec++] = 'l';
+				szSpec[cchSpec++] = 'l';
+				szSpec[cchSpec++] = chConversion;
+				szSpec[cchSpec] = '\0';
+				cchWritten = _snprintf(pszOut, pszEnd - pszOut, szSpec, pArg->m_ullValue);
+				break;
+
+			case 'c':
+				szSpec[cchSpec++] = chConversion;
+				szSpec[cchSpec] = '\0';
+				cchWritten = _snprintf(pszOut, pszEnd - pszOut, szSpec, (int)pArg->m_ullValue);
+				break;
+
+			case 'e': case 'E': case 'f': case 'g': case 'G':
+				szSpec[cchSpec++] = chConversion;
+				szSpec[cchSpec] = '\0';
+				cchWritten = _snprintf(pszOut, pszEnd - pszOut, szSpec, 
+									   pArg->m_eType == k_ELogArgDouble ? *reinterpret_cast<const double*>(&pArg->m_ullValue) : (double)pArg->m_ullValue);
+				break;
+
+			case 's':
+				szSpec[cchSpec++] = chConversion;
+				szSpec[cchSpec] = '\0';
+				cchWritten = _snprintf(pszOut, pszEnd - pszOut, szSpec, 
+									   pArg->m_eType == k_ELogArgString ? reinterpret_cast<const char*>(pRecord) + pArg->m_ullValue : "?");
+				break;
+
+			default:
+				szSpec[cchSpec++] = 'p';
+				szSpec[cchSpec] = '\0';
+				cchWritten = _snprintf(pszOut, pszEnd - pszOut, szSpec, (const void*)(uintptr_t)pArg->m_ullValue);
+				break;
+		}
+
+		// Truncated
+		if (cchWritten < 0)
+		{
+			pszOut = pszEnd;
+			break;
+		}
+
+		pszOut += cchWritten;
+	}
+
+	*pszOut = '\0';
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Writes formatted message to wherever the log goes.
+//-----------------------------------------------------------------------------
+static void AsyncLog_Output(ESteamAPILogSeverity eSeverity, DWORD dwTime, const char *pszMessage)
+{
+	pfnSteamAPILogCallback_t pfnCallback = s_pfnLogCallback;
+
+	if (pfnCallback)
+	{
+		pfnCallback(eSeverity, pszMessage);
+		return;
+	}
+
+	if (!s_pLogFile && s_szLogFile[0])
+		s_pLogFile = fopen(s_szLogFile, "a");
+
+	if (s_pLogFile)
+	{
+		fprintf(s_pLogFile, "%10u %s", dwTime, pszMessage);
+		return;
+	}
+
+	fputs(pszMessage, stdout);
+	OutputDebugStringA(pszMessage);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Consumes every ring. Only one thread drains at a time, so every
+//			ring keeps a single consumer.
+//-----------------------------------------------------------------------------
+static void AsyncLog_Drain()
+{
+	AsyncLogRing_t*	pRing;
+	LogRecord_t*	pRecord;
+	uint32			unHead, unTail, unOffset;
+	LONG			nDropped;
+	char			szMessage[ASYNCLOG_MAX_RECORD];
+	bool			bWritten;
+
+	AcquireSRWLockExclusive(&s_DrainLock);
+
+	bWritten = false;
+
+	for (pRing = s_pRings; pRing; pRing = pRing->m_pNext)
+	{
+		unHead = pRing->m_unHead;
+		_ReadBarrier();
+
+		for (unTail = pRing->m_unTail; unTail != unHead; unTail += pRecord->m_cubRecord)
+		{
+			unOffset = unTail % ASYNCLOG_RING_SIZE;
+
+			// Tail of the ring too short for a header, writer wrapped around
+			if (ASYNCLOG_RING_SIZE - unOffset < sizeof(LogRecord_t))
+			{
+				unTail += ASYNCLOG_RING_SIZE - unOffset;
+				unOffset = 0;
+			}
+
+			pRecord = reinterpret_cast<LogRecord_t*>(&pRing->m_Buffer[unOffset]);
+
+			if (!pRecord->m_pszFormat)
+				continue;
+
+			AsyncLog_Format(pRecord, szMessage, sizeof(szMessage));
+			AsyncLog_Output((ESteamAPILogSeverity)pRecord->m_eSeverity, pRecord->m_dwTime, szMessage);
+
+			bWritten = true;
+		}
+
+		_ReadWriteBarrier();
+		pRing->m_unTail = unTail;
+
+		nDropped = InterlockedExchange(&pRing->m_nDropped, 0);
+
+		if (nDropped)
+		{
+			_snprintf(szMessage, sizeof(szMessage), "[S_API] %d log messages dropped, ring full.\n", nDropped);
+			szMessage[sizeof(szMessage) - 1] = '\0';
+
+			AsyncLog_Output(k_ESteamAPILogWarning, GetTickCount(), szMessage);
+			bWritten = true;
+		}
+	}
+
+	if (bWritten)
+		fflush(s_pLogFile ? s_pLogFile : stdout);
+
+	ReleaseSRWLockExclusive(&s_DrainLock);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Background thread, drains the rings periodically.
+//-----------------------------------------------------------------------------
+static DWORD WINAPI AsyncLog_DrainThread(LPVOID pvParam)
+{
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+
+	for (;;)
+	{
+		Sleep(ASYNCLOG_DRAIN_INTERVAL);
+		AsyncLog_Drain();
+	}
+
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Writes out everything recorded so far from the calling thread. 
+//			Used at shutdown, when the process may exit before the next drain.
+//-----------------------------------------------------------------------------
+void AsyncLog_Flush()
+{
+	if (!s_pRings)
+		return;
+
+	AsyncLog_Drain();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Takes log settings from newly published configuration. Log file 
+//			is a startup setting, only the first one is used.
+//-----------------------------------------------------------------------------
+void AsyncLog_ApplyConfig(const SteamAPIConfig_t *pConfig)
+{
+	InterlockedExchange(&g_nAsyncLogLevel, (LONG)pConfig->m_unLogLevel);
+
+	if (!s_szLogFile[0] && pConfig->m_szLogFile[0])
+	{
+		strncpy(s_szLogFile, pConfig->m_szLogFile, sizeof(s_szLogFile));
+		s_szLogFile[sizeof(s_szLogFile) - 1] = '\0';
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Rings of every thread that has logged, used bytes are records 
+//			not yet drained.
+//-----------------------------------------------------------------------------
+void AsyncLog_GetMemoryUsage(SteamAPIMemoryUsage_t *pUsage)
+{
+	memset(pUsage, 0, sizeof(SteamAPIMemoryUsage_t));
+
+	for (AsyncLogRing_t* pRing = s_pRings; pRing; pRing = pRing->m_pNext)
+	{
+		pUsage->m_nEntries++;
+		pUsage->m_cubUsed += pRing->m_unHead - pRing->m_unTail;
+		pUsage->m_cubReserved += sizeof(AsyncLogRing_t);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// 
+// Async log interface
+// 
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Purpose: Redirects log output to the callback.
+//-----------------------------------------------------------------------------
+void SteamAPI_SetLogCallback(pfnSteamAPILogCallback_t pfnCallback)
+{
+	InterlockedExchangePointer(reinterpret_cast<PVOID volatile*>(&s_pfnLogCallback), reinterpret_cast<PVOID>(pfnCallback));
+}
@@ -0,0 +1,114 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+#ifndef ASYNC_LOG_H
+#define ASYNC_LOG_H
+#pragma once
+
+struct SteamAPIConfig_t;
+struct SteamAPIMemoryUsage_t;
+
+//-----------------------------------------------------------------------------
+// Purpose: Severity of log messages, messages below the log_level configuration
+//			key are dropped before they are recorded.
+//-----------------------------------------------------------------------------
+enum ESteamAPILogSeverity
+{
+	k_ESteamAPILogDebug = 0,
+	k_ESteamAPILogInfo = 1,
+	k_ESteamAPILogWarning = 2,
+	k_ESteamAPILogError = 3,
+};
+
+typedef void (*pfnSteamAPILogCallback_t)(ESteamAPILogSeverity eSeverity, const char *pszMessage);
+
+//-----------------------------------------------------------------------------
+// Purpose: Size of each thread's ring and limits of one record.
+//-----------------------------------------------------------------------------
+#define ASYNCLOG_RING_SIZE			(64 * 1024)
+#define ASYNCLOG_MAX_RECORD			2048
+#define ASYNCLOG_MAX_ARGS			12
+
+// How often the background thread looks into the rings, in milliseconds
+#define ASYNCLOG_DRAIN_INTERVAL		50
+
+//-----------------------------------------------------------------------------
+// Purpose: Argument of a log message. Formatting is done by the drain thread,
+//			only the values are recorded. Strings are copied into the record.
+//-----------------------------------------------------------------------------
+enum ELogArgType
+{
+	k_ELogArgInt,
+	k_ELogArgUint,
+	k_ELogArgDouble,
+	k_ELogArgString,
+	k_ELogArgPointer,
+};
+
+struct LogArg_t
+{
+	uint32				m_eType;
+	union
+	{
+		int64			m_llValue;
+		uint64			m_ullValue;
+		double			m_flValue;
+		const char*		m_pszValue;
+		const void*		m_pvValue;
+	};
+};
+
+inline LogArg_t LogArg(int64 llValue)				{ LogArg_t Arg; Arg.m_eType = k_ELogArgInt; Arg.m_llValue = llValue; return Arg; }
+inline LogArg_t LogArg(int nValue)					{ return LogArg((int64)nValue); }
+inline LogArg_t LogArg(long nValue)					{ return LogArg((int64)nValue); }
+inline LogArg_t LogArg(uint64 ullValue)				{ LogArg_t Arg; Arg.m_eType = k_ELogArgUint; Arg.m_ullValue = ullValue; return Arg; }
+inline LogArg_t LogArg(unsigned int unValue)		{ return LogArg((uint64)unValue); }
+inline LogArg_t LogArg(unsigned long unValue)		{ return LogArg((uint64)unValue); }
+inline LogArg_t LogArg(bool bValue)					{ return LogArg((uint64)bValue); }
+inline LogArg_t LogArg(double flValue)				{ LogArg_t Arg; Arg.m_eType = k_ELogArgDouble; Arg.m_flValue = flValue; return Arg; }
+inline LogArg_t LogArg(const char *pszValue)		{ LogArg_t Arg; Arg.m_eType = k_ELogArgString; Arg.m_pszValue = pszValue; return Arg; }
+inline LogArg_t LogArg(char *pszValue)				{ return LogArg((const char*)pszValue); }
+
+template <typename T>
+inline LogArg_t LogArg(T *pValue)					{ LogArg_t Arg; Arg.m_eType = k_ELogArgPointer; Arg.m_pvValue = pValue; return Arg; }
+
+//-----------------------------------------------------------------------------
+// 
+// Async log C interface
+// 
+//-----------------------------------------------------------------------------
+
+// Lowest severity that gets recorded, follows the configuration
+extern volatile LONG g_nAsyncLogLevel;
+
+extern void AsyncLog_Write(ESteamAPILogSeverity eSeverity, const char *pszFormat, const LogArg_t *pArgs, int nArgs);
+extern void AsyncLog_Flush();
+extern void AsyncLog_ApplyConfig(const SteamAPIConfig_t *pConfig);
+extern void AsyncLog_GetMemoryUsage(SteamAPIMemoryUsage_t *pUsage);
+
+//-----------------------------------------------------------------------------
+// Purpose: Records printf-style message into the calling thread's ring. Never
+//			blocks, the message is dropped when the ring is full. Format has to
+//			be a string literal, only the pointer is recorded.
+//-----------------------------------------------------------------------------
+template <typename... Args>
+inline void AsyncLog(ESteamAPILogSeverity eSeverity, const char *pszFormat, Args... args)
+{
+	if ((LONG)eSeverity < g_nAsyncLogLevel)
+		return;
+
+	const LogArg_t LogArgs[] = { LogArg(args)..., LogArg_t() };
+
+	AsyncLog_Write(eSeverity, pszFormat, LogArgs, (int)sizeof...(args));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Redirects log output to the callback, called from the log thread.
+//			Passing nullptr restores the default output.
+//-----------------------------------------------------------------------------
+S_API void SteamAPI_SetLogCallback(pfnSteamAPILogCallback_t pfnCallback);
+
+#endif
@@ -0,0 +1,322 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "steam_api_pch.h"
+#include "authtickets.h"
+#include "interfacecache.h"
+#include "apiconfig.h"
+#include "asynclog.h"
+
+//-----------------------------------------------------------------------------
+// 
+// Auth ticket prefetcher
+// 
+//	Tickets aren't bound to a server, but the one prefetched for the selected
+//	server is the one most likely to be used, so each is kept along with the
+//	address it was asked for. Taking a ticket for another server still gets
+//	a prefetched one if it's ready, the rest expire.
+// 
+//-----------------------------------------------------------------------------
+
+// Tickets kept at once, the oldest is cancelled to make room
+#define AUTHTICKETS_MAX			4
+
+// Steam limits tickets to about 1 KB
+#define AUTHTICKETS_MAX_SIZE	1024
+
+//-----------------------------------------------------------------------------
+// Purpose: State of a prefetched ticket
+//-----------------------------------------------------------------------------
+enum EAuthTicketState
+{
+	k_EAuthTicketFree = 0,
+	k_EAuthTicketPending,		// Waiting for GetAuthSessionTicketResponse_t
+	k_EAuthTicketReady,
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Prefetched ticket
+//-----------------------------------------------------------------------------
+struct AuthTicket_t
+{
+	EAuthTicketState	m_eState;
+	HAuthTicket			m_hAuthTicket;
+	uint32				m_unServerIP;
+	uint16				m_usServerPort;
+	DWORD				m_dwRequestTime;
+	uint32				m_cubTicket;
+	uint8				m_ubTicket[AUTHTICKETS_MAX_SIZE];
+};
+
+static AuthTicket_t					s_AuthTickets[AUTHTICKETS_MAX];
+static SteamAPIAuthTicketStats_t	s_AuthTicketStats;
+
+//-----------------------------------------------------------------------------
+// Purpose: User interface of the global user
+//-----------------------------------------------------------------------------
+static ISteamUser* AuthTickets_GetSteamUser()
+{
+	return static_cast<ISteamUser*>(InterfaceCache_FindOrCreate(g_pSteamClient, g_hSteamUser, g_hSteamPipe, STEAMUSER_INTERFACE_VERSION));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Cancels the ticket with steam and frees the slot
+//-----------------------------------------------------------------------------
+static void AuthTickets_Cancel(AuthTicket_t *pTicket)
+{
+	ISteamUser *pSteamUser;
+
+	pSteamUser = AuthTickets_GetSteamUser();
+
+	if (pSteamUser && pTicket->m_hAuthTicket != k_HAuthTicketInvalid)
+		pSteamUser->CancelAuthTicket(pTicket->m_hAuthTicket);
+
+	pTicket->m_eState = k_EAuthTicketFree;
+	pTicket->m_hAuthTicket = k_HAuthTicketInvalid;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns ticket prefetched for the server
+//-----------------------------------------------------------------------------
+static AuthTicket_t* AuthTickets_Find(uint32 unServerIP, uint16 usServerPort)
+{
+	int i;
+
+	for (i = 0; i < AUTHTICKETS_MAX; i++)
+	{
+		if (s_AuthTickets[i].m_eState != k_EAuthTicketFree && s_AuthTickets[i].m_unServerIP == unServerIP && s_AuthTickets[i].m_usServerPort == usServerPort)
+			return &s_AuthTickets[i];
+	}
+
+	return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Moves ticket data to the caller and gives the ticket away
+//-----------------------------------------------------------------------------
+static HAuthTicket AuthTickets_HandOut(AuthTicket_t *pTicket, void *pDest, int cbMaxTicket, uint32 *pcbTicket)
+{
+	HAuthTicket hAuthTicket;
+
+	if ((int)pTicket->m_cubTicket > cbMaxTicket)
+		return k_HAuthTicketInvalid;
+
+	memcpy(pDest, pTicket->m_ubTicket, pTicket->m_cubTicket);
+	*pcbTicket = pTicket->m_cubTicket;
+
+	hAuthTicket = pTicket->m_hAuthTicket;
+
+	pTicket->m_eState = k_EAuthTicketFree;
+	pTicket->m_hAuthTicket = k_HAuthTicketInvalid;
+
+	s_AuthTicketStats.m_nHandedOut++;
+
+	return hAuthTicket;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Steam has validated the ticket, or refused it
+//-----------------------------------------------------------------------------
+static void AuthTickets_OnTicketResponse(HSteamPipe hSteamPipe, int iCallback, void *pvParam, int cubParam)
+{
+	GetAuthSessionTicketResponse_t	*pResponse;
+	int								i;
+
+	// Ticket handles are per user, the game server's ones aren't ours
+	if (hSteamPipe != g_hSteamPipe || cubParam < (int)sizeof(GetAuthSessionTicketResponse_t))
+		return;
+
+	pResponse = (GetAuthSessionTicketResponse_t*)pvParam;
+
+	for (i = 0; i < AUTHTICKETS_MAX; i++)
+	{
+		if (s_AuthTickets[i].m_eState != k_EAuthTicketPending || s_AuthTickets[i].m_hAuthTicket != pResponse->m_hAuthTicket)
+			continue;
+
+		if (pResponse->m_eResult == k_EResultOK)
+		{
+			s_AuthTickets[i].m_eState = k_EAuthTicketReady;
+		}
+		else
+		{
+			AsyncLog(k_ESteamAPILogWarning, "[S_API] Prefetched auth ticket %u failed with result %d.\n", pResponse->m_hAuthTicket, pResponse->m_eResult);
+
+			s_AuthTicketStats.m_nFailed++;
+			AuthTickets_Cancel(&s_AuthTickets[i]);
+		}
+
+		break;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Starts listening for ticket responses
+//-----------------------------------------------------------------------------
+void AuthTickets_Init()
+{
+	CallbackMgr_AddObserver(GetAuthSessionTicketResponse_t::k_iCallback, AuthTickets_OnTicketResponse);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Cancels tickets nobody took within their lifetime, called at the
+//			end of every pump
+//-----------------------------------------------------------------------------
+void AuthTickets_OnPump()
+{
+	uint32	unLifetime;
+	DWORD	dwTime;
+	int		i;
+
+	unLifetime = SteamAPIConfig()->m_unAuthTicketLifetime * 1000;
+	dwTime = GetTickCount();
+
+	for (i = 0; i < AUTHTICKETS_MAX; i++)
+	{
+		if (s_AuthTickets[i].m_eState == k_EAuthTicketFree || dwTime - s_AuthTickets[i].m_dwRequestTime < unLifetime)
+			continue;
+
+		s_AuthTicketStats.m_nExpired++;
+		AuthTickets_Cancel(&s_AuthTickets[i]);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Forgets tickets of a pipe that is gone, there's nobody to cancel
+//			them with
+//-----------------------------------------------------------------------------
+void AuthTickets_Invalidate()
+{
+	int i;
+
+	for (i = 0; i < AUTHTICKETS_MAX; i++)
+	{
+		s_AuthTickets[i].m_eState = k_EAuthTicketFree;
+		s_AuthTickets[i].m_hAuthTicket = k_HAuthTicketInvalid;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Cancels unused tickets, must be called before the user is
+//			released
+//-----------------------------------------------------------------------------
+void AuthTickets_Shutdown()
+{
+	int i;
+
+	CallbackMgr_RemoveObserver(GetAuthSessionTicketResponse_t::k_iCallback, AuthTickets_OnTicketResponse);
+
+	for (i = 0; i < AUTHTICKETS_MAX; i++)
+	{
+		if (s_AuthTickets[i].m_eState != k_EAuthTicketFree)
+			AuthTickets_Cancel(&s_AuthTickets[i]);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// 
+// Auth ticket interface
+// 
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Purpose: Asks steam for a ticket to connect to the server with, unless
+//			there already is one.
+//-----------------------------------------------------------------------------
+void SteamAPI_PrefetchAuthTicket(uint32 unServerIP, uint16 usServerPort)
+{
+	AuthTicket_t	*pTicket;
+	ISteamUser		*pSteamUser;
+	int				i;
+
+	if (!SteamAPIConfig()->m_unAuthTicketLifetime || AuthTickets_Find(unServerIP, usServerPort))
+		return;
+
+	pSteamUser = AuthTickets_GetSteamUser();
+
+	if (!pSteamUser)
+		return;
+
+	pTicket = nullptr;
+
+	for (i = 0; i < AUTHTICKETS_MAX; i++)
+	{
+		if (s_AuthTickets[i].m_eState == k_EAuthTicketFree)
+		{
+			pTicket = &s_AuthTickets[i];
+			break;
+		}
+
+		// User is clicking through the list, the oldest goes
+		if (!pTicket || (LONG)(s_AuthTickets[i].m_dwRequestTime - pTicket->m_dwRequestTime) < 0)
+			pTicket = &s_AuthTickets[i];
+	}
+
+	if (pTicket->m_eState != k_EAuthTicketFree)
+	{
+		s_AuthTicketStats.m_nExpired++;
+		AuthTickets_Cancel(pTicket);
+	}
+
+	pTicket->m_hAuthTicket = pSteamUser->GetAuthSessionTicket(pTicket->m_ubTicket, sizeof(pTicket->m_ubTicket), &pTicket->m_cubTicket);
+
+	if (pTicket->m_hAuthTicket == k_HAuthTicketInvalid)
+		return;
+
+	pTicket->m_eState = k_EAuthTicketPending;
+	pTicket->m_unServerIP = unServerIP;
+	pTicket->m_usServerPort = usServerPort;
+	pTicket->m_dwRequestTime = GetTickCount();
+
+	s_AuthTicketStats.m_nPrefetched++;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns ticket to connect to the server with, like
+//			GetAuthSessionTicket(). Ticket prefetched for the server is used
+//			first, then any ready one, and only then steam is asked.
+//-----------------------------------------------------------------------------
+HAuthTicket SteamAPI_TakeAuthTicket(uint32 unServerIP, uint16 usServerPort, void *pTicket, int cbMaxTicket, uint32 *pcbTicket)
+{
+	AuthTicket_t	*pAuthTicket;
+	ISteamUser		*pSteamUser;
+	int				i;
+
+	if (!pTicket || !pcbTicket)
+		return k_HAuthTicketInvalid;
+
+	pAuthTicket = AuthTickets_Find(unServerIP, usServerPort);
+
+	// Ticket data is usable before steam has confirmed it
+	if (pAuthTicket)
+		return AuthTickets_HandOut(pAuthTicket, pTicket, cbMaxTicket, pcbTicket);
+
+	for (i = 0; i < AUTHTICKETS_MAX; i++)
+	{
+		if (s_AuthTickets[i].m_eState == k_EAuthTicketReady)
+			return AuthTickets_HandOut(&s_AuthTickets[i], pTicket, cbMaxTicket, pcbTicket);
+	}
+
+	pSteamUser = AuthTickets_GetSteamUser();
+
+	if (!pSteamUser)
+		return k_HAuthTicketInvalid;
+
+	s_AuthTicketStats.m_nFetchedOnConnect++;
+
+	return pSteamUser->GetAuthSessionTicket(pTicket, cbMaxTicket, pcbTicket);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Counters since init
+//-----------------------------------------------------------------------------
+void SteamAPI_GetAuthTicketStats(SteamAPIAuthTicketStats_t *pStats)
+{
+	if (!pStats)
+		return;
+
+	*pStats = s_AuthTicketStats;
+}
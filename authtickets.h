@@ -0,0 +1,48 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+#ifndef AUTH_TICKETS_H
+#define AUTH_TICKETS_H
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Purpose: Counters of the ticket prefetcher
+//-----------------------------------------------------------------------------
+struct SteamAPIAuthTicketStats_t
+{
+	uint32		m_nPrefetched;
+	uint32		m_nHandedOut;			// Connects served by a prefetched ticket
+	uint32		m_nFetchedOnConnect;	// Connects that had to ask steam
+	uint32		m_nExpired;				// Cancelled unused
+	uint32		m_nFailed;				// Steam rejected the ticket
+};
+
+//-----------------------------------------------------------------------------
+// 
+// Auth ticket C interface
+// 
+//-----------------------------------------------------------------------------
+
+extern void AuthTickets_Init();
+extern void AuthTickets_OnPump();
+extern void AuthTickets_Invalidate();
+extern void AuthTickets_Shutdown();
+
+//-----------------------------------------------------------------------------
+// Purpose: Auth ticket prefetch API. The server browser prefetches a ticket
+//			when a server is selected, so GetAuthSessionTicket() and the wait
+//			for GetAuthSessionTicketResponse_t are off the connect path.
+//			Tickets unused for auth_ticket_lifetime_s are cancelled. A ticket
+//			that was taken belongs to the game, which cancels it once it
+//			leaves the server, as with GetAuthSessionTicket().
+// 
+//			Has to be called from the thread that runs callbacks.
+//-----------------------------------------------------------------------------
+S_API void SteamAPI_PrefetchAuthTicket(uint32 unServerIP, uint16 usServerPort);
+S_API HAuthTicket SteamAPI_TakeAuthTicket(uint32 unServerIP, uint16 usServerPort, void *pTicket, int cbMaxTicket, uint32 *pcbTicket);
+S_API void SteamAPI_GetAuthTicketStats(SteamAPIAuthTicketStats_t *pStats);
+
+#endif
@@ -0,0 +1,684 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "steam_api_pch.h"
+#include "avatarcache.h"
+#include "memfootprint.h"
+#include "interfacecache.h"
+#include "apiconfig.h"
+#include "asynclog.h"
+
+//-----------------------------------------------------------------------------
+// 
+// Avatar cache
+// 
+//	Avatars are square and of fixed size, so every size gets one atlas cut
+//	into equal cells. A user keeps the same cell, and so the same UVs, until
+//	the atlas is full and the user is the one looked up least recently.
+//	Pixels are copied out of steamclient when the user is first looked up
+//	and then only when steam reports the avatar has loaded or changed.
+// 
+//-----------------------------------------------------------------------------
+
+// Width and height of every atlas in pixels
+#define AVATARCACHE_ATLAS_SIZE		1024
+
+// Cell of users that don't have an avatar
+#define AVATARCACHE_NO_CELL			0xFFFFFFFF
+
+// Largest avatar kept
+#define AVATARCACHE_MAX_CELL_SIZE	64
+
+// Users without avatar remembered per size, they're all asked again past it
+#define AVATARCACHE_MAX_NO_CELL		1024
+
+// Map node of an entry, value and tree links
+#define AVATARCACHE_ENTRY_NODE_SIZE	(sizeof(std::map<uint64, CAvatarAtlas::AvatarEntry_t>::value_type) + 4 * sizeof(void*))
+
+// Cell sizes, indexed by ESteamAPIAvatarSize
+static const uint32 s_unAvatarCellSizes[k_ESteamAPIAvatarSizeCount] = { 32, 64 };
+
+//-----------------------------------------------------------------------------
+// Purpose: Atlas of one avatar size
+//-----------------------------------------------------------------------------
+class CAvatarAtlas
+{
+public:
+	struct AvatarEntry_t
+	{
+		uint32					m_nCell;
+		int						m_iImage;
+		ESteamAPIAvatarState	m_eState;
+	};
+
+	struct AvatarCell_t
+	{
+		uint64					m_ulSteamID;
+		DWORD					m_dwLastUsed;
+	};
+
+public:
+	CAvatarAtlas();
+
+public:
+	void Init(ESteamAPIAvatarSize eSize);
+	void Clear();
+	void FreePixels();
+	ESteamAPIAvatarState Lookup(ISteamFriends *pSteamFriends, ISteamUtils *pSteamUtils, uint64 ulSteamID, SteamAPIAvatar_t *pAvatar);
+	void Refresh(ISteamFriends *pSteamFriends, ISteamUtils *pSteamUtils, uint64 ulSteamID);
+	void OnImageLoaded(ISteamUtils *pSteamUtils, uint64 ulSteamID, int iImage, int nWidth);
+	int GetChanges(SteamAPIAvatarRect_t *pRects, int nMaxRects);
+	void GetMemoryUsage(SteamAPIMemoryUsage_t *pUsage);
+
+private:
+	void Fetch(ISteamFriends *pSteamFriends, ISteamUtils *pSteamUtils, uint64 ulSteamID, AvatarEntry_t *pEntry);
+	bool CopyImage(ISteamUtils *pSteamUtils, int iImage, uint32 nCell);
+	uint32 AllocCell(uint64 ulSteamID);
+	uint32 GetUsedCells();
+	void PurgeNoCell();
+	void MarkDirty(uint32 nCell);
+
+public:
+	ESteamAPIAvatarSize				m_eSize;
+	uint32							m_unCellSize;
+	uint32							m_nColumns;
+	uint32							m_nCells;
+
+	// Allocated on first use, sizes nobody asks for cost nothing. The game
+	// holds on to it, so it's kept till SteamAPI_Shutdown()
+	uint8*							m_pubPixels;
+
+	std::map<uint64, AvatarEntry_t>	m_Entries;
+	std::vector<AvatarCell_t>		m_Cells;
+	std::vector<uint32>				m_FreeCells;
+
+	// Cells written since the game last asked for changes, one bit each
+	std::vector<uint32>				m_DirtyCells;
+
+	uint32							m_nEvictions;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Constructor
+//-----------------------------------------------------------------------------
+CAvatarAtlas::CAvatarAtlas() :
+	m_eSize(k_ESteamAPIAvatarSmall),
+	m_unCellSize(0),
+	m_nColumns(0),
+	m_nCells(0),
+	m_pubPixels(nullptr),
+	m_nEvictions(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Sets the cell layout of the size
+//-----------------------------------------------------------------------------
+void CAvatarAtlas::Init(ESteamAPIAvatarSize eSize)
+{
+	m_eSize = eSize;
+	m_unCellSize = s_unAvatarCellSizes[eSize];
+	m_nColumns = AVATARCACHE_ATLAS_SIZE / m_unCellSize;
+	m_nCells = m_nColumns * m_nColumns;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Forgets every user, pixels stay where the game can read them.
+//-----------------------------------------------------------------------------
+void CAvatarAtlas::Clear()
+{
+	m_Entries.clear();
+	std::vector<AvatarCell_t>().swap(m_Cells);
+	std::vector<uint32>().swap(m_FreeCells);
+	std::vector<uint32>().swap(m_DirtyCells);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Gives the pixels back, only once the game is done with the API.
+//-----------------------------------------------------------------------------
+void CAvatarAtlas::FreePixels()
+{
+	Clear();
+
+	if (m_pubPixels)
+		VirtualFree(m_pubPixels, 0, MEM_RELEASE);
+
+	m_pubPixels = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Marks the cell for upload
+//-----------------------------------------------------------------------------
+void CAvatarAtlas::MarkDirty(uint32 nCell)
+{
+	m_DirtyCells[nCell >> 5] |= 1u << (nCell & 31);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Takes a free cell, or the one looked up least recently once the
+//			atlas is full. Its user has to look it up again.
+//-----------------------------------------------------------------------------
+uint32 CAvatarAtlas::AllocCell(uint64 ulSteamID)
+{
+	uint32	nCell, i;
+
+	if (!m_pubPixels)
+		m_pubPixels = (uint8*)VirtualAlloc(NULL, AVATARCACHE_ATLAS_SIZE * AVATARCACHE_ATLAS_SIZE * 4, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+
+	if (!m_pubPixels)
+		return AVATARCACHE_NO_CELL;
+
+	// Pixels outlive a reconnect, the cells don't
+	if (m_Cells.empty())
+	{
+		m_Cells.resize(m_nCells);
+		m_DirtyCells.assign((m_nCells + 31) / 32, 0);
+		m_FreeCells.reserve(m_nCells);
+
+		// Hand out low cells first, they're at the top of the atlas
+		for (i = m_nCells; i > 0; i--)
+			m_FreeCells.push_back(i - 1);
+	}
+
+	if (!m_FreeCells.empty())
+	{
+		nCell = m_FreeCells.back();
+		m_FreeCells.pop_back();
+	}
+	else
+	{
+		nCell = 0;
+
+		for (i = 1; i < m_nCells; i++)
+		{
+			if ((LONG)(m_Cells[i].m_dwLastUsed - m_Cells[nCell].m_dwLastUsed) < 0)
+				nCell = i;
+		}
+
+		m_Entries.erase(m_Cells[nCell].m_ulSteamID);
+		m_nEvictions++;
+	}
+
+	m_Cells[nCell].m_ulSteamID = ulSteamID;
+	m_Cells[nCell].m_dwLastUsed = GetTickCount();
+
+	return nCell;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns number of cells users hold, each one has an entry.
+//-----------------------------------------------------------------------------
+uint32 CAvatarAtlas::GetUsedCells()
+{
+	return m_Cells.empty() ? 0 : m_nCells - m_FreeCells.size();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Forgets users that have no cell, they're asked for again on
+//			their next lookup.
+//-----------------------------------------------------------------------------
+void CAvatarAtlas::PurgeNoCell()
+{
+	for (auto Iter = m_Entries.begin(); Iter != m_Entries.end();)
+	{
+		if (Iter->second.m_nCell == AVATARCACHE_NO_CELL)
+			Iter = m_Entries.erase(Iter);
+		else
+			++Iter;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Copies the image into the cell, fails if it isn't of the size of
+//			the atlas.
+//-----------------------------------------------------------------------------
+bool CAvatarAtlas::CopyImage(ISteamUtils *pSteamUtils, int iImage, uint32 nCell)
+{
+	uint8	ubImage[AVATARCACHE_MAX_CELL_SIZE * AVATARCACHE_MAX_CELL_SIZE * 4];
+	uint8	*pubCell;
+	uint32	unWidth, unHeight;
+	uint32	cubRow, i;
+
+	if (!pSteamUtils->GetImageSize(iImage, &unWidth, &unHeight))
+		return false;
+
+	if (unWidth != m_unCellSize || unHeight != m_unCellSize)
+		return false;
+
+	cubRow = m_unCellSize * 4;
+
+	if (!pSteamUtils->GetImageRGBA(iImage, ubImage, cubRow * m_unCellSize))
+		return false;
+
+	pubCell = m_pubPixels + ((nCell / m_nColumns) * m_unCellSize * AVATARCACHE_ATLAS_SIZE + (nCell % m_nColumns) * m_unCellSize) * 4;
+
+	for (i = 0; i < m_unCellSize; i++)
+		memcpy(pubCell + i * AVATARCACHE_ATLAS_SIZE * 4, ubImage + i * cubRow, cubRow);
+
+	MarkDirty(nCell);
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Asks steamclient for the current avatar of the user. An image
+//			steam is still downloading gets its cell right away, pixels come
+//			with AvatarImageLoaded_t.
+//-----------------------------------------------------------------------------
+void CAvatarAtlas::Fetch(ISteamFriends *pSteamFriends, ISteamUtils *pSteamUtils, uint64 ulSteamID, AvatarEntry_t *pEntry)
+{
+	CSteamID SteamID(ulSteamID);
+
+	if (m_eSize == k_ESteamAPIAvatarSmall)
+		pEntry->m_iImage = pSteamFriends->GetSmallFriendAvatar(SteamID);
+	else
+		pEntry->m_iImage = pSteamFriends->GetMediumFriendAvatar(SteamID);
+
+	if (!pEntry->m_iImage)
+	{
+		pEntry->m_eState = k_ESteamAPIAvatarNone;
+		return;
+	}
+
+	if (pEntry->m_nCell == AVATARCACHE_NO_CELL)
+		pEntry->m_nCell = AllocCell(ulSteamID);
+
+	if (pEntry->m_nCell == AVATARCACHE_NO_CELL)
+		pEntry->m_eState = k_ESteamAPIAvatarNone;
+	else if (pEntry->m_iImage == -1)
+		pEntry->m_eState = k_ESteamAPIAvatarLoading;
+	else if (CopyImage(pSteamUtils, pEntry->m_iImage, pEntry->m_nCell))
+		pEntry->m_eState = k_ESteamAPIAvatarReady;
+	else
+		pEntry->m_eState = k_ESteamAPIAvatarNone;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns the avatar of the user, only users seen for the first
+//			time go to steamclient.
+//-----------------------------------------------------------------------------
+ESteamAPIAvatarState CAvatarAtlas::Lookup(ISteamFriends *pSteamFriends, ISteamUtils *pSteamUtils, uint64 ulSteamID, SteamAPIAvatar_t *pAvatar)
+{
+	AvatarEntry_t	*pEntry;
+	float			flScale;
+
+	auto Iter = m_Entries.find(ulSteamID);
+
+	if (Iter == m_Entries.end())
+	{
+		if (!pSteamFriends || !pSteamUtils)
+			return k_ESteamAPIAvatarNone;
+
+		if (m_Entries.size() - GetUsedCells() >= AVATARCACHE_MAX_NO_CELL)
+			PurgeNoCell();
+
+		Iter = m_Entries.insert(std::make_pair(ulSteamID, AvatarEntry_t())).first;
+		pEntry = &Iter->second;
+
+		pEntry->m_nCell = AVATARCACHE_NO_CELL;
+		pEntry->m_iImage = 0;
+		pEntry->m_eState = k_ESteamAPIAvatarNone;
+
+		Fetch(pSteamFriends, pSteamUtils, ulSteamID, pEntry);
+	}
+
+	pEntry = &Iter->second;
+
+	if (pEntry->m_nCell == AVATARCACHE_NO_CELL)
+		return pEntry->m_eState;
+
+	m_Cells[pEntry->m_nCell].m_dwLastUsed = GetTickCount();
+
+	if (pAvatar)
+	{
+		flScale = 1.0f / AVATARCACHE_ATLAS_SIZE;
+
+		pAvatar->m_nCell = pEntry->m_nCell;
+		pAvatar->m_flU0 = (pEntry->m_nCell % m_nColumns) * m_unCellSize * flScale;
+		pAvatar->m_flV0 = (pEntry->m_nCell / m_nColumns) * m_unCellSize * flScale;
+		pAvatar->m_flU1 = pAvatar->m_flU0 + m_unCellSize * flScale;
+		pAvatar->m_flV1 = pAvatar->m_flV0 + m_unCellSize * flScale;
+	}
+
+	return pEntry->m_eState;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: User changed the avatar, fetch the new one if the user is cached.
+//-----------------------------------------------------------------------------
+void CAvatarAtlas::Refresh(ISteamFriends *pSteamFriends, ISteamUtils *pSteamUtils, uint64 ulSteamID)
+{
+	auto Iter = m_Entries.find(ulSteamID);
+
+	if (Iter == m_Entries.end())
+		return;
+
+	Fetch(pSteamFriends, pSteamUtils, ulSteamID, &Iter->second);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Steam finished downloading an image, copy it if it's ours.
+//-----------------------------------------------------------------------------
+void CAvatarAtlas::OnImageLoaded(ISteamUtils *pSteamUtils, uint64 ulSteamID, int iImage, int nWidth)
+{
+	AvatarEntry_t *pEntry;
+
+	if ((uint32)nWidth != m_unCellSize)
+		return;
+
+	auto Iter = m_Entries.find(ulSteamID);
+
+	if (Iter == m_Entries.end())
+		return;
+
+	pEntry = &Iter->second;
+
+	if (pEntry->m_nCell == AVATARCACHE_NO_CELL)
+		return;
+
+	pEntry->m_iImage = iImage;
+
+	if (CopyImage(pSteamUtils, iImage, pEntry->m_nCell))
+		pEntry->m_eState = k_ESteamAPIAvatarReady;
+	else
+		pEntry->m_eState = k_ESteamAPIAvatarNone;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns rects of cells written since the last call, neighbouring
+//			cells of a row are merged. Returned cells are no longer dirty.
+//-----------------------------------------------------------------------------
+int CAvatarAtlas::GetChanges(SteamAPIAvatarRect_t *pRects, int nMaxRects)
+{
+	SteamAPIAvatarRect_t	*pRect;
+	uint32					nCell, nColumn;
+	uint32					unBit;
+	int						nRects;
+
+	nRects = 0;
+	pRect = nullptr;
+
+	for (nCell = 0; nCell < m_DirtyCells.size() * 32 && nCell < m_nCells; nCell++)
+	{
+		unBit = 1u << (nCell & 31);
+
+		if (!(m_DirtyCells[nCell >> 5] & unBit))
+		{
+			// Skip clean words at once, most of the atlas is
+			if (!m_DirtyCells[nCell >> 5])
+				nCell |= 31;
+
+			pRect = nullptr;
+			continue;
+		}
+
+		nColumn = nCell % m_nColumns;
+
+		// Extend the rect to the right if this cell continues its row
+		if (pRect && nColumn)
+		{
+			pRect->m_nWidth += (uint16)m_unCellSize;
+		}
+		else
+		{
+			if (nRects >= nMaxRects)
+				break;
+
+			pRect = &pRects[nRects++];
+			pRect->m_nX = (uint16)(nColumn * m_unCellSize);
+			pRect->m_nY = (uint16)((nCell / m_nColumns) * m_unCellSize);
+			pRect->m_nWidth = (uint16)m_unCellSize;
+			pRect->m_nHeight = (uint16)m_unCellSize;
+		}
+
+		m_DirtyCells[nCell >> 5] &= ~unBit;
+	}
+
+	return nRects;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: For memory stats
+//-----------------------------------------------------------------------------
+void CAvatarAtlas::GetMemoryUsage(SteamAPIMemoryUsage_t *pUsage)
+{
+	uint32 cubCells;
+
+	cubCells = m_Cells.size() * sizeof(AvatarCell_t) + m_DirtyCells.size() * sizeof(uint32) + m_FreeCells.capacity() * sizeof(uint32);
+
+	pUsage->m_nEntries += m_Entries.size();
+	pUsage->m_cubUsed += GetUsedCells() * m_unCellSize * m_unCellSize * 4 + cubCells;
+	pUsage->m_cubReserved += (m_pubPixels ? AVATARCACHE_ATLAS_SIZE * AVATARCACHE_ATLAS_SIZE * 4 : 0) + cubCells;
+
+	// Entries of users without avatar too, they save asking again
+	pUsage->m_cubUsed += m_Entries.size() * AVATARCACHE_ENTRY_NODE_SIZE;
+	pUsage->m_cubReserved += m_Entries.size() * AVATARCACHE_ENTRY_NODE_SIZE;
+}
+
+//-----------------------------------------------------------------------------
+// 
+// Avatar cache C interface
+// 
+//-----------------------------------------------------------------------------
+
+static CAvatarAtlas	s_AvatarAtlases[k_ESteamAPIAvatarSizeCount];
+
+// Pumps on several threads may deliver changes, see callback_locking
+static SRWLOCK		s_AvatarLock = SRWLOCK_INIT;
+
+//-----------------------------------------------------------------------------
+// Purpose: Friends interface of the global user
+//-----------------------------------------------------------------------------
+static ISteamFriends* AvatarCache_GetSteamFriends()
+{
+	return static_cast<ISteamFriends*>(InterfaceCache_FindOrCreate(g_pSteamClient, g_hSteamUser, g_hSteamPipe, STEAMFRIENDS_INTERFACE_VERSION));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Images are read through the utils interface of the pipe
+//-----------------------------------------------------------------------------
+static ISteamUtils* AvatarCache_GetSteamUtils()
+{
+	return static_cast<ISteamUtils*>(InterfaceCache_FindOrCreate(g_pSteamClient, 0, g_hSteamPipe, STEAMUTILS_INTERFACE_VERSION));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Copies the image steam just finished downloading
+//-----------------------------------------------------------------------------
+static void AvatarCache_OnAvatarImageLoaded(HSteamPipe hSteamPipe, int iCallback, void *pvParam, int cubParam)
+{
+	AvatarImageLoaded_t	*pLoaded;
+	ISteamUtils			*pSteamUtils;
+	int					i;
+
+	if (cubParam < (int)sizeof(AvatarImageLoaded_t))
+		return;
+
+	pLoaded = (AvatarImageLoaded_t*)pvParam;
+	pSteamUtils = AvatarCache_GetSteamUtils();
+
+	if (!pSteamUtils)
+		return;
+
+	AcquireSRWLockExclusive(&s_AvatarLock);
+
+	for (i = 0; i < k_ESteamAPIAvatarSizeCount; i++)
+		s_AvatarAtlases[i].OnImageLoaded(pSteamUtils, pLoaded->m_steamID.ConvertToUint64(), pLoaded->m_iImage, pLoaded->m_iWide);
+
+	ReleaseSRWLockExclusive(&s_AvatarLock);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Re-fetches avatars of the user when they change
+//-----------------------------------------------------------------------------
+static void AvatarCache_OnPersonaStateChange(HSteamPipe hSteamPipe, int iCallback, void *pvParam, int cubParam)
+{
+	PersonaStateChange_t	*pChange;
+	ISteamFriends			*pSteamFriends;
+	ISteamUtils				*pSteamUtils;
+	int						i;
+
+	if (cubParam < (int)sizeof(PersonaStateChange_t))
+		return;
+
+	pChange = (PersonaStateChange_t*)pvParam;
+
+	if (!(pChange->m_nChangeFlags & k_EPersonaChangeAvatar))
+		return;
+
+	pSteamFriends = AvatarCache_GetSteamFriends();
+	pSteamUtils = AvatarCache_GetSteamUtils();
+
+	if (!pSteamFriends || !pSteamUtils)
+		return;
+
+	AcquireSRWLockExclusive(&s_AvatarLock);
+
+	for (i = 0; i < k_ESteamAPIAvatarSizeCount; i++)
+		s_AvatarAtlases[i].Refresh(pSteamFriends, pSteamUtils, pChange->m_ulSteamID);
+
+	ReleaseSRWLockExclusive(&s_AvatarLock);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Called once the pipe and user are up, on init and on reconnect.
+//-----------------------------------------------------------------------------
+void AvatarCache_Init()
+{
+	int i;
+
+	if (!SteamAPIConfig()->m_bAvatarCache)
+		return;
+
+	for (i = 0; i < k_ESteamAPIAvatarSizeCount; i++)
+		s_AvatarAtlases[i].Init((ESteamAPIAvatarSize)i);
+
+	CallbackMgr_AddObserver(AvatarImageLoaded_t::k_iCallback, AvatarCache_OnAvatarImageLoaded);
+	CallbackMgr_AddObserver(PersonaStateChange_t::k_iCallback, AvatarCache_OnPersonaStateChange);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Image handles are only valid for the pipe, forget every user on
+//			reconnect. The atlas pixels stay, the game may be reading them.
+//-----------------------------------------------------------------------------
+void AvatarCache_Reset()
+{
+	int i;
+
+	AcquireSRWLockExclusive(&s_AvatarLock);
+
+	for (i = 0; i < k_ESteamAPIAvatarSizeCount; i++)
+		s_AvatarAtlases[i].Clear();
+
+	ReleaseSRWLockExclusive(&s_AvatarLock);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Drops everything, pixels included.
+//-----------------------------------------------------------------------------
+void AvatarCache_Shutdown()
+{
+	int i;
+
+	CallbackMgr_RemoveObserver(AvatarImageLoaded_t::k_iCallback, AvatarCache_OnAvatarImageLoaded);
+	CallbackMgr_RemoveObserver(PersonaStateChange_t::k_iCallback, AvatarCache_OnPersonaStateChange);
+
+	AcquireSRWLockExclusive(&s_AvatarLock);
+
+	for (i = 0; i < k_ESteamAPIAvatarSizeCount; i++)
+		s_AvatarAtlases[i].FreePixels();
+
+	ReleaseSRWLockExclusive(&s_AvatarLock);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: For memory stats
+//-----------------------------------------------------------------------------
+void AvatarCache_GetMemoryUsage(SteamAPIMemoryUsage_t *pUsage)
+{
+	int i;
+
+	AcquireSRWLockShared(&s_AvatarLock);
+
+	for (i = 0; i < k_ESteamAPIAvatarSizeCount; i++)
+		s_AvatarAtlases[i].GetMemoryUsage(pUsage);
+
+	ReleaseSRWLockShared(&s_AvatarLock);
+}
+
+//-----------------------------------------------------------------------------
+// 
+// Avatar cache interface
+// 
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns state of the avatar of the user, fills where it is in the
+//			atlas when it has a cell. Unknown users are fetched right away.
+//-----------------------------------------------------------------------------
+ESteamAPIAvatarState SteamAPI_GetCachedAvatar(uint64 ulSteamID, ESteamAPIAvatarSize eSize, SteamAPIAvatar_t *pAvatar)
+{
+	ESteamAPIAvatarState eState;
+
+	if (eSize < 0 || eSize >= k_ESteamAPIAvatarSizeCount || !ulSteamID || !s_AvatarAtlases[eSize].m_nCells)
+		return k_ESteamAPIAvatarNone;
+
+	AcquireSRWLockExclusive(&s_AvatarLock);
+	eState = s_AvatarAtlases[eSize].Lookup(AvatarCache_GetSteamFriends(), AvatarCache_GetSteamUtils(), ulSteamID, pAvatar);
+	ReleaseSRWLockExclusive(&s_AvatarLock);
+
+	return eState;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Fills pixels and layout of the atlas, fails until the first
+//			avatar of the size is cached. Pixels stay valid, also across a
+//			reconnect, until SteamAPI_Shutdown().
+//-----------------------------------------------------------------------------
+bool SteamAPI_GetAvatarAtlas(ESteamAPIAvatarSize eSize, SteamAPIAvatarAtlas_t *pAtlas)
+{
+	CAvatarAtlas	*pAvatarAtlas;
+	bool			bResult;
+
+	if (eSize < 0 || eSize >= k_ESteamAPIAvatarSizeCount || !pAtlas)
+		return false;
+
+	pAvatarAtlas = &s_AvatarAtlases[eSize];
+
+	AcquireSRWLockShared(&s_AvatarLock);
+
+	bResult = pAvatarAtlas->m_pubPixels != nullptr;
+
+	if (bResult)
+	{
+		pAtlas->m_pubPixels = pAvatarAtlas->m_pubPixels;
+		pAtlas->m_unWidth = AVATARCACHE_ATLAS_SIZE;
+		pAtlas->m_unHeight = AVATARCACHE_ATLAS_SIZE;
+		pAtlas->m_unCellSize = pAvatarAtlas->m_unCellSize;
+	}
+
+	ReleaseSRWLockShared(&s_AvatarLock);
+
+	return bResult;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns number of rects to upload, call again if it's nMaxRects.
+//-----------------------------------------------------------------------------
+int SteamAPI_GetAvatarAtlasChanges(ESteamAPIAvatarSize eSize, SteamAPIAvatarRect_t *pRects, int nMaxRects)
+{
+	int nRects;
+
+	if (eSize < 0 || eSize >= k_ESteamAPIAvatarSizeCount || !pRects || nMaxRects <= 0)
+		return 0;
+
+	AcquireSRWLockExclusive(&s_AvatarLock);
+	nRects = s_AvatarAtlases[eSize].GetChanges(pRects, nMaxRects);
+	ReleaseSRWLockExclusive(&s_AvatarLock);
+
+	return nRects;
+}
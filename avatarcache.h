@@ -0,0 +1,92 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+#ifndef AVATAR_CACHE_H
+#define AVATAR_CACHE_H
+#pragma once
+
+struct SteamAPIMemoryUsage_t;
+
+//-----------------------------------------------------------------------------
+// Purpose: Avatar sizes kept in the cache, each one has its own atlas.
+//-----------------------------------------------------------------------------
+enum ESteamAPIAvatarSize
+{
+	k_ESteamAPIAvatarSmall = 0,		// 32x32
+	k_ESteamAPIAvatarMedium = 1,	// 64x64
+
+	k_ESteamAPIAvatarSizeCount
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: State of the avatar of a user
+//-----------------------------------------------------------------------------
+enum ESteamAPIAvatarState
+{
+	k_ESteamAPIAvatarNone = 0,		// User has no avatar, or it can't be cached
+	k_ESteamAPIAvatarLoading,		// Steam is downloading it, check next frame
+	k_ESteamAPIAvatarReady,			// Pixels are in the atlas
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Where the avatar of a user lives in the atlas. Cell and UVs stay
+//			the same until the user is evicted to make room for another one.
+//-----------------------------------------------------------------------------
+struct SteamAPIAvatar_t
+{
+	uint32		m_nCell;
+	float		m_flU0;
+	float		m_flV0;
+	float		m_flU1;
+	float		m_flV1;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: RGBA pixels of an atlas, rows are m_unWidth * 4 bytes apart.
+//-----------------------------------------------------------------------------
+struct SteamAPIAvatarAtlas_t
+{
+	const uint8*	m_pubPixels;
+	uint32			m_unWidth;
+	uint32			m_unHeight;
+	uint32			m_unCellSize;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Part of the atlas that changed since the last upload, in pixels.
+//-----------------------------------------------------------------------------
+struct SteamAPIAvatarRect_t
+{
+	uint16		m_nX;
+	uint16		m_nY;
+	uint16		m_nWidth;
+	uint16		m_nHeight;
+};
+
+//-----------------------------------------------------------------------------
+// 
+// Avatar cache C interface
+// 
+//-----------------------------------------------------------------------------
+
+extern void AvatarCache_Init();
+extern void AvatarCache_Reset();
+extern void AvatarCache_Shutdown();
+extern void AvatarCache_GetMemoryUsage(SteamAPIMemoryUsage_t *pUsage);
+
+//-----------------------------------------------------------------------------
+// Purpose: Avatar cache API. Each avatar is copied out of steamclient once,
+//			straight into a shared RGBA atlas per size. Entries are refreshed
+//			only on AvatarImageLoaded_t and avatar changes reported through
+//			PersonaStateChange_t, the game uploads the changed rects instead
+//			of one texture per user. Pixels may only be read between calls
+//			to SteamAPI_RunCallbacks(), that's when the cache writes them.
+//-----------------------------------------------------------------------------
+S_API ESteamAPIAvatarState SteamAPI_GetCachedAvatar(uint64 ulSteamID, ESteamAPIAvatarSize eSize, SteamAPIAvatar_t *pAvatar);
+S_API bool SteamAPI_GetAvatarAtlas(ESteamAPIAvatarSize eSize, SteamAPIAvatarAtlas_t *pAtlas);
+S_API int SteamAPI_GetAvatarAtlasChanges(ESteamAPIAvatarSize eSize, SteamAPIAvatarRect_t *pRects, int nMaxRects);
+
+#endif
@@ -0,0 +1,133 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: Helpers shared by the benchmarks. Benchmarks link against 
+//			steam_api and run on the steamclient emulator, see 
+//			steamclientemu/.
+//
+// $NoKeywords: $
+//=============================================================================
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+#pragma once
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include "../steamclientemu/steamclientemu.h"
+
+typedef void (*pfnSteamClientEmu_GetStats_t)(SteamClientEmuStats_t *pStats, bool bReset);
+typedef bool (*pfnSteamClientEmu_PostCallback_t)(int hSteamPipe, int iCallback, const void *pvParam, int cubParam);
+
+//-----------------------------------------------------------------------------
+// Purpose: QPC time in microseconds.
+//-----------------------------------------------------------------------------
+inline double Bench_GetMicroseconds()
+{
+	static LARGE_INTEGER	s_Frequency;
+	LARGE_INTEGER			Counter;
+
+	if (!s_Frequency.QuadPart)
+		QueryPerformanceFrequency(&s_Frequency);
+
+	QueryPerformanceCounter(&Counter);
+	return (double)Counter.QuadPart * 1000000.0 / (double)s_Frequency.QuadPart;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Percentile of the samples, sorts them.
+//-----------------------------------------------------------------------------
+inline double Bench_Percentile(std::vector<double> &Samples, double flPercentile)
+{
+	size_t iSample;
+
+	if (Samples.empty())
+		return 0.0;
+
+	std::sort(Samples.begin(), Samples.end());
+
+	iSample = (size_t)(flPercentile * (Samples.size() - 1) + 0.5);
+	return Samples[min(iSample, Samples.size() - 1)];
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Makes sure the emulator daemon runs, starts it from the directory
+//			of the executable when it doesn't, then points steam_api at the 
+//			emulator's steamclient.dll through a temporary configuration.
+//-----------------------------------------------------------------------------
+inline bool Bench_SetupEmulator(const char *pszExtraConfig)
+{
+	STARTUPINFOA			StartupInfo;
+	PROCESS_INFORMATION		ProcessInfo;
+	HANDLE					hMapping;
+	char					szDir[MAX_PATH], szPath[MAX_PATH], szConfigPath[MAX_PATH];
+	char*					pszSlash;
+	FILE*					pConfigFile;
+
+	GetModuleFileNameA(NULL, szDir, sizeof(szDir));
+	pszSlash = strrchr(szDir, '\\');
+
+	if (pszSlash)
+		*pszSlash = '\0';
+
+	hMapping = OpenFileMappingA(FILE_MAP_READ, FALSE, STEAMCLIENTEMU_MAPPING_NAME);
+
+	if (!hMapping)
+	{
+		_snprintf(szPath, sizeof(szPath), "\"%s\\steamclientemud.exe\"", szDir);
+
+		memset(&StartupInfo, 0, sizeof(StartupInfo));
+		StartupInfo.cb = sizeof(StartupInfo);
+
+		if (!CreateProcessA(NULL, szPath, NULL, NULL, FALSE, CREATE_NEW_CONSOLE, NULL, szDir, &StartupInfo, &ProcessInfo))
+		{
+			fprintf(stderr, "Failed to start %s (%u)\n", szPath, GetLastError());
+			return false;
+		}
+
+		CloseHandle(ProcessInfo.hThread);
+		CloseHandle(ProcessInfo.hProcess);
+
+		for (int i = 0; i < 100 && !hMapping; i++)
+		{
+			Sleep(20);
+			hMapping = OpenFileMappingA(FILE_MAP_READ, FALSE, STEAMCLIENTEMU_MAPPING_NAME);
+		}
+
+		if (!hMapping)
+		{
+			fprintf(stderr, "steamclientemud didn't come up\n");
+			return false;
+		}
+	}
+
+	CloseHandle(hMapping);
+
+	GetTempPathA(sizeof(szConfigPath), szConfigPath);
+	_snprintf(szPath, sizeof(szPath), "%ssteam_api_bench_%u.cfg", szConfigPath, GetCurrentProcessId());
+
+	pConfigFile = fopen(szPath, "w");
+
+	if (!pConfigFile)
+		return false;
+
+	fprintf(pConfigFile, "appid 480\nsteamclient_path %s\\steamclient.dll\nlog_level 2\n%s", szDir, pszExtraConfig ? pszExtraConfig : "");
+	fclose(pConfigFile);
+
+	SetEnvironmentVariableA("SteamAPIConfig", szPath);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Emulator's own counters, loaded once steam_api has the module.
+//-----------------------------------------------------------------------------
+inline pfnSteamClientEmu_GetStats_t Bench_GetEmulatorStats()
+{
+	HMODULE hModule = GetModuleHandleA("steamclient.dll");
+
+	return hModule ? reinterpret_cast<pfnSteamClientEmu_GetStats_t>(GetProcAddress(hModule, "SteamClientEmu_GetStats")) : nullptr;
+}
+
+#endif
@@ -0,0 +1,401 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: Registration and dispatch contention benchmark. N worker threads
+//			register a callback, have the emulator post a message for it,
+//			wait for the delivery and unregister, and every few rounds 
+//			register a call result for a simulated HTTP request. One or 
+//			more threads pump SteamAPI_RunCallbacks meanwhile.
+//
+//			Reports throughput, latency percentiles of each operation and
+//			correctness violations: deliveries lost, delivered twice or to
+//			the wrong object. Each configuration runs in its own process, 
+//			as the unlocked manager may well crash under contention.
+//
+//			Usage: contention [iterations per thread]
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "../benchmark.h"
+#include "steam/steam_api.h"
+
+// Callback ids of the worker threads, not used by Steam
+#define CONTENTION_CALLBACK_BASE		990000
+
+#define CONTENTION_MAX_THREADS			32
+
+// How long a delivery is waited for before it's counted as lost
+#define CONTENTION_DELIVERY_TIMEOUT		2000
+
+// Every this many rounds the worker registers a call result as well
+#define CONTENTION_CALLRESULT_INTERVAL	8
+
+static const int k_nThreadCounts[] = { 1, 2, 4, 8, 16 };
+static const int k_nPumpCounts[] = { 1, 2 };
+
+//-----------------------------------------------------------------------------
+// Purpose: Message posted through the emulator.
+//-----------------------------------------------------------------------------
+struct ContentionMessage_t
+{
+	LONG		m_iThread;
+	LONG		m_iRound;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Counts every delivery per round, so both lost and repeated ones
+//			show up.
+//-----------------------------------------------------------------------------
+class CContentionCallback : public CCallbackBase
+{
+public:
+	CContentionCallback() : m_iThread(0), m_pDeliveries(nullptr), m_nWrongTarget(0) { }
+
+	virtual void Run(void *pvParam)
+	{
+		ContentionMessage_t* pMessage = reinterpret_cast<ContentionMessage_t*>(pvParam);
+
+		if (pMessage->m_iThread != m_iThread)
+		{
+			InterlockedIncrement(&m_nWrongTarget);
+			return;
+		}
+
+		InterlockedIncrement(&m_pDeliveries[pMessage->m_iRound]);
+	}
+
+	virtual void Run(void *pvParam, bool bIOFailure, SteamAPICall_t hSteamAPICall)
+	{
+		InterlockedIncrement(&m_nWrongTarget);
+	}
+
+	virtual int GetCallbackSizeBytes()
+	{
+		return sizeof(ContentionMessage_t);
+	}
+
+public:
+	LONG				m_iThread;
+	volatile LONG*		m_pDeliveries;
+	volatile LONG		m_nWrongTarget;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Call result of one worker, remembers which call completed.
+//-----------------------------------------------------------------------------
+class CContentionCallResult : public CCallbackBase
+{
+public:
+	CContentionCallResult() : m_hExpected(k_uAPICallInvalid), m_nDeliveries(0), m_nWrongCall(0)
+	{
+		m_iCallback = HTTPRequestCompleted_t::k_iCallback;
+	}
+
+	virtual void Run(void *pvParam)
+	{
+		InterlockedIncrement(&m_nWrongCall);
+	}
+
+	virtual void Run(void *pvParam, bool bIOFailure, SteamAPICall_t hSteamAPICall)
+	{
+		if (hSteamAPICall != m_hExpected)
+			InterlockedIncrement(&m_nWrongCall);
+
+		InterlockedIncrement(&m_nDeliveries);
+	}
+
+	virtual int GetCallbackSizeBytes()
+	{
+		return sizeof(HTTPRequestCompleted_t);
+	}
+
+public:
+	volatile SteamAPICall_t	m_hExpected;
+	volatile LONG			m_nDeliveries;
+	volatile LONG			m_nWrongCall;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: State of one worker thread.
+//-----------------------------------------------------------------------------
+struct ContentionWorker_t
+{
+	int						m_iThread;
+	int						m_nRounds;
+
+	CContentionCallback		m_Callback;
+	CContentionCallResult	m_CallResult;
+	std::vector<LONG>		m_Deliveries;
+
+	// Latencies in microseconds
+	std::vector<double>		m_RegisterTimes;
+	std::vector<double>		m_UnregisterTimes;
+	std::vector<double>		m_DeliveryTimes;
+	std::vector<double>		m_CallResultTimes;
+
+	int						m_nLost;
+	int						m_nCallResultsLost;
+	int						m_nCallResults;
+};
+
+static pfnSteamClientEmu_PostCallback_t	s_pfnPostCallback = nullptr;
+static volatile bool					s_bStopPumps = false;
+
+//-----------------------------------------------------------------------------
+// Purpose: Spins and yields until the counter moves, false on timeout.
+//-----------------------------------------------------------------------------
+static bool Contention_WaitFor(volatile LONG *pnValue, LONG nExpected)
+{
+	DWORD dwStartTime = GetTickCount();
+
+	while (*pnValue < nExpected)
+	{
+		if (GetTickCount() - dwStartTime >= CONTENTION_DELIVERY_TIMEOUT)
+			return false;
+
+		Sleep(0);
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Register, deliver, unregister, repeat.
+//-----------------------------------------------------------------------------
+static DWORD WINAPI Contention_WorkerThread(LPVOID pvParam)
+{
+	ContentionWorker_t*		pWorker = reinterpret_cast<ContentionWorker_t*>(pvParam);
+	ContentionMessage_t		Message;
+	HTTPRequestHandle		hRequest;
+	SteamAPICall_t			hSteamAPICall;
+	double					flStart;
+	LONG					nCallResults;
+
+	pWorker->m_Callback.m_iThread = pWorker->m_iThread;
+	pWorker->m_Callback.m_pDeliveries = pWorker->m_Deliveries.data();
+
+	nCallResults = 0;
+
+	for (int i = 0; i < pWorker->m_nRounds; i++)
+	{
+		flStart = Bench_GetMicroseconds();
+		SteamAPI_RegisterCallback(&pWorker->m_Callback, CONTENTION_CALLBACK_BASE + pWorker->m_iThread);
+		pWorker->m_RegisterTimes.push_back(Bench_GetMicroseconds() - flStart);
+
+		Message.m_iThread = pWorker->m_iThread;
+		Message.m_iRound = i;
+
+		flStart = Bench_GetMicroseconds();
+		s_pfnPostCallback(SteamAPI_GetHSteamPipe(), CONTENTION_CALLBACK_BASE + pWorker->m_iThread, &Message, sizeof(Message));
+
+		if (Contention_WaitFor(&pWorker->m_Deliveries[i], 1))
+			pWorker->m_DeliveryTimes.push_back(Bench_GetMicroseconds() - flStart);
+		else
+			pWorker->m_nLost++;
+
+		flStart = Bench_GetMicroseconds();
+		SteamAPI_UnregisterCallback(&pWorker->m_Callback);
+		pWorker->m_UnregisterTimes.push_back(Bench_GetMicroseconds() - flStart);
+
+		if (i % CONTENTION_CALLRESULT_INTERVAL)
+			continue;
+
+		// Completes after a couple of milliseconds, so registering right
+		// after sending isn't racing the completion
+		hRequest = SteamHTTP()->CreateHTTPRequest(k_EHTTPMethodGET, "http://emu/contention?size=64&ms=2");
+
+		if (hRequest == INVALID_HTTPREQUEST_HANDLE || !SteamHTTP()->SendHTTPRequest(hRequest, &hSteamAPICall))
+			continue;
+
+		flStart = Bench_GetMicroseconds();
+		pWorker->m_CallResult.m_hExpected = hSteamAPICall;
+		SteamAPI_RegisterCallResult(&pWorker->m_CallResult, hSteamAPICall);
+		pWorker->m_RegisterTimes.push_back(Bench_GetMicroseconds() - flStart);
+
+		nCallResults++;
+		pWorker->m_nCallResults++;
+
+		if (Contention_WaitFor(&pWorker->m_CallResult.m_nDeliveries, nCallResults))
+		{
+			pWorker->m_CallResultTimes.push_back(Bench_GetMicroseconds() - flStart);
+		}
+		else
+		{
+			pWorker->m_nCallResultsLost++;
+			SteamAPI_UnregisterCallResult(&pWorker->m_CallResult, hSteamAPICall);
+			nCallResults = pWorker->m_CallResult.m_nDeliveries;
+		}
+
+		SteamHTTP()->ReleaseHTTPRequest(hRequest);
+	}
+
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Pumps callbacks as fast as it can.
+//-----------------------------------------------------------------------------
+static DWORD WINAPI Contention_PumpThread(LPVOID pvParam)
+{
+	while (!s_bStopPumps)
+	{
+		SteamAPI_RunCallbacks();
+		YieldProcessor();
+	}
+
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Runs one configuration inside this process and prints its line.
+//-----------------------------------------------------------------------------
+static int Contention_RunChild(bool bLocked, int nThreads, int nPumps, int nRounds)
+{
+	ContentionWorker_t*		pWorkers;
+	HANDLE					hThreads[CONTENTION_MAX_THREADS];
+	HANDLE					hPumps[CONTENTION_MAX_THREADS];
+	std::vector<double>		RegisterTimes, UnregisterTimes, DeliveryTimes, CallResultTimes;
+	double					flStart, flElapsed;
+	int						nLost, nDouble, nWrong, nOperations;
+
+	nThreads = min(nThreads, CONTENTION_MAX_THREADS);
+	nPumps = min(nPumps, CONTENTION_MAX_THREADS);
+
+	if (!Bench_SetupEmulator(bLocked ? "callback_locking 1\n" : "callback_locking 0\n") || !SteamAPI_Init())
+		return 2;
+
+	s_pfnPostCallback = reinterpret_cast<pfnSteamClientEmu_PostCallback_t>(GetProcAddress(GetModuleHandleA("steamclient.dll"), "SteamClientEmu_PostCallback"));
+
+	if (!s_pfnPostCallback)
+		return 2;
+
+	pWorkers = new ContentionWorker_t[nThreads];
+
+	for (int i = 0; i < nThreads; i++)
+	{
+		pWorkers[i].m_iThread = i;
+		pWorkers[i].m_nRounds = nRounds;
+		pWorkers[i].m_Deliveries.assign(nRounds, 0);
+		pWorkers[i].m_RegisterTimes.reserve(nRounds * 2);
+		pWorkers[i].m_UnregisterTimes.reserve(nRounds);
+		pWorkers[i].m_DeliveryTimes.reserve(nRounds);
+		pWorkers[i].m_CallResultTimes.reserve(nRounds / CONTENTION_CALLRESULT_INTERVAL + 1);
+		pWorkers[i].m_nLost = 0;
+		pWorkers[i].m_nCallResultsLost = 0;
+		pWorkers[i].m_nCallResults = 0;
+	}
+
+	for (int i = 0; i < nPumps; i++)
+		hPumps[i] = CreateThread(NULL, 0, Contention_PumpThread, NULL, 0, NULL);
+
+	flStart = Bench_GetMicroseconds();
+
+	for (int i = 0; i < nThreads; i++)
+		hThreads[i] = CreateThread(NULL, 0, Contention_WorkerThread, &pWorkers[i], 0, NULL);
+
+	WaitForMultipleObjects(nThreads, hThreads, TRUE, INFINITE);
+	flElapsed = Bench_GetMicroseconds() - flStart;
+
+	s_bStopPumps = true;
+	WaitForMultipleObjects(nPumps, hPumps, TRUE, INFINITE);
+
+	nLost = nDouble = nWrong = nOperations = 0;
+
+	for (int i = 0; i < nThreads; i++)
+	{
+		ContentionWorker_t* pWorker = &pWorkers[i];
+
+		for (int j = 0; j < nRounds; j++)
+		{
+			if (pWorker->m_Deliveries[j] > 1)
+				nDouble++;
+		}
+
+		nLost += pWorker->m_nLost + pWorker->m_nCallResultsLost;
+		nWrong += pWorker->m_Callback.m_nWrongTarget + pWorker->m_CallResult.m_nWrongCall;
+		nDouble += max(0, (int)pWorker->m_CallResult.m_nDeliveries - (pWorker->m_nCallResults - pWorker->m_nCallResultsLost));
+		nOperations += (int)(pWorker->m_RegisterTimes.size() + pWorker->m_UnregisterTimes.size());
+
+		RegisterTimes.insert(RegisterTimes.end(), pWorker->m_RegisterTimes.begin(), pWorker->m_RegisterTimes.end());
+		UnregisterTimes.insert(UnregisterTimes.end(), pWorker->m_UnregisterTimes.begin(), pWorker->m_UnregisterTimes.end());
+		DeliveryTimes.insert(DeliveryTimes.end(), pWorker->m_DeliveryTimes.begin(), pWorker->m_DeliveryTimes.end());
+		CallResultTimes.insert(CallResultTimes.end(), pWorker->m_CallResultTimes.begin(), pWorker->m_CallResultTimes.end());
+	}
+
+	printf("%-8s %4d %5d %10.0f %8.1f %8.1f %8.1f %8.1f %9.1f %9.1f %9.1f %6d %6d %6d\n",
+		   bLocked ? "locked" : "unlocked", nThreads, nPumps, nOperations / (flElapsed / 1000000.0),
+		   Bench_Percentile(RegisterTimes, 0.50), Bench_Percentile(RegisterTimes, 0.999),
+		   Bench_Percentile(UnregisterTimes, 0.50), Bench_Percentile(UnregisterTimes, 0.999),
+		   Bench_Percentile(DeliveryTimes, 0.50), Bench_Percentile(DeliveryTimes, 0.99), Bench_Percentile(CallResultTimes, 0.99),
+		   nLost, nDouble, nWrong);
+
+	fflush(stdout);
+
+	// Leave without cleanup when something went wrong, objects may still
+	// be registered
+	if (nLost || nDouble || nWrong)
+		TerminateProcess(GetCurrentProcess(), 1);
+
+	SteamAPI_Shutdown();
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Starts the configuration in a child process and reports a crash.
+//-----------------------------------------------------------------------------
+static void Contention_RunConfiguration(bool bLocked, int nThreads, int nPumps, int nRounds)
+{
+	STARTUPINFOA			StartupInfo;
+	PROCESS_INFORMATION		ProcessInfo;
+	char					szCommandLine[MAX_PATH + 64];
+	char					szExecutable[MAX_PATH];
+	DWORD					dwExitCode;
+
+	GetModuleFileNameA(NULL, szExecutable, sizeof(szExecutable));
+	_snprintf(szCommandLine, sizeof(szCommandLine), "\"%s\" -run %d %d %d %d", szExecutable, bLocked, nThreads, nPumps, nRounds);
+
+	memset(&StartupInfo, 0, sizeof(StartupInfo));
+	StartupInfo.cb = sizeof(StartupInfo);
+
+	if (!CreateProcessA(NULL, szCommandLine, NULL, NULL, TRUE, 0, NULL, NULL, &StartupInfo, &ProcessInfo))
+		return;
+
+	WaitForSingleObject(ProcessInfo.hProcess, INFINITE);
+	GetExitCodeProcess(ProcessInfo.hProcess, &dwExitCode);
+
+	CloseHandle(ProcessInfo.hThread);
+	CloseHandle(ProcessInfo.hProcess);
+
+	if (dwExitCode >= 0xC0000000)
+		printf("%-8s %4d %5d   crashed with exception 0x%08X\n", bLocked ? "locked" : "unlocked", nThreads, nPumps, dwExitCode);
+	else if (dwExitCode == 2)
+		printf("%-8s %4d %5d   failed to start on the emulator\n", bLocked ? "locked" : "unlocked", nThreads, nPumps);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Entry point
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+	int nRounds;
+
+	if (argc == 6 && !strcmp(argv[1], "-run"))
+		return Contention_RunChild(atoi(argv[2]) != 0, atoi(argv[3]), atoi(argv[4]), atoi(argv[5]));
+
+	nRounds = argc > 1 ? atoi(argv[1]) : 2000;
+
+	printf("%d rounds per worker, latencies in us\n\n", nRounds);
+	printf("%-8s %4s %5s %10s %8s %8s %8s %8s %9s %9s %9s %6s %6s %6s\n",
+		   "VARIANT", "THR", "PUMPS", "OPS/S", "REG P50", "REG P999", "UNR P50", "UNR P999", "DLV P50", "DLV P99", "CR P99", "LOST", "DOUBLE", "WRONG");
+
+	for (int iVariant = 0; iVariant < 2; iVariant++)
+	{
+		for (int i = 0; i < ARRAYSIZE(k_nThreadCounts); i++)
+		{
+			for (int j = 0; j < ARRAYSIZE(k_nPumpCounts); j++)
+				Contention_RunConfiguration(iVariant == 1, k_nThreadCounts[i], k_nPumpCounts[j], nRounds);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,386 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: Frame simulation of the download manager pattern described in 
+//			README. Every frame starts new downloads up to the concurrency
+//			limit through SteamHTTP, registers them with 
+//			CMultipleCallResults::AddCall and pumps SteamAPI_RunCallbacks, 
+//			which completes them through OnSteamAPICallCompleted.
+//
+//			Reports frame time percentiles, completion latency and heap 
+//			allocations per frame for each concurrency level and file size 
+//			mix. Allocations are counted by the debug CRT only.
+//
+//			Usage: dlmframe [files per run] [frame ms]
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "../benchmark.h"
+#include <crtdbg.h>
+#include "steam/steam_api.h"
+#include "../../memfootprint.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: Size mixes the downloads are drawn from, log-uniformly.
+//-----------------------------------------------------------------------------
+struct SizeMix_t
+{
+	const char*		m_pszName;
+	uint32			m_cubMin;
+	uint32			m_cubMax;
+};
+
+static const SizeMix_t k_SizeMixes[] = 
+{
+	{ "small",	1024,			16 * 1024 },
+	{ "mixed",	1024,			1024 * 1024 },
+	{ "large",	256 * 1024,		4 * 1024 * 1024 },
+};
+
+static const int k_nConcurrencyLevels[] = { 1, 5, 10, 20 };
+
+// Simulated bandwidth of one download and fixed latency of each
+#define DLM_BYTES_PER_MS			10240
+#define DLM_BASE_LATENCY_MS			5
+
+#ifdef _DEBUG
+static volatile LONG s_nAllocations = 0;
+
+//-----------------------------------------------------------------------------
+// Purpose: Counts allocations of every module sharing the debug CRT.
+//-----------------------------------------------------------------------------
+static int __cdecl DLM_AllocHook(int nAllocType, void *pvData, size_t cubSize, int nBlockUse, long lRequest, const unsigned char *pszFileName, int nLine)
+{
+	if (nAllocType == _HOOK_ALLOC || nAllocType == _HOOK_REALLOC)
+		InterlockedIncrement(&s_nAllocations);
+
+	return TRUE;
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// Purpose: Several API calls served by one object, as the engine does it.
+//-----------------------------------------------------------------------------
+template <class T, class P>
+class CMultipleCallResults : public CCallbackBase
+{
+public:
+	typedef void (T::*func_t)(P*, bool, SteamAPICall_t);
+
+	CMultipleCallResults(T *pObj, func_t Func) : m_pObj(pObj), m_Func(Func)
+	{
+		m_iCallback = P::k_iCallback;
+		m_APICalls.reserve(64);
+	}
+
+	~CMultipleCallResults()
+	{
+		for (size_t i = 0; i < m_APICalls.size(); i++)
+			SteamAPI_UnregisterCallResult(this, m_APICalls[i]);
+	}
+
+	void AddCall(SteamAPICall_t hSteamAPICall)
+	{
+		m_APICalls.push_back(hSteamAPICall);
+
+		SteamAPI_RegisterCallResult(this, hSteamAPICall);
+	}
+
+private:
+	virtual void Run(void *pvParam)
+	{
+		// Only call results are expected
+	}
+
+	virtual void Run(void *pvParam, bool bIOFailure, SteamAPICall_t hSteamAPICall)
+	{
+		for (size_t i = 0; i < m_APICalls.size(); i++)
+		{
+			if (m_APICalls[i] != hSteamAPICall)
+				continue;
+
+			m_APICalls[i] = m_APICalls.back();
+			m_APICalls.pop_back();
+			break;
+		}
+
+		(m_pObj->*m_Func)(reinterpret_cast<P*>(pvParam), bIOFailure, hSteamAPICall);
+	}
+
+	virtual int GetCallbackSizeBytes()
+	{
+		return sizeof(P);
+	}
+
+private:
+	T*								m_pObj;
+	func_t							m_Func;
+	std::vector<SteamAPICall_t>		m_APICalls;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Download in flight.
+//-----------------------------------------------------------------------------
+struct DLMDownload_t
+{
+	HTTPRequestHandle	m_hRequest;
+	double				m_flIssueTime;
+	uint32				m_cubExpected;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Stand-in of the engine's download manager.
+//-----------------------------------------------------------------------------
+class CDownloadManager
+{
+public:
+	CDownloadManager(int nConcurrency, const SizeMix_t *pMix, int nFiles);
+
+	void StartNewDownloads();
+	bool IsDone() const { return m_nCompleted + m_nFailed >= m_nFiles; }
+
+	void OnHTTPRequestCompleted(HTTPRequestCompleted_t *pResult, bool bIOFailure, SteamAPICall_t hSteamAPICall);
+
+public:
+	int									m_nConcurrency;
+	const SizeMix_t*					m_pMix;
+	int									m_nFiles;
+	int									m_nStarted;
+	int									m_nCompleted;
+	int									m_nFailed;
+
+	DLMDownload_t						m_Downloads[64];
+	int									m_nDownloads;
+
+	std::vector<uint8>					m_Body;
+	std::vector<double>					m_Latencies;
+
+	CMultipleCallResults<CDownloadManager, HTTPRequestCompleted_t>	m_HTTPRequestCompleted;
+};
+
+CDownloadManager::CDownloadManager(int nConcurrency, const SizeMix_t *pMix, int nFiles) :
+	m_nConcurrency(min(nConcurrency, (int)ARRAYSIZE(m_Downloads))),
+	m_pMix(pMix),
+	m_nFiles(nFiles),
+	m_nStarted(0),
+	m_nCompleted(0),
+	m_nFailed(0),
+	m_nDownloads(0),
+	m_HTTPRequestCompleted(this, &CDownloadManager::OnHTTPRequestCompleted)
+{
+	m_Body.resize(pMix->m_cubMax);
+	m_Latencies.reserve(nFiles);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Fills free download slots, see DownloadManager::StartNewDownload().
+//-----------------------------------------------------------------------------
+void CDownloadManager::StartNewDownloads()
+{
+	DLMDownload_t*		pDownload;
+	HTTPRequestHandle	hRequest;
+	SteamAPICall_t		hSteamAPICall;
+	char				szURL[128];
+	double				flScale;
+	uint32				cubFile;
+
+	while (m_nDownloads < m_nConcurrency && m_nStarted < m_nFiles)
+	{
+		flScale = (double)rand() / RAND_MAX;
+		cubFile = (uint32)(m_pMix->m_cubMin * pow((double)m_pMix->m_cubMax / m_pMix->m_cubMin, flScale));
+
+		_snprintf(szURL, sizeof(szURL), "http://emu/file%d?size=%u&ms=%u", m_nStarted, cubFile, DLM_BASE_LATENCY_MS + cubFile / DLM_BYTES_PER_MS);
+
+		m_nStarted++;
+
+		hRequest = SteamHTTP()->CreateHTTPRequest(k_EHTTPMethodGET, szURL);
+
+		if (hRequest == INVALID_HTTPREQUEST_HANDLE)
+		{
+			m_nFailed++;
+			continue;
+		}
+
+		if (!SteamHTTP()->SendHTTPRequest(hRequest, &hSteamAPICall))
+		{
+			SteamHTTP()->ReleaseHTTPRequest(hRequest);
+			m_nFailed++;
+			continue;
+		}
+
+		pDownload = &m_Downloads[m_nDownloads++];
+		pDownload->m_hRequest = hRequest;
+		pDownload->m_flIssueTime = Bench_GetMicroseconds();
+		pDownload->m_cubExpected = cubFile;
+
+		// Add call for the steamAPI to process it
+		m_HTTPRequestCompleted.AddCall(hSteamAPICall);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Takes the body and frees the slot for the next file.
+//-----------------------------------------------------------------------------
+void CDownloadManager::OnHTTPRequestCompleted(HTTPRequestCompleted_t *pResult, bool bIOFailure, SteamAPICall_t hSteamAPICall)
+{
+	uint32 cubBody;
+
+	for (int i = 0; i < m_nDownloads; i++)
+	{
+		if (m_Downloads[i].m_hRequest != pResult->m_hRequest)
+			continue;
+
+		if (bIOFailure || !pResult->m_bRequestSuccessful ||
+			!SteamHTTP()->GetHTTPResponseBodySize(pResult->m_hRequest, &cubBody) || cubBody != m_Downloads[i].m_cubExpected ||
+			!SteamHTTP()->GetHTTPResponseBodyData(pResult->m_hRequest, m_Body.data(), (uint32)m_Body.size()))
+		{
+			m_nFailed++;
+		}
+		else
+		{
+			m_nCompleted++;
+			m_Latencies.push_back((Bench_GetMicroseconds() - m_Downloads[i].m_flIssueTime) / 1000.0);
+		}
+
+		SteamHTTP()->ReleaseHTTPRequest(pResult->m_hRequest);
+
+		m_Downloads[i] = m_Downloads[--m_nDownloads];
+		return;
+	}
+
+	m_nFailed++;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Runs one scenario at the frame rate and prints its line.
+//-----------------------------------------------------------------------------
+static void DLM_RunScenario(int nConcurrency, const SizeMix_t *pMix, int nFiles, double flFrameTime)
+{
+	pfnSteamClientEmu_GetStats_t	pfnGetEmulatorStats;
+	SteamClientEmuStats_t			EmulatorStats;
+	SteamAPIMemoryStats_t			MemoryBefore, MemoryAfter;
+	std::vector<double>				FrameTimes;
+	double							flFrameStart, flWorkEnd;
+	double							flFrameP50, flFrameP90, flFrameP99, flFrameMax;
+	double							flLatencyP50, flLatencyP99, flLatencyMax;
+	LONG							nAllocationsBefore;
+	int								nFrames;
+
+	CDownloadManager DownloadManager(nConcurrency, pMix, nFiles);
+
+	FrameTimes.reserve(100000);
+	srand(nConcurrency * 7919 + (int)pMix->m_cubMax);
+
+	pfnGetEmulatorStats = Bench_GetEmulatorStats();
+
+	if (pfnGetEmulatorStats)
+		pfnGetEmulatorStats(&EmulatorStats, true);
+
+	SteamAPI_GetMemoryStats(&MemoryBefore);
+
+#ifdef _DEBUG
+	nAllocationsBefore = s_nAllocations;
+#else
+	nAllocationsBefore = 0;
+#endif
+
+	nFrames = 0;
+
+	while (!DownloadManager.IsDone())
+	{
+		flFrameStart = Bench_GetMicroseconds();
+
+		DownloadManager.StartNewDownloads();
+		SteamAPI_RunCallbacks();
+
+		flWorkEnd = Bench_GetMicroseconds();
+		FrameTimes.push_back(flWorkEnd - flFrameStart);
+		nFrames++;
+
+		// Rest of the frame belongs to the game
+		while (Bench_GetMicroseconds() - flFrameStart < flFrameTime)
+		{
+			if (flFrameTime - (Bench_GetMicroseconds() - flFrameStart) > 2000.0)
+				Sleep(1);
+			else
+				YieldProcessor();
+		}
+	}
+
+	SteamAPI_GetMemoryStats(&MemoryAfter);
+
+	if (pfnGetEmulatorStats)
+		pfnGetEmulatorStats(&EmulatorStats, true);
+	else
+		memset(&EmulatorStats, 0, sizeof(EmulatorStats));
+
+	// Percentiles sort the samples, so they are taken before printing
+	flFrameP50 = Bench_Percentile(FrameTimes, 0.50);
+	flFrameP90 = Bench_Percentile(FrameTimes, 0.90);
+	flFrameP99 = Bench_Percentile(FrameTimes, 0.99);
+	flFrameMax = Bench_Percentile(FrameTimes, 1.0);
+
+	flLatencyP50 = Bench_Percentile(DownloadManager.m_Latencies, 0.50);
+	flLatencyP99 = Bench_Percentile(DownloadManager.m_Latencies, 0.99);
+	flLatencyMax = Bench_Percentile(DownloadManager.m_Latencies, 1.0);
+
+	printf("%4d %-6s %6d %8.1f %8.1f %8.1f %8.1f %8.1f %8.1f %8.1f ", 
+		   nConcurrency, pMix->m_pszName, nFrames,
+		   flFrameP50, flFrameP90, flFrameP99, flFrameMax,
+		   flLatencyP50, flLatencyP99, flLatencyMax);
+
+#ifdef _DEBUG
+	printf("%8.2f ", nFrames ? (double)(s_nAllocations - nAllocationsBefore) / nFrames : 0.0);
+#else
+	printf("%8s ", "n/a");
+#endif
+
+	printf("%7.2f %7.1f %6d %9d\n",
+		   nFrames ? (double)EmulatorStats.m_ullRoundTrips / nFrames : 0.0,
+		   EmulatorStats.m_ullRoundTrips ? (double)EmulatorStats.m_ullRoundTripTime / EmulatorStats.m_ullRoundTrips : 0.0,
+		   DownloadManager.m_nFailed,
+		   (int)MemoryAfter.m_ResultPool.m_cubReserved - (int)MemoryBefore.m_ResultPool.m_cubReserved);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Entry point
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+	int		nFiles;
+	double	flFrameTime;
+
+	nFiles = argc > 1 ? atoi(argv[1]) : 200;
+	flFrameTime = (argc > 2 ? atof(argv[2]) : 16.667) * 1000.0;
+
+	if (!Bench_SetupEmulator(nullptr))
+		return 1;
+
+	if (!SteamAPI_Init())
+	{
+		fprintf(stderr, "SteamAPI_Init() failed\n");
+		return 1;
+	}
+
+#ifdef _DEBUG
+	_CrtSetAllocHook(DLM_AllocHook);
+#endif
+
+	printf("%d files per run, %.1f ms frames\n\n", nFiles, flFrameTime / 1000.0);
+	printf("%4s %-6s %6s %8s %8s %8s %8s %8s %8s %8s %8s %7s %7s %6s %9s\n",
+		   "CONC", "MIX", "FRAMES", "FT P50", "FT P90", "FT P99", "FT MAX", "DL P50", "DL P99", "DL MAX", "ALLOC/F", "IPC/F", "IPC US", "FAILED", "POOL +B");
+	printf("%4s %-6s %6s %8s %8s %8s %8s %8s %8s %8s\n", "", "", "", "us", "us", "us", "us", "ms", "ms", "ms");
+
+	for (int i = 0; i < ARRAYSIZE(k_SizeMixes); i++)
+	{
+		for (int j = 0; j < ARRAYSIZE(k_nConcurrencyLevels); j++)
+			DLM_RunScenario(k_nConcurrencyLevels[j], &k_SizeMixes[i], nFiles, flFrameTime);
+	}
+
+#ifdef _DEBUG
+	_CrtSetAllocHook(nullptr);
+#endif
+
+	SteamAPI_Shutdown();
+	return 0;
+}
@@ -6,6 +6,17 @@
 //=============================================================================
 
 #include "steam_api_pch.h"
+#include <deque>
+#include <malloc.h>
+#include "apiconfig.h"
+#include "flightrecorder.h"
+#include "livestats.h"
+#include "calllatency.h"
+#include "handlerwatchdog.h"
+#include "resultpool.h"
+#include "memfootprint.h"
+#include "authtickets.h"
+#include "screenshotpipeline.h"
 
 // Set inside CCallbackMgr constructor and destructor. True if the class has been
 // instantiated and the constructor was called. False if the class object has been
@@ -29,6 +40,12 @@ typedef void (*pfnSteam_FreeLastCallback_t)(HSteamPipe hSteamPipe);
 typedef bool (*pfnSteam_GetAPICallResult_t)(HSteamPipe hSteamPipe, SteamAPICall_t hSteamAPICall, void* pCallback, int cubCallback, int iCallbackExpected, bool* pbFailed);
 typedef bool (*pfnSteam_CallbackDispatchMsg_t)(CallbackMsg_t* pCallbackMessage, bool bGameServerCallbacks);
 
+// Maximum number of internal observers the manager can hold at once
+#define MAX_CALLBACK_OBSERVERS		16
+
+// Approximate heap size of one map node, the pair plus three links and colour
+#define CALLBACK_MAP_NODE_SIZE(T)	(sizeof(T::value_type) + 4 * sizeof(void*))
+
 //-----------------------------------------------------------------------------
 // Purpose: Callback management class
 //-----------------------------------------------------------------------------
@@ -41,6 +58,37 @@ private:
 	template<class T>
 	using CallbackMultimap = std::multimap<T, CCallbackBase*>;
 
+	// Call result waiting for its handle. A listen server has the client and 
+	// the game server pipe open, each one only completes its own calls. The
+	// pipe is looked up only when it matters, until then it's NULL.
+	struct CallResult_t
+	{
+		CCallbackBase*				m_pCallback;
+		HSteamPipe					m_hSteamPipe;
+	};
+
+	using CallResultMultimap = std::multimap<SteamAPICall_t, CallResult_t>;
+
+	// Internal steam_api listener for a callback id. These are kept outside of
+	// m_CallbackMap, so they never shadow callbacks registered by the game.
+	struct CallbackObserver_t
+	{
+		int							m_iCallback;
+		pfnCallbackMgr_Observer_t	m_pfnObserver;
+	};
+
+	// Run of a demoted handler, postponed till the end of the pump. The
+	// payload is a copy, the original is gone by then.
+	struct DeferredRun_t
+	{
+		CCallbackBase*				m_pCallback;
+		void*						m_pubParam;
+		int							m_cubParam;
+		bool						m_bCallResult;
+		bool						m_bIOFailed;
+		SteamAPICall_t				m_hAPICall;
+	};
+
 public:
 	CCallbackMgr();
 	~CCallbackMgr();
@@ -54,18 +102,38 @@ public:
 
 	void RegisterInterfaceFuncs(HMODULE hModule);
 
+	void AddObserver(int iCallback, pfnCallbackMgr_Observer_t pfnObserver);
+	void RemoveObserver(int iCallback, pfnCallbackMgr_Observer_t pfnObserver);
+	void NotifyObservers(HSteamPipe hSteamPipe, CallbackMsg_t *pCallbackMsg);
+
 	void OnSteamAPICallCompleted(SteamAPICallCompleted_t *pCompletedSteamAPICall);
+	void ResolveCallResultPipes();
+	void FailPendingCallResults(HSteamPipe hSteamPipe);
+	void FailCallResult(CCallbackBase *pCallback, SteamAPICall_t hAPICall);
+	uint32 GetPendingCallResultCount(HSteamPipe hSteamPipe);
 
 	// Callback dispatch
 	void RunCallbacks(HSteamPipe hSteamPipe, bool bGameServerCallbacks);
 	void DispatchCallback(CallbackMsg_t *pCallbackMsg, bool bGameServerCallbacks);
 	void DispatchCallbackTryCatch(CallbackMsg_t *pCallbackMsg, bool bGameServerCallbacks);
 	void DispatchCallbackNoTryCatch(CallbackMsg_t *pCallbackMsg, bool bGameServerCallbacks);
+	void DispatchLocal(int iCallback, void *pvParam, int cubParam);
+
+	// Watched handler execution
+	void RunCallback(CCallbackBase *pCallback, void *pvParam, int cubParam);
+	void RunCallResult(CCallbackBase *pCallback, void *pvParam, int cubParam, bool bIOFailed, SteamAPICall_t hAPICall);
+	bool Defer(CCallbackBase *pCallback, void *pvParam, int cubParam, bool bCallResult, bool bIOFailed, SteamAPICall_t hAPICall);
+	void RunDeferred();
+	void PurgeDeferred(CCallbackBase *pCallback);
+
+	// Memory footprint
+	void GetMemoryUsage(SteamAPIMemoryStats_t *pStats);
+	uint32 Compact();
 
 public:
 	// Call maps
 	CallbackMultimap<int>				m_CallbackMap;
-	CallbackMultimap<SteamAPICall_t>	m_APICallMap;
+	CallResultMultimap					m_APICallMap;
 
 	// Callback steamclient API
 	pfnSteam_BGetCallback_t 			pfnSteam_BGetCallback;
@@ -80,6 +148,40 @@ public:
 	pfnSteam_CallbackDispatchMsg_t 		pfnSteam_CallbackDispatchMsg;
 	SteamAPICallback<false>				m_SteamCallback;
 	SteamAPICallback<true>				m_SteamGameServerCallback;
+
+	// Internal listeners
+	CallbackObserver_t					m_Observers[MAX_CALLBACK_OBSERVERS];
+	int									m_nObservers;
+
+	// Runs of demoted handlers, see handlerwatchdog.h
+	std::deque<DeferredRun_t>			m_DeferredRuns;
+
+	// Taken by the C interface when callback_locking is set. Critical section
+	// is used as handlers register and unregister from within the dispatch.
+	CRITICAL_SECTION					m_Lock;
+	bool								m_bLocking;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Holds the manager's lock for the scope, if locking is enabled.
+//-----------------------------------------------------------------------------
+class CCallbackMgrAutoLock
+{
+public:
+	CCallbackMgrAutoLock(CCallbackMgr *pCallbackMgr) : m_pCallbackMgr(pCallbackMgr->m_bLocking ? pCallbackMgr : nullptr)
+	{
+		if (m_pCallbackMgr)
+			EnterCriticalSection(&m_pCallbackMgr->m_Lock);
+	}
+
+	~CCallbackMgrAutoLock()
+	{
+		if (m_pCallbackMgr)
+			LeaveCriticalSection(&m_pCallbackMgr->m_Lock);
+	}
+
+private:
+	CCallbackMgr* m_pCallbackMgr;
 };
 
 //-----------------------------------------------------------------------------
@@ -98,12 +200,19 @@ CCallbackMgr::CCallbackMgr() :
 
 	// Communication to the steam client
 	m_hSteamPipe(NULL),
-	m_hSteamUser(NULL)
+	m_hSteamUser(NULL),
+
+	// Internal listeners
+	m_nObservers(0)
 {
 	// API call maps
 	m_CallbackMap.clear();
 	m_APICallMap.clear();
 
+	// Decided once, the manager may be in use before SteamAPI_Init()
+	InitializeCriticalSection(&m_Lock);
+	m_bLocking = SteamAPIConfig()->m_bCallbackLocking;
+
 	s_bCallbackManagerInitialized = true;
 }
 
@@ -113,6 +222,8 @@ CCallbackMgr::CCallbackMgr() :
 CCallbackMgr::~CCallbackMgr()
 {
 	s_bCallbackManagerInitialized = false;
+
+	DeleteCriticalSection(&m_Lock);
 }
 
 //-----------------------------------------------------------------------------
@@ -149,38 +260,54 @@ void CCallbackMgr::Unregister(CCallbackBase *pCallback)
 			m_CallbackMap.erase(Iter);
 		}
 	}
+
+	PurgeDeferred(pCallback);
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: Adds new call result to the map
+// Purpose: Adds new call result to the map, its pipe is resolved later by
+//			ResolveCallResultPipes()
 //-----------------------------------------------------------------------------
 void CCallbackMgr::RegisterCallResult(CCallbackBase* pCallback, SteamAPICall_t hAPICall)
 {
-	m_APICallMap.insert(std::make_pair(hAPICall, pCallback));
+	CallResult_t	CallResult;
+
+	CallResult.m_pCallback = pCallback;
+	CallResult.m_hSteamPipe = NULL;
+
+	m_APICallMap.insert(std::make_pair(hAPICall, CallResult));
+
+	CallLatency_OnIssue(hAPICall);
 }
 
 //-----------------------------------------------------------------------------
 // Purpose: Looks for a specific APICall handle entry and erases it from the map.
+// 
+// Note:	Call results never get the registered flag set, so the entry has to
+//			be looked up by its handle. Several objects may wait for the same
+//			handle, hence only the matching pair is erased.
 //-----------------------------------------------------------------------------
 void CCallbackMgr::UnregisterCallResult(CCallbackBase *pCallback, SteamAPICall_t hAPICall)
 {
-	// If already unregistered there's no need to do it again
-	if (!(pCallback->m_nCallbackFlags & CCallbackBase::k_ECallbackFlagsRegistered))
-		return;
-
-	// Mark as unregistered so we don't then process unregisterd api call
-	pCallback->m_nCallbackFlags &= ~CCallbackBase::k_ECallbackFlagsRegistered;
+	auto Range = m_APICallMap.equal_range(hAPICall);
 
 	// Find matched api call and unregister it from the list
-	auto Iter = m_APICallMap.find(pCallback->GetICallback());
-	if (Iter != m_APICallMap.end())
+	for (auto Iter = Range.first; Iter != Range.second; ++Iter)
 	{
-		if (Iter->second == pCallback)
+		if (Iter->second.m_pCallback == pCallback)
 		{
 			m_APICallMap.erase(Iter);
+
+			// Nobody waits for the call anymore
+			if (m_APICallMap.find(hAPICall) == m_APICallMap.end())
+				CallLatency_OnCancel(hAPICall);
+
+			break;
 		}
 	}
 
+	// Completed result may still wait in the deferred queue
+	PurgeDeferred(pCallback);
 }
 
 //-----------------------------------------------------------------------------
@@ -197,6 +324,55 @@ void CCallbackMgr::RegisterInterfaceFuncs(HMODULE hModule)
 	m_SteamGameServerCallback.Register(this, &CCallbackMgr::OnSteamAPICallCompleted);
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Adds internal listener for specified callback id. Adding the same
+//			listener twice is ignored.
+//-----------------------------------------------------------------------------
+void CCallbackMgr::AddObserver(int iCallback, pfnCallbackMgr_Observer_t pfnObserver)
+{
+	for (int i = 0; i < m_nObservers; i++)
+	{
+		if (m_Observers[i].m_iCallback == iCallback && m_Observers[i].m_pfnObserver == pfnObserver)
+			return;
+	}
+
+	if (m_nObservers >= MAX_CALLBACK_OBSERVERS)
+		return;
+
+	m_Observers[m_nObservers].m_iCallback = iCallback;
+	m_Observers[m_nObservers].m_pfnObserver = pfnObserver;
+	m_nObservers++;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Removes internal listener, the order of the rest is kept.
+//-----------------------------------------------------------------------------
+void CCallbackMgr::RemoveObserver(int iCallback, pfnCallbackMgr_Observer_t pfnObserver)
+{
+	for (int i = 0; i < m_nObservers; i++)
+	{
+		if (m_Observers[i].m_iCallback != iCallback || m_Observers[i].m_pfnObserver != pfnObserver)
+			continue;
+
+		memmove(&m_Observers[i], &m_Observers[i + 1], (m_nObservers - i - 1) * sizeof(CallbackObserver_t));
+		m_nObservers--;
+		return;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Lets internal listeners see the message before it's dispatched to
+//			the callbacks registered by the game.
+//-----------------------------------------------------------------------------
+void CCallbackMgr::NotifyObservers(HSteamPipe hSteamPipe, CallbackMsg_t *pCallbackMsg)
+{
+	for (int i = 0; i < m_nObservers; i++)
+	{
+		if (m_Observers[i].m_iCallback == pCallbackMsg->m_iCallback)
+			m_Observers[i].m_pfnObserver(hSteamPipe, pCallbackMsg->m_iCallback, pCallbackMsg->m_pubParam, pCallbackMsg->m_cubParam);
+	}
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Routine that is called on APICall completion. It's responsible for
 //			executing the callback and then for unregistering it.
@@ -204,10 +380,12 @@ void CCallbackMgr::RegisterInterfaceFuncs(HMODULE hModule)
 void CCallbackMgr::OnSteamAPICallCompleted(SteamAPICallCompleted_t *pCompletedSteamAPICall)
 {
 	void*			pCallbackData;
-	bool			bIOFailed;
+	bool			bIOFailed, bPooledData;
 	CCallbackBase*	pCallbackBase;
 	int				iCallbackSize;
 	SteamAPICall_t	hAPICall;
+	uint64			ullStartTime;
+	CallbackMsg_t	CallbackMsg;
 
 	hAPICall = pCompletedSteamAPICall->m_hAsyncCall;
 	
@@ -215,22 +393,152 @@ void CCallbackMgr::OnSteamAPICallCompleted(SteamAPICallCompleted_t *pCompletedSt
 	if (APICall == m_APICallMap.end())
 		return;
 
-	pCallbackBase = APICall->second;
+	pCallbackBase = APICall->second.m_pCallback;
 	iCallbackSize = pCallbackBase->GetCallbackSizeBytes();
 	bIOFailed = false;
 
-	pCallbackData = malloc(iCallbackSize);
+	CallLatency_OnComplete(hAPICall, pCallbackBase->GetICallback());
+
+	// We don't need it no more. Erase it before running, so that the handler
+	// is free to register the same object for another call.
+	m_APICallMap.erase(APICall);
+
+	FlightRecorder_Record(FLIGHTRECORD_CALLRESULT, pCallbackBase->GetICallback(), m_hSteamPipe, hAPICall, iCallbackSize);
+
+	// Out of memory, the stack will do. A deferred run copies the payload, 
+	// or runs inline when it can't.
+	pCallbackData = ResultPool_Alloc(iCallbackSize);
+	bPooledData = pCallbackData != nullptr;
+
+	if (!bPooledData)
+		pCallbackData = _alloca(iCallbackSize);
 
 	// Try to dispatch the callback
 	if (pfnSteam_GetAPICallResult(m_hSteamPipe, hAPICall, pCallbackData, iCallbackSize, pCallbackBase->GetICallback(), &bIOFailed))
 	{
-		pCallbackBase->Run(pCallbackData, bIOFailed, hAPICall);
+		LiveStats_OnCallResult(pCallbackBase->GetICallback(), pCallbackData, bIOFailed);
+
+		// Internal listeners see results the game asked for as well, some
+		// are never posted as callbacks
+		if (m_nObservers && !bIOFailed)
+		{
+			CallbackMsg.m_hSteamUser = m_hSteamUser;
+			CallbackMsg.m_iCallback = pCallbackBase->GetICallback();
+			CallbackMsg.m_pubParam = (uint8*)pCallbackData;
+			CallbackMsg.m_cubParam = iCallbackSize;
+
+			NotifyObservers(m_hSteamPipe, &CallbackMsg);
+		}
+
+		ullStartTime = Steam_GetMicroseconds();
+		RunCallResult(pCallbackBase, pCallbackData, iCallbackSize, bIOFailed, hAPICall);
+		LiveStats_OnCallback(pCallbackBase->GetICallback(), (uint32)(Steam_GetMicroseconds() - ullStartTime));
+	}
+
+	if (bPooledData)
+		ResultPool_Free(pCallbackData);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Looks up the pipe of every call result that doesn't know it yet.
+//			Only done on shutdown and reconnect, on a listen server it costs
+//			a call into steamclient per result.
+//-----------------------------------------------------------------------------
+void CCallbackMgr::ResolveCallResultPipes()
+{
+	for (auto Iter = m_APICallMap.begin(); Iter != m_APICallMap.end(); ++Iter)
+	{
+		if (!Iter->second.m_hSteamPipe)
+			Iter->second.m_hSteamPipe = SteamAPI_GetCallPipe_Internal(Iter->first);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Completes every outstanding call result of the pipe with an IO 
+//			failure, 0 fails those of every pipe. Used when the pipe the 
+//			results were issued on is gone, so nothing would ever complete 
+//			them. Results are failed in the order of their handles.
+//-----------------------------------------------------------------------------
+void CCallbackMgr::FailPendingCallResults(HSteamPipe hSteamPipe)
+{
+	CallResultMultimap	PendingCalls;
+
+	if (hSteamPipe)
+		ResolveCallResultPipes();
+
+	// Take the pipe's entries out, handlers may register new calls while we 
+	// run them
+	for (auto Iter = m_APICallMap.begin(); Iter != m_APICallMap.end(); )
+	{
+		if (!hSteamPipe || Iter->second.m_hSteamPipe == hSteamPipe)
+		{
+			PendingCalls.insert(*Iter);
+			Iter = m_APICallMap.erase(Iter);
+		}
+		else
+		{
+			++Iter;
+		}
 	}
 
-	free(pCallbackData);
+	for (auto Iter = PendingCalls.begin(); Iter != PendingCalls.end(); ++Iter)
+	{
+		// Only calls of this pipe are forgotten, the other one keeps timing
+		if (Iter == PendingCalls.begin() || std::prev(Iter)->first != Iter->first)
+			CallLatency_OnCancel(Iter->first);
 
-	// We don't need it no more
-	UnregisterCallResult(pCallbackBase, hAPICall);
+		FailCallResult(Iter->second.m_pCallback, Iter->first);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Runs one call result with zeroed data and an IO failure. Out of 
+//			memory the payload goes on the stack, which is given back on
+//			return.
+//-----------------------------------------------------------------------------
+void CCallbackMgr::FailCallResult(CCallbackBase *pCallback, SteamAPICall_t hAPICall)
+{
+	void*	pCallbackData;
+	int		iCallbackSize;
+	bool	bPooledData;
+
+	iCallbackSize = pCallback->GetCallbackSizeBytes();
+
+	pCallbackData = ResultPool_Alloc(iCallbackSize);
+	bPooledData = pCallbackData != nullptr;
+
+	if (!bPooledData)
+		pCallbackData = _alloca(iCallbackSize);
+
+	memset(pCallbackData, 0, iCallbackSize);
+	pCallback->Run(pCallbackData, true, hAPICall);
+
+	if (bPooledData)
+		ResultPool_Free(pCallbackData);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns number of call results of the pipe that haven't completed
+//			yet, 0 counts those of every pipe.
+//-----------------------------------------------------------------------------
+uint32 CCallbackMgr::GetPendingCallResultCount(HSteamPipe hSteamPipe)
+{
+	uint32	nPending;
+
+	if (!hSteamPipe)
+		return m_APICallMap.size();
+
+	ResolveCallResultPipes();
+
+	nPending = 0;
+
+	for (auto Iter = m_APICallMap.begin(); Iter != m_APICallMap.end(); ++Iter)
+	{
+		if (Iter->second.m_hSteamPipe == hSteamPipe)
+			nPending++;
+	}
+
+	return nPending;
 }
 
 //-----------------------------------------------------------------------------
@@ -238,10 +546,18 @@ void CCallbackMgr::OnSteamAPICallCompleted(SteamAPICallCompleted_t *pCompletedSt
 //			pipe. Whenether callbacks are dispatched is controlled by internal
 //			steamclient API - pfnSteam_BGetCallback() function. After the callback
 //			is dispatched, it's freed by calling pfnSteam_FreeLastCallback().
+// 
+// Note:	Pump may be limited by message count and time budget, see 
+//			pump_max_messages and pump_budget_us configuration keys. Messages
+//			left over stay queued inside steamclient for the next frame.
 //-----------------------------------------------------------------------------
 void CCallbackMgr::RunCallbacks(HSteamPipe hSteamPipe, bool bGameServerCallbacks)
 {
-	CallbackMsg_t CallbackMsg;
+	CallbackMsg_t			CallbackMsg;
+	const SteamAPIConfig_t*	pConfig;
+	uint32					nMessages;
+	uint64					ullDeadline, ullPumpStartTime, ullStartTime;
+	bool					bCutoff;
 
 	if (!pfnSteam_BGetCallback || !pfnSteam_FreeLastCallback)
 		return;
@@ -253,16 +569,61 @@ void CCallbackMgr::RunCallbacks(HSteamPipe hSteamPipe, bool bGameServerCallbacks
 	s_bRunningCallbacks = true;
 	m_hSteamPipe = hSteamPipe;
 
+	pConfig = SteamAPIConfig();
+	nMessages = 0;
+	bCutoff = false;
+	ullPumpStartTime = Steam_GetMicroseconds();
+	ullDeadline = pConfig->m_unPumpBudget ? ullPumpStartTime + pConfig->m_unPumpBudget : 0;
+
 	// Execute callbacks till there's no more left
 	while (pfnSteam_BGetCallback(hSteamPipe, &CallbackMsg))
 	{
 		m_hSteamUser = CallbackMsg.m_hSteamUser;
 
+		FlightRecorder_Record(FLIGHTRECORD_CALLBACK, CallbackMsg.m_iCallback, hSteamPipe, 
+			CallbackMsg.m_iCallback == SteamAPICallCompleted_t::k_iCallback ? ((SteamAPICallCompleted_t*)CallbackMsg.m_pubParam)->m_hAsyncCall : k_uAPICallInvalid, 
+			CallbackMsg.m_cubParam);
+
+		// Internal listeners go first
+		if (m_nObservers)
+			NotifyObservers(hSteamPipe, &CallbackMsg);
+
 		// Call exception or non-exception cared callback dispatcher
+		ullStartTime = Steam_GetMicroseconds();
 		DispatchCallback(&CallbackMsg, bGameServerCallbacks);
+		LiveStats_OnCallback(CallbackMsg.m_iCallback, (uint32)(Steam_GetMicroseconds() - ullStartTime));
 
 		if (pfnSteam_FreeLastCallback)
 			pfnSteam_FreeLastCallback(hSteamPipe);
+
+		nMessages++;
+
+		// Out of budget for this frame
+		if (pConfig->m_unPumpMaxMessages && nMessages >= pConfig->m_unPumpMaxMessages)
+		{
+			bCutoff = true;
+			break;
+		}
+
+		if (ullDeadline && Steam_GetMicroseconds() >= ullDeadline)
+		{
+			bCutoff = true;
+			break;
+		}
+	}
+
+	if (!m_DeferredRuns.empty())
+		RunDeferred();
+
+	LiveStats_OnPump(nMessages, (uint32)(Steam_GetMicroseconds() - ullPumpStartTime), bCutoff);
+	LiveStats_Publish();
+
+	Footprint_OnPump(nMessages);
+
+	if (!bGameServerCallbacks)
+	{
+		AuthTickets_OnPump();
+		ScreenshotPipeline_OnPump();
 	}
 
 	m_hSteamPipe = NULL;
@@ -305,7 +666,7 @@ void CCallbackMgr::DispatchCallbackTryCatch(CallbackMsg_t *pCallbackMsg, bool bG
 			if (bGameServerCallbacks == ((pCallback->m_nCallbackFlags & CCallbackBase::k_ECallbackFlagsGameServer) >> 1))
 			{
 				bGameServer = true;
-				pCallback->Run(pCallbackMsg->m_pubParam);
+				RunCallback(pCallback, pCallbackMsg->m_pubParam, pCallbackMsg->m_cubParam);
 			}
 		}
 
@@ -340,7 +701,7 @@ void CCallbackMgr::DispatchCallbackNoTryCatch(CallbackMsg_t *pCallbackMsg, bool
 		if (bGameServerCallbacks == (((pCallback->m_nCallbackFlags & CCallbackBase::k_ECallbackFlagsGameServer) >> 1) == 1))
 		{
 			bGameServer = true;
-			pCallback->Run(pCallbackMsg->m_pubParam);
+			RunCallback(pCallback, pCallbackMsg->m_pubParam, pCallbackMsg->m_cubParam);
 		}
 	}
 
@@ -348,6 +709,201 @@ void CCallbackMgr::DispatchCallbackNoTryCatch(CallbackMsg_t *pCallbackMsg, bool
 		pfnSteam_CallbackDispatchMsg(pCallbackMsg, bGameServer != false);
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Runs the game callback of a message steam_api raises on its own.
+//			Steamclient never sees these. Only called from within the pump.
+//-----------------------------------------------------------------------------
+void CCallbackMgr::DispatchLocal(int iCallback, void *pvParam, int cubParam)
+{
+	CallbackMsg_t	CallbackMsg;
+	CCallbackBase*	pCallback;
+
+	CallbackMsg.m_hSteamUser = m_hSteamUser;
+	CallbackMsg.m_iCallback = iCallback;
+	CallbackMsg.m_pubParam = (uint8*)pvParam;
+	CallbackMsg.m_cubParam = cubParam;
+
+	FlightRecorder_Record(FLIGHTRECORD_CALLBACK, iCallback, m_hSteamPipe, k_uAPICallInvalid, cubParam);
+
+	if (m_nObservers)
+		NotifyObservers(m_hSteamPipe, &CallbackMsg);
+
+	auto Iter = m_CallbackMap.find(iCallback);
+	if (Iter == m_CallbackMap.end())
+		return;
+
+	pCallback = Iter->second;
+
+	if (pCallback->m_nCallbackFlags & CCallbackBase::k_ECallbackFlagsGameServer)
+		return;
+
+	RunCallback(pCallback, pvParam, cubParam);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Runs the callback handler under the watchdog, or queues it when
+//			the handler has been demoted.
+//-----------------------------------------------------------------------------
+void CCallbackMgr::RunCallback(CCallbackBase *pCallback, void *pvParam, int cubParam)
+{
+	uint64 ullStartTicks;
+
+	// Our own completion handler only forwards to call results, those are
+	// watched on their own
+	if (pCallback == &m_SteamCallback || pCallback == &m_SteamGameServerCallback)
+	{
+		pCallback->Run(pvParam);
+		return;
+	}
+
+	// Runs inline when there's no memory for the copy, it mustn't get lost
+	if (Watchdog_IsDemoted(pCallback) && Defer(pCallback, pvParam, cubParam, false, false, k_uAPICallInvalid))
+		return;
+
+	ullStartTicks = __rdtsc();
+	pCallback->Run(pvParam);
+	Watchdog_OnRun(pCallback, pCallback->GetICallback(), __rdtsc() - ullStartTicks, false);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Same as RunCallback(), for call results.
+//-----------------------------------------------------------------------------
+void CCallbackMgr::RunCallResult(CCallbackBase *pCallback, void *pvParam, int cubParam, bool bIOFailed, SteamAPICall_t hAPICall)
+{
+	uint64 ullStartTicks;
+
+	if (Watchdog_IsDemoted(pCallback) && Defer(pCallback, pvParam, cubParam, true, bIOFailed, hAPICall))
+		return;
+
+	ullStartTicks = __rdtsc();
+	pCallback->Run(pvParam, bIOFailed, hAPICall);
+	Watchdog_OnRun(pCallback, pCallback->GetICallback(), __rdtsc() - ullStartTicks, false);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Queues the run of a demoted handler with a copy of its payload.
+//			Returns false if the payload couldn't be copied.
+//-----------------------------------------------------------------------------
+bool CCallbackMgr::Defer(CCallbackBase *pCallback, void *pvParam, int cubParam, bool bCallResult, bool bIOFailed, SteamAPICall_t hAPICall)
+{
+	DeferredRun_t DeferredRun;
+
+	DeferredRun.m_pCallback = pCallback;
+	DeferredRun.m_pubParam = ResultPool_Alloc(cubParam);
+	DeferredRun.m_cubParam = cubParam;
+	DeferredRun.m_bCallResult = bCallResult;
+	DeferredRun.m_bIOFailed = bIOFailed;
+	DeferredRun.m_hAPICall = hAPICall;
+
+	if (!DeferredRun.m_pubParam)
+		return false;
+
+	memcpy(DeferredRun.m_pubParam, pvParam, cubParam);
+	m_DeferredRuns.push_back(DeferredRun);
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Runs queued handlers in order within deferred_budget_us. At least
+//			one is run per pump, so the queue always moves.
+//-----------------------------------------------------------------------------
+void CCallbackMgr::RunDeferred()
+{
+	DeferredRun_t	DeferredRun;
+	uint32			unBudget;
+	uint64			ullDeadline, ullStartTicks;
+
+	unBudget = SteamAPIConfig()->m_unDeferredBudget;
+	ullDeadline = unBudget ? Steam_GetMicroseconds() + unBudget : 0;
+
+	while (!m_DeferredRuns.empty())
+	{
+		// Pop first, the handler may unregister itself and purge the queue
+		DeferredRun = m_DeferredRuns.front();
+		m_DeferredRuns.pop_front();
+
+		ullStartTicks = __rdtsc();
+
+		try
+		{
+			if (DeferredRun.m_bCallResult)
+				DeferredRun.m_pCallback->Run(DeferredRun.m_pubParam, DeferredRun.m_bIOFailed, DeferredRun.m_hAPICall);
+			else
+				DeferredRun.m_pCallback->Run(DeferredRun.m_pubParam);
+		}
+		catch (...)
+		{
+			if (g_bCatchExceptionsInCallbacks == false)
+			{
+				ResultPool_Free(DeferredRun.m_pubParam);
+				throw;
+			}
+#ifdef REGS_FIXES
+			__debugbreak();
+#endif
+		}
+
+		Watchdog_OnRun(DeferredRun.m_pCallback, DeferredRun.m_pCallback->GetICallback(), __rdtsc() - ullStartTicks, true);
+		ResultPool_Free(DeferredRun.m_pubParam);
+
+		if (ullDeadline && Steam_GetMicroseconds() >= ullDeadline)
+			break;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Drops queued runs of the handler that is being unregistered.
+//-----------------------------------------------------------------------------
+void CCallbackMgr::PurgeDeferred(CCallbackBase *pCallback)
+{
+	for (auto Iter = m_DeferredRuns.begin(); Iter != m_DeferredRuns.end();)
+	{
+		if (Iter->m_pCallback == pCallback)
+		{
+			ResultPool_Free(Iter->m_pubParam);
+			Iter = m_DeferredRuns.erase(Iter);
+		}
+		else
+		{
+			++Iter;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Fills footprint of the registries and the deferred queue. Map 
+//			nodes go back to the heap on erase, so nothing is held beyond the
+//			entries. The deque's spare blocks can't be seen and aren't counted.
+//-----------------------------------------------------------------------------
+void CCallbackMgr::GetMemoryUsage(SteamAPIMemoryStats_t *pStats)
+{
+	pStats->m_Callbacks.m_nEntries = m_CallbackMap.size();
+	pStats->m_Callbacks.m_cubUsed = m_CallbackMap.size() * CALLBACK_MAP_NODE_SIZE(CallbackMultimap<int>);
+	pStats->m_Callbacks.m_cubReserved = pStats->m_Callbacks.m_cubUsed;
+
+	pStats->m_CallResults.m_nEntries = m_APICallMap.size();
+	pStats->m_CallResults.m_cubUsed = m_APICallMap.size() * CALLBACK_MAP_NODE_SIZE(CallResultMultimap);
+	pStats->m_CallResults.m_cubReserved = pStats->m_CallResults.m_cubUsed;
+
+	// Payloads are counted with the result pool
+	pStats->m_DeferredRuns.m_nEntries = m_DeferredRuns.size();
+	pStats->m_DeferredRuns.m_cubUsed = m_DeferredRuns.size() * sizeof(DeferredRun_t);
+	pStats->m_DeferredRuns.m_cubReserved = pStats->m_DeferredRuns.m_cubUsed;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Shrinks the deferred queue and the result pool, returns bytes 
+//			released. Only the pool's cached buffers are counted, the queue's
+//			spare blocks aren't known.
+//-----------------------------------------------------------------------------
+uint32 CCallbackMgr::Compact()
+{
+	m_DeferredRuns.shrink_to_fit();
+
+	return ResultPool_Compact();
+}
+
 //-----------------------------------------------------------------------------
 // 
 // Callback manager C interface
@@ -368,6 +924,8 @@ CCallbackMgr *GCallbackMgr()
 //-----------------------------------------------------------------------------
 void CallbackMgr_RegisterCallback(CCallbackBase *pCallback, int iCallback)
 {
+	CCallbackMgrAutoLock Lock(GCallbackMgr());
+
 	GCallbackMgr()->Register(pCallback, iCallback);
 }
 
@@ -379,6 +937,8 @@ void CallbackMgr_UnregisterCallback(CCallbackBase *pCallback)
 	if (s_bCallbackManagerInitialized != true)
 		return;
 
+	CCallbackMgrAutoLock Lock(GCallbackMgr());
+
 	GCallbackMgr()->Unregister(pCallback);
 }
 
@@ -387,6 +947,8 @@ void CallbackMgr_UnregisterCallback(CCallbackBase *pCallback)
 //-----------------------------------------------------------------------------
 void CallbackMgr_RegisterCallResult(CCallbackBase *pCallback, SteamAPICall_t hAPICall)
 {
+	CCallbackMgrAutoLock Lock(GCallbackMgr());
+
 	GCallbackMgr()->RegisterCallResult(pCallback, hAPICall);
 }
 
@@ -398,6 +960,8 @@ void CallbackMgr_UnregisterCallResult(CCallbackBase *pCallback, SteamAPICall_t h
 	if (s_bCallbackManagerInitialized != true)
 		return;
 
+	CCallbackMgrAutoLock Lock(GCallbackMgr());
+
 	GCallbackMgr()->UnregisterCallResult(pCallback, hAPICall);
 }
 
@@ -406,6 +970,8 @@ void CallbackMgr_UnregisterCallResult(CCallbackBase *pCallback, SteamAPICall_t h
 //-----------------------------------------------------------------------------
 void CallbackMgr_RunCallbacks(HSteamPipe SteamPipe, bool bGameServerCallbacks)
 {
+	CCallbackMgrAutoLock Lock(GCallbackMgr());
+
 	GCallbackMgr()->RunCallbacks(SteamPipe, bGameServerCallbacks);
 }
 
@@ -414,9 +980,119 @@ void CallbackMgr_RunCallbacks(HSteamPipe SteamPipe, bool bGameServerCallbacks)
 //-----------------------------------------------------------------------------
 void CallbackMgr_RegisterInterfaceFuncs(HMODULE hModule)
 {
+	FlightRecorder_Init();
+	LiveStats_Init();
 	GCallbackMgr()->RegisterInterfaceFuncs(hModule);
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Adds internal listener for specified callback id.
+//-----------------------------------------------------------------------------
+void CallbackMgr_AddObserver(int iCallback, pfnCallbackMgr_Observer_t pfnObserver)
+{
+	CCallbackMgrAutoLock Lock(GCallbackMgr());
+
+	GCallbackMgr()->AddObserver(iCallback, pfnObserver);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Dispatches a message of steam_api to the game, see CCallbackMgr.
+//-----------------------------------------------------------------------------
+void CallbackMgr_DispatchLocal(int iCallback, void *pvParam, int cubParam)
+{
+	CCallbackMgrAutoLock Lock(GCallbackMgr());
+
+	GCallbackMgr()->DispatchLocal(iCallback, pvParam, cubParam);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Removes internal listener for specified callback id.
+//-----------------------------------------------------------------------------
+void CallbackMgr_RemoveObserver(int iCallback, pfnCallbackMgr_Observer_t pfnObserver)
+{
+	if (s_bCallbackManagerInitialized != true)
+		return;
+
+	CCallbackMgrAutoLock Lock(GCallbackMgr());
+
+	GCallbackMgr()->RemoveObserver(iCallback, pfnObserver);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Tags outstanding call results with their pipe, has to be done
+//			while the pipes are still open.
+//-----------------------------------------------------------------------------
+void CallbackMgr_ResolveCallResultPipes()
+{
+	if (s_bCallbackManagerInitialized != true)
+		return;
+
+	CCallbackMgrAutoLock Lock(GCallbackMgr());
+
+	GCallbackMgr()->ResolveCallResultPipes();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Fails outstanding call results of the pipe, see CCallbackMgr.
+//-----------------------------------------------------------------------------
+void CallbackMgr_FailPendingCallResults(HSteamPipe hSteamPipe)
+{
+	if (s_bCallbackManagerInitialized != true)
+		return;
+
+	CCallbackMgrAutoLock Lock(GCallbackMgr());
+
+	GCallbackMgr()->FailPendingCallResults(hSteamPipe);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns true while a pump is dispatching, handlers are on the stack.
+//-----------------------------------------------------------------------------
+bool CallbackMgr_IsDispatching()
+{
+	return s_bRunningCallbacks;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns number of call results of the pipe that haven't completed
+//			yet, see CCallbackMgr.
+//-----------------------------------------------------------------------------
+uint32 CallbackMgr_GetPendingCallResultCount(HSteamPipe hSteamPipe)
+{
+	if (s_bCallbackManagerInitialized != true)
+		return 0;
+
+	CCallbackMgrAutoLock Lock(GCallbackMgr());
+
+	return GCallbackMgr()->GetPendingCallResultCount(hSteamPipe);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Fills footprint of the manager's registries.
+//-----------------------------------------------------------------------------
+void CallbackMgr_GetMemoryUsage(SteamAPIMemoryStats_t *pStats)
+{
+	if (s_bCallbackManagerInitialized != true)
+		return;
+
+	CCallbackMgrAutoLock Lock(GCallbackMgr());
+
+	GCallbackMgr()->GetMemoryUsage(pStats);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Shrinks the manager's queue and the pool, returns bytes released.
+//-----------------------------------------------------------------------------
+uint32 CallbackMgr_Compact()
+{
+	if (s_bCallbackManagerInitialized != true)
+		return ResultPool_Compact();
+
+	CCallbackMgrAutoLock Lock(GCallbackMgr());
+
+	return GCallbackMgr()->Compact();
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Returns handle to steam user used by callback manager.
 //-----------------------------------------------------------------------------
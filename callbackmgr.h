@@ -8,6 +8,14 @@
 #define CALLBACK_MGR_H
 #pragma once
 
+struct SteamAPIMemoryStats_t;
+
+//-----------------------------------------------------------------------------
+// Purpose: Internal listener for a callback id, see CallbackMgr_AddObserver().
+//			Call results of the id the game waits for are passed to it too.
+//-----------------------------------------------------------------------------
+typedef void (*pfnCallbackMgr_Observer_t)(HSteamPipe hSteamPipe, int iCallback, void *pvParam, int cubParam);
+
 //-----------------------------------------------------------------------------
 // 
 // Callback manager C interface
@@ -21,6 +29,15 @@ extern void CallbackMgr_RegisterCallResult(CCallbackBase *pCallback, SteamAPICal
 extern void CallbackMgr_UnregisterCallResult(CCallbackBase *pCallback, SteamAPICall_t hAPICall);
 extern void CallbackMgr_RunCallbacks(HSteamPipe SteamPipe, bool bGameServerCallbacks);
 extern void CallbackMgr_RegisterInterfaceFuncs(HMODULE hModule);
+extern void CallbackMgr_AddObserver(int iCallback, pfnCallbackMgr_Observer_t pfnObserver);
+extern void CallbackMgr_RemoveObserver(int iCallback, pfnCallbackMgr_Observer_t pfnObserver);
+extern void CallbackMgr_DispatchLocal(int iCallback, void *pvParam, int cubParam);
+extern void CallbackMgr_ResolveCallResultPipes();
+extern void CallbackMgr_FailPendingCallResults(HSteamPipe hSteamPipe);
+extern bool CallbackMgr_IsDispatching();
+extern uint32 CallbackMgr_GetPendingCallResultCount(HSteamPipe hSteamPipe);
+extern void CallbackMgr_GetMemoryUsage(SteamAPIMemoryStats_t *pStats);
+extern uint32 CallbackMgr_Compact();
 extern HSteamUser CallbackMgr_GetHSteamUserCurrent();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,345 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "steam_api_pch.h"
+#include "calllatency.h"
+#include "memfootprint.h"
+#include "apiconfig.h"
+#include "asynclog.h"
+
+//-----------------------------------------------------------------------------
+// 
+// API call latency
+// 
+//	Issue time of every registered call result is kept in an open addressed
+//	table keyed by the handle, slots are claimed with a compare-exchange. On
+//	completion the latency goes into the histogram of the expected callback
+//	id. Nothing is allocated and no lock is taken on either side.
+// 
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Purpose: Call in flight, handle is zero when the slot is free.
+//-----------------------------------------------------------------------------
+struct PendingCall_t
+{
+	volatile LONG64	m_hAPICall;
+	uint64			m_ullIssueTime;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Histogram of one callback id, id is zero until claimed.
+//-----------------------------------------------------------------------------
+struct CallLatencyHistogram_t
+{
+	volatile LONG	m_iCallback;
+	volatile LONG	m_nCount;
+	volatile LONG	m_unMin;
+	volatile LONG	m_unMax;
+	volatile LONG64	m_ullTotal;
+	volatile LONG	m_Buckets[CALLLATENCY_BUCKETS];
+};
+
+static PendingCall_t			s_PendingCalls[CALLLATENCY_TABLE_SIZE];
+static CallLatencyHistogram_t	s_Histograms[CALLLATENCY_MAX_CALLBACKS];
+
+//-----------------------------------------------------------------------------
+// Purpose: First slot to probe for the handle.
+//-----------------------------------------------------------------------------
+static inline uint32 CallLatency_Hash(SteamAPICall_t hAPICall)
+{
+	return (uint32)((hAPICall * 0x9E3779B97F4A7C15ull) >> 32) & (CALLLATENCY_TABLE_SIZE - 1);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Bucket of the value and the lowest value of the bucket.
+//-----------------------------------------------------------------------------
+static inline uint32 CallLatency_Bucket(uint32 unValue)
+{
+	unsigned long	iHighBit;
+	uint32			unShift;
+
+	if (unValue < CALLLATENCY_SUB_BUCKETS)
+		return unValue;
+
+	_BitScanReverse(&iHighBit, unValue);
+	unShift = iHighBit - CALLLATENCY_SUB_BITS;
+
+	return (unShift + 1) * CALLLATENCY_SUB_BUCKETS + ((unValue >> unShift) & (CALLLATENCY_SUB_BUCKETS - 1));
+}
+
+static inline uint32 CallLatency_BucketValue(uint32 iBucket)
+{
+	uint32 unShift;
+
+	if (iBucket < CALLLATENCY_SUB_BUCKETS)
+		return iBucket;
+
+	unShift = iBucket / CALLLATENCY_SUB_BUCKETS - 1;
+
+	return (uint32)((uint64)(CALLLATENCY_SUB_BUCKETS + (iBucket & (CALLLATENCY_SUB_BUCKETS - 1))) << unShift);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Finds histogram of the callback id, claims free one if needed.
+//-----------------------------------------------------------------------------
+static CallLatencyHistogram_t* CallLatency_FindHistogram(int iCallback, bool bCreate)
+{
+	for (int i = 0; i < CALLLATENCY_MAX_CALLBACKS; i++)
+	{
+		CallLatencyHistogram_t* pHistogram = &s_Histograms[i];
+
+		if (pHistogram->m_iCallback == iCallback)
+			return pHistogram;
+
+		if (pHistogram->m_iCallback != 0)
+			continue;
+
+		if (!bCreate)
+			return nullptr;
+
+		if (InterlockedCompareExchange(&pHistogram->m_iCallback, iCallback, 0) == 0)
+		{
+			pHistogram->m_unMin = MAXLONG;
+			return pHistogram;
+		}
+
+		// Lost the race, the slot might have been claimed for the same id
+		if (pHistogram->m_iCallback == iCallback)
+			return pHistogram;
+	}
+
+	return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Removes the handle from the table, returns its issue time or 0.
+//-----------------------------------------------------------------------------
+static uint64 CallLatency_Remove(SteamAPICall_t hAPICall)
+{
+	uint32 iSlot = CallLatency_Hash(hAPICall);
+
+	for (int i = 0; i < CALLLATENCY_MAX_PROBES; i++, iSlot = (iSlot + 1) & (CALLLATENCY_TABLE_SIZE - 1))
+	{
+		PendingCall_t* pCall = &s_PendingCalls[iSlot];
+
+		if (pCall->m_hAPICall != (LONG64)hAPICall)
+			continue;
+
+		uint64 ullIssueTime = pCall->m_ullIssueTime;
+
+		if (InterlockedCompareExchange64(&pCall->m_hAPICall, 0, (LONG64)hAPICall) == (LONG64)hAPICall)
+			return ullIssueTime;
+	}
+
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Stamps the call when its result is registered. Calls registered 
+//			more than once keep the first stamp. Not tracked when the probe
+//			sequence is full.
+//-----------------------------------------------------------------------------
+void CallLatency_OnIssue(SteamAPICall_t hAPICall)
+{
+	uint32	iSlot;
+	uint64	ullNow;
+
+	if (hAPICall == k_uAPICallInvalid)
+		return;
+
+	ullNow = Steam_GetMicroseconds();
+	iSlot = CallLatency_Hash(hAPICall);
+
+	// Slots are freed anywhere in the sequence, the handle may sit past a
+	// free one
+	for (int i = 0; i < CALLLATENCY_MAX_PROBES; i++, iSlot = (iSlot + 1) & (CALLLATENCY_TABLE_SIZE - 1))
+	{
+		if (s_PendingCalls[iSlot].m_hAPICall == (LONG64)hAPICall)
+			return;
+	}
+
+	iSlot = CallLatency_Hash(hAPICall);
+
+	for (int i = 0; i < CALLLATENCY_MAX_PROBES; i++, iSlot = (iSlot + 1) & (CALLLATENCY_TABLE_SIZE - 1))
+	{
+		PendingCall_t* pCall = &s_PendingCalls[iSlot];
+
+		if (pCall->m_hAPICall == (LONG64)hAPICall)
+			return;
+
+		if (pCall->m_hAPICall != 0)
+			continue;
+
+		// Time goes in first, the slot becomes visible with the handle
+		pCall->m_ullIssueTime = ullNow;
+		_WriteBarrier();
+
+		if (InterlockedCompareExchange64(&pCall->m_hAPICall, (LONG64)hAPICall, 0) == 0)
+			return;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Records issue-to-completion time, logs slow calls.
+//-----------------------------------------------------------------------------
+void CallLatency_OnComplete(SteamAPICall_t hAPICall, int iCallback)
+{
+	CallLatencyHistogram_t*	pHistogram;
+	uint64					ullIssueTime, ullLatency;
+	uint32					unLatency, unSlowThreshold;
+	LONG					nOld;
+
+	ullIssueTime = CallLatency_Remove(hAPICall);
+
+	if (!ullIssueTime)
+		return;
+
+	ullLatency = Steam_GetMicroseconds() - ullIssueTime;
+	unLatency = (uint32)min(ullLatency, (uint64)MAXLONG);
+
+	pHistogram = CallLatency_FindHistogram(iCallback, true);
+
+	if (pHistogram)
+	{
+		InterlockedIncrement(&pHistogram->m_Buckets[CallLatency_Bucket(unLatency)]);
+		InterlockedExchangeAdd64(&pHistogram->m_ullTotal, unLatency);
+		InterlockedIncrement(&pHistogram->m_nCount);
+
+		while ((nOld = pHistogram->m_unMax) < (LONG)unLatency && InterlockedCompareExchange(&pHistogram->m_unMax, unLatency, nOld) != nOld)
+			;
+
+		while ((nOld = pHistogram->m_unMin) > (LONG)unLatency && InterlockedCompareExchange(&pHistogram->m_unMin, unLatency, nOld) != nOld)
+			;
+	}
+
+	unSlowThreshold = SteamAPIConfig()->m_unSlowCallThreshold;
+
+	if (unSlowThreshold && ullLatency >= (uint64)unSlowThreshold * 1000)
+		AsyncLog(k_ESteamAPILogWarning, "[S_API] Slow API call %llx, callback %d completed after %llu us.\n", hAPICall, iCallback, ullLatency);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Forgets the call, its result won't be waited for.
+//-----------------------------------------------------------------------------
+void CallLatency_OnCancel(SteamAPICall_t hAPICall)
+{
+	CallLatency_Remove(hAPICall);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Tables are static, entries are calls in flight.
+//-----------------------------------------------------------------------------
+void CallLatency_GetMemoryUsage(SteamAPIMemoryUsage_t *pUsage)
+{
+	pUsage->m_nEntries = 0;
+
+	for (int i = 0; i < CALLLATENCY_TABLE_SIZE; i++)
+	{
+		if (s_PendingCalls[i].m_hAPICall)
+			pUsage->m_nEntries++;
+	}
+
+	pUsage->m_cubUsed = sizeof(s_PendingCalls) + sizeof(s_Histograms);
+	pUsage->m_cubReserved = pUsage->m_cubUsed;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Computes stats from the histogram. Histogram may be updated while
+//			we read it, percentiles come from a slightly moving picture.
+//-----------------------------------------------------------------------------
+static void CallLatency_GetStats(const CallLatencyHistogram_t *pHistogram, SteamAPICallLatency_t *pLatency)
+{
+	const double	k_flPercentiles[] = { 0.50, 0.90, 0.99, 0.999 };
+	uint32*			pPercentiles[] = { &pLatency->m_unP50, &pLatency->m_unP90, &pLatency->m_unP99, &pLatency->m_unP999 };
+	uint32			nCount, nSeen, nTotal;
+	int				iPercentile;
+
+	memset(pLatency, 0, sizeof(SteamAPICallLatency_t));
+
+	pLatency->m_iCallback = pHistogram->m_iCallback;
+
+	// Count from the buckets, so percentiles add up
+	nTotal = 0;
+
+	for (int i = 0; i < CALLLATENCY_BUCKETS; i++)
+		nTotal += pHistogram->m_Buckets[i];
+
+	if (!nTotal)
+		return;
+
+	nCount = pHistogram->m_nCount;
+
+	pLatency->m_unCount = nCount;
+	pLatency->m_unMin = pHistogram->m_unMin;
+	pLatency->m_unMax = pHistogram->m_unMax;
+	pLatency->m_unMean = nCount ? (uint32)(pHistogram->m_ullTotal / nCount) : 0;
+
+	nSeen = 0;
+	iPercentile = 0;
+
+	for (int i = 0; i < CALLLATENCY_BUCKETS && iPercentile < Q_ARRAYSIZE(k_flPercentiles); i++)
+	{
+		nSeen += pHistogram->m_Buckets[i];
+
+		while (iPercentile < Q_ARRAYSIZE(k_flPercentiles) && nSeen >= (uint32)(k_flPercentiles[iPercentile] * nTotal + 0.5))
+		{
+			// Report the top of the bucket, never more than the maximum
+			*pPercentiles[iPercentile] = min(CallLatency_BucketValue(i + 1) - 1, pLatency->m_unMax);
+			iPercentile++;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// 
+// Call latency interface
+// 
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Purpose: Latency stats of the callback id.
+//-----------------------------------------------------------------------------
+bool SteamAPI_GetCallLatency(int iCallback, SteamAPICallLatency_t *pLatency)
+{
+	CallLatencyHistogram_t* pHistogram;
+
+	if (!pLatency)
+		return false;
+
+	pHistogram = CallLatency_FindHistogram(iCallback, false);
+
+	if (!pHistogram)
+		return false;
+
+	CallLatency_GetStats(pHistogram, pLatency);
+	return pLatency->m_unCount != 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Latency stats of every callback id seen so far.
+//-----------------------------------------------------------------------------
+uint32 SteamAPI_GetCallLatencies(SteamAPICallLatency_t *pLatencies, uint32 nMaxLatencies)
+{
+	uint32 nLatencies = 0;
+
+	if (!pLatencies)
+		return 0;
+
+	for (int i = 0; i < CALLLATENCY_MAX_CALLBACKS && nLatencies < nMaxLatencies; i++)
+	{
+		if (!s_Histograms[i].m_iCallback)
+			break;
+
+		CallLatency_GetStats(&s_Histograms[i], &pLatencies[nLatencies]);
+
+		if (pLatencies[nLatencies].m_unCount)
+			nLatencies++;
+	}
+
+	return nLatencies;
+}
@@ -0,0 +1,68 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+#ifndef CALL_LATENCY_H
+#define CALL_LATENCY_H
+#pragma once
+
+struct SteamAPIMemoryUsage_t;
+
+//-----------------------------------------------------------------------------
+// Purpose: Number of API calls tracked at once and number of callback ids 
+//			with their own histogram. Table size has to be power of two.
+//-----------------------------------------------------------------------------
+#define CALLLATENCY_TABLE_SIZE			4096
+#define CALLLATENCY_MAX_PROBES			16
+#define CALLLATENCY_MAX_CALLBACKS		32
+
+//-----------------------------------------------------------------------------
+// Purpose: Histogram buckets. Values below 2^CALLLATENCY_SUB_BITS get a bucket
+//			each, larger ones are split into 2^CALLLATENCY_SUB_BITS buckets per
+//			power of two, which keeps relative error under 1/16 up to 2^32 us.
+//-----------------------------------------------------------------------------
+#define CALLLATENCY_SUB_BITS			4
+#define CALLLATENCY_SUB_BUCKETS			(1 << CALLLATENCY_SUB_BITS)
+#define CALLLATENCY_BUCKETS				((32 - CALLLATENCY_SUB_BITS + 1) * CALLLATENCY_SUB_BUCKETS)
+
+//-----------------------------------------------------------------------------
+// Purpose: Issue-to-completion latency of one callback id, in microseconds.
+//-----------------------------------------------------------------------------
+struct SteamAPICallLatency_t
+{
+	int			m_iCallback;
+	uint32		m_unCount;
+	uint32		m_unMin;
+	uint32		m_unMax;
+	uint32		m_unMean;
+	uint32		m_unP50;
+	uint32		m_unP90;
+	uint32		m_unP99;
+	uint32		m_unP999;
+};
+
+//-----------------------------------------------------------------------------
+// 
+// Call latency C interface
+// 
+//-----------------------------------------------------------------------------
+
+extern void CallLatency_OnIssue(SteamAPICall_t hAPICall);
+extern void CallLatency_OnComplete(SteamAPICall_t hAPICall, int iCallback);
+extern void CallLatency_OnCancel(SteamAPICall_t hAPICall);
+extern void CallLatency_GetMemoryUsage(SteamAPIMemoryUsage_t *pUsage);
+
+//-----------------------------------------------------------------------------
+// Purpose: Fills latency stats of the callback id, returns false if no call
+//			with it has completed yet.
+//-----------------------------------------------------------------------------
+S_API bool SteamAPI_GetCallLatency(int iCallback, SteamAPICallLatency_t *pLatency);
+
+//-----------------------------------------------------------------------------
+// Purpose: Fills stats of up to nMaxLatencies callback ids, returns how many.
+//-----------------------------------------------------------------------------
+S_API uint32 SteamAPI_GetCallLatencies(SteamAPICallLatency_t *pLatencies, uint32 nMaxLatencies);
+
+#endif
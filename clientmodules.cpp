@@ -6,6 +6,8 @@
 //=============================================================================
 
 #include "steam_api_pch.h"
+#include "minidump.h"
+#include "asynclog.h"
 
 //-----------------------------------------------------------------------------
 // Purpose: Modules for steam.dll and steamclient.dll
@@ -185,9 +187,10 @@ bool ConfigureSteamClientPath(const char *pszPath, uint32 u32Length)
 //-----------------------------------------------------------------------------
 void Steam_SetMinidumpSteamID(uint64 u64SteamID)
 {
-	printf("Steam_SetMinidumpSteamID:  Caching Steam ID:  %lld [API loaded %s]\n", u64SteamID, s_pfnSteamSetSteamID ? "yes" : "no");
+	AsyncLog(k_ESteamAPILogInfo, "Steam_SetMinidumpSteamID:  Caching Steam ID:  %lld [API loaded %s]\n", u64SteamID, s_pfnSteamSetSteamID ? "yes" : "no");
 
 	g_SteamMinidumpSID = u64SteamID;
+	Minidump_UpdateHeader();
 
 	// Don't call minidump sid routine for steam.dll, because s_pfnSteamSetSteamID
 	// is nullptr there!
@@ -199,7 +202,7 @@ void Steam_SetMinidumpSteamID(uint64 u64SteamID)
 
 	if (s_pfnSteamSetSteamID)
 	{
-		printf("Steam_SetMinidumpSteamID:  Setting Steam ID:  %lld\n", u64SteamID);
+		AsyncLog(k_ESteamAPILogInfo, "Steam_SetMinidumpSteamID:  Setting Steam ID:  %lld\n", u64SteamID);
 		s_pfnSteamSetSteamID(u64SteamID);
 	}
 }
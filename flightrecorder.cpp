@@ -0,0 +1,169 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "steam_api_pch.h"
+#include "flightrecorder.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: Recent messages of the callback manager. Lives in the data section,
+//			so it's part of every full memory dump and can be located by its
+//			magic in the other ones.
+//-----------------------------------------------------------------------------
+CallbackFlightRecorder_t g_CallbackFlightRecorder = 
+{
+	FLIGHTRECORDER_MAGIC,
+	FLIGHTRECORDER_VERSION,
+	sizeof(FlightRecord_t),
+	FLIGHTRECORDER_SIZE,
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Samples time base of the recorder.
+//-----------------------------------------------------------------------------
+void FlightRecorder_Init()
+{
+	LARGE_INTEGER Counter, Frequency;
+
+	if (g_CallbackFlightRecorder.m_llCounterFrequency)
+		return;
+
+	QueryPerformanceFrequency(&Frequency);
+	QueryPerformanceCounter(&Counter);
+
+	g_CallbackFlightRecorder.m_ullBaseTimestamp = __rdtsc();
+	g_CallbackFlightRecorder.m_llBaseCounter = Counter.QuadPart;
+	g_CallbackFlightRecorder.m_llCounterFrequency = Frequency.QuadPart;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Appends string, returns new end of the output.
+//-----------------------------------------------------------------------------
+static char* FlightRecorder_AppendString(char *pszOut, char *pszEnd, const char *pszIn)
+{
+	while (*pszIn && pszOut < pszEnd)
+		*pszOut++ = *pszIn++;
+
+	return pszOut;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Appends unsigned decimal number.
+//-----------------------------------------------------------------------------
+static char* FlightRecorder_AppendUint(char *pszOut, char *pszEnd, uint64 ullValue)
+{
+	char	szDigits[24];
+	int		nDigits = 0;
+
+	do
+	{
+		szDigits[nDigits++] = '0' + (char)(ullValue % 10);
+		ullValue /= 10;
+	}
+	while (ullValue);
+
+	while (nDigits && pszOut < pszEnd)
+		*pszOut++ = szDigits[--nDigits];
+
+	return pszOut;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Appends number as hexadecimal.
+//-----------------------------------------------------------------------------
+static char* FlightRecorder_AppendHex(char *pszOut, char *pszEnd, uint64 ullValue)
+{
+	static const char	k_szHex[] = "0123456789abcdef";
+	char				szDigits[16];
+	int					nDigits = 0;
+
+	do
+	{
+		szDigits[nDigits++] = k_szHex[ullValue & 0xF];
+		ullValue >>= 4;
+	}
+	while (ullValue);
+
+	while (nDigits && pszOut < pszEnd)
+		*pszOut++ = szDigits[--nDigits];
+
+	return pszOut;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Writes the newest records as text, one per line, the newest last.
+//			Timestamps are relative to the newest record in microseconds.
+//			Doesn't allocate nor call into the CRT, so it can be used while 
+//			crashing. Returns number of characters written.
+//-----------------------------------------------------------------------------
+uint32 FlightRecorder_Format(char *pszOut, uint32 cchOut, uint32 nMaxRecords)
+{
+	const FlightRecord_t*	pRecord;
+	uint64					ullNewest, ullTicksPerUs;
+	uint32					unHead, unFirst;
+	char*					pszStart;
+	char*					pszEnd;
+
+	if (!cchOut || !nMaxRecords)
+		return 0;
+
+	unHead = g_CallbackFlightRecorder.m_unHead;
+
+	// Nothing was recorded yet
+	if (!unHead)
+		return 0;
+
+	pszStart = pszOut;
+	pszEnd = pszOut + cchOut - 1;
+
+	nMaxRecords = min(nMaxRecords, min(unHead, (uint32)FLIGHTRECORDER_SIZE));
+	unFirst = unHead - nMaxRecords;
+
+	ullNewest = g_CallbackFlightRecorder.m_Records[(unHead - 1) & (FLIGHTRECORDER_SIZE - 1)].m_ullTimestamp;
+
+	// Estimate TSC rate from the time that has passed since init
+	ullTicksPerUs = 0;
+
+	if (g_CallbackFlightRecorder.m_llCounterFrequency)
+	{
+		LARGE_INTEGER	Counter;
+		uint64			ullElapsedUs;
+
+		QueryPerformanceCounter(&Counter);
+		ullElapsedUs = (uint64)(Counter.QuadPart - g_CallbackFlightRecorder.m_llBaseCounter) * 1000000 / g_CallbackFlightRecorder.m_llCounterFrequency;
+
+		if (ullElapsedUs)
+			ullTicksPerUs = (__rdtsc() - g_CallbackFlightRecorder.m_ullBaseTimestamp) / ullElapsedUs;
+	}
+
+	pszOut = FlightRecorder_AppendString(pszOut, pszEnd, "-- callback flight recorder, newest last --\n");
+
+	for (uint32 i = unFirst; i != unHead; i++)
+	{
+		pRecord = &g_CallbackFlightRecorder.m_Records[i & (FLIGHTRECORDER_SIZE - 1)];
+
+		pszOut = FlightRecorder_AppendString(pszOut, pszEnd, pRecord->m_unType == FLIGHTRECORD_CALLRESULT ? "result " : "cb ");
+		pszOut = FlightRecorder_AppendUint(pszOut, pszEnd, (uint32)pRecord->m_iCallback);
+		pszOut = FlightRecorder_AppendString(pszOut, pszEnd, " pipe ");
+		pszOut = FlightRecorder_AppendUint(pszOut, pszEnd, (uint32)pRecord->m_hSteamPipe);
+		pszOut = FlightRecorder_AppendString(pszOut, pszEnd, " call ");
+		pszOut = FlightRecorder_AppendHex(pszOut, pszEnd, pRecord->m_hAPICall);
+		pszOut = FlightRecorder_AppendString(pszOut, pszEnd, " size ");
+		pszOut = FlightRecorder_AppendUint(pszOut, pszEnd, pRecord->m_cubParam);
+
+		if (ullTicksPerUs)
+		{
+			pszOut = FlightRecorder_AppendString(pszOut, pszEnd, " t-");
+			pszOut = FlightRecorder_AppendUint(pszOut, pszEnd, (ullNewest - pRecord->m_ullTimestamp) / ullTicksPerUs);
+			pszOut = FlightRecorder_AppendString(pszOut, pszEnd, "us");
+		}
+
+		pszOut = FlightRecorder_AppendString(pszOut, pszEnd, "\n");
+	}
+
+	*pszOut = '\0';
+	return (uint32)(pszOut - pszStart);
+}
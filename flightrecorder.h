@@ -0,0 +1,93 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Purpose: Number of records kept, has to be power of two.
+//-----------------------------------------------------------------------------
+#define FLIGHTRECORDER_SIZE			256
+
+#define FLIGHTRECORDER_MAGIC		0x52465343	// 'CSFR'
+#define FLIGHTRECORDER_VERSION		1
+
+//-----------------------------------------------------------------------------
+// Purpose: Values for FlightRecord_t::m_unType
+//-----------------------------------------------------------------------------
+#define FLIGHTRECORD_CALLBACK		0
+#define FLIGHTRECORD_CALLRESULT		1
+
+//-----------------------------------------------------------------------------
+// Purpose: One message seen by the callback manager. Callback records have
+//			the handle set only for SteamAPICallCompleted_t.
+//-----------------------------------------------------------------------------
+struct FlightRecord_t
+{
+	uint64			m_ullTimestamp;		// __rdtsc() when the message was seen
+	SteamAPICall_t	m_hAPICall;
+	int32			m_iCallback;
+	HSteamPipe		m_hSteamPipe;
+	uint32			m_cubParam;
+	uint32			m_unType;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Header and records. TSC and QPC are sampled together at init, so
+//			the timestamps can be converted into time when reading the dump.
+//-----------------------------------------------------------------------------
+struct CallbackFlightRecorder_t
+{
+	uint32			m_unMagic;
+	uint32			m_unVersion;
+	uint32			m_unRecordSize;
+	uint32			m_unRecords;
+
+	uint64			m_ullBaseTimestamp;
+	int64			m_llBaseCounter;
+	int64			m_llCounterFrequency;
+
+	// Total number of records written, last one is at (m_unHead - 1)
+	volatile uint32	m_unHead;
+	uint32			m_unPad;
+
+	FlightRecord_t	m_Records[FLIGHTRECORDER_SIZE];
+};
+
+extern CallbackFlightRecorder_t g_CallbackFlightRecorder;
+
+//-----------------------------------------------------------------------------
+// 
+// Flight recorder C interface
+// 
+//-----------------------------------------------------------------------------
+
+extern void FlightRecorder_Init();
+extern uint32 FlightRecorder_Format(char *pszOut, uint32 cchOut, uint32 nMaxRecords);
+
+//-----------------------------------------------------------------------------
+// Purpose: Writes a record. Messages are only recorded from within callback
+//			dispatch, which never runs twice at once, so there is exactly one
+//			writer and no interlocked operation is needed.
+//-----------------------------------------------------------------------------
+inline void FlightRecorder_Record(uint32 unType, int iCallback, HSteamPipe hSteamPipe, SteamAPICall_t hAPICall, uint32 cubParam)
+{
+	uint32			unHead = g_CallbackFlightRecorder.m_unHead;
+	FlightRecord_t*	pRecord = &g_CallbackFlightRecorder.m_Records[unHead & (FLIGHTRECORDER_SIZE - 1)];
+
+	pRecord->m_ullTimestamp = __rdtsc();
+	pRecord->m_hAPICall = hAPICall;
+	pRecord->m_iCallback = iCallback;
+	pRecord->m_hSteamPipe = hSteamPipe;
+	pRecord->m_cubParam = cubParam;
+	pRecord->m_unType = unType;
+
+	_WriteBarrier();
+	g_CallbackFlightRecorder.m_unHead = unHead + 1;
+}
+
+#endif
@@ -0,0 +1,185 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "steam_api_pch.h"
+#include "handlerwatchdog.h"
+#include "flightrecorder.h"
+#include "apiconfig.h"
+#include "asynclog.h"
+
+//-----------------------------------------------------------------------------
+// 
+// Handler watchdog
+// 
+//	Every CCallbackBase::Run() is timed with the TSC by the dispatcher. Runs
+//	over handler_warn_us are logged, runs over handler_limit_us count as
+//	a strike against the handler. After handler_strikes strikes the handler
+//	is demoted, its runs are queued and executed after the pump under a 
+//	budget. Every WATCHDOG_DECAY_RUNS fast runs in a row take a strike away,
+//	so a handler that was only slow during a load runs inline again. Only 
+//	the dispatch thread touches the offender table.
+// 
+//	Handlers are told apart by their class and callback id, not by address.
+//	A call result object is re-Set for every call and its address may be
+//	reused by another object once it's gone, none of which we get to see.
+// 
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Purpose: Handler that has been over the hard limit. The vtable stands for
+//			the class of CCallback or CCallResult the game instantiated.
+//-----------------------------------------------------------------------------
+struct WatchdogOffender_t
+{
+	const void*		m_pvVTable;
+	int				m_iCallback;
+	uint32			m_nStrikes;
+	uint32			m_nFastRuns;
+	bool			m_bDemoted;
+};
+
+volatile LONG				g_nWatchdogDemoted = 0;
+
+static WatchdogOffender_t	s_Offenders[WATCHDOG_MAX_OFFENDERS];
+static int					s_nOffenders = 0;
+
+// TSC ticks per microsecond, 0 until calibrated
+static uint64				s_ullTicksPerUs = 0;
+
+//-----------------------------------------------------------------------------
+// Purpose: Derives TSC rate from the flight recorder's time base, once enough
+//			time has passed for it to be accurate.
+//-----------------------------------------------------------------------------
+static bool Watchdog_Calibrate()
+{
+	LARGE_INTEGER	Counter;
+	int64			llElapsedUs;
+
+	if (s_ullTicksPerUs)
+		return true;
+
+	if (!g_CallbackFlightRecorder.m_llCounterFrequency)
+		return false;
+
+	QueryPerformanceCounter(&Counter);
+	llElapsedUs = (Counter.QuadPart - g_CallbackFlightRecorder.m_llBaseCounter) * 1000000 / g_CallbackFlightRecorder.m_llCounterFrequency;
+
+	if (llElapsedUs < 100000)
+		return false;
+
+	s_ullTicksPerUs = (__rdtsc() - g_CallbackFlightRecorder.m_ullBaseTimestamp) / llElapsedUs;
+	return s_ullTicksPerUs != 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Looks the handler up in the offender table.
+//-----------------------------------------------------------------------------
+static WatchdogOffender_t* Watchdog_FindOffender(CCallbackBase *pCallback, int iCallback)
+{
+	const void* pvVTable = *reinterpret_cast<const void* const*>(pCallback);
+
+	for (int i = 0; i < s_nOffenders; i++)
+	{
+		if (s_Offenders[i].m_pvVTable == pvVTable && s_Offenders[i].m_iCallback == iCallback)
+			return &s_Offenders[i];
+	}
+
+	return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Whenever the handler has been demoted, see Watchdog_IsDemoted().
+//-----------------------------------------------------------------------------
+bool Watchdog_IsDemotedSlow(CCallbackBase *pCallback)
+{
+	WatchdogOffender_t* pOffender = Watchdog_FindOffender(pCallback, pCallback->GetICallback());
+
+	return pOffender && pOffender->m_bDemoted;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Handler stayed under the hard limit, takes a strike away every so
+//			many runs. Handlers without strikes leave the table.
+//-----------------------------------------------------------------------------
+static void Watchdog_OnFastRun(CCallbackBase *pCallback, int iCallback)
+{
+	WatchdogOffender_t *pOffender;
+
+	pOffender = Watchdog_FindOffender(pCallback, iCallback);
+
+	if (!pOffender || ++pOffender->m_nFastRuns < WATCHDOG_DECAY_RUNS)
+		return;
+
+	pOffender->m_nFastRuns = 0;
+
+	if (--pOffender->m_nStrikes)
+		return;
+
+	if (pOffender->m_bDemoted)
+	{
+		InterlockedDecrement(&g_nWatchdogDemoted);
+
+		AsyncLog(k_ESteamAPILogInfo, "[S_API] Handler %p of callback %d is fast again, running it inline.\n", pCallback, iCallback);
+	}
+
+	*pOffender = s_Offenders[--s_nOffenders];
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Judges one run of the handler.
+//-----------------------------------------------------------------------------
+void Watchdog_OnRun(CCallbackBase *pCallback, int iCallback, uint64 ullTicks, bool bDeferred)
+{
+	const SteamAPIConfig_t*	pConfig;
+	WatchdogOffender_t*		pOffender;
+	uint32					unTime;
+
+	if (!Watchdog_Calibrate())
+		return;
+
+	pConfig = SteamAPIConfig();
+	unTime = (uint32)min(ullTicks / s_ullTicksPerUs, (uint64)0xFFFFFFFF);
+
+	if (s_nOffenders && (!pConfig->m_unHandlerLimitTime || unTime < pConfig->m_unHandlerLimitTime))
+		Watchdog_OnFastRun(pCallback, iCallback);
+
+	if (!pConfig->m_unHandlerWarnTime || unTime < pConfig->m_unHandlerWarnTime)
+		return;
+
+	AsyncLog(k_ESteamAPILogWarning, "[S_API] Slow %shandler: callback %d object %p took %u us.\n", bDeferred ? "deferred " : "", iCallback, pCallback, unTime);
+
+	// Already deferred, not over the hard limit or only reporting
+	if (bDeferred || !pConfig->m_unHandlerLimitTime || unTime < pConfig->m_unHandlerLimitTime || !pConfig->m_unHandlerStrikes)
+		return;
+
+	pOffender = Watchdog_FindOffender(pCallback, iCallback);
+
+	if (!pOffender)
+	{
+		if (s_nOffenders == WATCHDOG_MAX_OFFENDERS)
+			return;
+
+		pOffender = &s_Offenders[s_nOffenders++];
+		pOffender->m_pvVTable = *reinterpret_cast<const void* const*>(pCallback);
+		pOffender->m_iCallback = iCallback;
+		pOffender->m_nStrikes = 0;
+		pOffender->m_bDemoted = false;
+	}
+
+	pOffender->m_nStrikes++;
+	pOffender->m_nFastRuns = 0;
+
+	if (pOffender->m_bDemoted || pOffender->m_nStrikes < pConfig->m_unHandlerStrikes)
+		return;
+
+	pOffender->m_bDemoted = true;
+	InterlockedIncrement(&g_nWatchdogDemoted);
+
+	AsyncLog(k_ESteamAPILogWarning, "[S_API] Handler %p of callback %d went over %u us %u times, deferring it.\n", 
+			 pCallback, iCallback, pConfig->m_unHandlerLimitTime, pOffender->m_nStrikes);
+}
+
@@ -0,0 +1,42 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+#ifndef HANDLER_WATCHDOG_H
+#define HANDLER_WATCHDOG_H
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Purpose: Number of handler classes that can be tracked for strikes.
+//-----------------------------------------------------------------------------
+#define WATCHDOG_MAX_OFFENDERS			64
+
+//-----------------------------------------------------------------------------
+// Purpose: Runs under the hard limit in a row that take one strike away, a
+//			demoted handler without strikes runs inline again.
+//-----------------------------------------------------------------------------
+#define WATCHDOG_DECAY_RUNS				32
+
+//-----------------------------------------------------------------------------
+// 
+// Handler watchdog C interface
+// 
+//-----------------------------------------------------------------------------
+
+// Number of demoted handlers, lets the dispatch skip the lookup
+extern volatile LONG g_nWatchdogDemoted;
+
+extern bool Watchdog_IsDemotedSlow(CCallbackBase *pCallback);
+extern void Watchdog_OnRun(CCallbackBase *pCallback, int iCallback, uint64 ullTicks, bool bDeferred);
+
+//-----------------------------------------------------------------------------
+// Purpose: Whenever the handler has to be deferred instead of running inline.
+//-----------------------------------------------------------------------------
+inline bool Watchdog_IsDemoted(CCallbackBase *pCallback)
+{
+	return g_nWatchdogDemoted && Watchdog_IsDemotedSlow(pCallback);
+}
+
+#endif
@@ -0,0 +1,235 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "steam_api_pch.h"
+#include "interfacecache.h"
+
+//-----------------------------------------------------------------------------
+// 
+// Interface cache class
+// 
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Purpose: Interface pointers fetched from steamclient, keyed by the hash of
+//			their version string. Each pipe has its own set of interfaces, so
+//			entries are dropped once the pipe is released.
+//-----------------------------------------------------------------------------
+class CInterfaceCache
+{
+private:
+	struct CachedInterface_t
+	{
+		HSteamPipe	m_hSteamPipe;
+		HSteamUser	m_hSteamUser;
+		std::string	m_strVersion;
+		void*		m_pInterface;
+	};
+
+public:
+	CInterfaceCache();
+
+public:
+	void* FindOrCreate(ISteamClient *pSteamClient, HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pszVersion);
+	void InvalidatePipe(HSteamPipe hSteamPipe);
+
+private:
+	static uint32 HashVersion(const char *pszVersion);
+	static bool IsUserlessInterface(const char *pszVersion);
+
+public:
+	std::multimap<uint32, CachedInterface_t>	m_InterfaceMap;
+
+	// Lookups served from memory vs. fetched through steamclient
+	uint32										m_nHits;
+	uint32										m_nMisses;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Constructor
+//-----------------------------------------------------------------------------
+CInterfaceCache::CInterfaceCache() :
+	m_nHits(0),
+	m_nMisses(0)
+{
+	m_InterfaceMap.clear();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: FNV-1a hash of the version string
+//-----------------------------------------------------------------------------
+uint32 CInterfaceCache::HashVersion(const char *pszVersion)
+{
+	uint32 unHash = 2166136261u;
+
+	while (*pszVersion)
+	{
+		unHash ^= (uint8)*pszVersion++;
+		unHash *= 16777619u;
+	}
+
+	return unHash;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Utility interfaces belong to the pipe and not to the user.
+//-----------------------------------------------------------------------------
+bool CInterfaceCache::IsUserlessInterface(const char *pszVersion)
+{
+	return !strncmp(pszVersion, "SteamUtils", 10);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns cached interface for the pipe, user and version. If there
+//			isn't one, it's fetched from steamclient and remembered.
+//-----------------------------------------------------------------------------
+void* CInterfaceCache::FindOrCreate(ISteamClient *pSteamClient, HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pszVersion)
+{
+	CachedInterface_t	Interface;
+	uint32				unHash;
+	bool				bUserless;
+
+	if (!pSteamClient || !hSteamPipe || !pszVersion)
+		return nullptr;
+
+	bUserless = IsUserlessInterface(pszVersion);
+
+	if (bUserless)
+		hSteamUser = 0;
+
+	unHash = HashVersion(pszVersion);
+
+	auto Range = m_InterfaceMap.equal_range(unHash);
+	for (auto Iter = Range.first; Iter != Range.second; ++Iter)
+	{
+		if (Iter->second.m_hSteamPipe != hSteamPipe || Iter->second.m_hSteamUser != hSteamUser)
+			continue;
+
+		if (Iter->second.m_strVersion.compare(pszVersion) != 0)
+			continue;
+
+		m_nHits++;
+		return Iter->second.m_pInterface;
+	}
+
+	m_nMisses++;
+
+	if (bUserless)
+		Interface.m_pInterface = pSteamClient->GetISteamUtils(hSteamPipe, pszVersion);
+	else
+		Interface.m_pInterface = pSteamClient->GetISteamGenericInterface(hSteamUser, hSteamPipe, pszVersion);
+
+	// Don't remember failures, version might not be available yet
+	if (!Interface.m_pInterface)
+		return nullptr;
+
+	Interface.m_hSteamPipe = hSteamPipe;
+	Interface.m_hSteamUser = hSteamUser;
+	Interface.m_strVersion = pszVersion;
+
+	m_InterfaceMap.insert(std::make_pair(unHash, Interface));
+
+	return Interface.m_pInterface;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Drops every interface fetched on the pipe.
+//-----------------------------------------------------------------------------
+void CInterfaceCache::InvalidatePipe(HSteamPipe hSteamPipe)
+{
+	for (auto Iter = m_InterfaceMap.begin(); Iter != m_InterfaceMap.end(); )
+	{
+		if (Iter->second.m_hSteamPipe == hSteamPipe)
+			Iter = m_InterfaceMap.erase(Iter);
+		else
+			++Iter;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// 
+// Interface cache C interface
+// 
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Purpose: Singleton access
+//-----------------------------------------------------------------------------
+static CInterfaceCache *GInterfaceCache()
+{
+	static CInterfaceCache InterfaceCache;
+	return &InterfaceCache;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns interface for the version from the cache, or fetches it.
+//-----------------------------------------------------------------------------
+void* InterfaceCache_FindOrCreate(ISteamClient *pSteamClient, HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pszVersion)
+{
+	return GInterfaceCache()->FindOrCreate(pSteamClient, hSteamUser, hSteamPipe, pszVersion);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Must be called before the pipe is released.
+//-----------------------------------------------------------------------------
+void InterfaceCache_InvalidatePipe(HSteamPipe hSteamPipe)
+{
+	if (!hSteamPipe)
+		return;
+
+	GInterfaceCache()->InvalidatePipe(hSteamPipe);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Number of lookups served from memory, each one is an IPC saved,
+//			and number of lookups that had to go to steamclient.
+//-----------------------------------------------------------------------------
+void InterfaceCache_GetStats(uint32 *pnHits, uint32 *pnMisses)
+{
+	if (pnHits)
+		*pnHits = GInterfaceCache()->m_nHits;
+
+	if (pnMisses)
+		*pnMisses = GInterfaceCache()->m_nMisses;
+}
+
+//-----------------------------------------------------------------------------
+// 
+// Exported interface cache API
+// 
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Purpose: Looks up the steamclient instance that owns the pipe and returns
+//			cached interface for the version.
+//-----------------------------------------------------------------------------
+void* SteamAPI_FindOrCreateInterface(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion)
+{
+	ISteamClient* pSteamClient;
+
+	if (!hSteamPipe)
+		return nullptr;
+
+	if (hSteamPipe == g_hSteamPipe)
+		pSteamClient = g_pSteamClient;
+	else if (hSteamPipe == g_hSteamGameServerPipe)
+		pSteamClient = g_pSteamClientGameServer;
+	else if (hSteamPipe == g_hSteamContentServerPipe)
+		pSteamClient = g_pSteamContentServerClient;
+	else
+		return nullptr;
+
+	return InterfaceCache_FindOrCreate(pSteamClient, hSteamUser, hSteamPipe, pchVersion);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: See InterfaceCache_GetStats()
+//-----------------------------------------------------------------------------
+void SteamAPI_GetInterfaceCacheStats(uint32 *pnHits, uint32 *pnMisses)
+{
+	InterfaceCache_GetStats(pnHits, pnMisses);
+}
@@ -0,0 +1,21 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+#ifndef INTERFACE_CACHE_H
+#define INTERFACE_CACHE_H
+#pragma once
+
+//-----------------------------------------------------------------------------
+// 
+// Interface cache C interface
+// 
+//-----------------------------------------------------------------------------
+
+extern void* InterfaceCache_FindOrCreate(ISteamClient *pSteamClient, HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pszVersion);
+extern void InterfaceCache_InvalidatePipe(HSteamPipe hSteamPipe);
+extern void InterfaceCache_GetStats(uint32 *pnHits, uint32 *pnMisses);
+
+#endif
@@ -0,0 +1,196 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "steam_api_pch.h"
+#include "livestats.h"
+#include "apiconfig.h"
+#include "calllatency.h"
+#include "memfootprint.h"
+
+//-----------------------------------------------------------------------------
+// 
+// Live stats
+// 
+//	Counters are kept in private memory by the pump thread and copied into
+//	the shared segment at most every LIVESTATS_PUBLISH_INTERVAL, under the
+//	seqlock. The pump is the only writer, readers never block it.
+// 
+//-----------------------------------------------------------------------------
+
+static LiveStats_t			s_Stats;
+static LiveStats_t*			s_pSharedStats = nullptr;
+static DWORD				s_dwNextPublishTime = 0;
+
+//-----------------------------------------------------------------------------
+// Purpose: Counts IPC failures reported by steamclient.
+//-----------------------------------------------------------------------------
+static void LiveStats_OnIPCFailure(HSteamPipe hSteamPipe, int iCallback, void *pvParam, int cubParam)
+{
+	s_Stats.m_unIPCFailures++;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Creates the segment, if enabled. Safe to be called more than once.
+//-----------------------------------------------------------------------------
+void LiveStats_Init()
+{
+	HANDLE	hMapping;
+	char	szName[64];
+
+	if (s_pSharedStats || !SteamAPIConfig()->m_bLiveStats)
+		return;
+
+	_snprintf(szName, sizeof(szName), LIVESTATS_MAPPING_NAME, GetCurrentProcessId());
+	szName[sizeof(szName) - 1] = '\0';
+
+	hMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(LiveStats_t), szName);
+
+	if (!hMapping)
+		return;
+
+	// Mapping handle is kept open for the rest of the process
+	s_pSharedStats = reinterpret_cast<LiveStats_t*>(MapViewOfFile(hMapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, sizeof(LiveStats_t)));
+
+	if (!s_pSharedStats)
+	{
+		CloseHandle(hMapping);
+		return;
+	}
+
+	s_Stats.m_unVersion = LIVESTATS_VERSION;
+	s_Stats.m_dwProcessId = GetCurrentProcessId();
+
+	CallbackMgr_AddObserver(IPCFailure_t::k_iCallback, LiveStats_OnIPCFailure);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Records handler time of the callback id.
+//-----------------------------------------------------------------------------
+void LiveStats_OnCallback(int iCallback, uint32 unTime)
+{
+	LiveStatsCallback_t*	pCallback;
+	DWORD					i;
+
+	for (i = 0; i < s_Stats.m_nCallbacks; i++)
+	{
+		if (s_Stats.m_Callbacks[i].m_iCallback == iCallback)
+			break;
+	}
+
+	if (i == s_Stats.m_nCallbacks)
+	{
+		if (i == LIVESTATS_MAX_CALLBACKS)
+		{
+			s_Stats.m_unCallbackOverflow++;
+			return;
+		}
+
+		s_Stats.m_Callbacks[i].m_iCallback = iCallback;
+		s_Stats.m_nCallbacks++;
+	}
+
+	pCallback = &s_Stats.m_Callbacks[i];
+	pCallback->m_unCount++;
+	pCallback->m_ullTotalTime += unTime;
+	pCallback->m_unLastTime = unTime;
+	pCallback->m_unMaxTime = max(pCallback->m_unMaxTime, unTime);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Counts completed call result. Call result data is only valid when
+//			the IPC call succeeded.
+//-----------------------------------------------------------------------------
+void LiveStats_OnCallResult(int iCallback, void *pvParam, bool bIOFailed)
+{
+	s_Stats.m_ullIPCGetAPICallResult++;
+	s_Stats.m_ullCallResultsCompleted++;
+
+	if (bIOFailed)
+		s_Stats.m_ullCallResultsIOFailed++;
+
+	if (iCallback != HTTPRequestCompleted_t::k_iCallback)
+		return;
+
+	s_Stats.m_ullHTTPCompleted++;
+
+	if (bIOFailed || !pvParam || !reinterpret_cast<HTTPRequestCompleted_t*>(pvParam)->m_bRequestSuccessful)
+		s_Stats.m_ullHTTPFailed++;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Records one run of the callback pump.
+//-----------------------------------------------------------------------------
+void LiveStats_OnPump(uint32 nMessages, uint32 unTime, bool bCutoff)
+{
+	s_Stats.m_ullPumps++;
+	s_Stats.m_ullMessages += nMessages;
+
+	// The last call which found nothing is made only when the pump wasn't cut
+	s_Stats.m_ullIPCGetCallback += bCutoff ? nMessages : nMessages + 1;
+
+	if (bCutoff)
+		s_Stats.m_ullPumpCutoffs++;
+
+	s_Stats.m_unLastPumpMessages = nMessages;
+	s_Stats.m_unLastPumpTime = unTime;
+	s_Stats.m_unMaxPumpTime = max(s_Stats.m_unMaxPumpTime, unTime);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Copies the counters into the shared segment, rate limited.
+//-----------------------------------------------------------------------------
+void LiveStats_Publish()
+{
+	SteamAPICallLatency_t	Latencies[LIVESTATS_MAX_LATENCIES];
+	SteamAPIMemoryStats_t	MemoryStats;
+	DWORD					dwTime;
+
+	if (!s_pSharedStats)
+		return;
+
+	dwTime = GetTickCount();
+
+	if ((LONG)(dwTime - s_dwNextPublishTime) < 0)
+		return;
+
+	s_dwNextPublishTime = dwTime + LIVESTATS_PUBLISH_INTERVAL;
+
+	s_Stats.m_unAppId = g_BreakpadLastAppId;
+	s_Stats.m_dwUpdateTime = dwTime;
+	s_Stats.m_unGeneration = g_unSteamAPIGeneration;
+	s_Stats.m_unCallResultsPending = CallbackMgr_GetPendingCallResultCount(0);
+
+	s_Stats.m_nLatencies = SteamAPI_GetCallLatencies(Latencies, LIVESTATS_MAX_LATENCIES);
+
+	for (DWORD i = 0; i < s_Stats.m_nLatencies; i++)
+	{
+		s_Stats.m_Latencies[i].m_iCallback = Latencies[i].m_iCallback;
+		s_Stats.m_Latencies[i].m_unCount = Latencies[i].m_unCount;
+		s_Stats.m_Latencies[i].m_unP50 = Latencies[i].m_unP50;
+		s_Stats.m_Latencies[i].m_unP99 = Latencies[i].m_unP99;
+		s_Stats.m_Latencies[i].m_unMax = Latencies[i].m_unMax;
+	}
+
+	SteamAPI_GetMemoryStats(&MemoryStats);
+
+	s_Stats.m_unRegistryEntries = MemoryStats.m_Callbacks.m_nEntries + MemoryStats.m_CallResults.m_nEntries;
+	s_Stats.m_cubRegistries = MemoryStats.m_Callbacks.m_cubReserved + MemoryStats.m_CallResults.m_cubReserved + MemoryStats.m_DeferredRuns.m_cubReserved;
+	s_Stats.m_cubResultPoolUsed = MemoryStats.m_ResultPool.m_cubUsed;
+	s_Stats.m_cubResultPoolReserved = MemoryStats.m_ResultPool.m_cubReserved;
+	s_Stats.m_cubTraceBuffers = MemoryStats.m_CallLatency.m_cubReserved + MemoryStats.m_FlightRecorder.m_cubReserved + MemoryStats.m_LogRings.m_cubReserved;
+	s_Stats.m_cubTotalReserved = MemoryStats.m_cubTotalReserved;
+	s_Stats.m_unCompactions = MemoryStats.m_nCompactions;
+
+	s_Stats.m_nSequence = s_pSharedStats->m_nSequence + 1;
+	s_pSharedStats->m_nSequence = s_Stats.m_nSequence;
+	_WriteBarrier();
+
+	memcpy(s_pSharedStats, &s_Stats, sizeof(LiveStats_t));
+
+	_WriteBarrier();
+	s_pSharedStats->m_nSequence = s_Stats.m_nSequence + 1;
+}
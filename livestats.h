@@ -0,0 +1,159 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: Layout of the live stats segment every process publishes. Shared
+//			with the steamapistat viewer, so only Windows types are used.
+//
+// $NoKeywords: $
+//=============================================================================
+#ifndef LIVE_STATS_H
+#define LIVE_STATS_H
+#pragma once
+
+#define LIVESTATS_VERSION				3
+
+//-----------------------------------------------------------------------------
+// Purpose: Segment name, formatted with the process id.
+//-----------------------------------------------------------------------------
+#define LIVESTATS_MAPPING_NAME			"Local\\SteamAPIStats_%u"
+
+//-----------------------------------------------------------------------------
+// Purpose: Number of callback ids tracked, the rest is counted as overflow.
+//-----------------------------------------------------------------------------
+#define LIVESTATS_MAX_CALLBACKS			32
+
+//-----------------------------------------------------------------------------
+// Purpose: Number of callback ids with API call latency published.
+//-----------------------------------------------------------------------------
+#define LIVESTATS_MAX_LATENCIES			16
+
+// Segment isn't written more often than this, in milliseconds
+#define LIVESTATS_PUBLISH_INTERVAL		100
+
+//-----------------------------------------------------------------------------
+// Purpose: Handler times of one callback id, in microseconds.
+//-----------------------------------------------------------------------------
+struct LiveStatsCallback_t
+{
+	LONG			m_iCallback;
+	DWORD			m_unCount;
+	ULONG64			m_ullTotalTime;
+	DWORD			m_unMaxTime;
+	DWORD			m_unLastTime;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Issue-to-completion latency of API calls of one callback id, in
+//			microseconds.
+//-----------------------------------------------------------------------------
+struct LiveStatsLatency_t
+{
+	LONG			m_iCallback;
+	DWORD			m_unCount;
+	DWORD			m_unP50;
+	DWORD			m_unP99;
+	DWORD			m_unMax;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: The segment. Counters are totals since init, readers compute the
+//			rates from two samples. m_nSequence is odd while the writer is
+//			updating the segment.
+//-----------------------------------------------------------------------------
+struct LiveStats_t
+{
+	DWORD				m_unVersion;
+	DWORD				m_dwProcessId;
+	volatile LONG		m_nSequence;
+	DWORD				m_unAppId;
+	DWORD				m_dwUpdateTime;		// GetTickCount() of the last publish
+	DWORD				m_unGeneration;		// Bumped by every reconnect
+
+	// Callback pump
+	ULONG64				m_ullMessages;
+	ULONG64				m_ullPumps;
+	ULONG64				m_ullPumpCutoffs;	// Pumps that left messages queued
+	DWORD				m_unLastPumpMessages;
+	DWORD				m_unLastPumpTime;
+	DWORD				m_unMaxPumpTime;
+
+	// Call results
+	DWORD				m_unCallResultsPending;
+	ULONG64				m_ullCallResultsCompleted;
+	ULONG64				m_ullCallResultsIOFailed;
+
+	// Calls into steamclient
+	ULONG64				m_ullIPCGetCallback;
+	ULONG64				m_ullIPCGetAPICallResult;
+	DWORD				m_unIPCFailures;
+
+	// HTTP requests completed through call results
+	DWORD				m_unPad;
+	ULONG64				m_ullHTTPCompleted;
+	ULONG64				m_ullHTTPFailed;
+
+	// Handler times per callback id, call results are under their own id
+	DWORD				m_nCallbacks;
+	DWORD				m_unCallbackOverflow;
+	LiveStatsCallback_t	m_Callbacks[LIVESTATS_MAX_CALLBACKS];
+
+	// API call latencies
+	DWORD				m_nLatencies;
+	LiveStatsLatency_t	m_Latencies[LIVESTATS_MAX_LATENCIES];
+
+	// Memory footprint in bytes, reserved includes what compaction can free
+	DWORD				m_unRegistryEntries;
+	DWORD				m_cubRegistries;
+	DWORD				m_cubResultPoolUsed;
+	DWORD				m_cubResultPoolReserved;
+	DWORD				m_cubTraceBuffers;
+	DWORD				m_cubTotalReserved;
+	DWORD				m_unCompactions;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Takes consistent copy of the segment, returns false if the writer
+//			kept changing it.
+//-----------------------------------------------------------------------------
+inline bool LiveStats_Read(const LiveStats_t *pShared, LiveStats_t *pCopy)
+{
+	LONG nSequence;
+
+	for (int i = 0; i < 100; i++)
+	{
+		nSequence = pShared->m_nSequence;
+		_ReadBarrier();
+
+		if (nSequence & 1)
+		{
+			YieldProcessor();
+			continue;
+		}
+
+		memcpy(pCopy, const_cast<const LiveStats_t*>(pShared), sizeof(LiveStats_t));
+
+		_ReadBarrier();
+
+		if (pShared->m_nSequence == nSequence)
+			return true;
+	}
+
+	return false;
+}
+
+#ifndef LIVESTATS_VIEWER
+
+//-----------------------------------------------------------------------------
+// 
+// Live stats C interface
+// 
+//-----------------------------------------------------------------------------
+
+extern void LiveStats_Init();
+extern void LiveStats_OnCallback(int iCallback, uint32 unTime);
+extern void LiveStats_OnCallResult(int iCallback, void *pvParam, bool bIOFailed);
+extern void LiveStats_OnPump(uint32 nMessages, uint32 unTime, bool bCutoff);
+extern void LiveStats_Publish();
+
+#endif
+
+#endif
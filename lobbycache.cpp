@@ -0,0 +1,550 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "steam_api_pch.h"
+#include <set>
+#include "lobbycache.h"
+#include "memfootprint.h"
+#include "interfacecache.h"
+#include "apiconfig.h"
+#include "asynclog.h"
+
+//-----------------------------------------------------------------------------
+// 
+// Lobby cache
+// 
+//	Lobbies of a list share most of their keys and many of their values, so
+//	every string is interned once and a lobby only keeps pointers to its
+//	keys and values. A lookup interns nothing, a key that was never seen
+//	can't be set on any lobby. Strings are dropped with a new list, as the
+//	UI may hold on to them until then, or when updates have piled up so many
+//	that no lobby uses that the pool has doubled since it was last swept.
+// 
+//-----------------------------------------------------------------------------
+
+// Pool is never swept below this many strings
+#define LOBBYCACHE_MIN_SWEEP_STRINGS	1024
+
+// Map node of a lobby and of an interned string, value and tree links
+#define LOBBYCACHE_LOBBY_NODE_SIZE	(sizeof(std::map<uint64, CLobbyCache::Lobby_t>::value_type) + 4 * sizeof(void*))
+#define LOBBYCACHE_STRING_NODE_SIZE	(sizeof(std::set<std::string>::value_type) + 4 * sizeof(void*))
+
+//-----------------------------------------------------------------------------
+// Purpose: Lobby cache class
+//-----------------------------------------------------------------------------
+class CLobbyCache
+{
+public:
+	struct LobbyData_t
+	{
+		const char*		m_pchKey;
+		const char*		m_pchValue;
+	};
+
+	struct Lobby_t
+	{
+		uint64						m_ulSteamIDOwner;
+		int32						m_nMembers;
+		int32						m_nMemberLimit;
+		std::vector<LobbyData_t>	m_Data;
+	};
+
+public:
+	CLobbyCache();
+
+public:
+	void Snapshot(ISteamMatchmaking *pSteamMatchmaking, uint32 nLobbies);
+	void OnDataUpdate(ISteamMatchmaking *pSteamMatchmaking, uint64 ulSteamIDLobby);
+	void OnMemberUpdate(uint64 ulSteamIDLobby, uint32 rgfChatMemberStateChange);
+	void Clear();
+
+	const Lobby_t* Find(uint64 ulSteamIDLobby) const;
+	const char* GetData(const Lobby_t *pLobby, const char *pchKey) const;
+	void GetMemoryUsage(SteamAPIMemoryUsage_t *pUsage);
+
+private:
+	const char* Intern(const char *pchString);
+	void SweepStrings();
+	void Read(ISteamMatchmaking *pSteamMatchmaking, uint64 ulSteamIDLobby, Lobby_t *pLobby);
+
+public:
+	// Lobbies in order of the list
+	std::vector<uint64>				m_LobbyIds;
+	std::map<uint64, Lobby_t>		m_Lobbies;
+
+	// Every key and value, nodes don't move so pointers stay valid
+	std::set<std::string>			m_Strings;
+	uint32							m_nSweepStrings;
+
+	uint32							m_nSnapshots;
+	uint32							m_nDataUpdates;
+	uint32							m_nMemberUpdates;
+	uint32							m_unChangeNumber;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Constructor
+//-----------------------------------------------------------------------------
+CLobbyCache::CLobbyCache() :
+	m_nSweepStrings(LOBBYCACHE_MIN_SWEEP_STRINGS),
+	m_nSnapshots(0),
+	m_nDataUpdates(0),
+	m_nMemberUpdates(0),
+	m_unChangeNumber(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns the one copy of the string
+//-----------------------------------------------------------------------------
+const char* CLobbyCache::Intern(const char *pchString)
+{
+	return m_Strings.insert(pchString).first->c_str();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Drops strings no lobby uses anymore once the pool has grown to
+//			twice its size after the last sweep
+//-----------------------------------------------------------------------------
+void CLobbyCache::SweepStrings()
+{
+	std::set<const char*> Used;
+
+	if (m_Strings.size() < m_nSweepStrings)
+		return;
+
+	for (auto &Lobby : m_Lobbies)
+	{
+		for (auto &Data : Lobby.second.m_Data)
+		{
+			Used.insert(Data.m_pchKey);
+			Used.insert(Data.m_pchValue);
+		}
+	}
+
+	for (auto Iter = m_Strings.begin(); Iter != m_Strings.end();)
+	{
+		if (!Used.count(Iter->c_str()))
+			Iter = m_Strings.erase(Iter);
+		else
+			++Iter;
+	}
+
+	m_nSweepStrings = max((uint32)m_Strings.size() * 2, (uint32)LOBBYCACHE_MIN_SWEEP_STRINGS);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Reads everything steam knows about the lobby
+//-----------------------------------------------------------------------------
+void CLobbyCache::Read(ISteamMatchmaking *pSteamMatchmaking, uint64 ulSteamIDLobby, Lobby_t *pLobby)
+{
+	char		szKey[k_nMaxLobbyKeyLength];
+	char		szValue[k_cubChatMetadataMax];
+	LobbyData_t	Data;
+	CSteamID	SteamIDLobby(ulSteamIDLobby);
+	int			nData;
+	int			i;
+
+	pLobby->m_ulSteamIDOwner = pSteamMatchmaking->GetLobbyOwner(SteamIDLobby).ConvertToUint64();
+	pLobby->m_nMembers = pSteamMatchmaking->GetNumLobbyMembers(SteamIDLobby);
+	pLobby->m_nMemberLimit = pSteamMatchmaking->GetLobbyMemberLimit(SteamIDLobby);
+
+	nData = pSteamMatchmaking->GetLobbyDataCount(SteamIDLobby);
+
+	pLobby->m_Data.clear();
+	pLobby->m_Data.reserve(max(nData, 0));
+
+	for (i = 0; i < nData; i++)
+	{
+		if (!pSteamMatchmaking->GetLobbyDataByIndex(SteamIDLobby, i, szKey, sizeof(szKey), szValue, sizeof(szValue)))
+			continue;
+
+		Data.m_pchKey = Intern(szKey);
+		Data.m_pchValue = Intern(szValue);
+
+		pLobby->m_Data.push_back(Data);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Replaces the cache with lobbies of the list steam just returned
+//-----------------------------------------------------------------------------
+void CLobbyCache::Snapshot(ISteamMatchmaking *pSteamMatchmaking, uint32 nLobbies)
+{
+	uint64	ulSteamIDLobby;
+	uint32	i;
+
+	Clear();
+
+	m_LobbyIds.reserve(nLobbies);
+
+	for (i = 0; i < nLobbies; i++)
+	{
+		ulSteamIDLobby = pSteamMatchmaking->GetLobbyByIndex(i).ConvertToUint64();
+
+		// Listed twice, the list keeps its first place
+		if (!m_Lobbies.insert(std::make_pair(ulSteamIDLobby, Lobby_t())).second)
+			continue;
+
+		m_LobbyIds.push_back(ulSteamIDLobby);
+
+		Read(pSteamMatchmaking, ulSteamIDLobby, &m_Lobbies[ulSteamIDLobby]);
+	}
+
+	m_nSnapshots++;
+	m_unChangeNumber++;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Data of the lobby changed, re-reads it. Lobbies that aren't in
+//			the list are left alone.
+//-----------------------------------------------------------------------------
+void CLobbyCache::OnDataUpdate(ISteamMatchmaking *pSteamMatchmaking, uint64 ulSteamIDLobby)
+{
+	auto Iter = m_Lobbies.find(ulSteamIDLobby);
+
+	if (Iter == m_Lobbies.end())
+		return;
+
+	// Strings it no longer uses are kept, the UI may still have them, until
+	// enough of them pile up
+	Read(pSteamMatchmaking, ulSteamIDLobby, &Iter->second);
+	SweepStrings();
+
+	m_nDataUpdates++;
+	m_unChangeNumber++;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: A user entered or left the lobby, steam isn't asked again
+//-----------------------------------------------------------------------------
+void CLobbyCache::OnMemberUpdate(uint64 ulSteamIDLobby, uint32 rgfChatMemberStateChange)
+{
+	auto Iter = m_Lobbies.find(ulSteamIDLobby);
+
+	if (Iter == m_Lobbies.end())
+		return;
+
+	if (rgfChatMemberStateChange & k_EChatMemberStateChangeEntered)
+		Iter->second.m_nMembers++;
+	else if (Iter->second.m_nMembers > 0)
+		Iter->second.m_nMembers--;
+
+	m_nMemberUpdates++;
+	m_unChangeNumber++;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Forgets every lobby and string
+//-----------------------------------------------------------------------------
+void CLobbyCache::Clear()
+{
+	std::vector<uint64>().swap(m_LobbyIds);
+	m_Lobbies.clear();
+	m_Strings.clear();
+	m_nSweepStrings = LOBBYCACHE_MIN_SWEEP_STRINGS;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns the lobby, nullptr if it isn't cached
+//-----------------------------------------------------------------------------
+const CLobbyCache::Lobby_t* CLobbyCache::Find(uint64 ulSteamIDLobby) const
+{
+	auto Iter = m_Lobbies.find(ulSteamIDLobby);
+
+	return (Iter != m_Lobbies.end()) ? &Iter->second : nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns value of the key, "" if the lobby doesn't have it, like
+//			GetLobbyData()
+//-----------------------------------------------------------------------------
+const char* CLobbyCache::GetData(const Lobby_t *pLobby, const char *pchKey) const
+{
+	const char *pchInterned;
+
+	auto Iter = m_Strings.find(pchKey);
+
+	if (Iter == m_Strings.end())
+		return "";
+
+	// Keys are interned, comparing pointers is enough
+	pchInterned = Iter->c_str();
+
+	for (auto &Data : pLobby->m_Data)
+	{
+		if (Data.m_pchKey == pchInterned)
+			return Data.m_pchValue;
+	}
+
+	return "";
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: For memory stats
+//-----------------------------------------------------------------------------
+void CLobbyCache::GetMemoryUsage(SteamAPIMemoryUsage_t *pUsage)
+{
+	uint32 cubStrings;
+
+	cubStrings = 0;
+
+	for (auto &String : m_Strings)
+		cubStrings += LOBBYCACHE_STRING_NODE_SIZE + String.capacity() + 1;
+
+	pUsage->m_nEntries = m_Lobbies.size();
+	pUsage->m_cubUsed = m_LobbyIds.size() * sizeof(uint64) + m_Lobbies.size() * LOBBYCACHE_LOBBY_NODE_SIZE + cubStrings;
+	pUsage->m_cubReserved = m_LobbyIds.capacity() * sizeof(uint64) + m_Lobbies.size() * LOBBYCACHE_LOBBY_NODE_SIZE + cubStrings;
+
+	for (auto &Lobby : m_Lobbies)
+	{
+		pUsage->m_cubUsed += Lobby.second.m_Data.size() * sizeof(LobbyData_t);
+		pUsage->m_cubReserved += Lobby.second.m_Data.capacity() * sizeof(LobbyData_t);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns global lobby cache
+//-----------------------------------------------------------------------------
+static CLobbyCache *GLobbyCache()
+{
+	static CLobbyCache LobbyCache;
+	return &LobbyCache;
+}
+
+//-----------------------------------------------------------------------------
+// 
+// Lobby cache C interface
+// 
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Purpose: Matchmaking interface of the global user
+//-----------------------------------------------------------------------------
+static ISteamMatchmaking* LobbyCache_GetSteamMatchmaking()
+{
+	return static_cast<ISteamMatchmaking*>(InterfaceCache_FindOrCreate(g_pSteamClient, g_hSteamUser, g_hSteamPipe, STEAMMATCHMAKING_INTERFACE_VERSION));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: A lobby list request completed, takes a snapshot of it
+//-----------------------------------------------------------------------------
+static void LobbyCache_OnLobbyMatchList(HSteamPipe hSteamPipe, int iCallback, void *pvParam, int cubParam)
+{
+	ISteamMatchmaking	*pSteamMatchmaking;
+	uint64				ullStartTime;
+
+	if (cubParam < (int)sizeof(LobbyMatchList_t))
+		return;
+
+	pSteamMatchmaking = LobbyCache_GetSteamMatchmaking();
+
+	if (!pSteamMatchmaking)
+		return;
+
+	ullStartTime = Steam_GetMicroseconds();
+
+	GLobbyCache()->Snapshot(pSteamMatchmaking, ((LobbyMatchList_t*)pvParam)->m_nLobbiesMatching);
+
+	AsyncLog(k_ESteamAPILogDebug, "[S_API] Lobby cache read %u lobbies and %u strings in %llu us.\n",
+		(uint32)GLobbyCache()->m_LobbyIds.size(), (uint32)GLobbyCache()->m_Strings.size(), Steam_GetMicroseconds() - ullStartTime);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Lobby data changed, data of members isn't kept
+//-----------------------------------------------------------------------------
+static void LobbyCache_OnLobbyDataUpdate(HSteamPipe hSteamPipe, int iCallback, void *pvParam, int cubParam)
+{
+	LobbyDataUpdate_t	*pUpdate;
+	ISteamMatchmaking	*pSteamMatchmaking;
+
+	if (cubParam < (int)sizeof(LobbyDataUpdate_t))
+		return;
+
+	pUpdate = (LobbyDataUpdate_t*)pvParam;
+
+	if (pUpdate->m_ulSteamIDMember != pUpdate->m_ulSteamIDLobby)
+		return;
+
+	pSteamMatchmaking = LobbyCache_GetSteamMatchmaking();
+
+	if (!pSteamMatchmaking)
+		return;
+
+	GLobbyCache()->OnDataUpdate(pSteamMatchmaking, pUpdate->m_ulSteamIDLobby);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Someone entered or left a lobby
+//-----------------------------------------------------------------------------
+static void LobbyCache_OnLobbyChatUpdate(HSteamPipe hSteamPipe, int iCallback, void *pvParam, int cubParam)
+{
+	LobbyChatUpdate_t *pUpdate;
+
+	if (cubParam < (int)sizeof(LobbyChatUpdate_t))
+		return;
+
+	pUpdate = (LobbyChatUpdate_t*)pvParam;
+
+	GLobbyCache()->OnMemberUpdate(pUpdate->m_ulSteamIDLobby, pUpdate->m_rgfChatMemberStateChange);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Called once the pipe and user are up, on init and on reconnect.
+//-----------------------------------------------------------------------------
+void LobbyCache_Init()
+{
+	if (!SteamAPIConfig()->m_bLobbyCache)
+		return;
+
+	CallbackMgr_AddObserver(LobbyMatchList_t::k_iCallback, LobbyCache_OnLobbyMatchList);
+	CallbackMgr_AddObserver(LobbyDataUpdate_t::k_iCallback, LobbyCache_OnLobbyDataUpdate);
+	CallbackMgr_AddObserver(LobbyChatUpdate_t::k_iCallback, LobbyCache_OnLobbyChatUpdate);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Updates of the pipe are gone, so is the list
+//-----------------------------------------------------------------------------
+void LobbyCache_Shutdown()
+{
+	CallbackMgr_RemoveObserver(LobbyMatchList_t::k_iCallback, LobbyCache_OnLobbyMatchList);
+	CallbackMgr_RemoveObserver(LobbyDataUpdate_t::k_iCallback, LobbyCache_OnLobbyDataUpdate);
+	CallbackMgr_RemoveObserver(LobbyChatUpdate_t::k_iCallback, LobbyCache_OnLobbyChatUpdate);
+
+	GLobbyCache()->Clear();
+	GLobbyCache()->m_unChangeNumber++;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: For memory stats
+//-----------------------------------------------------------------------------
+void LobbyCache_GetMemoryUsage(SteamAPIMemoryUsage_t *pUsage)
+{
+	GLobbyCache()->GetMemoryUsage(pUsage);
+}
+
+//-----------------------------------------------------------------------------
+// 
+// Lobby cache interface
+// 
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Purpose: Fills the public view of a cached lobby
+//-----------------------------------------------------------------------------
+static void LobbyCache_Fill(uint64 ulSteamIDLobby, const CLobbyCache::Lobby_t *pEntry, SteamAPICachedLobby_t *pLobby)
+{
+	pLobby->m_ulSteamIDLobby = ulSteamIDLobby;
+	pLobby->m_ulSteamIDOwner = pEntry->m_ulSteamIDOwner;
+	pLobby->m_nMembers = pEntry->m_nMembers;
+	pLobby->m_nMemberLimit = pEntry->m_nMemberLimit;
+	pLobby->m_nDataCount = (int32)pEntry->m_Data.size();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Number of lobbies in the last list, GetLobbyByIndex() range
+//-----------------------------------------------------------------------------
+int SteamAPI_GetCachedLobbyCount()
+{
+	return (int)GLobbyCache()->m_LobbyIds.size();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Lobby at the index of the last list
+//-----------------------------------------------------------------------------
+bool SteamAPI_GetCachedLobbyByIndex(int iLobby, SteamAPICachedLobby_t *pLobby)
+{
+	CLobbyCache *pCache;
+
+	pCache = GLobbyCache();
+
+	if (!pLobby || iLobby < 0 || iLobby >= (int)pCache->m_LobbyIds.size())
+		return false;
+
+	LobbyCache_Fill(pCache->m_LobbyIds[iLobby], pCache->Find(pCache->m_LobbyIds[iLobby]), pLobby);
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Lobby by its id, false if it isn't in the last list
+//-----------------------------------------------------------------------------
+bool SteamAPI_GetCachedLobby(uint64 ulSteamIDLobby, SteamAPICachedLobby_t *pLobby)
+{
+	const CLobbyCache::Lobby_t *pEntry;
+
+	if (!pLobby)
+		return false;
+
+	pEntry = GLobbyCache()->Find(ulSteamIDLobby);
+
+	if (!pEntry)
+		return false;
+
+	LobbyCache_Fill(ulSteamIDLobby, pEntry, pLobby);
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Value of the key, "" if not set, as GetLobbyData() does
+//-----------------------------------------------------------------------------
+const char* SteamAPI_GetCachedLobbyData(uint64 ulSteamIDLobby, const char *pchKey)
+{
+	const CLobbyCache::Lobby_t *pEntry;
+
+	if (!pchKey)
+		return "";
+
+	pEntry = GLobbyCache()->Find(ulSteamIDLobby);
+
+	if (!pEntry)
+		return "";
+
+	return GLobbyCache()->GetData(pEntry, pchKey);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Key and value at the index, for GetLobbyDataByIndex() users
+//-----------------------------------------------------------------------------
+bool SteamAPI_GetCachedLobbyDataByIndex(uint64 ulSteamIDLobby, int iData, const char **ppchKey, const char **ppchValue)
+{
+	const CLobbyCache::Lobby_t *pEntry;
+
+	if (!ppchKey || !ppchValue)
+		return false;
+
+	pEntry = GLobbyCache()->Find(ulSteamIDLobby);
+
+	if (!pEntry || iData < 0 || iData >= (int)pEntry->m_Data.size())
+		return false;
+
+	*ppchKey = pEntry->m_Data[iData].m_pchKey;
+	*ppchValue = pEntry->m_Data[iData].m_pchValue;
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Counters since init
+//-----------------------------------------------------------------------------
+void SteamAPI_GetLobbyCacheStats(SteamAPILobbyCacheStats_t *pStats)
+{
+	CLobbyCache *pCache;
+
+	if (!pStats)
+		return;
+
+	pCache = GLobbyCache();
+
+	pStats->m_nLobbies = (uint32)pCache->m_LobbyIds.size();
+	pStats->m_nStrings = (uint32)pCache->m_Strings.size();
+	pStats->m_nSnapshots = pCache->m_nSnapshots;
+	pStats->m_nDataUpdates = pCache->m_nDataUpdates;
+	pStats->m_nMemberUpdates = pCache->m_nMemberUpdates;
+	pStats->m_unChangeNumber = pCache->m_unChangeNumber;
+}
@@ -0,0 +1,67 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+#ifndef LOBBY_CACHE_H
+#define LOBBY_CACHE_H
+#pragma once
+
+struct SteamAPIMemoryUsage_t;
+
+//-----------------------------------------------------------------------------
+// Purpose: Lobby as last reported by steam, see SteamAPI_GetCachedLobby().
+//-----------------------------------------------------------------------------
+struct SteamAPICachedLobby_t
+{
+	uint64		m_ulSteamIDLobby;
+	uint64		m_ulSteamIDOwner;		// Only known for lobbies the user is in
+	int32		m_nMembers;
+	int32		m_nMemberLimit;
+	int32		m_nDataCount;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Counters of the lobby cache. The change number goes up with every
+//			snapshot and update, so the UI knows when to redraw.
+//-----------------------------------------------------------------------------
+struct SteamAPILobbyCacheStats_t
+{
+	uint32		m_nLobbies;
+	uint32		m_nStrings;				// Distinct interned keys and values
+	uint32		m_nSnapshots;			// LobbyMatchList_t results read
+	uint32		m_nDataUpdates;			// LobbyDataUpdate_t applied
+	uint32		m_nMemberUpdates;		// LobbyChatUpdate_t applied
+	uint32		m_unChangeNumber;
+};
+
+//-----------------------------------------------------------------------------
+// 
+// Lobby cache C interface
+// 
+//-----------------------------------------------------------------------------
+
+extern void LobbyCache_Init();
+extern void LobbyCache_Shutdown();
+extern void LobbyCache_GetMemoryUsage(SteamAPIMemoryUsage_t *pUsage);
+
+//-----------------------------------------------------------------------------
+// Purpose: Lobby cache API. Lobbies of a LobbyMatchList_t result, and their
+//			data, are read once when the result arrives, afterwards a lobby
+//			is only re-read on its LobbyDataUpdate_t and LobbyChatUpdate_t
+//			moves the member count. Lookups never go to steamclient.
+// 
+//			The result is seen only when the game waits for it with a call
+//			result. Strings returned stay valid until the next result, a
+//			value a lobby no longer has may go with any later update.
+//			Has to be used from the thread that runs callbacks.
+//-----------------------------------------------------------------------------
+S_API int SteamAPI_GetCachedLobbyCount();
+S_API bool SteamAPI_GetCachedLobbyByIndex(int iLobby, SteamAPICachedLobby_t *pLobby);
+S_API bool SteamAPI_GetCachedLobby(uint64 ulSteamIDLobby, SteamAPICachedLobby_t *pLobby);
+S_API const char* SteamAPI_GetCachedLobbyData(uint64 ulSteamIDLobby, const char *pchKey);
+S_API bool SteamAPI_GetCachedLobbyDataByIndex(uint64 ulSteamIDLobby, int iData, const char **ppchKey, const char **ppchValue);
+S_API void SteamAPI_GetLobbyCacheStats(SteamAPILobbyCacheStats_t *pStats);
+
+#endif
@@ -0,0 +1,152 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "steam_api_pch.h"
+#include "memfootprint.h"
+#include "resultpool.h"
+#include "calllatency.h"
+#include "flightrecorder.h"
+#include "personacache.h"
+#include "avatarcache.h"
+#include "lobbycache.h"
+#include "apiconfig.h"
+#include "asynclog.h"
+
+//-----------------------------------------------------------------------------
+// 
+// Memory footprint
+// 
+//	The result pool keeps buffers of the largest burst seen, such as a map
+//	download with thousands of call results. Compaction gives them back, 
+//	either on SteamAPI_CompactMemory() or once the pump has been idle for
+//	idle_compact_ms. Registries give their nodes back on erase. Only the 
+//	explicit call trims the process heap behind them, that walks the game's
+//	whole heap under its lock.
+// 
+//-----------------------------------------------------------------------------
+
+static uint32		s_nCompactions = 0;
+static uint64		s_ullCompactedBytes = 0;
+
+// GetTickCount() of the last pump that dispatched something
+static DWORD		s_dwLastBusyTime = 0;
+static bool			s_bIdleCompacted = true;
+
+//-----------------------------------------------------------------------------
+// Purpose: Adds the structure to the totals.
+//-----------------------------------------------------------------------------
+static void Footprint_AddTotal(SteamAPIMemoryStats_t *pStats, const SteamAPIMemoryUsage_t *pUsage)
+{
+	pStats->m_cubTotalUsed += pUsage->m_cubUsed;
+	pStats->m_cubTotalReserved += pUsage->m_cubReserved;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Releases memory our registries and pools kept from earlier 
+//			bursts, returns bytes released.
+//-----------------------------------------------------------------------------
+static uint32 Footprint_Compact()
+{
+	uint32 cubReleased;
+
+	cubReleased = CallbackMgr_Compact();
+
+	s_nCompactions++;
+	s_ullCompactedBytes += cubReleased;
+
+	return cubReleased;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Compacts once per idle period, called at the end of every pump.
+//-----------------------------------------------------------------------------
+void Footprint_OnPump(uint32 nMessages)
+{
+	uint32	unIdleTime;
+	uint32	cubReleased;
+	DWORD	dwTime;
+
+	dwTime = GetTickCount();
+
+	if (nMessages)
+	{
+		s_dwLastBusyTime = dwTime;
+		s_bIdleCompacted = false;
+		return;
+	}
+
+	unIdleTime = SteamAPIConfig()->m_unIdleCompactTime;
+
+	if (s_bIdleCompacted || !unIdleTime || dwTime - s_dwLastBusyTime < unIdleTime)
+		return;
+
+	s_bIdleCompacted = true;
+	cubReleased = Footprint_Compact();
+
+	if (cubReleased)
+		AsyncLog(k_ESteamAPILogDebug, "[S_API] Idle compaction released %u bytes.\n", cubReleased);
+}
+
+//-----------------------------------------------------------------------------
+// 
+// Memory footprint interface
+// 
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Purpose: Fills the footprint of every registry, pool and trace buffer.
+//-----------------------------------------------------------------------------
+void SteamAPI_GetMemoryStats(SteamAPIMemoryStats_t *pStats)
+{
+	if (!pStats)
+		return;
+
+	memset(pStats, 0, sizeof(SteamAPIMemoryStats_t));
+
+	CallbackMgr_GetMemoryUsage(pStats);
+	ResultPool_GetUsage(&pStats->m_ResultPool);
+	CallLatency_GetMemoryUsage(&pStats->m_CallLatency);
+	AsyncLog_GetMemoryUsage(&pStats->m_LogRings);
+	PersonaCache_GetMemoryUsage(&pStats->m_PersonaCache);
+	AvatarCache_GetMemoryUsage(&pStats->m_AvatarCache);
+	LobbyCache_GetMemoryUsage(&pStats->m_LobbyCache);
+
+	pStats->m_FlightRecorder.m_nEntries = min(g_CallbackFlightRecorder.m_unHead, (uint32)FLIGHTRECORDER_SIZE);
+	pStats->m_FlightRecorder.m_cubUsed = sizeof(g_CallbackFlightRecorder);
+	pStats->m_FlightRecorder.m_cubReserved = sizeof(g_CallbackFlightRecorder);
+
+	Footprint_AddTotal(pStats, &pStats->m_Callbacks);
+	Footprint_AddTotal(pStats, &pStats->m_CallResults);
+	Footprint_AddTotal(pStats, &pStats->m_DeferredRuns);
+	Footprint_AddTotal(pStats, &pStats->m_ResultPool);
+	Footprint_AddTotal(pStats, &pStats->m_CallLatency);
+	Footprint_AddTotal(pStats, &pStats->m_FlightRecorder);
+	Footprint_AddTotal(pStats, &pStats->m_LogRings);
+	Footprint_AddTotal(pStats, &pStats->m_PersonaCache);
+	Footprint_AddTotal(pStats, &pStats->m_AvatarCache);
+	Footprint_AddTotal(pStats, &pStats->m_LobbyCache);
+
+	pStats->m_nCompactions = s_nCompactions;
+	pStats->m_ullCompactedBytes = s_ullCompactedBytes;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Shrinks pools to their working set and trims the heap. 
+//			Registrations and buffers in use are not touched.
+//-----------------------------------------------------------------------------
+uint32 SteamAPI_CompactMemory()
+{
+	uint32 cubReleased;
+
+	cubReleased = Footprint_Compact();
+
+	// Erased map nodes and freed buffers are back in the heap, let it
+	// decommit what it can
+	HeapCompact(GetProcessHeap(), 0);
+
+	return cubReleased;
+}
@@ -0,0 +1,73 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+#ifndef MEM_FOOTPRINT_H
+#define MEM_FOOTPRINT_H
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Purpose: Memory held by one structure. Reserved bytes include memory kept
+//			from earlier bursts that compaction can give back.
+//-----------------------------------------------------------------------------
+struct SteamAPIMemoryUsage_t
+{
+	uint32		m_nEntries;
+	uint32		m_cubUsed;
+	uint32		m_cubReserved;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Memory footprint of steam_api, see SteamAPI_GetMemoryStats().
+//-----------------------------------------------------------------------------
+struct SteamAPIMemoryStats_t
+{
+	// Registries of the callback manager
+	SteamAPIMemoryUsage_t	m_Callbacks;
+	SteamAPIMemoryUsage_t	m_CallResults;
+	SteamAPIMemoryUsage_t	m_DeferredRuns;
+
+	// Payload buffers of call results
+	SteamAPIMemoryUsage_t	m_ResultPool;
+
+	// Trace buffers, entries are API calls in flight, records and log rings
+	SteamAPIMemoryUsage_t	m_CallLatency;
+	SteamAPIMemoryUsage_t	m_FlightRecorder;
+	SteamAPIMemoryUsage_t	m_LogRings;
+
+	// Client-side caches of steamclient state
+	SteamAPIMemoryUsage_t	m_PersonaCache;
+	SteamAPIMemoryUsage_t	m_AvatarCache;
+	SteamAPIMemoryUsage_t	m_LobbyCache;
+
+	uint32					m_cubTotalUsed;
+	uint32					m_cubTotalReserved;
+
+	// Compactions done so far, explicit and on idle, and bytes they released
+	uint32					m_nCompactions;
+	uint64					m_ullCompactedBytes;
+};
+
+//-----------------------------------------------------------------------------
+// 
+// Memory footprint C interface
+// 
+//-----------------------------------------------------------------------------
+
+extern void Footprint_OnPump(uint32 nMessages);
+
+//-----------------------------------------------------------------------------
+// Purpose: Fills the footprint of every registry, pool and trace buffer.
+//-----------------------------------------------------------------------------
+S_API void SteamAPI_GetMemoryStats(SteamAPIMemoryStats_t *pStats);
+
+//-----------------------------------------------------------------------------
+// Purpose: Shrinks pools to their working set and trims the heap, returns 
+//			bytes the pools released. Has to be called from the thread that 
+//			runs callbacks, unless callback_locking is set.
+//-----------------------------------------------------------------------------
+S_API uint32 SteamAPI_CompactMemory();
+
+#endif
@@ -0,0 +1,954 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "steam_api_pch.h"
+#include <dbghelp.h>
+#include <compressapi.h>
+#include "minidump.h"
+#include "minidumphelper.h"
+#include "flightrecorder.h"
+#include "apiconfig.h"
+#include "asynclog.h"
+
+//-----------------------------------------------------------------------------
+// 
+// Minidump comment ring
+// 
+//	Comments are only written into the ring, which costs one interlocked
+//	increment and a bounded copy. Nothing is passed to steamclient until the
+//	process crashes, then the ring is concatenated into the dump comment.
+// 
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Purpose: One ring slot. Sequence is zero while the slot is being written,
+//			otherwise it's the sequence number of the comment stored.
+//-----------------------------------------------------------------------------
+struct MinidumpComment_t
+{
+	volatile LONG	m_nSequence;
+	char			m_szComment[MINIDUMP_COMMENT_LENGTH];
+};
+
+static MinidumpComment_t	s_CommentRing[MINIDUMP_COMMENT_RING_SIZE];
+
+// Sequence number of the last claimed slot
+static volatile LONG		s_nCommentHead = 0;
+
+// Concatenated header, comments and flight recorder, filled at crash time
+#define MINIDUMP_COMMENT_FLUSH_SIZE	(MINIDUMP_HEADER_LENGTH + MINIDUMP_COMMENT_RING_SIZE * MINIDUMP_COMMENT_LENGTH + MINIDUMP_FLIGHT_RECORDS * 80)
+
+static char*				s_pszCommentFlush = nullptr;
+
+// Part of the flushed comment after the header
+static char*				s_pszCommentBody = nullptr;
+
+//-----------------------------------------------------------------------------
+// 
+// Emergency arena
+// 
+//	Everything the crash path needs is carved out of this block at init, so
+//	writing a dump doesn't touch the heap, which may be the very thing that 
+//	got corrupted. The block is never freed, dumps can be written even after
+//	the API was shut down.
+// 
+//-----------------------------------------------------------------------------
+
+static uint8*				s_pubArena = nullptr;
+static volatile LONG		s_cubArenaUsed = 0;
+
+// Preformatted description of the process, see Minidump_UpdateHeader().
+// Sequence is odd while the header is being rewritten.
+static char					s_szDumpHeader[MINIDUMP_HEADER_LENGTH];
+static volatile LONG		s_nDumpHeaderSequence = 0;
+
+static void Minidump_InitFilter();
+static void Minidump_UpdateHelper();
+
+//-----------------------------------------------------------------------------
+// Purpose: Reserves emergency arena and buffers of the crash path. Safe to be
+//			called more than once.
+//-----------------------------------------------------------------------------
+bool Minidump_Init()
+{
+	uint8* pubArena;
+
+	// Filtering may have been asked for since the arena was reserved
+	if (s_pubArena)
+	{
+		Minidump_InitFilter();
+		return true;
+	}
+
+	pubArena = reinterpret_cast<uint8*>(VirtualAlloc(NULL, MINIDUMP_ARENA_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+
+	if (!pubArena)
+		return false;
+
+	// Someone else was faster
+	if (InterlockedCompareExchangePointer(reinterpret_cast<PVOID volatile*>(&s_pubArena), pubArena, NULL) != NULL)
+	{
+		VirtualFree(pubArena, 0, MEM_RELEASE);
+		return true;
+	}
+
+	s_pszCommentFlush = reinterpret_cast<char*>(Minidump_ArenaAlloc(MINIDUMP_COMMENT_FLUSH_SIZE));
+
+	Minidump_UpdateHeader();
+	Minidump_InitFilter();
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Carves a block out of the emergency arena. Blocks are never given
+//			back. Returns nullptr when the arena is missing or exhausted.
+//-----------------------------------------------------------------------------
+void* Minidump_ArenaAlloc(uint32 cubSize)
+{
+	LONG cubEnd;
+
+	if (!s_pubArena)
+		return nullptr;
+
+	// Keep blocks 16 byte aligned
+	cubSize = (cubSize + 15) & ~15;
+
+	cubEnd = InterlockedExchangeAdd(&s_cubArenaUsed, (LONG)cubSize) + (LONG)cubSize;
+
+	if (cubEnd > MINIDUMP_ARENA_SIZE)
+		return nullptr;
+
+	return s_pubArena + cubEnd - cubSize;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Formats description of the process put at the top of the dump
+//			comment. Called whenever any of the values changes, so the crash
+//			path only has to copy it. Values are set from the game thread, 
+//			there is only one writer at a time.
+//-----------------------------------------------------------------------------
+void Minidump_UpdateHeader()
+{
+	char szHeader[MINIDUMP_HEADER_LENGTH];
+
+	_snprintf(szHeader, sizeof(szHeader), "appid %u version %s built %s steamid %llu\n",
+		g_BreakpadLastAppId, g_pchBreakpadVersion, g_szBreakpadTimestamp, g_SteamMinidumpSID);
+
+	szHeader[sizeof(szHeader) - 1] = '\0';
+
+	// Format aside and publish under the sequence, a crash meanwhile tells
+	// the copy is torn
+	InterlockedIncrement(&s_nDumpHeaderSequence);
+	memcpy(s_szDumpHeader, szHeader, sizeof(s_szDumpHeader));
+	InterlockedIncrement(&s_nDumpHeaderSequence);
+
+	Minidump_UpdateHelper();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Stores comment into the ring. Wait-free, oldest comment gets
+//			overwritten when the ring is full.
+//-----------------------------------------------------------------------------
+void Minidump_AddComment(const char *pszComment)
+{
+	MinidumpComment_t*	pSlot;
+	LONG				nSequence;
+	int					i;
+
+	if (!pszComment)
+		return;
+
+	nSequence = InterlockedIncrement(&s_nCommentHead);
+	pSlot = &s_CommentRing[(nSequence - 1) & (MINIDUMP_COMMENT_RING_SIZE - 1)];
+
+	// Tell readers the slot is incomplete
+	pSlot->m_nSequence = 0;
+	_WriteBarrier();
+
+	for (i = 0; i < MINIDUMP_COMMENT_LENGTH - 1 && pszComment[i]; i++)
+		pSlot->m_szComment[i] = pszComment[i];
+
+	pSlot->m_szComment[i] = '\0';
+
+	_WriteBarrier();
+	pSlot->m_nSequence = nSequence;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Concatenates header and comments from the oldest to the newest
+//			one, appends the newest flight recorder entries and hands it all to
+//			steamclient, if it's there. Only meant to be called from the 
+//			crash path, so it doesn't load, format nor allocate anything.
+//-----------------------------------------------------------------------------
+void Minidump_FlushComments()
+{
+	MinidumpComment_t*	pSlot;
+	LONG				nHead, nSequence, nHeaderSequence;
+	char*				pszOut;
+	char*				pszEnd;
+
+	if (!s_pszCommentFlush)
+		return;
+
+	nHead = s_nCommentHead;
+
+	pszEnd = s_pszCommentFlush + MINIDUMP_COMMENT_FLUSH_SIZE - 1;
+
+	// Copy again when an update raced with us. The writer may be the thread
+	// that crashed, so it isn't waited for long, a torn header is still
+	// terminated.
+	for (int nTry = 0; nTry < 4; nTry++)
+	{
+		nHeaderSequence = s_nDumpHeaderSequence;
+		_ReadBarrier();
+
+		pszOut = s_pszCommentFlush;
+
+		for (const char* pszIn = s_szDumpHeader; *pszIn && pszOut < pszEnd; )
+			*pszOut++ = *pszIn++;
+
+		_ReadBarrier();
+
+		if (!(nHeaderSequence & 1) && nHeaderSequence == s_nDumpHeaderSequence)
+			break;
+	}
+
+	s_pszCommentBody = pszOut;
+
+	nSequence = max(nHead - MINIDUMP_COMMENT_RING_SIZE + 1, 1);
+
+	for (; nSequence <= nHead; nSequence++)
+	{
+		pSlot = &s_CommentRing[(nSequence - 1) & (MINIDUMP_COMMENT_RING_SIZE - 1)];
+
+		// Torn or already overwritten slot
+		if (pSlot->m_nSequence != nSequence)
+			continue;
+
+		for (const char* pszIn = pSlot->m_szComment; *pszIn && pszOut < pszEnd; )
+			*pszOut++ = *pszIn++;
+
+		if (pszOut < pszEnd)
+			*pszOut++ = '\n';
+	}
+
+	*pszOut = '\0';
+
+	FlightRecorder_Format(pszOut, (uint32)(pszEnd - pszOut + 1), MINIDUMP_FLIGHT_RECORDS);
+
+	if (s_pfnSteamWriteMiniDumpSetComment)
+		s_pfnSteamWriteMiniDumpSetComment(s_pszCommentFlush);
+}
+
+//-----------------------------------------------------------------------------
+// 
+// Region filtered dumps
+// 
+//	Full memory dumps of large processes take long to write and upload. When
+//	the application asks for them, breakpad is told to write a normal dump and
+//	we write our own one next to it from the pre minidump callback. It holds
+//	thread stacks and the memory they reference, the comment and flight data,
+//	and regions registered by the application, minus the excluded ones.
+// 
+//-----------------------------------------------------------------------------
+
+typedef BOOL (WINAPI *pfnMiniDumpWriteDump_t)(HANDLE hProcess, DWORD ProcessId, HANDLE hFile, MINIDUMP_TYPE DumpType,
+											 PMINIDUMP_EXCEPTION_INFORMATION ExceptionParam, 
+											 PMINIDUMP_USER_STREAM_INFORMATION UserStreamParam,
+											 PMINIDUMP_CALLBACK_INFORMATION CallbackParam);
+
+//-----------------------------------------------------------------------------
+// Purpose: Region registered by the application.
+//-----------------------------------------------------------------------------
+struct MinidumpRegion_t
+{
+	const void*		m_pvBase;
+	uint32			m_cubSize;
+	bool			m_bExclude;
+};
+
+static MinidumpRegion_t			s_Regions[MINIDUMP_MAX_REGIONS];
+static volatile LONG			s_nRegions = 0;
+static SRWLOCK					s_RegionLock = SRWLOCK_INIT;
+
+static pfnMiniDumpWriteDump_t	s_pfnMiniDumpWriteDump = nullptr;
+
+// "<dir>\steam_api_<pid>_", dump index and extension are added when writing
+static char						s_szFilteredDumpPrefix[MAX_PATH];
+static volatile LONG			s_nFilteredDumps = 0;
+
+// Exception being reported and the thread it was raised on, if known
+static EXCEPTION_POINTERS*		s_pCrashExceptionInfo = nullptr;
+static DWORD					s_dwCrashThreadId = 0;
+
+// Breakpad's filter, ours only records the exception and calls it
+static LPTOP_LEVEL_EXCEPTION_FILTER	s_pfnPrevExceptionFilter = nullptr;
+
+//-----------------------------------------------------------------------------
+// Purpose: Walk state of the filter callback.
+//-----------------------------------------------------------------------------
+struct MinidumpFilterState_t
+{
+	int		m_iInclude;
+	int		m_iExclude;
+};
+
+static DWORD WINAPI Minidump_CompressThread(LPVOID pvParam);
+
+//-----------------------------------------------------------------------------
+// Purpose: Resolves dbghelp and prepares the dump path, so that nothing has to
+//			be loaded nor formatted while crashing. Starts compression of dumps
+//			left by previous runs. Called on every Minidump_Init(), the 
+//			application may ask for full memory dumps after the arena exists.
+//-----------------------------------------------------------------------------
+static void Minidump_InitFilter()
+{
+	const SteamAPIConfig_t*	pConfig;
+	HMODULE					hDbgHelpModule;
+	HANDLE					hThread;
+
+	pConfig = SteamAPIConfig();
+
+	// Already on, or normal dumps which are small already
+	if (s_pfnMiniDumpWriteDump || !pConfig->m_szMinidumpDir[0] || !pConfig->m_bMinidumpFilter || !g_bBreakpadFullMemoryDumps)
+		return;
+
+	hDbgHelpModule = LoadLibraryA("dbghelp.dll");
+
+	if (!hDbgHelpModule)
+		return;
+
+	CreateDirectoryA(pConfig->m_szMinidumpDir, NULL);
+
+	_snprintf(s_szFilteredDumpPrefix, sizeof(s_szFilteredDumpPrefix), "%s\\steam_api_%u_", pConfig->m_szMinidumpDir, GetCurrentProcessId());
+	s_szFilteredDumpPrefix[sizeof(s_szFilteredDumpPrefix) - 1] = '\0';
+
+	s_pfnMiniDumpWriteDump = reinterpret_cast<pfnMiniDumpWriteDump_t>(GetProcAddress(hDbgHelpModule, "MiniDumpWriteDump"));
+
+	// Only our own dumps are compressed
+	if (s_pfnMiniDumpWriteDump && pConfig->m_bMinidumpCompress)
+	{
+		hThread = CreateThread(NULL, 0, Minidump_CompressThread, NULL, 0, NULL);
+
+		if (hThread)
+			CloseHandle(hThread);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Whenever breakpad should be asked for full memory dumps or not.
+//-----------------------------------------------------------------------------
+bool Minidump_IsFiltering()
+{
+	return s_pfnMiniDumpWriteDump != nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Remembers exception being reported for the filtered dump. Has to
+//			be called on the thread that raised it.
+//-----------------------------------------------------------------------------
+void Minidump_SetExceptionInfo(void *pvExceptionInfo)
+{
+	s_pCrashExceptionInfo = reinterpret_cast<EXCEPTION_POINTERS*>(pvExceptionInfo);
+	s_dwCrashThreadId = GetCurrentThreadId();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Records the exception on the crashing thread before breakpad gets
+//			it. Breakpad's pre minidump callback carries no exception and may
+//			run on breakpad's own thread.
+//-----------------------------------------------------------------------------
+static LONG WINAPI Minidump_ExceptionFilter(EXCEPTION_POINTERS *pExceptionInfo)
+{
+	Minidump_SetExceptionInfo(pExceptionInfo);
+
+	if (s_pfnPrevExceptionFilter)
+		return s_pfnPrevExceptionFilter(pExceptionInfo);
+
+	return EXCEPTION_CONTINUE_SEARCH;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Puts our filter in front of breakpad's. Has to be called after
+//			every breakpad init, which installs its filter again.
+//-----------------------------------------------------------------------------
+void Minidump_HookExceptionFilter()
+{
+	LPTOP_LEVEL_EXCEPTION_FILTER pfnPrevExceptionFilter;
+
+	pfnPrevExceptionFilter = SetUnhandledExceptionFilter(Minidump_ExceptionFilter);
+
+	if (pfnPrevExceptionFilter != Minidump_ExceptionFilter)
+		s_pfnPrevExceptionFilter = pfnPrevExceptionFilter;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Adds region to the list, replaces the one with the same base.
+//-----------------------------------------------------------------------------
+static void Minidump_AddRegion(const void *pvBase, uint32 cubSize, bool bExclude)
+{
+	int i;
+
+	if (!pvBase || !cubSize)
+		return;
+
+	AcquireSRWLockExclusive(&s_RegionLock);
+
+	for (i = 0; i < s_nRegions; i++)
+	{
+		if (s_Regions[i].m_pvBase == pvBase)
+			break;
+	}
+
+	if (i < MINIDUMP_MAX_REGIONS)
+	{
+		s_Regions[i].m_pvBase = pvBase;
+		s_Regions[i].m_cubSize = cubSize;
+		s_Regions[i].m_bExclude = bExclude;
+
+		if (i == s_nRegions)
+			s_nRegions++;
+	}
+
+	ReleaseSRWLockExclusive(&s_RegionLock);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Finds next region of the kind starting at index, returns false
+//			when there's none left.
+//-----------------------------------------------------------------------------
+static bool Minidump_NextRegion(int *piRegion, bool bExclude, PMINIDUMP_CALLBACK_OUTPUT pOutput)
+{
+	for (; *piRegion < s_nRegions; (*piRegion)++)
+	{
+		const MinidumpRegion_t* pRegion = &s_Regions[*piRegion];
+
+		if (pRegion->m_bExclude != bExclude)
+			continue;
+
+		pOutput->MemoryBase = reinterpret_cast<ULONG_PTR>(pRegion->m_pvBase);
+		pOutput->MemorySize = pRegion->m_cubSize;
+
+		(*piRegion)++;
+		return true;
+	}
+
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Tells dbghelp what memory to put into the dump. Our own crash data
+//			goes first, then the included regions. Region list is read without
+//			the lock, the process is dying anyway.
+//-----------------------------------------------------------------------------
+static BOOL CALLBACK Minidump_FilterCallback(PVOID pvParam, const PMINIDUMP_CALLBACK_INPUT pInput, PMINIDUMP_CALLBACK_OUTPUT pOutput)
+{
+	MinidumpFilterState_t* pState = reinterpret_cast<MinidumpFilterState_t*>(pvParam);
+
+	switch (pInput->CallbackType)
+	{
+		case MemoryCallback:
+			if (pState->m_iInclude == -2)
+			{
+				pOutput->MemoryBase = reinterpret_cast<ULONG_PTR>(&g_CallbackFlightRecorder);
+				pOutput->MemorySize = sizeof(g_CallbackFlightRecorder);
+				pState->m_iInclude++;
+				return TRUE;
+			}
+
+			if (pState->m_iInclude == -1)
+			{
+				pOutput->MemoryBase = reinterpret_cast<ULONG_PTR>(s_CommentRing);
+				pOutput->MemorySize = sizeof(s_CommentRing);
+				pState->m_iInclude++;
+				return TRUE;
+			}
+
+			return Minidump_NextRegion(&pState->m_iInclude, false, pOutput) ? TRUE : FALSE;
+
+		case RemoveMemoryCallback:
+			return Minidump_NextRegion(&pState->m_iExclude, true, pOutput) ? TRUE : FALSE;
+
+		case CancelCallback:
+			pOutput->Cancel = FALSE;
+			pOutput->CheckCancel = FALSE;
+			return TRUE;
+	}
+
+	return TRUE;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Appends unsigned decimal number, used instead of the CRT formatting
+//			on the crash path.
+//-----------------------------------------------------------------------------
+static char* Minidump_AppendUint(char *pszOut, char *pszEnd, uint32 unValue)
+{
+	char	szDigits[12];
+	int		nDigits = 0;
+
+	do
+	{
+		szDigits[nDigits++] = '0' + (char)(unValue % 10);
+		unValue /= 10;
+	}
+	while (unValue);
+
+	while (nDigits && pszOut < pszEnd)
+		*pszOut++ = szDigits[--nDigits];
+
+	return pszOut;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Writes the region filtered dump. Comment is stored as a comment
+//			stream, so the dump is self-contained. Returns false if there is
+//			no dump.
+//-----------------------------------------------------------------------------
+static bool Minidump_WriteFiltered()
+{
+	MINIDUMP_EXCEPTION_INFORMATION		ExceptionInfo;
+	MINIDUMP_USER_STREAM				CommentStream;
+	MINIDUMP_USER_STREAM_INFORMATION	UserStreams;
+	MINIDUMP_CALLBACK_INFORMATION		CallbackInfo;
+	MinidumpFilterState_t				FilterState;
+	char								szPath[MAX_PATH];
+	char*								pszOut;
+	char*								pszEnd;
+	HANDLE								hFile;
+	BOOL								bWritten;
+
+	pszEnd = szPath + sizeof(szPath) - 1;
+	pszOut = szPath;
+
+	for (const char* pszIn = s_szFilteredDumpPrefix; *pszIn && pszOut < pszEnd; )
+		*pszOut++ = *pszIn++;
+
+	pszOut = Minidump_AppendUint(pszOut, pszEnd, (uint32)InterlockedIncrement(&s_nFilteredDumps));
+
+	for (const char* pszIn = ".dmp"; *pszIn && pszOut < pszEnd; )
+		*pszOut++ = *pszIn++;
+
+	*pszOut = '\0';
+
+	hFile = CreateFileA(szPath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	ExceptionInfo.ThreadId = s_dwCrashThreadId;
+	ExceptionInfo.ExceptionPointers = s_pCrashExceptionInfo;
+	ExceptionInfo.ClientPointers = FALSE;
+
+	UserStreams.UserStreamCount = 0;
+	UserStreams.UserStreamArray = &CommentStream;
+
+	if (s_pszCommentFlush && s_pszCommentFlush[0])
+	{
+		CommentStream.Type = CommentStreamA;
+		CommentStream.Buffer = s_pszCommentFlush;
+		CommentStream.BufferSize = (ULONG)strlen(s_pszCommentFlush) + 1;
+		UserStreams.UserStreamCount = 1;
+	}
+
+	FilterState.m_iInclude = -2;
+	FilterState.m_iExclude = 0;
+
+	CallbackInfo.CallbackRoutine = Minidump_FilterCallback;
+	CallbackInfo.CallbackParam = &FilterState;
+
+	bWritten = s_pfnMiniDumpWriteDump(GetCurrentProcess(), GetCurrentProcessId(), hFile, 
+						   (MINIDUMP_TYPE)(MiniDumpNormal | MiniDumpWithIndirectlyReferencedMemory | MiniDumpWithThreadInfo | MiniDumpWithUnloadedModules),
+						   s_pCrashExceptionInfo ? &ExceptionInfo : NULL,
+						   &UserStreams,
+						   &CallbackInfo);
+
+	CloseHandle(hFile);
+
+	return bWritten != FALSE;
+}
+
+//-----------------------------------------------------------------------------
+// 
+// Background compression
+// 
+//	Runs on the start after the crash, at the lowest priority. Each dump is
+//	compressed with LZMS into "<name>.dmp.lzms" and the original is deleted.
+//	Dumps still being written by other processes can't be opened and are left
+//	for later.
+// 
+//-----------------------------------------------------------------------------
+
+typedef BOOL (WINAPI *pfnCreateCompressor_t)(DWORD Algorithm, PCOMPRESS_ALLOCATION_ROUTINES AllocationRoutines, PCOMPRESSOR_HANDLE CompressorHandle);
+typedef BOOL (WINAPI *pfnCompress_t)(COMPRESSOR_HANDLE CompressorHandle, LPCVOID UncompressedData, SIZE_T UncompressedDataSize, PVOID CompressedBuffer, SIZE_T CompressedBufferSize, PSIZE_T CompressedDataSize);
+typedef BOOL (WINAPI *pfnCloseCompressor_t)(COMPRESSOR_HANDLE CompressorHandle);
+
+//-----------------------------------------------------------------------------
+// Purpose: Compresses one dump, returns true if the original may be deleted.
+//-----------------------------------------------------------------------------
+static bool Minidump_CompressFile(pfnCompress_t pfnCompress, COMPRESSOR_HANDLE hCompressor, const char *pszPath)
+{
+	HANDLE	hFile, hMapping, hOutFile;
+	DWORD	cubFile, cubWritten;
+	SIZE_T	cubCompressed;
+	void*	pvView;
+	void*	pvCompressed;
+	char	szOutPath[MAX_PATH];
+	bool	bSuccess;
+
+	// No sharing, fails if someone is still writing the dump
+	hFile = CreateFileA(pszPath, GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	bSuccess = false;
+	cubFile = GetFileSize(hFile, NULL);
+	hMapping = cubFile ? CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+	pvView = hMapping ? MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+	if (pvView)
+	{
+		// Ask for the size first
+		cubCompressed = 0;
+		pfnCompress(hCompressor, pvView, cubFile, NULL, 0, &cubCompressed);
+
+		pvCompressed = cubCompressed ? malloc(cubCompressed) : nullptr;
+
+		if (pvCompressed && pfnCompress(hCompressor, pvView, cubFile, pvCompressed, cubCompressed, &cubCompressed))
+		{
+			_snprintf(szOutPath, sizeof(szOutPath), "%s.lzms", pszPath);
+			szOutPath[sizeof(szOutPath) - 1] = '\0';
+
+			hOutFile = CreateFileA(szOutPath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+			if (hOutFile != INVALID_HANDLE_VALUE)
+			{
+				bSuccess = WriteFile(hOutFile, pvCompressed, (DWORD)cubCompressed, &cubWritten, NULL) && cubWritten == cubCompressed;
+				CloseHandle(hOutFile);
+
+				if (!bSuccess)
+					DeleteFileA(szOutPath);
+			}
+		}
+
+		free(pvCompressed);
+		UnmapViewOfFile(pvView);
+	}
+
+	if (hMapping)
+		CloseHandle(hMapping);
+
+	CloseHandle(hFile);
+	return bSuccess;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Compresses dumps left in the dump directory.
+//-----------------------------------------------------------------------------
+static DWORD WINAPI Minidump_CompressThread(LPVOID pvParam)
+{
+	pfnCreateCompressor_t	pfnCreateCompressor;
+	pfnCompress_t			pfnCompress;
+	pfnCloseCompressor_t	pfnCloseCompressor;
+	COMPRESSOR_HANDLE		hCompressor;
+	WIN32_FIND_DATAA		FindData;
+	HMODULE					hCabinetModule;
+	HANDLE					hFind;
+	char					szPath[MAX_PATH];
+	const char*				pszDir;
+
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+
+	// Startup setting, never changes
+	pszDir = SteamAPIConfig()->m_szMinidumpDir;
+
+	_snprintf(szPath, sizeof(szPath), "%s\\*.dmp", pszDir);
+	szPath[sizeof(szPath) - 1] = '\0';
+
+	hFind = FindFirstFileA(szPath, &FindData);
+
+	if (hFind == INVALID_HANDLE_VALUE)
+		return 0;
+
+	hCabinetModule = LoadLibraryA("cabinet.dll");
+
+	pfnCreateCompressor = hCabinetModule ? reinterpret_cast<pfnCreateCompressor_t>(GetProcAddress(hCabinetModule, "CreateCompressor")) : nullptr;
+	pfnCompress = hCabinetModule ? reinterpret_cast<pfnCompress_t>(GetProcAddress(hCabinetModule, "Compress")) : nullptr;
+	pfnCloseCompressor = hCabinetModule ? reinterpret_cast<pfnCloseCompressor_t>(GetProcAddress(hCabinetModule, "CloseCompressor")) : nullptr;
+
+	if (pfnCreateCompressor && pfnCompress && pfnCloseCompressor && pfnCreateCompressor(COMPRESS_ALGORITHM_LZMS, NULL, &hCompressor))
+	{
+		do
+		{
+			if (FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+				continue;
+
+			_snprintf(szPath, sizeof(szPath), "%s\\%s", pszDir, FindData.cFileName);
+			szPath[sizeof(szPath) - 1] = '\0';
+
+			if (Minidump_CompressFile(pfnCompress, hCompressor, szPath))
+				DeleteFileA(szPath);
+		}
+		while (FindNextFileA(hFind, &FindData));
+
+		pfnCloseCompressor(hCompressor);
+	}
+
+	FindClose(hFind);
+
+	if (hCabinetModule)
+		FreeLibrary(hCabinetModule);
+
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// 
+// Out-of-process writer
+// 
+//	Optional helper process (see minidumphelper/) that shares a region with
+//	us. On crash we only fill in the crash fields and signal it. Once it has
+//	snapshotted our address space breakpad carries on, and our dump is 
+//	written from the snapshot while breakpad and the game finish theirs.
+// 
+//-----------------------------------------------------------------------------
+
+static MinidumpHelperShared_t*	s_pHelperShared = nullptr;
+static HANDLE					s_hHelperCrashEvent = NULL;
+static HANDLE					s_hHelperAckEvent = NULL;
+static HANDLE					s_hHelperProcess = NULL;
+static volatile LONG			s_bHelperSignaled = 0;
+
+//-----------------------------------------------------------------------------
+// Purpose: Copies description of the process into the shared region.
+//-----------------------------------------------------------------------------
+static void Minidump_UpdateHelper()
+{
+	if (!s_pHelperShared)
+		return;
+
+	s_pHelperShared->m_unAppId = g_BreakpadLastAppId;
+	s_pHelperShared->m_ullSteamID = g_SteamMinidumpSID;
+	s_pHelperShared->m_bFullMemory = g_bBreakpadFullMemoryDumps && !Minidump_IsFiltering();
+
+	strncpy(s_pHelperShared->m_szVersion, g_pchBreakpadVersion, sizeof(s_pHelperShared->m_szVersion));
+	s_pHelperShared->m_szVersion[sizeof(s_pHelperShared->m_szVersion) - 1] = '\0';
+
+	strncpy(s_pHelperShared->m_szTimestamp, g_szBreakpadTimestamp, sizeof(s_pHelperShared->m_szTimestamp));
+	s_pHelperShared->m_szTimestamp[sizeof(s_pHelperShared->m_szTimestamp) - 1] = '\0';
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Creates the shared region and starts the helper, if configured.
+//-----------------------------------------------------------------------------
+bool Minidump_StartHelper()
+{
+	const SteamAPIConfig_t*	pConfig;
+	PROCESS_INFORMATION		ProcessInfo;
+	STARTUPINFOA			StartupInfo;
+	HANDLE					hMapping;
+	DWORD					dwProcessId;
+	char					szName[64];
+	char					szCommandLine[MAX_PATH + 32];
+
+	pConfig = SteamAPIConfig();
+
+	if (s_hHelperProcess || !pConfig->m_szMinidumpHelperPath[0])
+		return false;
+
+	dwProcessId = GetCurrentProcessId();
+
+	_snprintf(szName, sizeof(szName), MINIDUMPHELPER_MAPPING_NAME, dwProcessId);
+	hMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(MinidumpHelperShared_t), szName);
+
+	if (!hMapping)
+		return false;
+
+	// Mapping handle is kept open for the rest of the process
+	s_pHelperShared = reinterpret_cast<MinidumpHelperShared_t*>(MapViewOfFile(hMapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, sizeof(MinidumpHelperShared_t)));
+
+	if (!s_pHelperShared)
+	{
+		CloseHandle(hMapping);
+		return false;
+	}
+
+	_snprintf(szName, sizeof(szName), MINIDUMPHELPER_CRASH_EVENT_NAME, dwProcessId);
+	s_hHelperCrashEvent = CreateEventA(NULL, TRUE, FALSE, szName);
+
+	_snprintf(szName, sizeof(szName), MINIDUMPHELPER_ACK_EVENT_NAME, dwProcessId);
+	s_hHelperAckEvent = CreateEventA(NULL, TRUE, FALSE, szName);
+
+	if (!s_hHelperCrashEvent || !s_hHelperAckEvent)
+		return false;
+
+	s_pHelperShared->m_unVersion = MINIDUMPHELPER_VERSION;
+	s_pHelperShared->m_dwProcessId = dwProcessId;
+
+	strncpy(s_pHelperShared->m_szDumpDir, pConfig->m_szMinidumpDir[0] ? pConfig->m_szMinidumpDir : ".", sizeof(s_pHelperShared->m_szDumpDir));
+	s_pHelperShared->m_szDumpDir[sizeof(s_pHelperShared->m_szDumpDir) - 1] = '\0';
+
+	Minidump_UpdateHelper();
+
+	_snprintf(szCommandLine, sizeof(szCommandLine), "\"%s\" %u", pConfig->m_szMinidumpHelperPath, dwProcessId);
+	szCommandLine[sizeof(szCommandLine) - 1] = '\0';
+
+	memset(&StartupInfo, 0, sizeof(StartupInfo));
+	StartupInfo.cb = sizeof(StartupInfo);
+
+	if (!CreateProcessA(pConfig->m_szMinidumpHelperPath, szCommandLine, NULL, NULL, FALSE, CREATE_NO_WINDOW, NULL, NULL, &StartupInfo, &ProcessInfo))
+	{
+		AsyncLog(k_ESteamAPILogError, "[S_API] Failed to start minidump helper %s (%u)\n", pConfig->m_szMinidumpHelperPath, GetLastError());
+		return false;
+	}
+
+	CloseHandle(ProcessInfo.hThread);
+	s_hHelperProcess = ProcessInfo.hProcess;
+
+	AsyncLog(k_ESteamAPILogInfo, "[S_API] Started minidump helper, pid %u\n", ProcessInfo.dwProcessId);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Hands the crash over to the helper and waits for its snapshot. 
+//			Returns false when there's no helper to take it, then the dump has
+//			to be written in-process. Comments have to be flushed already. 
+//			The helper is signaled once, later calls of the same crash only
+//			tell whether it took it.
+//-----------------------------------------------------------------------------
+bool Minidump_HandOffToHelper()
+{
+	DWORD	dwExceptionCode;
+	char*	pszOut;
+	char*	pszEnd;
+	int		nRegions;
+
+	if (!s_hHelperProcess)
+		return false;
+
+	if (InterlockedExchange(&s_bHelperSignaled, 1))
+		return WaitForSingleObject(s_hHelperAckEvent, 0) == WAIT_OBJECT_0;
+
+	// Helper is gone
+	if (WaitForSingleObject(s_hHelperProcess, 0) != WAIT_TIMEOUT)
+		return false;
+
+	dwExceptionCode = s_pCrashExceptionInfo ? s_pCrashExceptionInfo->ExceptionRecord->ExceptionCode : 0;
+
+	pszOut = s_pHelperShared->m_szComment;
+	pszEnd = s_pHelperShared->m_szComment + sizeof(s_pHelperShared->m_szComment) - 1;
+
+	if (s_pszCommentBody)
+	{
+		for (const char* pszIn = s_pszCommentBody; *pszIn && pszOut < pszEnd; )
+			*pszOut++ = *pszIn++;
+	}
+
+	*pszOut = '\0';
+
+	// Region list is read without the lock, the process is dying anyway
+	nRegions = min((int)s_nRegions, MINIDUMPHELPER_MAX_REGIONS);
+
+	for (int i = 0; i < nRegions; i++)
+	{
+		s_pHelperShared->m_Regions[i].m_ullBase = reinterpret_cast<ULONG_PTR>(s_Regions[i].m_pvBase);
+		s_pHelperShared->m_Regions[i].m_cubSize = s_Regions[i].m_cubSize;
+		s_pHelperShared->m_Regions[i].m_bExclude = s_Regions[i].m_bExclude;
+	}
+
+	s_pHelperShared->m_nRegions = nRegions;
+
+	s_pHelperShared->m_dwCrashThreadId = s_dwCrashThreadId ? s_dwCrashThreadId : GetCurrentThreadId();
+	s_pHelperShared->m_dwExceptionCode = dwExceptionCode;
+	s_pHelperShared->m_ullExceptionPointers = reinterpret_cast<ULONG_PTR>(s_pCrashExceptionInfo);
+
+	SetEvent(s_hHelperCrashEvent);
+
+	// Snapshot failed or took too long, write the dump ourselves
+	return WaitForSingleObject(s_hHelperAckEvent, MINIDUMPHELPER_ACK_TIMEOUT) == WAIT_OBJECT_0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The dump is taken care of, lets the application's pre minidump
+//			callback run and exits without breakpad writing another one.
+//-----------------------------------------------------------------------------
+void Minidump_ExitCrashed(void *pvContext)
+{
+	DWORD dwExceptionCode;
+
+	if (g_pfnBreakpadPreMinidumpCallback)
+		g_pfnBreakpadPreMinidumpCallback(pvContext);
+
+	dwExceptionCode = s_pCrashExceptionInfo ? s_pCrashExceptionInfo->ExceptionRecord->ExceptionCode : 1;
+
+	TerminateProcess(GetCurrentProcess(), dwExceptionCode);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Passed to steamclient's breakpad instead of the application's pre
+//			minidump callback. Flushes our data and hands the crash to the
+//			helper, or writes the filtered dump, and the process exits once
+//			either has the dump. Otherwise forwards the call and breakpad
+//			writes its own dump once we return.
+//-----------------------------------------------------------------------------
+void Minidump_PreMinidumpCallback(void *pvContext)
+{
+	Minidump_FlushComments();
+
+	if (Minidump_HandOffToHelper())
+		Minidump_ExitCrashed(pvContext);
+
+	// Filtered dump replaces breakpad's full memory one
+	if (s_pfnMiniDumpWriteDump && Minidump_WriteFiltered())
+		Minidump_ExitCrashed(pvContext);
+
+	if (g_pfnBreakpadPreMinidumpCallback)
+		g_pfnBreakpadPreMinidumpCallback(pvContext);
+}
+
+//-----------------------------------------------------------------------------
+// 
+// Minidump region interface
+// 
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Purpose: Puts the memory into filtered dumps, e.g. an interesting heap.
+//-----------------------------------------------------------------------------
+void SteamAPI_AddMinidumpRegion(const void *pvBase, uint32 cubSize)
+{
+	Minidump_AddRegion(pvBase, cubSize, false);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Keeps the memory out of filtered dumps, e.g. large asset buffers.
+//-----------------------------------------------------------------------------
+void SteamAPI_ExcludeMinidumpRegion(const void *pvBase, uint32 cubSize)
+{
+	Minidump_AddRegion(pvBase, cubSize, true);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Forgets region added or excluded before.
+//-----------------------------------------------------------------------------
+void SteamAPI_RemoveMinidumpRegion(const void *pvBase)
+{
+	AcquireSRWLockExclusive(&s_RegionLock);
+
+	for (int i = 0; i < s_nRegions; i++)
+	{
+		if (s_Regions[i].m_pvBase != pvBase)
+			continue;
+
+		s_Regions[i] = s_Regions[s_nRegions - 1];
+		s_nRegions--;
+		break;
+	}
+
+	ReleaseSRWLockExclusive(&s_RegionLock);
+}
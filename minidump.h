@@ -0,0 +1,68 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+#ifndef MINIDUMP_H
+#define MINIDUMP_H
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Purpose: Number of recent comments kept for the crash dump and maximum
+//			length of each of them. Ring size has to be power of two.
+//-----------------------------------------------------------------------------
+#define MINIDUMP_COMMENT_RING_SIZE		32
+#define MINIDUMP_COMMENT_LENGTH			128
+
+//-----------------------------------------------------------------------------
+// Purpose: Number of the newest flight recorder entries put into the comment.
+//			The whole recorder is still in the dump memory.
+//-----------------------------------------------------------------------------
+#define MINIDUMP_FLIGHT_RECORDS			64
+
+//-----------------------------------------------------------------------------
+// Purpose: Size of the memory reserved at init for work done while crashing.
+//-----------------------------------------------------------------------------
+#define MINIDUMP_ARENA_SIZE				(64 * 1024)
+
+//-----------------------------------------------------------------------------
+// Purpose: Maximum length of the appid/version/steamid line of the comment.
+//-----------------------------------------------------------------------------
+#define MINIDUMP_HEADER_LENGTH			256
+
+//-----------------------------------------------------------------------------
+// Purpose: Maximum number of regions added to or excluded from filtered dumps.
+//-----------------------------------------------------------------------------
+#define MINIDUMP_MAX_REGIONS			64
+
+//-----------------------------------------------------------------------------
+// 
+// Minidump C interface
+// 
+//-----------------------------------------------------------------------------
+
+extern bool Minidump_Init();
+extern void* Minidump_ArenaAlloc(uint32 cubSize);
+extern void Minidump_UpdateHeader();
+extern void Minidump_AddComment(const char *pszComment);
+extern void Minidump_FlushComments();
+extern bool Minidump_IsFiltering();
+extern void Minidump_SetExceptionInfo(void *pvExceptionInfo);
+extern void Minidump_HookExceptionFilter();
+extern bool Minidump_StartHelper();
+extern bool Minidump_HandOffToHelper();
+extern void Minidump_ExitCrashed(void *pvContext);
+extern void Minidump_PreMinidumpCallback(void *pvContext);
+
+//-----------------------------------------------------------------------------
+// 
+// Minidump region interface
+// 
+//-----------------------------------------------------------------------------
+
+S_API void SteamAPI_AddMinidumpRegion(const void *pvBase, uint32 cubSize);
+S_API void SteamAPI_ExcludeMinidumpRegion(const void *pvBase, uint32 cubSize);
+S_API void SteamAPI_RemoveMinidumpRegion(const void *pvBase);
+
+#endif
@@ -0,0 +1,68 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: Memory shared between the game and the out-of-process minidump 
+//			writer. Included by both sides, so only Windows types are used.
+//
+// $NoKeywords: $
+//=============================================================================
+#ifndef MINIDUMP_HELPER_H
+#define MINIDUMP_HELPER_H
+#pragma once
+
+#define MINIDUMPHELPER_VERSION			2
+
+//-----------------------------------------------------------------------------
+// Purpose: Object names, formatted with the game process id.
+//-----------------------------------------------------------------------------
+#define MINIDUMPHELPER_MAPPING_NAME		"Local\\SteamAPIMinidump_%u"
+#define MINIDUMPHELPER_CRASH_EVENT_NAME	"Local\\SteamAPIMinidumpCrash_%u"
+#define MINIDUMPHELPER_ACK_EVENT_NAME	"Local\\SteamAPIMinidumpAck_%u"
+
+//-----------------------------------------------------------------------------
+// Purpose: How long the game waits for the helper to take the snapshot.
+//-----------------------------------------------------------------------------
+#define MINIDUMPHELPER_ACK_TIMEOUT		5000
+
+#define MINIDUMPHELPER_COMMENT_SIZE		(16 * 1024)
+
+//-----------------------------------------------------------------------------
+// Purpose: Regions the game added to or excluded from its dumps, the helper 
+//			applies them the same way as the game's own filtered dump.
+//-----------------------------------------------------------------------------
+#define MINIDUMPHELPER_MAX_REGIONS		64
+
+struct MinidumpHelperRegion_t
+{
+	ULONG64			m_ullBase;
+	DWORD			m_cubSize;
+	DWORD			m_bExclude;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Shared region. Descriptive fields are kept up to date by the game
+//			while running, the crash fields are filled right before signaling.
+//-----------------------------------------------------------------------------
+struct MinidumpHelperShared_t
+{
+	DWORD			m_unVersion;
+	DWORD			m_dwProcessId;
+
+	// Describes the process
+	DWORD			m_unAppId;
+	DWORD			m_bFullMemory;
+	ULONG64			m_ullSteamID;
+	char			m_szVersion[64];
+	char			m_szTimestamp[16];
+	char			m_szDumpDir[MAX_PATH];
+
+	// Crash, pointers are in the address space of the game
+	DWORD			m_dwCrashThreadId;
+	DWORD			m_dwExceptionCode;
+	ULONG64			m_ullExceptionPointers;
+	char			m_szComment[MINIDUMPHELPER_COMMENT_SIZE];
+
+	DWORD					m_nRegions;
+	MinidumpHelperRegion_t	m_Regions[MINIDUMPHELPER_MAX_REGIONS];
+};
+
+#endif
@@ -0,0 +1,244 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: Out-of-process minidump writer. Started by the game with its 
+//			process id on the command line. Waits for the crash signal, 
+//			snapshots the game, lets it carry on with breakpad and writes the
+//			dump from the snapshot.
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include <windows.h>
+#include <dbghelp.h>
+#include <processsnapshot.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../minidumphelper.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: Walk state of the callback over the game's regions.
+//-----------------------------------------------------------------------------
+struct MinidumpHelperState_t
+{
+	const MinidumpHelperShared_t*	m_pShared;
+	DWORD							m_iInclude;
+	DWORD							m_iExclude;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Finds next region of the kind starting at index, returns false
+//			when there's none left.
+//-----------------------------------------------------------------------------
+static bool MinidumpHelper_NextRegion(const MinidumpHelperShared_t *pShared, DWORD *piRegion, bool bExclude, PMINIDUMP_CALLBACK_OUTPUT pOutput)
+{
+	DWORD nRegions = min(pShared->m_nRegions, (DWORD)MINIDUMPHELPER_MAX_REGIONS);
+
+	for (; *piRegion < nRegions; (*piRegion)++)
+	{
+		const MinidumpHelperRegion_t* pRegion = &pShared->m_Regions[*piRegion];
+
+		if ((pRegion->m_bExclude != 0) != bExclude)
+			continue;
+
+		pOutput->MemoryBase = pRegion->m_ullBase;
+		pOutput->MemorySize = pRegion->m_cubSize;
+
+		(*piRegion)++;
+		return true;
+	}
+
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Lets dbghelp know that it's reading a snapshot, not a process, and
+//			applies the game's regions unless the whole memory is dumped.
+//-----------------------------------------------------------------------------
+static BOOL CALLBACK MinidumpHelper_Callback(PVOID pvParam, const PMINIDUMP_CALLBACK_INPUT pInput, PMINIDUMP_CALLBACK_OUTPUT pOutput)
+{
+	MinidumpHelperState_t* pState = reinterpret_cast<MinidumpHelperState_t*>(pvParam);
+
+	switch (pInput->CallbackType)
+	{
+		case IsProcessSnapshotCallback:
+			pOutput->Status = S_FALSE;
+			return TRUE;
+
+		case MemoryCallback:
+			return MinidumpHelper_NextRegion(pState->m_pShared, &pState->m_iInclude, false, pOutput) ? TRUE : FALSE;
+
+		case RemoveMemoryCallback:
+			return MinidumpHelper_NextRegion(pState->m_pShared, &pState->m_iExclude, true, pOutput) ? TRUE : FALSE;
+
+		case CancelCallback:
+			pOutput->Cancel = FALSE;
+			pOutput->CheckCancel = FALSE;
+			return TRUE;
+	}
+
+	return TRUE;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Writes the dump from the snapshot. Description of the process goes
+//			first into the comment stream, then the game's own comment.
+//-----------------------------------------------------------------------------
+static bool MinidumpHelper_WriteDump(HANDLE hSnapshot, MinidumpHelperShared_t *pShared)
+{
+	MINIDUMP_EXCEPTION_INFORMATION		ExceptionInfo;
+	MINIDUMP_USER_STREAM				CommentStream;
+	MINIDUMP_USER_STREAM_INFORMATION	UserStreams;
+	MINIDUMP_CALLBACK_INFORMATION		CallbackInfo;
+	MinidumpHelperState_t				State;
+	MINIDUMP_TYPE						DumpType;
+	SYSTEMTIME							Time;
+	static char							s_szComment[MINIDUMPHELPER_COMMENT_SIZE + 256];
+	char								szPath[MAX_PATH];
+	HANDLE								hFile;
+	BOOL								bSuccess;
+
+	GetLocalTime(&Time);
+
+	CreateDirectoryA(pShared->m_szDumpDir, NULL);
+
+	_snprintf(szPath, sizeof(szPath), "%s\\steam_api_%u_%04u%02u%02u%02u%02u%02u_%u.dmp", 
+			  pShared->m_szDumpDir, pShared->m_unAppId, 
+			  Time.wYear, Time.wMonth, Time.wDay, Time.wHour, Time.wMinute, Time.wSecond,
+			  pShared->m_dwProcessId);
+	szPath[sizeof(szPath) - 1] = '\0';
+
+	hFile = CreateFileA(szPath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	_snprintf(s_szComment, sizeof(s_szComment), "appid %u version %s built %s steamid %llu exception %08x\n%s", 
+			  pShared->m_unAppId, pShared->m_szVersion, pShared->m_szTimestamp, pShared->m_ullSteamID, 
+			  pShared->m_dwExceptionCode, pShared->m_szComment);
+	s_szComment[sizeof(s_szComment) - 1] = '\0';
+
+	CommentStream.Type = CommentStreamA;
+	CommentStream.Buffer = s_szComment;
+	CommentStream.BufferSize = (ULONG)strlen(s_szComment) + 1;
+
+	UserStreams.UserStreamCount = 1;
+	UserStreams.UserStreamArray = &CommentStream;
+
+	ExceptionInfo.ThreadId = pShared->m_dwCrashThreadId;
+	ExceptionInfo.ExceptionPointers = reinterpret_cast<PEXCEPTION_POINTERS>(pShared->m_ullExceptionPointers);
+	ExceptionInfo.ClientPointers = TRUE;
+
+	// Full memory has nothing to add, regions are skipped
+	State.m_pShared = pShared;
+	State.m_iInclude = pShared->m_bFullMemory ? MINIDUMPHELPER_MAX_REGIONS : 0;
+	State.m_iExclude = State.m_iInclude;
+
+	CallbackInfo.CallbackRoutine = MinidumpHelper_Callback;
+	CallbackInfo.CallbackParam = &State;
+
+	if (pShared->m_bFullMemory)
+		DumpType = (MINIDUMP_TYPE)(MiniDumpWithFullMemory | MiniDumpWithHandleData | MiniDumpWithThreadInfo | MiniDumpWithUnloadedModules);
+	else
+		DumpType = (MINIDUMP_TYPE)(MiniDumpNormal | MiniDumpWithIndirectlyReferencedMemory | MiniDumpWithThreadInfo | MiniDumpWithUnloadedModules);
+
+	bSuccess = MiniDumpWriteDump(hSnapshot, pShared->m_dwProcessId, hFile, DumpType, 
+								 pShared->m_ullExceptionPointers ? &ExceptionInfo : NULL, 
+								 &UserStreams, 
+								 &CallbackInfo);
+
+	CloseHandle(hFile);
+
+	if (!bSuccess)
+	{
+		DeleteFileA(szPath);
+		return false;
+	}
+
+	printf("Wrote %s\n", szPath);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Entry point, minidumphelper <game process id>
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+	MinidumpHelperShared_t*	pShared;
+	HANDLE					hMapping, hCrashEvent, hAckEvent, hProcess, hSnapshot;
+	HANDLE					Handles[2];
+	DWORD					dwProcessId, dwResult;
+	char					szName[64];
+
+	if (argc < 2)
+	{
+		printf("Usage: minidumphelper <pid>\n");
+		return 1;
+	}
+
+	dwProcessId = strtoul(argv[1], nullptr, 0);
+
+	_snprintf(szName, sizeof(szName), MINIDUMPHELPER_MAPPING_NAME, dwProcessId);
+	hMapping = OpenFileMappingA(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, szName);
+
+	_snprintf(szName, sizeof(szName), MINIDUMPHELPER_CRASH_EVENT_NAME, dwProcessId);
+	hCrashEvent = OpenEventA(SYNCHRONIZE, FALSE, szName);
+
+	_snprintf(szName, sizeof(szName), MINIDUMPHELPER_ACK_EVENT_NAME, dwProcessId);
+	hAckEvent = OpenEventA(EVENT_MODIFY_STATE, FALSE, szName);
+
+	hProcess = OpenProcess(PROCESS_ALL_ACCESS, FALSE, dwProcessId);
+
+	if (!hMapping || !hCrashEvent || !hAckEvent || !hProcess)
+	{
+		printf("Failed to attach to process %u (%u)\n", dwProcessId, GetLastError());
+		return 1;
+	}
+
+	pShared = reinterpret_cast<MinidumpHelperShared_t*>(MapViewOfFile(hMapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, sizeof(MinidumpHelperShared_t)));
+
+	if (!pShared || pShared->m_unVersion != MINIDUMPHELPER_VERSION)
+	{
+		printf("Incompatible shared memory\n");
+		return 1;
+	}
+
+	// Either the game crashes, or exits and we're done
+	Handles[0] = hCrashEvent;
+	Handles[1] = hProcess;
+
+	dwResult = WaitForMultipleObjects(2, Handles, FALSE, INFINITE);
+
+	if (dwResult != WAIT_OBJECT_0)
+		return 0;
+
+	// Clone the address space, the game is free to die after that
+	dwResult = PssCaptureSnapshot(hProcess, 
+								  PSS_CAPTURE_VA_CLONE | PSS_CAPTURE_HANDLES | PSS_CAPTURE_HANDLE_NAME_INFORMATION |
+								  PSS_CAPTURE_HANDLE_BASIC_INFORMATION | PSS_CAPTURE_HANDLE_TYPE_SPECIFIC_INFORMATION |
+								  PSS_CAPTURE_HANDLE_TRACE | PSS_CAPTURE_THREADS | PSS_CAPTURE_THREAD_CONTEXT |
+								  PSS_CAPTURE_THREAD_CONTEXT_EXTENDED | PSS_CREATE_BREAKAWAY | PSS_CREATE_BREAKAWAY_OPTIONAL |
+								  PSS_CREATE_USE_VM_ALLOCATIONS | PSS_CREATE_RELEASE_SECTION, 
+								  CONTEXT_ALL, 
+								  reinterpret_cast<HPSS*>(&hSnapshot));
+
+	// No ack, the game times out and writes its own dump
+	if (dwResult != ERROR_SUCCESS)
+	{
+		printf("Failed to snapshot process %u (%u)\n", dwProcessId, dwResult);
+		return 1;
+	}
+
+	SetEvent(hAckEvent);
+
+	MinidumpHelper_WriteDump(hSnapshot, pShared);
+
+	PssFreeSnapshot(GetCurrentProcess(), reinterpret_cast<HPSS>(hSnapshot));
+
+	UnmapViewOfFile(pShared);
+	CloseHandle(hMapping);
+	CloseHandle(hCrashEvent);
+	CloseHandle(hAckEvent);
+	CloseHandle(hProcess);
+
+	return 0;
+}
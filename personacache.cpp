@@ -0,0 +1,586 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "steam_api_pch.h"
+#include "personacache.h"
+#include "memfootprint.h"
+#include "interfacecache.h"
+#include "apiconfig.h"
+#include "asynclog.h"
+
+//-----------------------------------------------------------------------------
+// 
+// Persona cache
+// 
+//	Scoreboards and friend lists ask for the same names every frame, each
+//	one an IPC round trip to steamclient. The cache keeps them in process:
+//	entries live in an open addressed table keyed by SteamID, names are
+//	packed into a string arena. Only the thread running callbacks writes,
+//	readers on any thread copy entries out under a sequence counter and
+//	retry if it moved.
+// 
+//-----------------------------------------------------------------------------
+
+// Table size has to be a power of two, it's never filled over 3/4
+#define PERSONACACHE_SIZE_SHIFT		12
+#define PERSONACACHE_SIZE			(1 << PERSONACACHE_SIZE_SHIFT)
+#define PERSONACACHE_MAX_ENTRIES	(PERSONACACHE_SIZE / 4 * 3)
+
+// Each of the two arenas, names that were replaced stay in the active one
+// until it fills up and live names are copied to the other. Pages are only
+// backed once names reach them.
+#define PERSONACACHE_ARENA_SIZE		(PERSONACACHE_MAX_ENTRIES * PERSONACACHE_NAME_MAX)
+
+// Changes that require re-reading the field from steamclient
+#define PERSONACACHE_CHANGE_NAME	(k_EPersonaChangeName | k_EPersonaChangeNameFirstSet)
+#define PERSONACACHE_CHANGE_STATE	(k_EPersonaChangeStatus | k_EPersonaChangeComeOnline | k_EPersonaChangeGoneOffline)
+#define PERSONACACHE_CHANGE_GAME	(k_EPersonaChangeGamePlayed | k_EPersonaChangeComeOnline | k_EPersonaChangeGoneOffline)
+#define PERSONACACHE_CHANGE_ALL		(PERSONACACHE_CHANGE_NAME | PERSONACACHE_CHANGE_STATE | PERSONACACHE_CHANGE_GAME | k_EPersonaChangeRelationshipChanged)
+
+//-----------------------------------------------------------------------------
+// Purpose: Persona cache class
+//-----------------------------------------------------------------------------
+class CPersonaCache
+{
+private:
+	struct PersonaEntry_t
+	{
+		// Odd while the entry is being written
+		volatile LONG		m_nSequence;
+		uint32				m_unNameOffset;
+		volatile uint64		m_ulSteamID;
+		uint16				m_cubName;
+		uint8				m_ePersonaState;
+		uint8				m_eRelationship;
+		AppId_t				m_nGameAppId;
+	};
+
+public:
+	CPersonaCache();
+
+public:
+	void Fill(ISteamFriends *pSteamFriends, ISteamUser *pSteamUser);
+	void Update(ISteamFriends *pSteamFriends, uint64 ulSteamID, int nChangeFlags);
+	void Clear();
+	bool Lookup(uint64 ulSteamID, SteamAPICachedPersona_t *pPersona, char *pchName, int cchName);
+	void GetMemoryUsage(SteamAPIMemoryUsage_t *pUsage);
+
+private:
+	static uint32 HashSteamID(uint64 ulSteamID);
+	PersonaEntry_t* Find(uint64 ulSteamID);
+	PersonaEntry_t* FindOrInsert(uint64 ulSteamID, bool *pbInserted);
+	bool StoreName(PersonaEntry_t *pEntry, const char *pszName);
+	void CompactArena();
+
+public:
+	PersonaEntry_t			m_Entries[PERSONACACHE_SIZE];
+
+	// Names, only m_pchArena is read from
+	char*					m_pchArenas[2];
+	char* volatile			m_pchArena;
+	uint32					m_cubArenaUsed;
+
+	// Odd while names are being moved to the other arena
+	volatile LONG			m_nArenaSequence;
+
+	// Serializes writers, pumps on several threads may deliver changes
+	SRWLOCK					m_WriteLock;
+
+	uint32					m_nEntries;
+	volatile LONG			m_nHits;
+	volatile LONG			m_nMisses;
+	uint32					m_nUpdates;
+	uint32					m_nArenaCompactions;
+	bool					m_bFullReported;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Constructor
+//-----------------------------------------------------------------------------
+CPersonaCache::CPersonaCache() :
+	m_pchArena(nullptr),
+	m_cubArenaUsed(0),
+	m_nArenaSequence(0),
+	m_nEntries(0),
+	m_nHits(0),
+	m_nMisses(0),
+	m_nUpdates(0),
+	m_nArenaCompactions(0),
+	m_bFullReported(false)
+{
+	memset(m_Entries, 0, sizeof(m_Entries));
+	InitializeSRWLock(&m_WriteLock);
+
+	// Readers may still be copying out of an arena while it's reused, so
+	// these are never freed until the process exits
+	m_pchArenas[0] = (char*)VirtualAlloc(NULL, PERSONACACHE_ARENA_SIZE * 2, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	m_pchArenas[1] = m_pchArenas[0] ? m_pchArenas[0] + PERSONACACHE_ARENA_SIZE : nullptr;
+	m_pchArena = m_pchArenas[0];
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Fibonacci hash of the SteamID, account ids are sequential
+//-----------------------------------------------------------------------------
+uint32 CPersonaCache::HashSteamID(uint64 ulSteamID)
+{
+	return (uint32)((ulSteamID * 0x9E3779B97F4A7C15ull) >> (64 - PERSONACACHE_SIZE_SHIFT));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Entries are never removed, so a probe stops on the first empty
+//			slot. The SteamID is published last, after the entry is filled.
+//-----------------------------------------------------------------------------
+CPersonaCache::PersonaEntry_t* CPersonaCache::Find(uint64 ulSteamID)
+{
+	PersonaEntry_t	*pEntry;
+	uint64			ulEntrySteamID;
+	uint32			i, unIndex;
+
+	unIndex = HashSteamID(ulSteamID);
+
+	for (i = 0; i < PERSONACACHE_SIZE; i++)
+	{
+		pEntry = &m_Entries[(unIndex + i) & (PERSONACACHE_SIZE - 1)];
+		ulEntrySteamID = pEntry->m_ulSteamID;
+
+		if (ulEntrySteamID == ulSteamID)
+			return pEntry;
+
+		if (!ulEntrySteamID)
+			break;
+	}
+
+	return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns entry of the user, a new one is claimed if there is room.
+//			Called with the write lock held.
+//-----------------------------------------------------------------------------
+CPersonaCache::PersonaEntry_t* CPersonaCache::FindOrInsert(uint64 ulSteamID, bool *pbInserted)
+{
+	PersonaEntry_t	*pEntry;
+	uint32			i, unIndex;
+
+	*pbInserted = false;
+	unIndex = HashSteamID(ulSteamID);
+
+	for (i = 0; i < PERSONACACHE_SIZE; i++)
+	{
+		pEntry = &m_Entries[(unIndex + i) & (PERSONACACHE_SIZE - 1)];
+
+		if (pEntry->m_ulSteamID == ulSteamID)
+			return pEntry;
+
+		if (!pEntry->m_ulSteamID)
+			break;
+	}
+
+	if (i == PERSONACACHE_SIZE || m_nEntries >= PERSONACACHE_MAX_ENTRIES)
+	{
+		if (!m_bFullReported)
+			AsyncLog(k_ESteamAPILogWarning, "[S_API] Persona cache is full (%u users), new users are looked up through steamclient.\n", m_nEntries);
+
+		m_bFullReported = true;
+		return nullptr;
+	}
+
+	// Slot may hold fields of a user from the previous session, reset them
+	// before the entry is visible
+	pEntry->m_unNameOffset = 0;
+	pEntry->m_cubName = 0;
+	pEntry->m_ePersonaState = k_EPersonaStateOffline;
+	pEntry->m_eRelationship = k_EFriendRelationshipNone;
+	pEntry->m_nGameAppId = 0;
+	MemoryBarrier();
+	pEntry->m_ulSteamID = ulSteamID;
+
+	m_nEntries++;
+	*pbInserted = true;
+
+	return pEntry;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Copies live names to the other arena, replaced ones are dropped.
+//			Readers that started before the switch see the arena sequence
+//			move and retry. Called with the write lock held.
+//-----------------------------------------------------------------------------
+void CPersonaCache::CompactArena()
+{
+	PersonaEntry_t	*pEntry;
+	char			*pchSource, *pchTarget;
+	uint32			cubUsed;
+	uint32			i;
+
+	pchSource = m_pchArena;
+	pchTarget = (pchSource == m_pchArenas[0]) ? m_pchArenas[1] : m_pchArenas[0];
+	cubUsed = 0;
+
+	InterlockedIncrement(&m_nArenaSequence);
+
+	for (i = 0; i < PERSONACACHE_SIZE; i++)
+	{
+		pEntry = &m_Entries[i];
+
+		if (!pEntry->m_ulSteamID || !pEntry->m_cubName)
+			continue;
+
+		memcpy(pchTarget + cubUsed, pchSource + pEntry->m_unNameOffset, pEntry->m_cubName);
+		pEntry->m_unNameOffset = cubUsed;
+
+		cubUsed += pEntry->m_cubName;
+	}
+
+	m_pchArena = pchTarget;
+	m_cubArenaUsed = cubUsed;
+	m_nArenaCompactions++;
+
+	InterlockedIncrement(&m_nArenaSequence);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Points the entry to the name, unchanged names aren't copied
+//			again. Called with the write lock held and entry sequence odd.
+//-----------------------------------------------------------------------------
+bool CPersonaCache::StoreName(PersonaEntry_t *pEntry, const char *pszName)
+{
+	uint32 cubName;
+
+	cubName = (uint32)strlen(pszName);
+
+	if (cubName >= PERSONACACHE_NAME_MAX)
+		cubName = PERSONACACHE_NAME_MAX - 1;
+
+	if (cubName == pEntry->m_cubName && !memcmp(m_pchArena + pEntry->m_unNameOffset, pszName, cubName))
+		return false;
+
+	if (m_cubArenaUsed + cubName > PERSONACACHE_ARENA_SIZE)
+		CompactArena();
+
+	// Every name fits once replaced ones are dropped, the arena is sized
+	// for the longest name of every user the table can hold
+	memcpy(m_pchArena + m_cubArenaUsed, pszName, cubName);
+
+	pEntry->m_unNameOffset = m_cubArenaUsed;
+	pEntry->m_cubName = (uint16)cubName;
+
+	m_cubArenaUsed += cubName;
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Re-reads fields named by the change flags from steamclient.
+//-----------------------------------------------------------------------------
+void CPersonaCache::Update(ISteamFriends *pSteamFriends, uint64 ulSteamID, int nChangeFlags)
+{
+	PersonaEntry_t		*pEntry;
+	FriendGameInfo_t	GameInfo;
+	CSteamID			SteamID(ulSteamID);
+	bool				bInserted;
+
+	if (!pSteamFriends || !m_pchArena || !ulSteamID)
+		return;
+
+	AcquireSRWLockExclusive(&m_WriteLock);
+
+	pEntry = FindOrInsert(ulSteamID, &bInserted);
+
+	if (!pEntry)
+	{
+		ReleaseSRWLockExclusive(&m_WriteLock);
+		return;
+	}
+
+	// A user seen for the first time is read whole
+	if (bInserted)
+		nChangeFlags |= PERSONACACHE_CHANGE_ALL;
+
+	InterlockedIncrement(&pEntry->m_nSequence);
+
+	if (nChangeFlags & PERSONACACHE_CHANGE_NAME)
+		StoreName(pEntry, pSteamFriends->GetFriendPersonaName(SteamID));
+
+	if (nChangeFlags & PERSONACACHE_CHANGE_STATE)
+		pEntry->m_ePersonaState = (uint8)pSteamFriends->GetFriendPersonaState(SteamID);
+
+	if (nChangeFlags & k_EPersonaChangeRelationshipChanged)
+		pEntry->m_eRelationship = (uint8)pSteamFriends->GetFriendRelationship(SteamID);
+
+	if (nChangeFlags & PERSONACACHE_CHANGE_GAME)
+	{
+		if (pSteamFriends->GetFriendGamePlayed(SteamID, &GameInfo))
+			pEntry->m_nGameAppId = GameInfo.m_gameID.AppID();
+		else
+			pEntry->m_nGameAppId = 0;
+	}
+
+	InterlockedIncrement(&pEntry->m_nSequence);
+
+	m_nUpdates++;
+
+	ReleaseSRWLockExclusive(&m_WriteLock);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Reads the friend list and the local user. The only time the
+//			cache goes to steamclient for users nobody asked about.
+//-----------------------------------------------------------------------------
+void CPersonaCache::Fill(ISteamFriends *pSteamFriends, ISteamUser *pSteamUser)
+{
+	int		nFriends;
+	int		i;
+
+	if (!pSteamFriends)
+		return;
+
+	if (pSteamUser)
+		Update(pSteamFriends, pSteamUser->GetSteamID().ConvertToUint64(), PERSONACACHE_CHANGE_ALL);
+
+	nFriends = pSteamFriends->GetFriendCount(k_EFriendFlagImmediate);
+
+	for (i = 0; i < nFriends; i++)
+		Update(pSteamFriends, pSteamFriends->GetFriendByIndex(i, k_EFriendFlagImmediate).ConvertToUint64(), PERSONACACHE_CHANGE_ALL);
+
+	AsyncLog(k_ESteamAPILogDebug, "[S_API] Persona cache filled with %u users, %u bytes of names.\n", m_nEntries, m_cubArenaUsed);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Forgets every user. Readers racing with this may get stale data
+//			for the last time, but never a torn entry.
+//-----------------------------------------------------------------------------
+void CPersonaCache::Clear()
+{
+	uint32 i;
+
+	AcquireSRWLockExclusive(&m_WriteLock);
+
+	InterlockedIncrement(&m_nArenaSequence);
+
+	for (i = 0; i < PERSONACACHE_SIZE; i++)
+	{
+		m_Entries[i].m_ulSteamID = 0;
+		m_Entries[i].m_cubName = 0;
+	}
+
+	m_nEntries = 0;
+	m_cubArenaUsed = 0;
+	m_bFullReported = false;
+
+	InterlockedIncrement(&m_nArenaSequence);
+
+	ReleaseSRWLockExclusive(&m_WriteLock);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Copies the entry out without taking any lock. Fails if the user
+//			isn't cached.
+//-----------------------------------------------------------------------------
+bool CPersonaCache::Lookup(uint64 ulSteamID, SteamAPICachedPersona_t *pPersona, char *pchName, int cchName)
+{
+	PersonaEntry_t	*pEntry;
+	LONG			nArenaSequence, nSequence;
+	uint32			cubName;
+
+	if (!m_pchArena || !ulSteamID)
+		return false;
+
+	for (;;)
+	{
+		nArenaSequence = m_nArenaSequence;
+		MemoryBarrier();
+
+		if (nArenaSequence & 1)
+		{
+			YieldProcessor();
+			continue;
+		}
+
+		pEntry = Find(ulSteamID);
+
+		if (!pEntry)
+			break;
+
+		nSequence = pEntry->m_nSequence;
+		MemoryBarrier();
+
+		if (nSequence & 1)
+		{
+			YieldProcessor();
+			continue;
+		}
+
+		cubName = pEntry->m_cubName;
+
+		if (pPersona)
+		{
+			pPersona->m_ulSteamID = ulSteamID;
+			pPersona->m_nGameAppId = pEntry->m_nGameAppId;
+			pPersona->m_ePersonaState = pEntry->m_ePersonaState;
+			pPersona->m_eRelationship = pEntry->m_eRelationship;
+
+			memcpy(pPersona->m_szName, m_pchArena + pEntry->m_unNameOffset, cubName);
+			pPersona->m_szName[cubName] = '\0';
+		}
+
+		if (pchName && cchName > 0)
+		{
+			if (cubName >= (uint32)cchName)
+				cubName = cchName - 1;
+
+			memcpy(pchName, m_pchArena + pEntry->m_unNameOffset, cubName);
+			pchName[cubName] = '\0';
+		}
+
+		MemoryBarrier();
+
+		// Entry or arena was written to while copying, try again
+		if (pEntry->m_nSequence != nSequence || m_nArenaSequence != nArenaSequence || pEntry->m_ulSteamID != ulSteamID)
+			continue;
+
+		InterlockedIncrement(&m_nHits);
+		return true;
+	}
+
+	InterlockedIncrement(&m_nMisses);
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Table and arenas are allocated once, used counts live names.
+//-----------------------------------------------------------------------------
+void CPersonaCache::GetMemoryUsage(SteamAPIMemoryUsage_t *pUsage)
+{
+	pUsage->m_nEntries = m_nEntries;
+	pUsage->m_cubUsed = m_nEntries * sizeof(PersonaEntry_t) + m_cubArenaUsed;
+	pUsage->m_cubReserved = sizeof(m_Entries) + (m_pchArenas[0] ? PERSONACACHE_ARENA_SIZE * 2 : 0);
+}
+
+//-----------------------------------------------------------------------------
+// 
+// Persona cache C interface
+// 
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Purpose: Singleton access
+//-----------------------------------------------------------------------------
+static CPersonaCache *GPersonaCache()
+{
+	static CPersonaCache PersonaCache;
+	return &PersonaCache;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Friends interface of the global user, from the interface cache so
+//			this works in safe mode too.
+//-----------------------------------------------------------------------------
+static ISteamFriends* PersonaCache_GetSteamFriends()
+{
+	return static_cast<ISteamFriends*>(InterfaceCache_FindOrCreate(g_pSteamClient, g_hSteamUser, g_hSteamPipe, STEAMFRIENDS_INTERFACE_VERSION));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Applies the change before handlers of the game see it, so they
+//			already read the new persona from the cache.
+//-----------------------------------------------------------------------------
+static void PersonaCache_OnPersonaStateChange(HSteamPipe hSteamPipe, int iCallback, void *pvParam, int cubParam)
+{
+	PersonaStateChange_t *pChange;
+
+	if (cubParam < (int)sizeof(PersonaStateChange_t))
+		return;
+
+	pChange = (PersonaStateChange_t*)pvParam;
+
+	GPersonaCache()->Update(PersonaCache_GetSteamFriends(), pChange->m_ulSteamID, pChange->m_nChangeFlags);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Called once the pipe and user are up, on init and on reconnect.
+//			Whatever changed while the pipe was gone is picked up by the fill.
+//-----------------------------------------------------------------------------
+void PersonaCache_Init()
+{
+	ISteamUser *pSteamUser;
+
+	if (!SteamAPIConfig()->m_bPersonaCache)
+		return;
+
+	CallbackMgr_AddObserver(PersonaStateChange_t::k_iCallback, PersonaCache_OnPersonaStateChange);
+
+	pSteamUser = static_cast<ISteamUser*>(InterfaceCache_FindOrCreate(g_pSteamClient, g_hSteamUser, g_hSteamPipe, STEAMUSER_INTERFACE_VERSION));
+
+	GPersonaCache()->Fill(PersonaCache_GetSteamFriends(), pSteamUser);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Users of one session don't carry over to the next.
+//-----------------------------------------------------------------------------
+void PersonaCache_Shutdown()
+{
+	CallbackMgr_RemoveObserver(PersonaStateChange_t::k_iCallback, PersonaCache_OnPersonaStateChange);
+
+	GPersonaCache()->Clear();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: For memory stats
+//-----------------------------------------------------------------------------
+void PersonaCache_GetMemoryUsage(SteamAPIMemoryUsage_t *pUsage)
+{
+	GPersonaCache()->GetMemoryUsage(pUsage);
+}
+
+//-----------------------------------------------------------------------------
+// 
+// Persona cache interface
+// 
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Purpose: Fills persona of the user, fails if it isn't cached.
+//-----------------------------------------------------------------------------
+bool SteamAPI_GetCachedPersona(uint64 ulSteamID, SteamAPICachedPersona_t *pPersona)
+{
+	if (!pPersona)
+		return false;
+
+	return GPersonaCache()->Lookup(ulSteamID, pPersona, nullptr, 0);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Copies the name of the user, truncated to the buffer. Fails if the
+//			user isn't cached.
+//-----------------------------------------------------------------------------
+bool SteamAPI_GetCachedPersonaName(uint64 ulSteamID, char *pchName, int cchName)
+{
+	if (!pchName || cchName <= 0)
+		return false;
+
+	return GPersonaCache()->Lookup(ulSteamID, nullptr, pchName, cchName);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Hits are lookups answered without IPC.
+//-----------------------------------------------------------------------------
+void SteamAPI_GetPersonaCacheStats(SteamAPIPersonaCacheStats_t *pStats)
+{
+	CPersonaCache *pCache;
+
+	if (!pStats)
+		return;
+
+	pCache = GPersonaCache();
+
+	pStats->m_nEntries = pCache->m_nEntries;
+	pStats->m_nHits = (uint32)pCache->m_nHits;
+	pStats->m_nMisses = (uint32)pCache->m_nMisses;
+	pStats->m_nUpdates = pCache->m_nUpdates;
+	pStats->m_nArenaCompactions = pCache->m_nArenaCompactions;
+}
@@ -0,0 +1,62 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+#ifndef PERSONA_CACHE_H
+#define PERSONA_CACHE_H
+#pragma once
+
+struct SteamAPIMemoryUsage_t;
+
+// Longest persona name kept, including the terminator
+#define PERSONACACHE_NAME_MAX		128
+
+//-----------------------------------------------------------------------------
+// Purpose: Persona of a user as last reported by steam, see
+//			SteamAPI_GetCachedPersona().
+//-----------------------------------------------------------------------------
+struct SteamAPICachedPersona_t
+{
+	uint64		m_ulSteamID;
+	AppId_t		m_nGameAppId;		// Game the user is playing, 0 if none
+	uint8		m_ePersonaState;	// EPersonaState
+	uint8		m_eRelationship;	// EFriendRelationship
+	char		m_szName[PERSONACACHE_NAME_MAX];
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Lookups served from the cache, lookups of unknown users and
+//			changes applied from PersonaStateChange_t.
+//-----------------------------------------------------------------------------
+struct SteamAPIPersonaCacheStats_t
+{
+	uint32		m_nEntries;
+	uint32		m_nHits;
+	uint32		m_nMisses;
+	uint32		m_nUpdates;
+	uint32		m_nArenaCompactions;
+};
+
+//-----------------------------------------------------------------------------
+// 
+// Persona cache C interface
+// 
+//-----------------------------------------------------------------------------
+
+extern void PersonaCache_Init();
+extern void PersonaCache_Shutdown();
+extern void PersonaCache_GetMemoryUsage(SteamAPIMemoryUsage_t *pUsage);
+
+//-----------------------------------------------------------------------------
+// Purpose: Persona cache API. The friend list and the local user are read
+//			once at init, afterwards entries are only touched by
+//			PersonaStateChange_t. Lookups never go to steamclient and may be
+//			done from any thread.
+//-----------------------------------------------------------------------------
+S_API bool SteamAPI_GetCachedPersona(uint64 ulSteamID, SteamAPICachedPersona_t *pPersona);
+S_API bool SteamAPI_GetCachedPersonaName(uint64 ulSteamID, char *pchName, int cchName);
+S_API void SteamAPI_GetPersonaCacheStats(SteamAPIPersonaCacheStats_t *pStats);
+
+#endif
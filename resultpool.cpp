@@ -0,0 +1,226 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "steam_api_pch.h"
+#include "resultpool.h"
+#include "memfootprint.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: Header in front of each buffer, keeps the payload 16 byte aligned.
+//			Free buffers are linked through the header.
+//-----------------------------------------------------------------------------
+struct ResultPoolBlock_t
+{
+	union
+	{
+		struct
+		{
+			ResultPoolBlock_t*	m_pNext;
+			uint32				m_iClass;
+			uint32				m_cubBuffer;
+		};
+
+		uint8					m_Align[16];
+	};
+};
+
+#define RESULTPOOL_CLASS_LARGE			0xFFFFFFFF
+
+//-----------------------------------------------------------------------------
+// Purpose: Buffers of one size class.
+//-----------------------------------------------------------------------------
+struct ResultPoolClass_t
+{
+	ResultPoolBlock_t*	m_pFree;
+	uint32				m_nFree;
+	uint32				m_nUsed;
+};
+
+static ResultPoolClass_t	s_Classes[RESULTPOOL_CLASSES];
+
+// Buffers over the largest class, these are never cached
+static uint32				s_nLargeUsed = 0;
+static uint32				s_cubLargeUsed = 0;
+
+// Client and game server pumps may run on different threads. Held only for
+// the list and the counters, never around the heap.
+static SRWLOCK				s_ResultPoolLock = SRWLOCK_INIT;
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns the smallest class the buffer fits in.
+//-----------------------------------------------------------------------------
+static inline uint32 ResultPool_Class(uint32 cubBuffer)
+{
+	unsigned long iBit;
+
+	if (cubBuffer <= (1u << RESULTPOOL_MIN_SHIFT))
+		return 0;
+
+	_BitScanReverse(&iBit, cubBuffer - 1);
+	return iBit + 1 - RESULTPOOL_MIN_SHIFT;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns buffer of at least cubBuffer bytes, nullptr on failure.
+//-----------------------------------------------------------------------------
+void* ResultPool_Alloc(int cubBuffer)
+{
+	ResultPoolBlock_t*	pBlock;
+	ResultPoolClass_t*	pClass;
+	uint32				iClass;
+
+	if (cubBuffer < 0)
+		return nullptr;
+
+	if (cubBuffer > RESULTPOOL_MAX_SIZE)
+	{
+		pBlock = reinterpret_cast<ResultPoolBlock_t*>(malloc(sizeof(ResultPoolBlock_t) + cubBuffer));
+
+		if (!pBlock)
+			return nullptr;
+
+		pBlock->m_iClass = RESULTPOOL_CLASS_LARGE;
+		pBlock->m_cubBuffer = cubBuffer;
+
+		AcquireSRWLockExclusive(&s_ResultPoolLock);
+		s_nLargeUsed++;
+		s_cubLargeUsed += cubBuffer;
+		ReleaseSRWLockExclusive(&s_ResultPoolLock);
+
+		return pBlock + 1;
+	}
+
+	iClass = ResultPool_Class(cubBuffer);
+	pClass = &s_Classes[iClass];
+
+	AcquireSRWLockExclusive(&s_ResultPoolLock);
+
+	pBlock = pClass->m_pFree;
+
+	if (pBlock)
+	{
+		pClass->m_pFree = pBlock->m_pNext;
+		pClass->m_nFree--;
+	}
+
+	ReleaseSRWLockExclusive(&s_ResultPoolLock);
+
+	if (!pBlock)
+	{
+		pBlock = reinterpret_cast<ResultPoolBlock_t*>(malloc(sizeof(ResultPoolBlock_t) + (1 << (RESULTPOOL_MIN_SHIFT + iClass))));
+
+		if (!pBlock)
+			return nullptr;
+
+		pBlock->m_iClass = iClass;
+	}
+
+	pBlock->m_cubBuffer = cubBuffer;
+
+	AcquireSRWLockExclusive(&s_ResultPoolLock);
+	pClass->m_nUsed++;
+	ReleaseSRWLockExclusive(&s_ResultPoolLock);
+
+	return pBlock + 1;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Puts the buffer back to its class for reuse.
+//-----------------------------------------------------------------------------
+void ResultPool_Free(void *pvBuffer)
+{
+	ResultPoolBlock_t*	pBlock;
+	ResultPoolClass_t*	pClass;
+
+	if (!pvBuffer)
+		return;
+
+	pBlock = reinterpret_cast<ResultPoolBlock_t*>(pvBuffer) - 1;
+
+	if (pBlock->m_iClass == RESULTPOOL_CLASS_LARGE)
+	{
+		AcquireSRWLockExclusive(&s_ResultPoolLock);
+		s_nLargeUsed--;
+		s_cubLargeUsed -= pBlock->m_cubBuffer;
+		ReleaseSRWLockExclusive(&s_ResultPoolLock);
+
+		free(pBlock);
+		return;
+	}
+
+	pClass = &s_Classes[pBlock->m_iClass];
+
+	AcquireSRWLockExclusive(&s_ResultPoolLock);
+
+	pClass->m_nUsed--;
+
+	pBlock->m_pNext = pClass->m_pFree;
+	pClass->m_pFree = pBlock;
+	pClass->m_nFree++;
+
+	ReleaseSRWLockExclusive(&s_ResultPoolLock);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Frees every cached buffer, buffers in use are left alone. Returns
+//			number of bytes released.
+//-----------------------------------------------------------------------------
+uint32 ResultPool_Compact()
+{
+	ResultPoolBlock_t*	pBlock;
+	ResultPoolBlock_t*	pFree;
+	uint32				cubReleased;
+
+	cubReleased = 0;
+
+	for (uint32 i = 0; i < RESULTPOOL_CLASSES; i++)
+	{
+		// Take the list, it's freed outside of the lock
+		AcquireSRWLockExclusive(&s_ResultPoolLock);
+
+		pFree = s_Classes[i].m_pFree;
+		s_Classes[i].m_pFree = nullptr;
+		s_Classes[i].m_nFree = 0;
+
+		ReleaseSRWLockExclusive(&s_ResultPoolLock);
+
+		while ((pBlock = pFree) != nullptr)
+		{
+			pFree = pBlock->m_pNext;
+			free(pBlock);
+
+			cubReleased += sizeof(ResultPoolBlock_t) + (1 << (RESULTPOOL_MIN_SHIFT + i));
+		}
+	}
+
+	return cubReleased;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Buffers in use and bytes held including the cached ones.
+//-----------------------------------------------------------------------------
+void ResultPool_GetUsage(SteamAPIMemoryUsage_t *pUsage)
+{
+	uint32 cubBlock;
+
+	AcquireSRWLockShared(&s_ResultPoolLock);
+
+	pUsage->m_nEntries = s_nLargeUsed;
+	pUsage->m_cubUsed = s_cubLargeUsed + s_nLargeUsed * sizeof(ResultPoolBlock_t);
+	pUsage->m_cubReserved = pUsage->m_cubUsed;
+
+	for (uint32 i = 0; i < RESULTPOOL_CLASSES; i++)
+	{
+		cubBlock = sizeof(ResultPoolBlock_t) + (1 << (RESULTPOOL_MIN_SHIFT + i));
+
+		pUsage->m_nEntries += s_Classes[i].m_nUsed;
+		pUsage->m_cubUsed += s_Classes[i].m_nUsed * cubBlock;
+		pUsage->m_cubReserved += (s_Classes[i].m_nUsed + s_Classes[i].m_nFree) * cubBlock;
+	}
+
+	ReleaseSRWLockShared(&s_ResultPoolLock);
+}
@@ -0,0 +1,36 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+#ifndef RESULT_POOL_H
+#define RESULT_POOL_H
+#pragma once
+
+struct SteamAPIMemoryUsage_t;
+
+//-----------------------------------------------------------------------------
+// Purpose: Size classes of the pool, powers of two from the smallest. Larger
+//			buffers go straight to the heap.
+//-----------------------------------------------------------------------------
+#define RESULTPOOL_MIN_SHIFT			6
+#define RESULTPOOL_CLASSES				11
+#define RESULTPOOL_MAX_SIZE				(1 << (RESULTPOOL_MIN_SHIFT + RESULTPOOL_CLASSES - 1))
+
+//-----------------------------------------------------------------------------
+// 
+// Result pool C interface
+// 
+//	Payload buffers of call results and deferred callbacks. Buffers freed
+//	are cached per size class for the next burst, until compaction. Safe to
+//	use from any thread, the client and game server pumps share it.
+// 
+//-----------------------------------------------------------------------------
+
+extern void* ResultPool_Alloc(int cubBuffer);
+extern void ResultPool_Free(void *pvBuffer);
+extern uint32 ResultPool_Compact();
+extern void ResultPool_GetUsage(SteamAPIMemoryUsage_t *pUsage);
+
+#endif
@@ -0,0 +1,703 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "steam_api_pch.h"
+#include <algorithm>
+#include <emmintrin.h>
+#include "screenshotpipeline.h"
+#include "interfacecache.h"
+#include "asynclog.h"
+
+//-----------------------------------------------------------------------------
+// 
+// Screenshot pipeline
+// 
+//	Every buffer starts with the job that describes it, so submitting is a
+//	push onto a lock-free list and setting an event. Rows shrink from 4 to 3
+//	bytes per pixel and the output of a row never reaches the input of the
+//	next one, so pixels are converted in the buffer they came in.
+// 
+//	WriteScreenshot() takes RGB top-down. Files for AddScreenshotToLibrary()
+//	are TGA, which stores BGR either way up, so those keep their order.
+// 
+//-----------------------------------------------------------------------------
+
+// Tells buffers of the pipeline from anything else
+#define SCREENSHOT_JOB_MAGIC		0x53484F54
+
+// Job in front of the pixels, pixels stay 64 byte aligned
+#define SCREENSHOT_HEADER_SIZE		((sizeof(ScreenshotJob_t) + 63) & ~63)
+
+// TGA stores sizes in 16 bits
+#define SCREENSHOT_MAX_SIZE			0xFFFF
+
+//-----------------------------------------------------------------------------
+// Purpose: Submitted frame, lives in front of its pixels
+//-----------------------------------------------------------------------------
+struct ScreenshotJob_t
+{
+	SLIST_ENTRY		m_ListEntry;		// Buffers are page aligned, as lists want
+	uint32			m_unMagic;
+	uint32			m_cubPixels;
+	uint32			m_nRequest;
+	int				m_nWidth;
+	int				m_nHeight;
+	int				m_nPitch;
+	bool			m_bBottomUp;
+	bool			m_bThumbnail;
+	bool			m_bLibrary;
+	bool			m_bConverted;
+	uint32			m_unConvertTime;
+	char			m_szFilename[MAX_PATH];
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Finished job, waiting for the pump
+//-----------------------------------------------------------------------------
+struct ScreenshotDone_t
+{
+	SLIST_ENTRY					m_ListEntry;
+	SteamAPIScreenshotDone_t	m_Done;
+};
+
+static SLIST_HEADER					s_PendingScreenshots;
+static SLIST_HEADER					s_DoneScreenshots;
+
+static HANDLE						s_hScreenshotWakeEvent = NULL;
+static HANDLE						s_hScreenshotStopEvent = NULL;
+static HANDLE						s_hScreenshotThread = NULL;
+
+// Worker is started on the first submit
+static volatile LONG				s_nScreenshotWorkerStarted = 0;
+static volatile LONG				s_nScreenshotRequests = 0;
+
+// Worker holds it shared while handing over, a reconnect exclusive
+static SRWLOCK						s_ScreenshotLock = SRWLOCK_INIT;
+static ISteamScreenshots*			s_pSteamScreenshots = nullptr;
+
+static SteamAPIScreenshotStats_t	s_ScreenshotStats;
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns job of the buffer, nullptr if it isn't one of ours
+//-----------------------------------------------------------------------------
+static ScreenshotJob_t* Screenshot_GetJob(void *pubPixels)
+{
+	ScreenshotJob_t *pJob;
+
+	if (!pubPixels)
+		return nullptr;
+
+	pJob = (ScreenshotJob_t*)((uint8*)pubPixels - SCREENSHOT_HEADER_SIZE);
+
+	return (pJob->m_unMagic == SCREENSHOT_JOB_MAGIC) ? pJob : nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Frees the job along with its pixels
+//-----------------------------------------------------------------------------
+static void Screenshot_FreeJob(ScreenshotJob_t *pJob)
+{
+	pJob->m_unMagic = 0;
+	VirtualFree(pJob, 0, MEM_RELEASE);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Packs a row of 32-bit pixels to 24-bit, optionally swapping red
+//			and blue. Four pixels are swizzled at once, each is stored as
+//			4 bytes of which the last is overwritten by the next pixel.
+//			Destination may be the source, or anywhere before it.
+//-----------------------------------------------------------------------------
+static void Screenshot_ConvertRow(const uint8 *pubSrc, uint8 *pubDest, int nPixels, bool bSwapRB)
+{
+	__m128i	vPixels, vRedBlue;
+	__m128i	vMaskGreenAlpha, vMaskRedBlue;
+	uint8	ubBlue, ubGreen, ubRed;
+	int		i;
+
+	vMaskGreenAlpha = _mm_set1_epi32(0xFF00FF00);
+	vMaskRedBlue = _mm_set1_epi32(0x00FF00FF);
+
+	for (i = 0; i + 4 <= nPixels; i += 4)
+	{
+		vPixels = _mm_loadu_si128((const __m128i*)(pubSrc + i * 4));
+
+		if (bSwapRB)
+		{
+			vRedBlue = _mm_and_si128(vPixels, vMaskRedBlue);
+			vPixels = _mm_and_si128(vPixels, vMaskGreenAlpha);
+			vPixels = _mm_or_si128(vPixels, _mm_or_si128(_mm_srli_epi32(vRedBlue, 16), _mm_slli_epi32(vRedBlue, 16)));
+		}
+
+		// Byte after the last pixel belongs to the next group, or to input
+		// that was already read
+		*(uint32*)(pubDest + i * 3) = (uint32)_mm_cvtsi128_si32(vPixels);
+		*(uint32*)(pubDest + i * 3 + 3) = (uint32)_mm_cvtsi128_si32(_mm_srli_si128(vPixels, 4));
+		*(uint32*)(pubDest + i * 3 + 6) = (uint32)_mm_cvtsi128_si32(_mm_srli_si128(vPixels, 8));
+		*(uint32*)(pubDest + i * 3 + 9) = (uint32)_mm_cvtsi128_si32(_mm_srli_si128(vPixels, 12));
+	}
+
+	for (; i < nPixels; i++)
+	{
+		// Read the pixel first, the first one may be written over itself
+		ubBlue = pubSrc[i * 4 + 0];
+		ubGreen = pubSrc[i * 4 + 1];
+		ubRed = pubSrc[i * 4 + 2];
+
+		pubDest[i * 3 + 0] = bSwapRB ? ubRed : ubBlue;
+		pubDest[i * 3 + 1] = ubGreen;
+		pubDest[i * 3 + 2] = bSwapRB ? ubBlue : ubRed;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Converts the frame in place, rows end up packed
+//-----------------------------------------------------------------------------
+static void Screenshot_Convert(ScreenshotJob_t *pJob, uint8 *pubPixels)
+{
+	std::vector<uint8>	Row;
+	size_t				cubRow;
+	int					y;
+
+	cubRow = (size_t)pJob->m_nWidth * 3;
+
+	for (y = 0; y < pJob->m_nHeight; y++)
+		Screenshot_ConvertRow(pubPixels + (size_t)y * pJob->m_nPitch, pubPixels + y * cubRow, pJob->m_nWidth, !pJob->m_bLibrary);
+
+	if (pJob->m_bLibrary || !pJob->m_bBottomUp)
+		return;
+
+	Row.resize(cubRow);
+
+	for (y = 0; y < pJob->m_nHeight / 2; y++)
+	{
+		memcpy(Row.data(), pubPixels + y * cubRow, cubRow);
+		memcpy(pubPixels + y * cubRow, pubPixels + (pJob->m_nHeight - 1 - y) * cubRow, cubRow);
+		memcpy(pubPixels + (pJob->m_nHeight - 1 - y) * cubRow, Row.data(), cubRow);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Box filters packed 24-bit pixels down to the thumbnail size
+//-----------------------------------------------------------------------------
+static void Screenshot_Downscale(const uint8 *pubSrc, int nWidth, int nHeight, uint8 *pubDest, int nThumbWidth, int nThumbHeight)
+{
+	const uint8	*pubPixel;
+	uint32		unSum[3];
+	uint32		nPixels;
+	int			x0, x1, y0, y1;
+	int			tx, ty, x, y;
+
+	for (ty = 0; ty < nThumbHeight; ty++)
+	{
+		y0 = (int)((int64)ty * nHeight / nThumbHeight);
+		y1 = max((int)((int64)(ty + 1) * nHeight / nThumbHeight), y0 + 1);
+
+		for (tx = 0; tx < nThumbWidth; tx++)
+		{
+			x0 = (int)((int64)tx * nWidth / nThumbWidth);
+			x1 = max((int)((int64)(tx + 1) * nWidth / nThumbWidth), x0 + 1);
+
+			unSum[0] = unSum[1] = unSum[2] = 0;
+
+			for (y = y0; y < y1; y++)
+			{
+				pubPixel = pubSrc + ((size_t)y * nWidth + x0) * 3;
+
+				for (x = x0; x < x1; x++, pubPixel += 3)
+				{
+					unSum[0] += pubPixel[0];
+					unSum[1] += pubPixel[1];
+					unSum[2] += pubPixel[2];
+				}
+			}
+
+			nPixels = (y1 - y0) * (x1 - x0);
+
+			*pubDest++ = (uint8)(unSum[0] / nPixels);
+			*pubDest++ = (uint8)(unSum[1] / nPixels);
+			*pubDest++ = (uint8)(unSum[2] / nPixels);
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Writes packed BGR pixels as an uncompressed TGA
+//-----------------------------------------------------------------------------
+static bool Screenshot_WriteTGA(const char *pszPath, const uint8 *pubPixels, int nWidth, int nHeight, bool bBottomUp)
+{
+	uint8	ubHeader[18];
+	HANDLE	hFile;
+	DWORD	cubPixels, cubWritten;
+	bool	bWritten;
+
+	memset(ubHeader, 0, sizeof(ubHeader));
+
+	ubHeader[2] = 2;							// Uncompressed true color
+	ubHeader[12] = (uint8)nWidth;
+	ubHeader[13] = (uint8)(nWidth >> 8);
+	ubHeader[14] = (uint8)nHeight;
+	ubHeader[15] = (uint8)(nHeight >> 8);
+	ubHeader[16] = 24;
+	ubHeader[17] = bBottomUp ? 0x00 : 0x20;		// Origin at the top
+
+	hFile = CreateFileA(pszPath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	cubPixels = (DWORD)nWidth * nHeight * 3;
+
+	bWritten = WriteFile(hFile, ubHeader, sizeof(ubHeader), &cubWritten, NULL) && cubWritten == sizeof(ubHeader) &&
+		WriteFile(hFile, pubPixels, cubPixels, &cubWritten, NULL) && cubWritten == cubPixels;
+
+	CloseHandle(hFile);
+
+	if (!bWritten)
+		DeleteFileA(pszPath);
+
+	return bWritten;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Thumbnail goes next to the file, "shot.tga" gets "shot_thumb.tga"
+//-----------------------------------------------------------------------------
+static bool Screenshot_GetThumbnailPath(const char *pszPath, char *pszThumbPath, size_t cchThumbPath)
+{
+	const char	*pszExtension;
+	const char	*pszSlash;
+	size_t		cchName;
+
+	pszExtension = strrchr(pszPath, '.');
+	pszSlash = max(strrchr(pszPath, '\\'), strrchr(pszPath, '/'));
+
+	if (!pszExtension || pszExtension < pszSlash)
+		pszExtension = pszPath + strlen(pszPath);
+
+	cchName = pszExtension - pszPath;
+
+	return _snprintf_s(pszThumbPath, cchThumbPath, _TRUNCATE, "%.*s_thumb%s", (int)cchName, pszPath, pszExtension) >= 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Writes the library files of the job, the thumbnail path is left
+//			empty if there is no thumbnail
+//-----------------------------------------------------------------------------
+static EResult Screenshot_WriteFiles(ScreenshotJob_t *pJob, uint8 *pubPixels, char *pszThumbPath, size_t cchThumbPath)
+{
+	std::vector<uint8>	Thumbnail;
+	int					nThumbHeight;
+
+	pszThumbPath[0] = '\0';
+
+	if (!Screenshot_WriteTGA(pJob->m_szFilename, pubPixels, pJob->m_nWidth, pJob->m_nHeight, pJob->m_bBottomUp))
+		return k_EResultIOFailure;
+
+	if (!pJob->m_bThumbnail)
+		return k_EResultOK;
+
+	// Steam wants the thumbnail this wide, at the aspect ratio of the image
+	nThumbHeight = max((int)((int64)pJob->m_nHeight * k_ScreenshotThumbWidth / pJob->m_nWidth), 1);
+
+	Thumbnail.resize((size_t)k_ScreenshotThumbWidth * nThumbHeight * 3);
+	Screenshot_Downscale(pubPixels, pJob->m_nWidth, pJob->m_nHeight, Thumbnail.data(), k_ScreenshotThumbWidth, nThumbHeight);
+
+	// Steam makes its own thumbnail when there is none
+	if (!Screenshot_GetThumbnailPath(pJob->m_szFilename, pszThumbPath, cchThumbPath) ||
+		!Screenshot_WriteTGA(pszThumbPath, Thumbnail.data(), k_ScreenshotThumbWidth, nThumbHeight, pJob->m_bBottomUp))
+	{
+		AsyncLog(k_ESteamAPILogWarning, "[S_API] Failed to write screenshot thumbnail for %s.\n", pJob->m_szFilename);
+		pszThumbPath[0] = '\0';
+	}
+
+	return k_EResultOK;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Queues the result for the pump and frees the job
+//-----------------------------------------------------------------------------
+static void Screenshot_Complete(ScreenshotJob_t *pJob, ScreenshotHandle hScreenshot, EResult eResult)
+{
+	ScreenshotDone_t *pDone;
+
+	if (eResult == k_EResultOK)
+		s_ScreenshotStats.m_nCompleted++;
+	else
+		s_ScreenshotStats.m_nFailed++;
+
+	pDone = (ScreenshotDone_t*)_aligned_malloc(sizeof(ScreenshotDone_t), MEMORY_ALLOCATION_ALIGNMENT);
+
+	if (pDone)
+	{
+		pDone->m_Done.m_nRequest = pJob->m_nRequest;
+		pDone->m_Done.m_hScreenshot = hScreenshot;
+		pDone->m_Done.m_eResult = eResult;
+		pDone->m_Done.m_unConvertTime = pJob->m_unConvertTime;
+
+		InterlockedPushEntrySList(&s_DoneScreenshots, &pDone->m_ListEntry);
+	}
+
+	Screenshot_FreeJob(pJob);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Converts the job, once, and hands it to steam. Returns false when
+//			steam is away and the job has to wait.
+//-----------------------------------------------------------------------------
+static bool Screenshot_Process(ScreenshotJob_t *pJob)
+{
+	char				szThumbPath[MAX_PATH];
+	uint8				*pubPixels;
+	ScreenshotHandle	hScreenshot;
+	EResult				eResult;
+	uint64				ullStartTime;
+
+	pubPixels = (uint8*)pJob + SCREENSHOT_HEADER_SIZE;
+
+	if (!pJob->m_bConverted)
+	{
+		ullStartTime = Steam_GetMicroseconds();
+
+		Screenshot_Convert(pJob, pubPixels);
+
+		pJob->m_bConverted = true;
+		pJob->m_unConvertTime = (uint32)(Steam_GetMicroseconds() - ullStartTime);
+
+		s_ScreenshotStats.m_ullConvertTime += pJob->m_unConvertTime;
+	}
+
+	AcquireSRWLockShared(&s_ScreenshotLock);
+
+	if (!s_pSteamScreenshots)
+	{
+		ReleaseSRWLockShared(&s_ScreenshotLock);
+		return false;
+	}
+
+	ullStartTime = Steam_GetMicroseconds();
+	hScreenshot = INVALID_SCREENSHOT_HANDLE;
+
+	if (pJob->m_bLibrary)
+	{
+		eResult = Screenshot_WriteFiles(pJob, pubPixels, szThumbPath, sizeof(szThumbPath));
+
+		if (eResult == k_EResultOK)
+			hScreenshot = s_pSteamScreenshots->AddScreenshotToLibrary(pJob->m_szFilename, szThumbPath[0] ? szThumbPath : nullptr, pJob->m_nWidth, pJob->m_nHeight);
+	}
+	else
+	{
+		eResult = k_EResultOK;
+		hScreenshot = s_pSteamScreenshots->WriteScreenshot(pubPixels, (uint32)pJob->m_nWidth * pJob->m_nHeight * 3, pJob->m_nWidth, pJob->m_nHeight);
+	}
+
+	ReleaseSRWLockShared(&s_ScreenshotLock);
+
+	s_ScreenshotStats.m_ullWriteTime += Steam_GetMicroseconds() - ullStartTime;
+
+	if (eResult == k_EResultOK && hScreenshot == INVALID_SCREENSHOT_HANDLE)
+		eResult = k_EResultFail;
+
+	if (eResult != k_EResultOK)
+		AsyncLog(k_ESteamAPILogWarning, "[S_API] Screenshot %u failed with result %d.\n", pJob->m_nRequest, eResult);
+
+	Screenshot_Complete(pJob, hScreenshot, eResult);
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Takes jobs off the list in order of submission and processes
+//			them one by one
+//-----------------------------------------------------------------------------
+static DWORD WINAPI Screenshot_WorkerThread(LPVOID pvParam)
+{
+	std::vector<ScreenshotJob_t*>	Jobs;
+	PSLIST_ENTRY					pEntry;
+	HANDLE							hEvents[2];
+	size_t							nFirst;
+
+	hEvents[0] = s_hScreenshotStopEvent;
+	hEvents[1] = s_hScreenshotWakeEvent;
+
+	while (WaitForMultipleObjects(2, hEvents, FALSE, INFINITE) == WAIT_OBJECT_0 + 1)
+	{
+		// The list gives the newest first
+		nFirst = Jobs.size();
+
+		for (pEntry = InterlockedFlushSList(&s_PendingScreenshots); pEntry; pEntry = pEntry->Next)
+			Jobs.push_back(CONTAINING_RECORD(pEntry, ScreenshotJob_t, m_ListEntry));
+
+		std::reverse(Jobs.begin() + nFirst, Jobs.end());
+
+		while (!Jobs.empty() && WaitForSingleObject(s_hScreenshotStopEvent, 0) != WAIT_OBJECT_0)
+		{
+			// Steam is away, resuming wakes us up again
+			if (!Screenshot_Process(Jobs.front()))
+				break;
+
+			Jobs.erase(Jobs.begin());
+		}
+	}
+
+	for (auto pJob : Jobs)
+		Screenshot_FreeJob(pJob);
+
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Screenshots interface of the global user
+//-----------------------------------------------------------------------------
+static ISteamScreenshots* Screenshot_GetSteamScreenshots()
+{
+	return static_cast<ISteamScreenshots*>(InterfaceCache_FindOrCreate(g_pSteamClient, g_hSteamUser, g_hSteamPipe, STEAMSCREENSHOTS_INTERFACE_VERSION));
+}
+
+//-----------------------------------------------------------------------------
+// 
+// Screenshot pipeline C interface
+// 
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Purpose: Called once the pipe and user are up. The worker isn't started
+//			until a screenshot is submitted.
+//-----------------------------------------------------------------------------
+void ScreenshotPipeline_Init()
+{
+	if (!s_hScreenshotWakeEvent)
+	{
+		InitializeSListHead(&s_PendingScreenshots);
+		InitializeSListHead(&s_DoneScreenshots);
+
+		s_hScreenshotWakeEvent = CreateEventA(NULL, FALSE, FALSE, NULL);
+		s_hScreenshotStopEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+	}
+
+	ScreenshotPipeline_Resume();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Posts SteamAPIScreenshotDone_t of finished jobs, in order, called
+//			at the end of every pump
+//-----------------------------------------------------------------------------
+void ScreenshotPipeline_OnPump()
+{
+	PSLIST_ENTRY		pEntry, pNext, pReversed;
+	ScreenshotDone_t	*pDone;
+
+	if (!s_hScreenshotWakeEvent || !QueryDepthSList(&s_DoneScreenshots))
+		return;
+
+	pReversed = nullptr;
+
+	for (pEntry = InterlockedFlushSList(&s_DoneScreenshots); pEntry; pEntry = pNext)
+	{
+		pNext = pEntry->Next;
+		pEntry->Next = pReversed;
+		pReversed = pEntry;
+	}
+
+	for (pEntry = pReversed; pEntry; pEntry = pNext)
+	{
+		pNext = pEntry->Next;
+		pDone = CONTAINING_RECORD(pEntry, ScreenshotDone_t, m_ListEntry);
+
+		CallbackMgr_DispatchLocal(SteamAPIScreenshotDone_t::k_iCallback, &pDone->m_Done, sizeof(pDone->m_Done));
+
+		_aligned_free(pDone);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Waits for a handover in progress, jobs stay queued until the
+//			pipe is back
+//-----------------------------------------------------------------------------
+void ScreenshotPipeline_Suspend()
+{
+	AcquireSRWLockExclusive(&s_ScreenshotLock);
+	s_pSteamScreenshots = nullptr;
+	ReleaseSRWLockExclusive(&s_ScreenshotLock);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Picks up the interface of the new pipe and the jobs that waited
+//-----------------------------------------------------------------------------
+void ScreenshotPipeline_Resume()
+{
+	ISteamScreenshots *pSteamScreenshots;
+
+	pSteamScreenshots = Screenshot_GetSteamScreenshots();
+
+	AcquireSRWLockExclusive(&s_ScreenshotLock);
+	s_pSteamScreenshots = pSteamScreenshots;
+	ReleaseSRWLockExclusive(&s_ScreenshotLock);
+
+	if (s_hScreenshotWakeEvent)
+		SetEvent(s_hScreenshotWakeEvent);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Stops the worker, jobs not handed over yet are dropped. Nothing
+//			may be submitting anymore.
+//-----------------------------------------------------------------------------
+void ScreenshotPipeline_Shutdown()
+{
+	PSLIST_ENTRY pEntry, pNext;
+
+	ScreenshotPipeline_Suspend();
+
+	if (!s_hScreenshotWakeEvent)
+		return;
+
+	if (s_hScreenshotThread)
+	{
+		SetEvent(s_hScreenshotStopEvent);
+		WaitForSingleObject(s_hScreenshotThread, INFINITE);
+		CloseHandle(s_hScreenshotThread);
+	}
+
+	for (pEntry = InterlockedFlushSList(&s_PendingScreenshots); pEntry; pEntry = pNext)
+	{
+		pNext = pEntry->Next;
+		Screenshot_FreeJob(CONTAINING_RECORD(pEntry, ScreenshotJob_t, m_ListEntry));
+	}
+
+	for (pEntry = InterlockedFlushSList(&s_DoneScreenshots); pEntry; pEntry = pNext)
+	{
+		pNext = pEntry->Next;
+		_aligned_free(CONTAINING_RECORD(pEntry, ScreenshotDone_t, m_ListEntry));
+	}
+
+	CloseHandle(s_hScreenshotWakeEvent);
+	CloseHandle(s_hScreenshotStopEvent);
+
+	s_hScreenshotThread = NULL;
+	s_hScreenshotWakeEvent = NULL;
+	s_hScreenshotStopEvent = NULL;
+	s_nScreenshotWorkerStarted = 0;
+}
+
+//-----------------------------------------------------------------------------
+// 
+// Screenshot pipeline interface
+// 
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns buffer for a frame of 32-bit pixels, to be submitted or
+//			freed
+//-----------------------------------------------------------------------------
+void* SteamAPI_AllocScreenshotBuffer(uint32 cubPixels)
+{
+	ScreenshotJob_t *pJob;
+
+	if (!cubPixels)
+		return nullptr;
+
+	pJob = (ScreenshotJob_t*)VirtualAlloc(NULL, SCREENSHOT_HEADER_SIZE + cubPixels, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+
+	if (!pJob)
+		return nullptr;
+
+	pJob->m_unMagic = SCREENSHOT_JOB_MAGIC;
+	pJob->m_cubPixels = cubPixels;
+
+	return (uint8*)pJob + SCREENSHOT_HEADER_SIZE;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Frees a buffer that wasn't submitted
+//-----------------------------------------------------------------------------
+void SteamAPI_FreeScreenshotBuffer(void *pubPixels)
+{
+	ScreenshotJob_t *pJob;
+
+	pJob = Screenshot_GetJob(pubPixels);
+
+	if (pJob)
+		Screenshot_FreeJob(pJob);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Queues the frame for the worker, never waits. Returns request
+//			number of the job, or 0 if the request is invalid.
+//-----------------------------------------------------------------------------
+uint32 SteamAPI_SubmitScreenshot(const SteamAPIScreenshotRequest_t *pRequest)
+{
+	ScreenshotJob_t	*pJob;
+	int				nPitch;
+
+	if (!pRequest)
+		return 0;
+
+	pJob = Screenshot_GetJob(pRequest->m_pubPixels);
+
+	if (!pJob)
+		return 0;
+
+	nPitch = pRequest->m_nPitch ? pRequest->m_nPitch : pRequest->m_nWidth * 4;
+
+	// Converting in place needs every row to hold 4 bytes per pixel
+	if (!s_hScreenshotWakeEvent ||
+		pRequest->m_nWidth <= 0 || pRequest->m_nWidth > SCREENSHOT_MAX_SIZE ||
+		pRequest->m_nHeight <= 0 || pRequest->m_nHeight > SCREENSHOT_MAX_SIZE ||
+		nPitch < pRequest->m_nWidth * 4 || (uint64)nPitch * pRequest->m_nHeight > pJob->m_cubPixels ||
+		(pRequest->m_pchFilename && strlen(pRequest->m_pchFilename) >= sizeof(pJob->m_szFilename)))
+	{
+		Screenshot_FreeJob(pJob);
+		return 0;
+	}
+
+	pJob->m_nRequest = (uint32)InterlockedIncrement(&s_nScreenshotRequests);
+	pJob->m_nWidth = pRequest->m_nWidth;
+	pJob->m_nHeight = pRequest->m_nHeight;
+	pJob->m_nPitch = nPitch;
+	pJob->m_bBottomUp = pRequest->m_bBottomUp;
+	pJob->m_bThumbnail = pRequest->m_bThumbnail;
+	pJob->m_bLibrary = pRequest->m_pchFilename != nullptr;
+	pJob->m_bConverted = false;
+	pJob->m_unConvertTime = 0;
+	pJob->m_szFilename[0] = '\0';
+
+	if (pRequest->m_pchFilename)
+		strcpy_s(pJob->m_szFilename, sizeof(pJob->m_szFilename), pRequest->m_pchFilename);
+
+	if (InterlockedCompareExchange(&s_nScreenshotWorkerStarted, 1, 0) == 0)
+	{
+		s_hScreenshotThread = CreateThread(NULL, 0, Screenshot_WorkerThread, NULL, 0, NULL);
+
+		// Nothing would ever complete the job, let the game fall back
+		if (!s_hScreenshotThread)
+		{
+			AsyncLog(k_ESteamAPILogError, "[S_API] Failed to start screenshot worker, error %u.\n", GetLastError());
+
+			InterlockedExchange(&s_nScreenshotWorkerStarted, 0);
+			Screenshot_FreeJob(pJob);
+			return 0;
+		}
+
+		SetThreadPriority(s_hScreenshotThread, THREAD_PRIORITY_BELOW_NORMAL);
+	}
+
+	InterlockedIncrement((volatile LONG*)&s_ScreenshotStats.m_nSubmitted);
+
+	InterlockedPushEntrySList(&s_PendingScreenshots, &pJob->m_ListEntry);
+	SetEvent(s_hScreenshotWakeEvent);
+
+	return pJob->m_nRequest;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Counters since init
+//-----------------------------------------------------------------------------
+void SteamAPI_GetScreenshotStats(SteamAPIScreenshotStats_t *pStats)
+{
+	if (!pStats)
+		return;
+
+	*pStats = s_ScreenshotStats;
+}
@@ -0,0 +1,81 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+#ifndef SCREENSHOT_PIPELINE_H
+#define SCREENSHOT_PIPELINE_H
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Purpose: Frame to hand to steam, see SteamAPI_SubmitScreenshot().
+//-----------------------------------------------------------------------------
+struct SteamAPIScreenshotRequest_t
+{
+	void*		m_pubPixels;			// 32-bit BGRA from SteamAPI_AllocScreenshotBuffer()
+	int			m_nWidth;
+	int			m_nHeight;
+	int			m_nPitch;				// Bytes per row, 0 means width * 4
+	bool		m_bBottomUp;			// First row is the bottom one, as glReadPixels() returns
+	bool		m_bThumbnail;			// Library files only, see m_pchFilename
+	const char*	m_pchFilename;			// Written as TGA and added with AddScreenshotToLibrary(),
+										// nullptr passes the pixels to WriteScreenshot()
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Posted through the callback pump once steam has the screenshot
+//			and the buffer is freed. Steam still sends ScreenshotReady_t on
+//			its own.
+//-----------------------------------------------------------------------------
+struct SteamAPIScreenshotDone_t
+{
+	// Steam's own screenshot callbacks use the low numbers of the range
+	enum { k_iCallback = k_iSteamScreenshotsCallbacks + 90 };
+
+	uint32				m_nRequest;		// As returned by SteamAPI_SubmitScreenshot()
+	ScreenshotHandle	m_hScreenshot;	// INVALID_SCREENSHOT_HANDLE on failure
+	EResult				m_eResult;
+	uint32				m_unConvertTime;	// Microseconds spent on the worker
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Counters of the screenshot pipeline, times are in microseconds.
+//-----------------------------------------------------------------------------
+struct SteamAPIScreenshotStats_t
+{
+	uint32		m_nSubmitted;
+	uint32		m_nCompleted;
+	uint32		m_nFailed;
+	uint64		m_ullConvertTime;
+	uint64		m_ullWriteTime;			// Files and the handoff to steam
+};
+
+//-----------------------------------------------------------------------------
+// 
+// Screenshot pipeline C interface
+// 
+//-----------------------------------------------------------------------------
+
+extern void ScreenshotPipeline_Init();
+extern void ScreenshotPipeline_OnPump();
+extern void ScreenshotPipeline_Suspend();
+extern void ScreenshotPipeline_Resume();
+extern void ScreenshotPipeline_Shutdown();
+
+//-----------------------------------------------------------------------------
+// Purpose: Screenshot pipeline API. The render thread reads the frame into a
+//			buffer of the pipeline and submits it, which only queues it. A
+//			worker thread converts the pixels in place to what steam takes
+//			and hands them over, the game learns of it from
+//			SteamAPIScreenshotDone_t.
+// 
+//			A submitted buffer belongs to the pipeline, also when submitting
+//			fails.
+//-----------------------------------------------------------------------------
+S_API void* SteamAPI_AllocScreenshotBuffer(uint32 cubPixels);
+S_API void SteamAPI_FreeScreenshotBuffer(void *pubPixels);
+S_API uint32 SteamAPI_SubmitScreenshot(const SteamAPIScreenshotRequest_t *pRequest);
+S_API void SteamAPI_GetScreenshotStats(SteamAPIScreenshotStats_t *pStats);
+
+#endif
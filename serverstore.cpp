@@ -0,0 +1,734 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "steam_api_pch.h"
+#include <algorithm>
+#include <emmintrin.h>
+#include "serverstore.h"
+
+//-----------------------------------------------------------------------------
+// 
+// Server browser result store
+// 
+//	gameserveritem_t is over 400 bytes, of which a filter or a sort looks at
+//	a few. The store keeps the fields that are filtered on in 16-bit columns,
+//	so eight servers are tested with one compare, and tags as a 64-bit mask.
+//	Map names and tags are interned, strings go to an arena.
+// 
+//	Sorted indexes are built the first time a key is sorted by, from then on
+//	every insert puts its row in place with a binary search.
+// 
+//-----------------------------------------------------------------------------
+
+#define SERVERSTORE_MAX_STORES		8
+
+// Tags that get a bit, tags seen after these are kept as text only
+#define SERVERSTORE_MAX_TAGS		64
+
+// Pings above this sort and filter as this
+#define SERVERSTORE_MAX_PING		9999
+
+// Bits of the flags column
+#define SERVERSTORE_FLAG_PASSWORD	0x0001
+#define SERVERSTORE_FLAG_SECURE		0x0002
+
+//-----------------------------------------------------------------------------
+// Purpose: Server browser result store class
+//-----------------------------------------------------------------------------
+class CServerStore
+{
+public:
+	CServerStore();
+
+public:
+	int AddServer(const gameserveritem_t *pServer);
+	void Clear();
+	bool GetRow(int iRow, SteamAPIServerRow_t *pRow);
+	int16 FindMap(const char *pchMap);
+	uint64 GetTagBit(const char *pchTag);
+	int Query(ESteamAPIServerSortKey eSortKey, bool bDescending, const SteamAPIServerFilter_t *pFilter, int *piRows, int nMaxRows);
+
+	uint32 GetCount() const { return (uint32)m_ullAddress.size(); }
+
+private:
+	uint32 AddString(const char *pchString);
+	int16 InternMap(const char *pchMap);
+	uint64 ParseTags(const char *pchTags);
+	bool Less(ESteamAPIServerSortKey eSortKey, uint32 iRowA, uint32 iRowB) const;
+	void IndexInsert(ESteamAPIServerSortKey eSortKey, uint32 iRow);
+	void IndexRemove(ESteamAPIServerSortKey eSortKey, uint32 iRow);
+	void BuildIndex(ESteamAPIServerSortKey eSortKey);
+	bool RowPasses(const SteamAPIServerFilter_t *pFilter, uint32 iRow) const;
+	void Filter(const SteamAPIServerFilter_t *pFilter);
+
+private:
+	// Columns, one entry per row
+	std::vector<uint64>		m_ullAddress;		// IP, connection port, query port
+	std::vector<AppId_t>	m_nAppId;
+	std::vector<int16>		m_nPing;
+	std::vector<int16>		m_nPlayers;
+	std::vector<int16>		m_nMaxPlayers;
+	std::vector<int16>		m_nBotPlayers;
+	std::vector<int16>		m_nMapId;
+	std::vector<int16>		m_nFlags;
+	std::vector<uint64>		m_ullTags;
+	std::vector<uint32>		m_unNameOffset;
+	std::vector<uint32>		m_unTagsOffset;
+
+	// Zero terminated names and tag strings
+	std::vector<char>		m_Strings;
+
+	std::vector<std::string>		m_Maps;
+	std::map<std::string, int16>	m_MapIds;
+	std::map<std::string, uint64>	m_TagBits;
+
+	std::map<uint64, uint32>		m_RowsByAddress;
+
+	// Row numbers in ascending order of the key, only once sorted by
+	std::vector<uint32>		m_Indexes[k_ESteamAPIServerSortKeyCount];
+	bool					m_bIndexed[k_ESteamAPIServerSortKeyCount];
+
+	// Bit per row of the last filter
+	std::vector<uint32>		m_PassBits;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Constructor
+//-----------------------------------------------------------------------------
+CServerStore::CServerStore()
+{
+	memset(m_bIndexed, 0, sizeof(m_bIndexed));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Forgets every server, interned maps and tags are kept
+//-----------------------------------------------------------------------------
+void CServerStore::Clear()
+{
+	int i;
+
+	m_ullAddress.clear();
+	m_nAppId.clear();
+	m_nPing.clear();
+	m_nPlayers.clear();
+	m_nMaxPlayers.clear();
+	m_nBotPlayers.clear();
+	m_nMapId.clear();
+	m_nFlags.clear();
+	m_ullTags.clear();
+	m_unNameOffset.clear();
+	m_unTagsOffset.clear();
+	m_Strings.clear();
+	m_RowsByAddress.clear();
+
+	for (i = 0; i < k_ESteamAPIServerSortKeyCount; i++)
+		m_Indexes[i].clear();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Appends the string to the arena, returns its offset
+//-----------------------------------------------------------------------------
+uint32 CServerStore::AddString(const char *pchString)
+{
+	uint32 unOffset;
+
+	unOffset = (uint32)m_Strings.size();
+	m_Strings.insert(m_Strings.end(), pchString, pchString + strlen(pchString) + 1);
+
+	return unOffset;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns id of the map, new maps get the next one
+//-----------------------------------------------------------------------------
+int16 CServerStore::InternMap(const char *pchMap)
+{
+	int16 nMapId;
+
+	auto Iter = m_MapIds.find(pchMap);
+
+	if (Iter != m_MapIds.end())
+		return Iter->second;
+
+	// Out of ids, these all share the last one
+	if (m_Maps.size() >= 0x7FFF)
+		return 0x7FFE;
+
+	nMapId = (int16)m_Maps.size();
+
+	m_Maps.push_back(pchMap);
+	m_MapIds.insert(std::make_pair(std::string(pchMap), nMapId));
+
+	return nMapId;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns bit of the tag, interning it if there's a bit left. 0 if
+//			the tag can't be filtered on.
+//-----------------------------------------------------------------------------
+uint64 CServerStore::GetTagBit(const char *pchTag)
+{
+	uint64 ullBit;
+
+	auto Iter = m_TagBits.find(pchTag);
+
+	if (Iter != m_TagBits.end())
+		return Iter->second;
+
+	if (m_TagBits.size() >= SERVERSTORE_MAX_TAGS)
+		return 0;
+
+	// No server stored so far has the tag, or it would have its bit already
+	ullBit = 1ull << m_TagBits.size();
+	m_TagBits.insert(std::make_pair(std::string(pchTag), ullBit));
+
+	return ullBit;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns mask of the comma separated tags
+//-----------------------------------------------------------------------------
+uint64 CServerStore::ParseTags(const char *pchTags)
+{
+	char		szTag[128];
+	const char	*pchEnd;
+	uint64		ullTags;
+	size_t		cchTag;
+
+	ullTags = 0;
+
+	while (*pchTags)
+	{
+		pchEnd = strchr(pchTags, ',');
+		cchTag = pchEnd ? (size_t)(pchEnd - pchTags) : strlen(pchTags);
+
+		if (cchTag && cchTag < sizeof(szTag))
+		{
+			memcpy(szTag, pchTags, cchTag);
+			szTag[cchTag] = '\0';
+
+			ullTags |= GetTagBit(szTag);
+		}
+
+		pchTags += cchTag;
+
+		if (*pchTags == ',')
+			pchTags++;
+	}
+
+	return ullTags;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Strict order of the key, ties are broken by row so every row has
+//			exactly one place in an index
+//-----------------------------------------------------------------------------
+bool CServerStore::Less(ESteamAPIServerSortKey eSortKey, uint32 iRowA, uint32 iRowB) const
+{
+	int nCompare;
+
+	switch (eSortKey)
+	{
+	case k_ESteamAPIServerSortPing:
+		nCompare = m_nPing[iRowA] - m_nPing[iRowB];
+		break;
+
+	case k_ESteamAPIServerSortPlayers:
+		nCompare = m_nPlayers[iRowA] - m_nPlayers[iRowB];
+		break;
+
+	case k_ESteamAPIServerSortName:
+		nCompare = _stricmp(&m_Strings[m_unNameOffset[iRowA]], &m_Strings[m_unNameOffset[iRowB]]);
+		break;
+
+	case k_ESteamAPIServerSortMap:
+		nCompare = (m_nMapId[iRowA] == m_nMapId[iRowB]) ? 0 : _stricmp(m_Maps[m_nMapId[iRowA]].c_str(), m_Maps[m_nMapId[iRowB]].c_str());
+		break;
+
+	default:
+		nCompare = 0;
+		break;
+	}
+
+	return nCompare ? (nCompare < 0) : (iRowA < iRowB);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Puts the row in place in a built index
+//-----------------------------------------------------------------------------
+void CServerStore::IndexInsert(ESteamAPIServerSortKey eSortKey, uint32 iRow)
+{
+	std::vector<uint32> &Index = m_Indexes[eSortKey];
+
+	auto Iter = std::lower_bound(Index.begin(), Index.end(), iRow, [this, eSortKey](uint32 iRowA, uint32 iRowB) { return Less(eSortKey, iRowA, iRowB); });
+	Index.insert(Iter, iRow);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Takes the row out of a built index, before its key changes
+//-----------------------------------------------------------------------------
+void CServerStore::IndexRemove(ESteamAPIServerSortKey eSortKey, uint32 iRow)
+{
+	std::vector<uint32> &Index = m_Indexes[eSortKey];
+
+	auto Iter = std::lower_bound(Index.begin(), Index.end(), iRow, [this, eSortKey](uint32 iRowA, uint32 iRowB) { return Less(eSortKey, iRowA, iRowB); });
+
+	if (Iter != Index.end() && *Iter == iRow)
+		Index.erase(Iter);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Sorts every row by the key, the index is kept from now on
+//-----------------------------------------------------------------------------
+void CServerStore::BuildIndex(ESteamAPIServerSortKey eSortKey)
+{
+	std::vector<uint32> &Index = m_Indexes[eSortKey];
+	uint32 i;
+
+	Index.resize(GetCount());
+
+	for (i = 0; i < GetCount(); i++)
+		Index[i] = i;
+
+	std::sort(Index.begin(), Index.end(), [this, eSortKey](uint32 iRowA, uint32 iRowB) { return Less(eSortKey, iRowA, iRowB); });
+
+	m_bIndexed[eSortKey] = true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Copies the server into the columns, a server already stored is
+//			updated in place. Returns its row.
+//-----------------------------------------------------------------------------
+int CServerStore::AddServer(const gameserveritem_t *pServer)
+{
+	uint64	ullAddress;
+	uint32	iRow;
+	int16	nFlags;
+	bool	bNew;
+	int		i;
+
+	ullAddress = ((uint64)pServer->m_NetAdr.GetIP() << 32) | ((uint32)pServer->m_NetAdr.GetConnectionPort() << 16) | pServer->m_NetAdr.GetQueryPort();
+
+	auto Iter = m_RowsByAddress.find(ullAddress);
+	bNew = (Iter == m_RowsByAddress.end());
+
+	if (bNew)
+	{
+		iRow = GetCount();
+
+		m_ullAddress.push_back(ullAddress);
+		m_nAppId.push_back(0);
+		m_nPing.push_back(0);
+		m_nPlayers.push_back(0);
+		m_nMaxPlayers.push_back(0);
+		m_nBotPlayers.push_back(0);
+		m_nMapId.push_back(0);
+		m_nFlags.push_back(0);
+		m_ullTags.push_back(0);
+		m_unNameOffset.push_back(0);
+		m_unTagsOffset.push_back(0);
+
+		m_RowsByAddress.insert(std::make_pair(ullAddress, iRow));
+	}
+	else
+	{
+		iRow = Iter->second;
+
+		for (i = 0; i < k_ESteamAPIServerSortKeyCount; i++)
+		{
+			if (m_bIndexed[i])
+				IndexRemove((ESteamAPIServerSortKey)i, iRow);
+		}
+	}
+
+	nFlags = 0;
+
+	if (pServer->m_bPassword)
+		nFlags |= SERVERSTORE_FLAG_PASSWORD;
+
+	if (pServer->m_bSecure)
+		nFlags |= SERVERSTORE_FLAG_SECURE;
+
+	m_nAppId[iRow] = pServer->m_nAppID;
+	m_nPing[iRow] = (int16)min(max(pServer->m_nPing, 0), SERVERSTORE_MAX_PING);
+	m_nPlayers[iRow] = (int16)pServer->m_nPlayers;
+	m_nMaxPlayers[iRow] = (int16)pServer->m_nMaxPlayers;
+	m_nBotPlayers[iRow] = (int16)pServer->m_nBotPlayers;
+	m_nMapId[iRow] = InternMap(pServer->m_szMap);
+	m_nFlags[iRow] = nFlags;
+	m_ullTags[iRow] = ParseTags(pServer->m_szGameTags);
+
+	// Old strings of an updated server stay in the arena until Clear()
+	if (bNew || strcmp(&m_Strings[m_unNameOffset[iRow]], pServer->GetName()))
+		m_unNameOffset[iRow] = AddString(pServer->GetName());
+
+	if (bNew || strcmp(&m_Strings[m_unTagsOffset[iRow]], pServer->m_szGameTags))
+		m_unTagsOffset[iRow] = AddString(pServer->m_szGameTags);
+
+	for (i = 0; i < k_ESteamAPIServerSortKeyCount; i++)
+	{
+		if (m_bIndexed[i])
+			IndexInsert((ESteamAPIServerSortKey)i, iRow);
+	}
+
+	return (int)iRow;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Fills the row, strings point into the store
+//-----------------------------------------------------------------------------
+bool CServerStore::GetRow(int iRow, SteamAPIServerRow_t *pRow)
+{
+	if (iRow < 0 || (uint32)iRow >= GetCount())
+		return false;
+
+	pRow->m_unIP = (uint32)(m_ullAddress[iRow] >> 32);
+	pRow->m_usConnectionPort = (uint16)(m_ullAddress[iRow] >> 16);
+	pRow->m_usQueryPort = (uint16)m_ullAddress[iRow];
+	pRow->m_nAppId = m_nAppId[iRow];
+	pRow->m_nPing = m_nPing[iRow];
+	pRow->m_nPlayers = m_nPlayers[iRow];
+	pRow->m_nMaxPlayers = m_nMaxPlayers[iRow];
+	pRow->m_nBotPlayers = m_nBotPlayers[iRow];
+	pRow->m_nMapId = m_nMapId[iRow];
+	pRow->m_bPassword = (m_nFlags[iRow] & SERVERSTORE_FLAG_PASSWORD) != 0;
+	pRow->m_bSecure = (m_nFlags[iRow] & SERVERSTORE_FLAG_SECURE) != 0;
+	pRow->m_pchName = &m_Strings[m_unNameOffset[iRow]];
+	pRow->m_pchMap = m_Maps[m_nMapId[iRow]].c_str();
+	pRow->m_pchTags = &m_Strings[m_unTagsOffset[iRow]];
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns id of the map, -1 if no stored server runs it
+//-----------------------------------------------------------------------------
+int16 CServerStore::FindMap(const char *pchMap)
+{
+	auto Iter = m_MapIds.find(pchMap);
+
+	return (Iter != m_MapIds.end()) ? Iter->second : -1;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Scalar version of the filter, for rows that don't fill a vector
+//-----------------------------------------------------------------------------
+bool CServerStore::RowPasses(const SteamAPIServerFilter_t *pFilter, uint32 iRow) const
+{
+	if (pFilter->m_nMaxPing && m_nPing[iRow] > pFilter->m_nMaxPing)
+		return false;
+
+	if (m_nPlayers[iRow] < pFilter->m_nMinPlayers)
+		return false;
+
+	if (pFilter->m_bNotFull && m_nPlayers[iRow] >= m_nMaxPlayers[iRow])
+		return false;
+
+	if (pFilter->m_bNotEmpty && m_nPlayers[iRow] <= 0)
+		return false;
+
+	if (pFilter->m_bNoPassword && (m_nFlags[iRow] & SERVERSTORE_FLAG_PASSWORD))
+		return false;
+
+	if (pFilter->m_bSecureOnly && !(m_nFlags[iRow] & SERVERSTORE_FLAG_SECURE))
+		return false;
+
+	if (pFilter->m_nMapId >= 0 && m_nMapId[iRow] != pFilter->m_nMapId)
+		return false;
+
+	if ((m_ullTags[iRow] & pFilter->m_ullRequiredTags) != pFilter->m_ullRequiredTags)
+		return false;
+
+	if (m_ullTags[iRow] & pFilter->m_ullExcludedTags)
+		return false;
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Sets a bit for every row that passes the filter. Eight rows are
+//			tested at once, 16-bit columns in one vector and tags in four.
+//-----------------------------------------------------------------------------
+void CServerStore::Filter(const SteamAPIServerFilter_t *pFilter)
+{
+	__m128i		vPass, vFail, vValue, vPlayers;
+	__m128i		vMaxPing, vMinPlayers, vFlagMask, vFlagValue, vMapId;
+	__m128i		vRequired, vExcluded, vZero, vOnes, vTags;
+	__m128i		vMatch32, vMatch64;
+	uint32		nRows, nPassBits;
+	uint32		i, j;
+	int16		nFlagMask, nFlagValue;
+
+	nRows = GetCount();
+	m_PassBits.assign((nRows + 31) / 32, 0);
+
+	nFlagMask = 0;
+	nFlagValue = 0;
+
+	if (pFilter->m_bNoPassword)
+		nFlagMask |= SERVERSTORE_FLAG_PASSWORD;
+
+	if (pFilter->m_bSecureOnly)
+	{
+		nFlagMask |= SERVERSTORE_FLAG_SECURE;
+		nFlagValue |= SERVERSTORE_FLAG_SECURE;
+	}
+
+	vMaxPing = _mm_set1_epi16(pFilter->m_nMaxPing ? pFilter->m_nMaxPing : 0x7FFF);
+	vMinPlayers = _mm_set1_epi16(pFilter->m_nMinPlayers);
+	vFlagMask = _mm_set1_epi16(nFlagMask);
+	vFlagValue = _mm_set1_epi16(nFlagValue);
+	vMapId = _mm_set1_epi16(pFilter->m_nMapId);
+	vRequired = _mm_set_epi32((int)(pFilter->m_ullRequiredTags >> 32), (int)pFilter->m_ullRequiredTags, (int)(pFilter->m_ullRequiredTags >> 32), (int)pFilter->m_ullRequiredTags);
+	vExcluded = _mm_set_epi32((int)(pFilter->m_ullExcludedTags >> 32), (int)pFilter->m_ullExcludedTags, (int)(pFilter->m_ullExcludedTags >> 32), (int)pFilter->m_ullExcludedTags);
+	vZero = _mm_setzero_si128();
+	vOnes = _mm_set1_epi16(-1);
+
+	for (i = 0; i + 8 <= nRows; i += 8)
+	{
+		vPlayers = _mm_loadu_si128((const __m128i*)&m_nPlayers[i]);
+
+		vFail = _mm_cmpgt_epi16(_mm_loadu_si128((const __m128i*)&m_nPing[i]), vMaxPing);
+		vFail = _mm_or_si128(vFail, _mm_cmplt_epi16(vPlayers, vMinPlayers));
+
+		if (pFilter->m_bNotFull)
+			vFail = _mm_or_si128(vFail, _mm_xor_si128(_mm_cmpgt_epi16(_mm_loadu_si128((const __m128i*)&m_nMaxPlayers[i]), vPlayers), vOnes));
+
+		if (pFilter->m_bNotEmpty)
+			vFail = _mm_or_si128(vFail, _mm_cmpgt_epi16(_mm_set1_epi16(1), vPlayers));
+
+		if (nFlagMask)
+		{
+			vValue = _mm_and_si128(_mm_loadu_si128((const __m128i*)&m_nFlags[i]), vFlagMask);
+			vFail = _mm_or_si128(vFail, _mm_xor_si128(_mm_cmpeq_epi16(vValue, vFlagValue), vOnes));
+		}
+
+		if (pFilter->m_nMapId >= 0)
+			vFail = _mm_or_si128(vFail, _mm_xor_si128(_mm_cmpeq_epi16(_mm_loadu_si128((const __m128i*)&m_nMapId[i]), vMapId), vOnes));
+
+		vPass = _mm_andnot_si128(vFail, vOnes);
+
+		// One bit per row
+		nPassBits = (uint32)_mm_movemask_epi8(_mm_packs_epi16(vPass, vZero)) & 0xFF;
+
+		if (nPassBits && (pFilter->m_ullRequiredTags || pFilter->m_ullExcludedTags))
+		{
+			for (j = 0; j < 8; j += 2)
+			{
+				vTags = _mm_loadu_si128((const __m128i*)&m_ullTags[i + j]);
+
+				// 64-bit equality out of two 32-bit halves
+				vMatch32 = _mm_cmpeq_epi32(_mm_and_si128(vTags, vRequired), vRequired);
+				vMatch32 = _mm_and_si128(vMatch32, _mm_cmpeq_epi32(_mm_and_si128(vTags, vExcluded), vZero));
+				vMatch64 = _mm_and_si128(vMatch32, _mm_shuffle_epi32(vMatch32, _MM_SHUFFLE(2, 3, 0, 1)));
+
+				nPassBits &= ~((~(uint32)_mm_movemask_pd(_mm_castsi128_pd(vMatch64)) & 3) << j);
+			}
+		}
+
+		m_PassBits[i >> 5] |= nPassBits << (i & 31);
+	}
+
+	for (; i < nRows; i++)
+	{
+		if (RowPasses(pFilter, i))
+			m_PassBits[i >> 5] |= 1u << (i & 31);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Writes rows that pass the filter in order of the key, returns
+//			number of rows that passed, which may be more than were written.
+//-----------------------------------------------------------------------------
+int CServerStore::Query(ESteamAPIServerSortKey eSortKey, bool bDescending, const SteamAPIServerFilter_t *pFilter, int *piRows, int nMaxRows)
+{
+	uint32	nRows, i, iRow;
+	int		nPassed;
+
+	if (!m_bIndexed[eSortKey])
+		BuildIndex(eSortKey);
+
+	if (pFilter)
+		Filter(pFilter);
+
+	std::vector<uint32> &Index = m_Indexes[eSortKey];
+
+	nRows = (uint32)Index.size();
+	nPassed = 0;
+
+	for (i = 0; i < nRows; i++)
+	{
+		iRow = bDescending ? Index[nRows - 1 - i] : Index[i];
+
+		if (pFilter && !(m_PassBits[iRow >> 5] & (1u << (iRow & 31))))
+			continue;
+
+		if (nPassed < nMaxRows)
+			piRows[nPassed] = (int)iRow;
+
+		nPassed++;
+	}
+
+	return nPassed;
+}
+
+//-----------------------------------------------------------------------------
+// 
+// Server browser result store interface
+// 
+//-----------------------------------------------------------------------------
+
+static CServerStore* s_pServerStores[SERVERSTORE_MAX_STORES];
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns store of the handle
+//-----------------------------------------------------------------------------
+static CServerStore* ServerStore_Get(HSteamAPIServerStore hStore)
+{
+	if (hStore <= 0 || hStore > SERVERSTORE_MAX_STORES)
+		return nullptr;
+
+	return s_pServerStores[hStore - 1];
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Creates an empty store, one per server list
+//-----------------------------------------------------------------------------
+HSteamAPIServerStore SteamAPI_ServerStore_Create()
+{
+	int i;
+
+	for (i = 0; i < SERVERSTORE_MAX_STORES; i++)
+	{
+		if (s_pServerStores[i])
+			continue;
+
+		s_pServerStores[i] = new CServerStore();
+		return i + 1;
+	}
+
+	return STEAMAPI_SERVERSTORE_INVALID;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Frees the store
+//-----------------------------------------------------------------------------
+void SteamAPI_ServerStore_Destroy(HSteamAPIServerStore hStore)
+{
+	CServerStore *pStore;
+
+	pStore = ServerStore_Get(hStore);
+
+	if (!pStore)
+		return;
+
+	s_pServerStores[hStore - 1] = nullptr;
+	delete pStore;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Forgets every server, for a refresh of the list
+//-----------------------------------------------------------------------------
+void SteamAPI_ServerStore_Clear(HSteamAPIServerStore hStore)
+{
+	CServerStore *pStore;
+
+	pStore = ServerStore_Get(hStore);
+
+	if (pStore)
+		pStore->Clear();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Copies the server in, returns its row or -1
+//-----------------------------------------------------------------------------
+int SteamAPI_ServerStore_AddServer(HSteamAPIServerStore hStore, const gameserveritem_t *pServer)
+{
+	CServerStore *pStore;
+
+	pStore = ServerStore_Get(hStore);
+
+	if (!pStore || !pServer)
+		return -1;
+
+	return pStore->AddServer(pServer);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Number of rows
+//-----------------------------------------------------------------------------
+int SteamAPI_ServerStore_GetCount(HSteamAPIServerStore hStore)
+{
+	CServerStore *pStore;
+
+	pStore = ServerStore_Get(hStore);
+
+	return pStore ? (int)pStore->GetCount() : 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Fills the row for display
+//-----------------------------------------------------------------------------
+bool SteamAPI_ServerStore_GetRow(HSteamAPIServerStore hStore, int iRow, SteamAPIServerRow_t *pRow)
+{
+	CServerStore *pStore;
+
+	pStore = ServerStore_Get(hStore);
+
+	if (!pStore || !pRow)
+		return false;
+
+	return pStore->GetRow(iRow, pRow);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Map id for filters, -1 if no stored server runs the map
+//-----------------------------------------------------------------------------
+int16 SteamAPI_ServerStore_GetMapId(HSteamAPIServerStore hStore, const char *pchMap)
+{
+	CServerStore *pStore;
+
+	pStore = ServerStore_Get(hStore);
+
+	if (!pStore || !pchMap)
+		return -1;
+
+	return pStore->FindMap(pchMap);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Tag bit for filters, 0 if the store is out of bits
+//-----------------------------------------------------------------------------
+uint64 SteamAPI_ServerStore_GetTagBit(HSteamAPIServerStore hStore, const char *pchTag)
+{
+	CServerStore *pStore;
+
+	pStore = ServerStore_Get(hStore);
+
+	if (!pStore || !pchTag || !*pchTag)
+		return 0;
+
+	return pStore->GetTagBit(pchTag);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Sorted and filtered rows, the filter is optional
+//-----------------------------------------------------------------------------
+int SteamAPI_ServerStore_Query(HSteamAPIServerStore hStore, ESteamAPIServerSortKey eSortKey, bool bDescending, const SteamAPIServerFilter_t *pFilter, int *piRows, int nMaxRows)
+{
+	CServerStore *pStore;
+
+	pStore = ServerStore_Get(hStore);
+
+	if (!pStore || eSortKey < 0 || eSortKey >= k_ESteamAPIServerSortKeyCount)
+		return 0;
+
+	if (!piRows)
+		nMaxRows = 0;
+
+	return pStore->Query(eSortKey, bDescending, pFilter, piRows, nMaxRows);
+}
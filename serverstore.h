@@ -0,0 +1,88 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+#ifndef SERVER_STORE_H
+#define SERVER_STORE_H
+#pragma once
+
+typedef int32 HSteamAPIServerStore;
+
+#define STEAMAPI_SERVERSTORE_INVALID	0
+
+//-----------------------------------------------------------------------------
+// Purpose: Columns the store can sort by, each gets an index maintained on
+//			insert once it's been sorted by.
+//-----------------------------------------------------------------------------
+enum ESteamAPIServerSortKey
+{
+	k_ESteamAPIServerSortPing = 0,
+	k_ESteamAPIServerSortPlayers,
+	k_ESteamAPIServerSortName,
+	k_ESteamAPIServerSortMap,
+
+	k_ESteamAPIServerSortKeyCount
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Predicates of a query, all of them have to hold. Zero fields,
+//			false flags and a map id of -1 don't filter.
+//-----------------------------------------------------------------------------
+struct SteamAPIServerFilter_t
+{
+	int16		m_nMaxPing;
+	int16		m_nMinPlayers;
+	bool		m_bNotFull;
+	bool		m_bNotEmpty;
+	bool		m_bNoPassword;
+	bool		m_bSecureOnly;
+	int16		m_nMapId;				// See SteamAPI_ServerStore_GetMapId()
+	uint64		m_ullRequiredTags;		// See SteamAPI_ServerStore_GetTagBit()
+	uint64		m_ullExcludedTags;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: One server as kept by the store
+//-----------------------------------------------------------------------------
+struct SteamAPIServerRow_t
+{
+	uint32		m_unIP;
+	uint16		m_usConnectionPort;
+	uint16		m_usQueryPort;
+	AppId_t		m_nAppId;
+	int16		m_nPing;
+	int16		m_nPlayers;
+	int16		m_nMaxPlayers;
+	int16		m_nBotPlayers;
+	int16		m_nMapId;
+	bool		m_bPassword;
+	bool		m_bSecure;
+	const char*	m_pchName;				// Valid until the next insert
+	const char*	m_pchMap;
+	const char*	m_pchTags;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Server browser result store API. The item returned by
+//			GetServerDetails() in ServerResponded() is copied once into a
+//			column per field, filters run over the columns with SIMD
+//			and sorted indexes are kept up to date on insert, so the list can
+//			be re-sorted and filtered without going back to steamclient.
+//			Rows are numbered in order of insertion, a server answering again
+//			keeps its row.
+// 
+//			A store has to be used from one thread.
+//-----------------------------------------------------------------------------
+S_API HSteamAPIServerStore SteamAPI_ServerStore_Create();
+S_API void SteamAPI_ServerStore_Destroy(HSteamAPIServerStore hStore);
+S_API void SteamAPI_ServerStore_Clear(HSteamAPIServerStore hStore);
+S_API int SteamAPI_ServerStore_AddServer(HSteamAPIServerStore hStore, const gameserveritem_t *pServer);
+S_API int SteamAPI_ServerStore_GetCount(HSteamAPIServerStore hStore);
+S_API bool SteamAPI_ServerStore_GetRow(HSteamAPIServerStore hStore, int iRow, SteamAPIServerRow_t *pRow);
+S_API int16 SteamAPI_ServerStore_GetMapId(HSteamAPIServerStore hStore, const char *pchMap);
+S_API uint64 SteamAPI_ServerStore_GetTagBit(HSteamAPIServerStore hStore, const char *pchTag);
+S_API int SteamAPI_ServerStore_Query(HSteamAPIServerStore hStore, ESteamAPIServerSortKey eSortKey, bool bDescending, const SteamAPIServerFilter_t *pFilter, int *piRows, int nMaxRows);
+
+#endif
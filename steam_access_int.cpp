@@ -6,6 +6,7 @@
 //=============================================================================
 
 #include "steam_api_pch.h"
+#include "steam_api_interfacetable.h"
 
 //-----------------------------------------------------------------------------
 // Purpose: SteamAPI access interfaces
@@ -40,6 +41,11 @@ ISteamHTTP*					g_pSteamGameServerHTTP;
 HSteamPipe					g_hSteamGameServerPipe;
 HSteamUser					g_hSteamGameServerUser;
 
+//-----------------------------------------------------------------------------
+// Purpose: Table of all of the above handed out to other modules.
+//-----------------------------------------------------------------------------
+static SteamAPIInterfaceTable_t	s_SteamAPIInterfaceTable = { STEAMAPI_INTERFACETABLE_VERSION, sizeof(SteamAPIInterfaceTable_t) };
+
 //-----------------------------------------------------------------------------
 // 
 // SteamAPI access routines
@@ -248,4 +254,65 @@ HSteamPipe SteamGameServer_GetHSteamPipe()
 HSteamUser SteamGameServer_GetHSteamUser()
 {
 	return g_hSteamGameServerUser;
+}
+
+//-----------------------------------------------------------------------------
+// 
+// SteamAPI interface table
+// 
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns the table if requested version is supported.
+//-----------------------------------------------------------------------------
+const SteamAPIInterfaceTable_t* SteamAPI_GetInterfaceTable(uint32 unVersion)
+{
+	if (unVersion == 0 || unVersion > STEAMAPI_INTERFACETABLE_VERSION)
+		return nullptr;
+
+	return &s_SteamAPIInterfaceTable;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Copies current interface pointers into the table. Has to be called
+//			whenever any of the globals above change.
+//-----------------------------------------------------------------------------
+void SteamAPI_RefreshInterfaceTable_Internal()
+{
+	SteamAPIInterfaceTable_t* pTable = &s_SteamAPIInterfaceTable;
+
+	// Odd sequence tells readers that the table is being written
+	InterlockedIncrement(reinterpret_cast<volatile LONG*>(&pTable->m_unSequence));
+
+	pTable->m_unGeneration = g_unSteamAPIGeneration;
+
+	pTable->m_hSteamPipe = g_hSteamPipe;
+	pTable->m_hSteamUser = g_hSteamUser;
+
+	pTable->m_pSteamClient = g_pSteamClient;
+	pTable->m_pSteamUser = g_SteamAPIContext.m_pSteamUser;
+	pTable->m_pSteamFriends = g_SteamAPIContext.m_pSteamFriends;
+	pTable->m_pSteamUtils = g_SteamAPIContext.m_pSteamUtils;
+	pTable->m_pSteamMatchmaking = g_SteamAPIContext.m_pSteamMatchmaking;
+	pTable->m_pSteamUserStats = g_SteamAPIContext.m_pSteamUserStats;
+	pTable->m_pSteamApps = g_SteamAPIContext.m_pSteamApps;
+	pTable->m_pSteamMatchmakingServers = g_SteamAPIContext.m_pSteamMatchmakingServers;
+	pTable->m_pSteamNetworking = g_SteamAPIContext.m_pSteamNetworking;
+	pTable->m_pSteamRemoteStorage = g_SteamAPIContext.m_pSteamRemoteStorage;
+	pTable->m_pSteamScreenshots = g_SteamAPIContext.m_pSteamScreenshots;
+	pTable->m_pSteamHTTP = g_SteamAPIContext.m_pSteamHTTP;
+
+	pTable->m_hSteamGameServerPipe = g_hSteamGameServerPipe;
+	pTable->m_hSteamGameServerUser = g_hSteamGameServerUser;
+
+	pTable->m_pSteamClientGameServer = g_pSteamClientGameServer;
+	pTable->m_pSteamGameServer = g_pSteamGameServer;
+	pTable->m_pSteamGameServerUtils = g_pSteamGameServerUtils;
+	pTable->m_pSteamGameServerApps = g_pSteamGameServerApps;
+	pTable->m_pSteamGameServerNetworking = g_pSteamGameServerNetworking;
+	pTable->m_pSteamGameServerStats = g_pSteamGameServerStats;
+	pTable->m_pSteamGameServerHTTP = g_pSteamGameServerHTTP;
+
+	// Even again, readers may use the table
+	InterlockedIncrement(reinterpret_cast<volatile LONG*>(&pTable->m_unSequence));
 }
\ No newline at end of file
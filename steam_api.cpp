@@ -6,6 +6,16 @@
 //=============================================================================
 
 #include "steam_api_pch.h"
+#include "interfacecache.h"
+#include "apiconfig.h"
+#include "minidump.h"
+#include "asynclog.h"
+#include "personacache.h"
+#include "avatarcache.h"
+#include "lobbycache.h"
+#include "voicepipeline.h"
+#include "authtickets.h"
+#include "screenshotpipeline.h"
 
 //-----------------------------------------------------------------------------
 // 
@@ -34,7 +44,17 @@ bool SteamAPI_Init()
 //-----------------------------------------------------------------------------
 void SteamAPI_Shutdown()
 {
+	uint32	nHits, nMisses;
+
+	// Tell how many interface fetches the cache saved us
+	InterfaceCache_GetStats(&nHits, &nMisses);
+
+	AsyncLog(k_ESteamAPILogInfo, "[S_API] Interface cache: %u lookups served from memory, %u fetched from steamclient.\n", nHits, nMisses);
+
 	g_pSteamUtilsRunFrame = nullptr;
+	VoicePipeline_Shutdown();
+	ScreenshotPipeline_Shutdown();
+	AuthTickets_Shutdown();
 
 	if (g_hSteamPipe && g_hSteamUser)
 		g_pSteamClient->ReleaseUser(g_hSteamPipe, g_hSteamUser);
@@ -43,6 +63,10 @@ void SteamAPI_Shutdown()
 
 	// Set all pointers to NULL
 	g_SteamAPIContext.Clear();
+	PersonaCache_Shutdown();
+	AvatarCache_Shutdown();
+	LobbyCache_Shutdown();
+	InterfaceCache_InvalidatePipe(g_hSteamPipe);
 
 	if (g_hSteamPipe)
 		g_pSteamClient->BReleaseSteamPipe(g_hSteamPipe);
@@ -54,8 +78,71 @@ void SteamAPI_Shutdown()
 
 	g_pSteamClient = nullptr;
 
+	SteamAPI_RefreshInterfaceTable_Internal();
+
 	SteamAPI_Shutdown_Internal(g_hSteamClientModule);
 	g_hSteamClientModule = nullptr;
+
+	AsyncLog_Flush();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Shuts down steam API within a bounded time. Pending call results
+//			get at most unDrainTimeoutMS to complete, the client module stays
+//			loaded and the minidump interface stays usable until process exit.
+//-----------------------------------------------------------------------------
+void SteamAPI_ShutdownFast(uint32 unDrainTimeoutMS, SteamAPIShutdownTimings_t *pTimings)
+{
+	SteamAPIShutdownTimings_t	Timings;
+	uint64						ullStartTime, ullPhaseTime;
+
+	memset(&Timings, 0, sizeof(Timings));
+	ullStartTime = Steam_GetMicroseconds();
+
+	// Drain phase
+	SteamAPI_DrainCallResults_Internal(g_hSteamPipe, false, unDrainTimeoutMS, &Timings);
+
+	// Release phase, there is nothing to log off for the global user
+	ullPhaseTime = Steam_GetMicroseconds();
+
+	g_pSteamUtilsRunFrame = nullptr;
+	VoicePipeline_Shutdown();
+	ScreenshotPipeline_Shutdown();
+	AuthTickets_Shutdown();
+
+	if (g_pSteamClient && g_hSteamPipe && g_hSteamUser)
+		g_pSteamClient->ReleaseUser(g_hSteamPipe, g_hSteamUser);
+
+	g_hSteamUser = 0;
+
+	g_SteamAPIContext.Clear();
+	PersonaCache_Shutdown();
+	AvatarCache_Shutdown();
+	LobbyCache_Shutdown();
+	InterfaceCache_InvalidatePipe(g_hSteamPipe);
+
+	if (g_pSteamClient && g_hSteamPipe)
+		g_pSteamClient->BReleaseSteamPipe(g_hSteamPipe);
+
+	g_hSteamPipe = 0;
+
+	if (g_pSteamClient)
+		g_pSteamClient->BShutdownIfAllPipesClosed();
+
+	g_pSteamClient = nullptr;
+
+	SteamAPI_RefreshInterfaceTable_Internal();
+
+	// Process is about to exit, the loader will take care of the module
+	g_hSteamClientModule = nullptr;
+
+	Timings.m_unReleaseTime = (uint32)(Steam_GetMicroseconds() - ullPhaseTime);
+	Timings.m_unTotalTime = (uint32)(Steam_GetMicroseconds() - ullStartTime);
+
+	SteamAPI_ReportShutdownTimings_Internal("SteamAPI", &Timings);
+
+	if (pTimings)
+		*pTimings = Timings;
 }
 
 //-----------------------------------------------------------------------------
@@ -85,6 +172,10 @@ bool SteamAPI_RestartAppIfNecessary(uint32 unOwnAppID)
 	if (GetSteamAppID("steam_appid.txt") != NULL)
 		return false;
 
+	// Or from the configuration file
+	if (SteamAPIConfig()->m_nAppId != k_uAppIdInvalid)
+		return false;
+
 	*szInstallPath = '\0';
 	memset(szInstallPath + 1, NULL, sizeof(szInstallPath) - 1);
 
@@ -289,10 +380,15 @@ void SteamAPI_RunCallbacks()
 	if (g_hSteamPipe)
 		CallbackMgr_RunCallbacks(g_hSteamPipe, false);
 
-	if (!g_pSteamClient)
+	// Pipe may have been lost while dispatching
+	SteamAPI_CheckPipe_Internal();
+
+	Config_CheckForChanges();
+
+	if (!g_pSteamClient || !g_hSteamPipe)
 		return;
 
-	pSteamUtils = g_pSteamClient->GetISteamUtils(g_hSteamPipe, STEAMUTILS_INTERFACE_VERSION);
+	pSteamUtils = static_cast<ISteamUtils*>(InterfaceCache_FindOrCreate(g_pSteamClient, 0, g_hSteamPipe, STEAMUTILS_INTERFACE_VERSION));
 
 	if (!g_pSteamUtilsRunFrame)
 		g_pSteamUtilsRunFrame = pSteamUtils;
@@ -341,6 +437,33 @@ void SteamAPI_SetTryCatchCallbacks(bool bCatchCallbacks)
 	g_bCatchExceptionsInCallbacks = bCatchCallbacks;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Enables or disables transparent reconnect of the steam pipe.
+//-----------------------------------------------------------------------------
+void SteamAPI_SetReconnectMode(bool bEnabled)
+{
+	g_bSteamAPIReconnectMode = bEnabled;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Forces the steam pipe to be re-established right away, or at the
+//			end of the pump when called from a handler. Returns true if the
+//			pipe and user are connected again.
+//-----------------------------------------------------------------------------
+bool SteamAPI_Reconnect()
+{
+	return SteamAPI_Reconnect_Internal();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns generation of the interface pointers. Changes whenever the
+//			pointers were fetched again, cached copies have to be refreshed.
+//-----------------------------------------------------------------------------
+uint32 SteamAPI_GetInterfaceGeneration()
+{
+	return g_unSteamAPIGeneration;
+}
+
 //-----------------------------------------------------------------------------
 // 
 // SteamAPI breakpad/minidump layer
@@ -359,7 +482,7 @@ void SteamAPI_UseBreakpadCrashHandler(char const *pchVersion, char const *pchDat
 	const char* pszMonths[12] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
 	int			iYear, iMonth, iDay, iHour, iMinute, iSecond;
 
-	printf("Using breakpad crash handler\n");
+	AsyncLog(k_ESteamAPILogInfo, "Using breakpad crash handler\n");
 
 	// Using breakpad API from steamclient.dll
 	s_BreakpadInfo = STEAM_BREAKPAD_STEAMCLIENT;
@@ -372,6 +495,9 @@ void SteamAPI_UseBreakpadCrashHandler(char const *pchVersion, char const *pchDat
 	g_pvBreakpadContext = pvContext;
 	g_pfnBreakpadPreMinidumpCallback = m_pfnPreMinidumpCallback;
 
+	// Reserve crash time memory while the process is still healthy
+	Minidump_Init();
+
 	// Search for match in months
 	for (iMonth = 1; iMonth <= Q_ARRAYSIZE(pszMonths); iMonth++)
 	{
@@ -388,6 +514,11 @@ void SteamAPI_UseBreakpadCrashHandler(char const *pchVersion, char const *pchDat
 
 	sscanf(pchTime, "%02d:%02d:%02d", &iHour, &iMinute, &iSecond);
 	_snprintf(g_szBreakpadTimestamp, sizeof(g_szBreakpadTimestamp), "%04d%02d%02d%02d%02d%02d", iYear, iMonth, iDay, iHour, iMinute, iSecond);
+
+	Minidump_UpdateHeader();
+
+	// Optional out-of-process writer, see minidump_helper configuration key
+	Minidump_StartHelper();
 }
 
 //-----------------------------------------------------------------------------
@@ -399,13 +530,15 @@ void SteamAPI_SetBreakpadAppID(uint32 unAppID)
 	// On change or initially
 	if (g_BreakpadLastAppId != unAppID)
 	{
-		printf("Setting breakpad minidump AppID = %u\n", unAppID);
+		AsyncLog(k_ESteamAPILogInfo, "Setting breakpad minidump AppID = %u\n", unAppID);
 		g_BreakpadLastAppId = unAppID;
+
+		Minidump_UpdateHeader();
 	}
 
 	if (unAppID != NULL && !s_pfnSteamMiniDumpFn && s_BreakpadInfo != STEAM_BREAKPAD_STEAM)
 	{
-		printf("Forcing breakpad minidump interfaces to load\n");
+		AsyncLog(k_ESteamAPILogInfo, "Forcing breakpad minidump interfaces to load\n");
 
 		// Load minidump interface either from steamclient.dll
 		Steam_LoadMinidumpInterface();
@@ -417,26 +550,33 @@ void SteamAPI_SetBreakpadAppID(uint32 unAppID)
 
 //-----------------------------------------------------------------------------
 // Purpose: Tries to call s_pfnSteamMiniDumpFn() routine
+// 
+// Note:	Called from within a crashing process. Breakpad interface is resolved
+//			during init, nothing is loaded nor allocated here. Without the API
+//			initialized there's no breakpad to write the dump with anyway.
+//			With the minidump helper running, it takes a snapshot and writes
+//			the dump from that while the process exits right away.
 //-----------------------------------------------------------------------------
 void SteamAPI_WriteMiniDump(uint32 uStructuredExceptionCode, void* pvExceptionInfo, uint32 uBuildID)
 {
-	// Try to load the interface if we haven't already
-	if (!s_pfnSteamMiniDumpFn)
-		Steam_LoadMinidumpInterface();
+	// Comments recorded so far go into this dump
+	Minidump_FlushComments();
+	Minidump_SetExceptionInfo(pvExceptionInfo);
+
+	// Helper has the snapshot, breakpad isn't needed
+	if (Minidump_HandOffToHelper())
+		Minidump_ExitCrashed(g_pvBreakpadContext);
 
 	if (s_pfnSteamMiniDumpFn)
 		s_pfnSteamMiniDumpFn(uStructuredExceptionCode, pvExceptionInfo, uBuildID);
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: Tries to call s_pfnSteamWriteMiniDumpSetComment()
+// Purpose: Records the comment for the next minidump. Comments are kept in a
+//			ring of recent ones and passed to s_pfnSteamWriteMiniDumpSetComment()
+//			only when the dump is being written.
 //-----------------------------------------------------------------------------
 void SteamAPI_SetMiniDumpComment(const char *pchMsg)
 {
-	// Try to load the interface if we haven't already
-	if (!s_pfnSteamWriteMiniDumpSetComment)
-		Steam_LoadMinidumpInterface();
-
-	if (s_pfnSteamWriteMiniDumpSetComment)
-		s_pfnSteamWriteMiniDumpSetComment(pchMsg);
+	Minidump_AddComment(pchMsg);
 }
\ No newline at end of file
@@ -0,0 +1,137 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: Versioned table of all steam API interface pointers. Meant to be
+//			fetched once and read directly, so that hot code doesn't have to
+//			call into steam_api module for every interface access.
+//
+// $NoKeywords: $
+//=============================================================================
+#ifndef STEAM_API_INTERFACETABLE_H
+#define STEAM_API_INTERFACETABLE_H
+#pragma once
+
+#define STEAMAPI_INTERFACETABLE_VERSION		1
+
+//-----------------------------------------------------------------------------
+// Purpose: The table lives inside steam_api module for the whole lifetime of
+//			the process, the address returned never changes. Its contents are
+//			refreshed in place on init, reconnect and shutdown.
+// 
+//			m_unSequence is odd while the table is being written. Readers that
+//			need a consistent snapshot of several members should copy the table
+//			with SteamAPI_CopyInterfaceTable(). Reading a single pointer is
+//			always safe.
+// 
+//			m_unGeneration matches SteamAPI_GetInterfaceGeneration() and changes
+//			whenever the pointers were fetched again.
+// 
+// Note:	New members can only be appended. Version has to be bumped then.
+//-----------------------------------------------------------------------------
+struct SteamAPIInterfaceTable_t
+{
+	uint32						m_unVersion;
+	uint32						m_cubTable;
+	volatile uint32				m_unSequence;
+	uint32						m_unGeneration;
+
+	// Steam client
+	HSteamPipe					m_hSteamPipe;
+	HSteamUser					m_hSteamUser;
+
+	ISteamClient				*m_pSteamClient;
+	ISteamUser					*m_pSteamUser;
+	ISteamFriends				*m_pSteamFriends;
+	ISteamUtils					*m_pSteamUtils;
+	ISteamMatchmaking			*m_pSteamMatchmaking;
+	ISteamUserStats				*m_pSteamUserStats;
+	ISteamApps					*m_pSteamApps;
+	ISteamMatchmakingServers	*m_pSteamMatchmakingServers;
+	ISteamNetworking			*m_pSteamNetworking;
+	ISteamRemoteStorage			*m_pSteamRemoteStorage;
+	ISteamScreenshots			*m_pSteamScreenshots;
+	ISteamHTTP					*m_pSteamHTTP;
+
+	// Steam game server
+	HSteamPipe					m_hSteamGameServerPipe;
+	HSteamUser					m_hSteamGameServerUser;
+
+	ISteamClient				*m_pSteamClientGameServer;
+	ISteamGameServer			*m_pSteamGameServer;
+	ISteamUtils					*m_pSteamGameServerUtils;
+	ISteamApps					*m_pSteamGameServerApps;
+	ISteamNetworking			*m_pSteamGameServerNetworking;
+	ISteamGameServerStats		*m_pSteamGameServerStats;
+	ISteamHTTP					*m_pSteamGameServerHTTP;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns the table if steam_api supports requested version, NULL
+//			otherwise.
+//-----------------------------------------------------------------------------
+S_API const SteamAPIInterfaceTable_t* SteamAPI_GetInterfaceTable(uint32 unVersion);
+
+//-----------------------------------------------------------------------------
+// 
+// Inline accessor layer
+// 
+//	Fetches the table once per module and reads the pointers directly.
+// 
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns the table this module was compiled against.
+//-----------------------------------------------------------------------------
+inline const SteamAPIInterfaceTable_t* SteamAPIInterfaceTable()
+{
+	static const SteamAPIInterfaceTable_t* s_pTable = SteamAPI_GetInterfaceTable(STEAMAPI_INTERFACETABLE_VERSION);
+	return s_pTable;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Copies consistent snapshot of the table. Returns false if steam_api
+//			doesn't support the version.
+//-----------------------------------------------------------------------------
+inline bool SteamAPI_CopyInterfaceTable(SteamAPIInterfaceTable_t *pCopy)
+{
+	const SteamAPIInterfaceTable_t*	pTable = SteamAPIInterfaceTable();
+	uint32							unSequence;
+
+	if (!pTable)
+		return false;
+
+	do
+	{
+		// Wait for the writer to finish
+		while ((unSequence = pTable->m_unSequence) & 1)
+			YieldProcessor();
+
+		_ReadBarrier();
+		memcpy(pCopy, pTable, sizeof(SteamAPIInterfaceTable_t));
+		_ReadBarrier();
+	}
+	while (pTable->m_unSequence != unSequence);
+
+	return true;
+}
+
+inline uint32 SteamTable_Generation()						{ return SteamAPIInterfaceTable() ? SteamAPIInterfaceTable()->m_unGeneration : 0; }
+
+inline ISteamUser* SteamTable_User()						{ return SteamAPIInterfaceTable() ? SteamAPIInterfaceTable()->m_pSteamUser : NULL; }
+inline ISteamFriends* SteamTable_Friends()					{ return SteamAPIInterfaceTable() ? SteamAPIInterfaceTable()->m_pSteamFriends : NULL; }
+inline ISteamUtils* SteamTable_Utils()						{ return SteamAPIInterfaceTable() ? SteamAPIInterfaceTable()->m_pSteamUtils : NULL; }
+inline ISteamMatchmaking* SteamTable_Matchmaking()			{ return SteamAPIInterfaceTable() ? SteamAPIInterfaceTable()->m_pSteamMatchmaking : NULL; }
+inline ISteamUserStats* SteamTable_UserStats()				{ return SteamAPIInterfaceTable() ? SteamAPIInterfaceTable()->m_pSteamUserStats : NULL; }
+inline ISteamApps* SteamTable_Apps()						{ return SteamAPIInterfaceTable() ? SteamAPIInterfaceTable()->m_pSteamApps : NULL; }
+inline ISteamMatchmakingServers* SteamTable_MatchmakingServers() { return SteamAPIInterfaceTable() ? SteamAPIInterfaceTable()->m_pSteamMatchmakingServers : NULL; }
+inline ISteamNetworking* SteamTable_Networking()			{ return SteamAPIInterfaceTable() ? SteamAPIInterfaceTable()->m_pSteamNetworking : NULL; }
+inline ISteamRemoteStorage* SteamTable_RemoteStorage()		{ return SteamAPIInterfaceTable() ? SteamAPIInterfaceTable()->m_pSteamRemoteStorage : NULL; }
+inline ISteamScreenshots* SteamTable_Screenshots()			{ return SteamAPIInterfaceTable() ? SteamAPIInterfaceTable()->m_pSteamScreenshots : NULL; }
+inline ISteamHTTP* SteamTable_HTTP()						{ return SteamAPIInterfaceTable() ? SteamAPIInterfaceTable()->m_pSteamHTTP : NULL; }
+
+inline ISteamGameServer* SteamTable_GameServer()			{ return SteamAPIInterfaceTable() ? SteamAPIInterfaceTable()->m_pSteamGameServer : NULL; }
+inline ISteamUtils* SteamTable_GameServerUtils()			{ return SteamAPIInterfaceTable() ? SteamAPIInterfaceTable()->m_pSteamGameServerUtils : NULL; }
+inline ISteamNetworking* SteamTable_GameServerNetworking()	{ return SteamAPIInterfaceTable() ? SteamAPIInterfaceTable()->m_pSteamGameServerNetworking : NULL; }
+inline ISteamGameServerStats* SteamTable_GameServerStats()	{ return SteamAPIInterfaceTable() ? SteamAPIInterfaceTable()->m_pSteamGameServerStats : NULL; }
+inline ISteamHTTP* SteamTable_GameServerHTTP()				{ return SteamAPIInterfaceTable() ? SteamAPIInterfaceTable()->m_pSteamGameServerHTTP : NULL; }
+
+#endif
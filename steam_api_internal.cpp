@@ -6,6 +6,16 @@
 //=============================================================================
 
 #include "steam_api_pch.h"
+#include "interfacecache.h"
+#include "apiconfig.h"
+#include "minidump.h"
+#include "asynclog.h"
+#include "personacache.h"
+#include "avatarcache.h"
+#include "lobbycache.h"
+#include "voicepipeline.h"
+#include "authtickets.h"
+#include "screenshotpipeline.h"
 
 //-----------------------------------------------------------------------------
 // 
@@ -30,6 +40,28 @@ CSteamAPIContext	g_SteamAPIContext;
 // We're allowing to catch exceptions inside callback handling code by default
 bool				g_bCatchExceptionsInCallbacks = true;
 
+// When set, lost steam pipe is re-established in place instead of leaving the
+// application without steam until it calls SteamAPI_Shutdown() & SteamAPI_Init().
+bool				g_bSteamAPIReconnectMode = false;
+
+// Bumped each time the pipe and interface pointers are refreshed.
+uint32				g_unSteamAPIGeneration = 0;
+
+// Mode the steamAPI was initialized with, reconnect has to fetch the same set.
+static bool			s_bSteamAPIInitSafe = false;
+
+// Set by the IPC failure listener, handled after callbacks are dispatched.
+static bool			s_bSteamAPIPipeLost = false;
+
+// Don't hammer steamclient with pipe requests while steam is still down.
+static DWORD		s_dwSteamAPINextReconnectTime = 0;
+
+// Reconnect asked for from a handler, done once the pump is over.
+static bool			s_bSteamAPIReconnectPending = false;
+static bool			s_bSteamAPIReconnecting = false;
+
+#define STEAMAPI_RECONNECT_RETRY_INTERVAL	500
+
 //-----------------------------------------------------------------------------
 // Purpose: Module names that the SteamAPI module accesses
 //-----------------------------------------------------------------------------
@@ -103,6 +135,51 @@ HMODULE			g_hSteamGameServerModule;
 // 
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+// Purpose: Listener for IPCFailure_t. steamclient posts this on the pipe that
+//			has lost its connection to the steam process.
+//-----------------------------------------------------------------------------
+static void Steam_OnIPCFailure(HSteamPipe hSteamPipe, int iCallback, void *pvParam, int cubParam)
+{
+	IPCFailure_t* pFailure;
+
+	if (hSteamPipe != g_hSteamPipe || cubParam < (int)sizeof(IPCFailure_t))
+		return;
+
+	pFailure = reinterpret_cast<IPCFailure_t*>(pvParam);
+
+	if (pFailure->m_eFailureType == IPCFailure_t::k_EFailurePipeFail)
+		s_bSteamAPIPipeLost = true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Applies startup settings from the configuration file. Has to be
+//			called before steamclient is loaded.
+//-----------------------------------------------------------------------------
+void SteamAPI_ApplyStartupConfig_Internal()
+{
+	const SteamAPIConfig_t*	pConfig;
+	char					SteamAPPId[12];
+
+	pConfig = SteamAPIConfig();
+
+	// App id from the configuration file takes place of steam_appid.txt, unless
+	// we were launched by steam.
+	if (pConfig->m_nAppId != k_uAppIdInvalid && !GetEnvironmentVariableA("SteamAppId", nullptr, NULL))
+	{
+		snprintf(SteamAPPId, sizeof(SteamAPPId), "%u", pConfig->m_nAppId);
+		SteamAPPId[sizeof(SteamAPPId) - 1] = '\0';
+
+		SetEnvironmentVariableA("SteamAppId", SteamAPPId);
+	}
+
+	if (pConfig->m_bReconnectMode)
+		g_bSteamAPIReconnectMode = true;
+
+	if (!pConfig->m_bCatchExceptionsInCallbacks)
+		g_bCatchExceptionsInCallbacks = false;
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Internal routine for steamAPI initialization. Introduces both safe
 //			and unsafe mode intiialization. This isn't exposed to the user.
@@ -118,6 +195,8 @@ bool SteamAPI_InitInternal(bool safe)
 	if (g_pSteamClient != nullptr)
 		return true;
 
+	SteamAPI_ApplyStartupConfig_Internal();
+
 	// Get steam client interface and module handle to steamclient.dll or steam.dll
 	g_pSteamClient = SteamAPI_Init_Internal(&g_hSteamClientModule, false);
 
@@ -129,6 +208,9 @@ bool SteamAPI_InitInternal(bool safe)
 
 	g_pSteamUtilsRunFrame = nullptr;
 
+	s_bSteamAPIInitSafe = safe;
+	s_bSteamAPIPipeLost = false;
+
 	// These two are essential for us in the future, because without
 	// them we cannot access individual steam client interfaces.
 	if (!g_hSteamPipe || !g_hSteamUser)
@@ -140,7 +222,7 @@ bool SteamAPI_InitInternal(bool safe)
 	// Safe mode
 	if (safe != false)
 	{
-		pSteamUtils = g_pSteamClient->GetISteamUtils(g_hSteamPipe, STEAMUTILS_INTERFACE_VERSION);
+		pSteamUtils = static_cast<ISteamUtils*>(InterfaceCache_FindOrCreate(g_pSteamClient, 0, g_hSteamPipe, STEAMUTILS_INTERFACE_VERSION));
 	}
 	// Unsafe mode
 	else
@@ -162,8 +244,8 @@ bool SteamAPI_InitInternal(bool safe)
 
 	if (!pSteamUtils || !AppID)
 	{
-		OutputDebugStringA("[S_API FAIL] SteamAPI_Init() failed; no appID found.\n"
-						   "Either launch the game from Steam, or put the file steam_appid.txt containing the correct appID in your game folder.\n");
+		AsyncLog(k_ESteamAPILogError, "[S_API FAIL] SteamAPI_Init() failed; no appID found.\n"
+									  "Either launch the game from Steam, or put the file steam_appid.txt containing the correct appID in your game folder.\n");
 
 		SteamAPI_Shutdown();
 		return false;
@@ -181,13 +263,23 @@ bool SteamAPI_InitInternal(bool safe)
 	SteamAPI_SetBreakpadAppID(AppID);
 
 	CallbackMgr_RegisterInterfaceFuncs(g_hSteamClientModule);
+	CallbackMgr_AddObserver(IPCFailure_t::k_iCallback, Steam_OnIPCFailure);
+
+	g_unSteamAPIGeneration++;
+	SteamAPI_RefreshInterfaceTable_Internal();
+
+	PersonaCache_Init();
+	AvatarCache_Init();
+	LobbyCache_Init();
+	AuthTickets_Init();
+	ScreenshotPipeline_Init();
 
 	Steam_LoadMinidumpInterface();
 	Steam_LoadGameOverlayRenderer();
 
 	if (safe != false)
 	{
-		pSteamUser = g_pSteamClient->GetISteamUser(g_hSteamUser, g_hSteamPipe, STEAMUSER_INTERFACE_VERSION);
+		pSteamUser = static_cast<ISteamUser*>(InterfaceCache_FindOrCreate(g_pSteamClient, g_hSteamUser, g_hSteamPipe, STEAMUSER_INTERFACE_VERSION));
 
 		if (pSteamUser)
 			Steam_SetMinidumpSteamID(pSteamUser->GetSteamID().ConvertToUint64());
@@ -215,18 +307,29 @@ bool SteamAPI_InitInternal(bool safe)
 ISteamClient* SteamAPI_Init_Internal(HMODULE* SteamModule, bool TryLocal)
 {
 	char SteamClientPath[MAX_PATH];
-	char DebugBuffer[1024];
 
 	if (!SteamModule)
 		return false;
 
+	*SteamModule = NULL;
 	*g_szSteamClientPath = '\0';
 	*SteamClientPath = '\0';
 
 	memset(SteamClientPath + 1, NULL, sizeof(SteamClientPath) - 1);
 
+	// Configuration file may point us to specific steamclient module
+	if (*SteamAPIConfig()->m_szSteamClientPath)
+	{
+		*SteamModule = Steam_LoadModule(SteamAPIConfig()->m_szSteamClientPath);
+
+		if (!*SteamModule)
+		{
+			AsyncLog(k_ESteamAPILogError, "[S_API FAIL] SteamAPI_Init() failed; Steam_LoadModule failed to load configured: %s\n", SteamAPIConfig()->m_szSteamClientPath);
+		}
+	}
+
 	// Try to get online running instance of steam
-	if (ConfigureSteamClientPath(SteamClientPath, sizeof(SteamClientPath)))
+	if (!*SteamModule && ConfigureSteamClientPath(SteamClientPath, sizeof(SteamClientPath)))
 	{
 		if (SteamAPI_IsSteamRunning())
 		{
@@ -234,14 +337,12 @@ ISteamClient* SteamAPI_Init_Internal(HMODULE* SteamModule, bool TryLocal)
 
 			if (!SteamModule)
 			{
-				snprintf(DebugBuffer, sizeof(DebugBuffer), "[S_API FAIL] SteamAPI_Init() failed; Steam_LoadModule failed to load: %s\n", SteamClientPath);
-				DebugBuffer[sizeof(DebugBuffer) - 1] = '\0';
-				OutputDebugStringA(DebugBuffer);
+				AsyncLog(k_ESteamAPILogError, "[S_API FAIL] SteamAPI_Init() failed; Steam_LoadModule failed to load: %s\n", SteamClientPath);
 			}
 		}
 		else
 		{
-			OutputDebugStringA("[S_API FAIL] SteamAPI_Init() failed; SteamAPI_IsSteamRunning() failed.\n");
+			AsyncLog(k_ESteamAPILogError, "[S_API FAIL] SteamAPI_Init() failed; SteamAPI_IsSteamRunning() failed.\n");
 		}
 	}
 
@@ -253,7 +354,7 @@ ISteamClient* SteamAPI_Init_Internal(HMODULE* SteamModule, bool TryLocal)
 
 		if (!*SteamModule)
 		{
-			OutputDebugStringA("[S_API FAIL] SteamAPI_Init() failed; unable to locate a running instance of Steam, or a local steamclient.dll.\n");
+			AsyncLog(k_ESteamAPILogError, "[S_API FAIL] SteamAPI_Init() failed; unable to locate a running instance of Steam, or a local steamclient.dll.\n");
 			return false;
 		}
 	}
@@ -272,6 +373,243 @@ void SteamAPI_Shutdown_Internal(HMODULE hSteamServerModule)
 	Steam_ShutdownMinidumpInterface();
 }
 
+static bool SteamAPI_ReconnectPipe_Internal();
+
+//-----------------------------------------------------------------------------
+// Purpose: Re-establishes the steam pipe and global user on already loaded
+//			steamclient module and refreshes interface pointers. Callbacks stay
+//			registered. Call results issued on the old pipe can never complete,
+//			so these are failed.
+// 
+// Note:	Returns false if steam isn't back yet, the pipe stays marked as lost
+//			so that we try again later. Called from a handler, the reconnect
+//			is done at the end of the pump and false is returned.
+//-----------------------------------------------------------------------------
+bool SteamAPI_Reconnect_Internal()
+{
+	bool bReconnected;
+
+	if (!g_pSteamClient)
+		return false;
+
+	// Failing call results would run their handlers in the middle of the
+	// dispatch that asked for this
+	if (CallbackMgr_IsDispatching() || s_bSteamAPIReconnecting)
+	{
+		s_bSteamAPIReconnectPending = true;
+		return false;
+	}
+
+	s_bSteamAPIReconnecting = true;
+	s_bSteamAPIReconnectPending = false;
+
+	bReconnected = SteamAPI_ReconnectPipe_Internal();
+
+	s_bSteamAPIReconnecting = false;
+
+	return bReconnected;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Does the work of SteamAPI_Reconnect_Internal(), which makes sure
+//			it isn't run from within a dispatch.
+//-----------------------------------------------------------------------------
+static bool SteamAPI_ReconnectPipe_Internal()
+{
+	DWORD		dwStartTime;
+	HSteamPipe	hOldSteamPipe;
+
+	dwStartTime = GetTickCount();
+	hOldSteamPipe = g_hSteamPipe;
+	s_dwSteamAPINextReconnectTime = dwStartTime + STEAMAPI_RECONNECT_RETRY_INTERVAL;
+
+	VoicePipeline_Suspend();
+	ScreenshotPipeline_Suspend();
+	AuthTickets_Invalidate();
+
+	// Call results are failed below, tell which pipe they're on while it's
+	// still there
+	CallbackMgr_ResolveCallResultPipes();
+
+	// Let go of what steamclient still holds for the dead pipe
+	InterfaceCache_InvalidatePipe(g_hSteamPipe);
+
+	if (g_hSteamPipe && g_hSteamUser)
+		g_pSteamClient->ReleaseUser(g_hSteamPipe, g_hSteamUser);
+
+	if (g_hSteamPipe)
+		g_pSteamClient->BReleaseSteamPipe(g_hSteamPipe);
+
+	g_hSteamPipe = 0;
+	g_hSteamUser = 0;
+
+	g_pSteamUtilsRunFrame = nullptr;
+	g_SteamAPIContext.Clear();
+
+	s_bSteamAPIPipeLost = true;
+
+	// Nobody may use the old pointers from now on
+	SteamAPI_RefreshInterfaceTable_Internal();
+
+	// Nothing is going to complete these anymore
+	CallbackMgr_FailPendingCallResults(hOldSteamPipe);
+
+	g_hSteamPipe = g_pSteamClient->CreateSteamPipe();
+
+	if (!g_hSteamPipe)
+		return false;
+
+	g_hSteamUser = g_pSteamClient->ConnectToGlobalUser(g_hSteamPipe);
+
+	if (!g_hSteamUser)
+	{
+		g_pSteamClient->BReleaseSteamPipe(g_hSteamPipe);
+		g_hSteamPipe = 0;
+		return false;
+	}
+
+	// Safe mode doesn't keep any interfaces around
+	if (s_bSteamAPIInitSafe != true)
+	{
+		if (!g_SteamAPIContext.Init())
+			return false;
+	}
+
+	g_unSteamAPIGeneration++;
+	s_bSteamAPIPipeLost = false;
+	s_dwSteamAPINextReconnectTime = 0;
+
+	SteamAPI_RefreshInterfaceTable_Internal();
+
+	// Changes sent while the pipe was gone are lost, read everything again
+	PersonaCache_Shutdown();
+	PersonaCache_Init();
+	AvatarCache_Reset();
+	LobbyCache_Shutdown();
+	LobbyCache_Init();
+	VoicePipeline_Resume();
+	ScreenshotPipeline_Resume();
+
+	AsyncLog(k_ESteamAPILogInfo, "[S_API] Steam pipe re-established in %u ms (generation %u).\n", GetTickCount() - dwStartTime, g_unSteamAPIGeneration);
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Called after the callbacks were run. Reconnects if the pipe has
+//			been lost and reconnect mode is enabled.
+//-----------------------------------------------------------------------------
+void SteamAPI_CheckPipe_Internal()
+{
+	if (s_bSteamAPIReconnectPending)
+	{
+		SteamAPI_Reconnect_Internal();
+		return;
+	}
+
+	if (!s_bSteamAPIPipeLost || !g_bSteamAPIReconnectMode)
+		return;
+
+	// Still waiting for steam to come back
+	if (s_dwSteamAPINextReconnectTime && (int)(GetTickCount() - s_dwSteamAPINextReconnectTime) < 0)
+		return;
+
+	SteamAPI_Reconnect_Internal();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns monotonic time in microseconds.
+//-----------------------------------------------------------------------------
+uint64 Steam_GetMicroseconds()
+{
+	static LARGE_INTEGER	s_Frequency = { 0 };
+	LARGE_INTEGER			Counter;
+
+	if (!s_Frequency.QuadPart)
+		QueryPerformanceFrequency(&s_Frequency);
+
+	QueryPerformanceCounter(&Counter);
+
+	return (uint64)(Counter.QuadPart / s_Frequency.QuadPart) * 1000000ull +
+		   (uint64)(Counter.QuadPart % s_Frequency.QuadPart) * 1000000ull / s_Frequency.QuadPart;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns the pipe a call was issued on. Only a listen server has 
+//			both pipes open, then the game server pipe is asked whether it 
+//			knows the handle.
+//-----------------------------------------------------------------------------
+HSteamPipe SteamAPI_GetCallPipe_Internal(SteamAPICall_t hAPICall)
+{
+	if (!g_hSteamGameServerPipe || !g_pSteamGameServerUtils)
+		return g_hSteamPipe;
+
+	if (!g_hSteamPipe)
+		return g_hSteamGameServerPipe;
+
+	if (g_pSteamGameServerUtils->GetAPICallFailureReason(hAPICall) != k_ESteamAPICallFailureInvalidHandle)
+		return g_hSteamGameServerPipe;
+
+	return g_hSteamPipe;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Runs callbacks on the pipe until none of its call results are 
+//			pending or the timeout expires. Whatever is left afterwards is failed, so
+//			that no handler waits forever.
+//-----------------------------------------------------------------------------
+void SteamAPI_DrainCallResults_Internal(HSteamPipe hSteamPipe, bool bGameServerCallbacks, uint32 unTimeoutMS, SteamAPIShutdownTimings_t *pTimings)
+{
+	uint64	ullStartTime, ullDeadline;
+	uint32	nPending;
+
+	if (unTimeoutMS == STEAMAPI_SHUTDOWN_DRAIN_DEFAULT)
+		unTimeoutMS = SteamAPIConfig()->m_unShutdownDrainTimeout;
+
+	ullStartTime = Steam_GetMicroseconds();
+	ullDeadline = ullStartTime + (uint64)unTimeoutMS * 1000;
+
+	nPending = CallbackMgr_GetPendingCallResultCount(hSteamPipe);
+	pTimings->m_nCallResultsDrained = nPending;
+
+	while (nPending && hSteamPipe)
+	{
+		CallbackMgr_RunCallbacks(hSteamPipe, bGameServerCallbacks);
+
+		nPending = CallbackMgr_GetPendingCallResultCount(hSteamPipe);
+
+		if (!nPending || Steam_GetMicroseconds() >= ullDeadline)
+			break;
+
+		// Give steamclient time to deliver
+		Sleep(1);
+	}
+
+	pTimings->m_nCallResultsFailed = nPending;
+	pTimings->m_nCallResultsDrained -= min(pTimings->m_nCallResultsDrained, nPending);
+
+	if (nPending)
+		CallbackMgr_FailPendingCallResults(hSteamPipe);
+
+	pTimings->m_unDrainTime = (uint32)(Steam_GetMicroseconds() - ullStartTime);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Logs fast shutdown timings and writes out the log, the process is
+//			about to exit.
+//-----------------------------------------------------------------------------
+void SteamAPI_ReportShutdownTimings_Internal(const char *pszWhich, const SteamAPIShutdownTimings_t *pTimings)
+{
+	AsyncLog(k_ESteamAPILogInfo, "[S_API] %s fast shutdown: drain %u us (%u completed, %u failed), logoff %u us, release %u us, total %u us.\n",
+			 pszWhich, 
+			 pTimings->m_unDrainTime, pTimings->m_nCallResultsDrained, pTimings->m_nCallResultsFailed,
+			 pTimings->m_unLogOffTime, 
+			 pTimings->m_unReleaseTime, 
+			 pTimings->m_unTotalTime);
+
+	AsyncLog_Flush();
+}
+
 //-----------------------------------------------------------------------------
 // 
 // Steam game server internal API
@@ -279,15 +617,17 @@ void SteamAPI_Shutdown_Internal(HMODULE hSteamServerModule)
 //-----------------------------------------------------------------------------
 
 //-----------------------------------------------------------------------------
-// Purpose: Setups connection to the game server. Initialitzes global data
-//			for the game server internal API.
+// Purpose: Does the work of SteamGameServer_Init_Internal(), which publishes
+//			the interfaces however far this got.
 //-----------------------------------------------------------------------------
-bool SteamGameServer_Init_Internal(uint32 unIP, uint16 usSteamPort, uint32 usGamePort, int usQueryPort, EServerMode eServerMode, const char* pchVersionString, bool bSafe)
+static bool SteamGameServer_Connect_Internal(uint32 unIP, uint16 usSteamPort, uint32 usGamePort, int usQueryPort, EServerMode eServerMode, const char* pchVersionString, bool bSafe)
 {
 	uint32	unFlags;
 	AppId_t	nGameAppId;
 
 	g_eGameServerMode = eServerMode;
+
+	SteamAPI_ApplyStartupConfig_Internal();
 	
 	// Locate and setup steam game server module
 	g_pSteamClientGameServer = SteamAPI_Init_Internal(&g_hSteamGameServerModule, true);
@@ -305,25 +645,25 @@ bool SteamGameServer_Init_Internal(uint32 unIP, uint16 usSteamPort, uint32 usGam
 		return false;
 
 	// Create game server object for us
-	g_pSteamGameServer = g_pSteamClientGameServer->GetISteamGameServer(g_hSteamGameServerUser, g_hSteamGameServerPipe, STEAMGAMESERVER_INTERFACE_VERSION);
+	g_pSteamGameServer = static_cast<ISteamGameServer*>(InterfaceCache_FindOrCreate(g_pSteamClientGameServer, g_hSteamGameServerUser, g_hSteamGameServerPipe, STEAMGAMESERVER_INTERFACE_VERSION));
 
 	if (!g_pSteamGameServer)
 		return false;
 
 	// Create game server utility object
-	g_pSteamGameServerUtils = g_pSteamClientGameServer->GetISteamUtils(g_hSteamGameServerPipe, STEAMUTILS_INTERFACE_VERSION);
+	g_pSteamGameServerUtils = static_cast<ISteamUtils*>(InterfaceCache_FindOrCreate(g_pSteamClientGameServer, 0, g_hSteamGameServerPipe, STEAMUTILS_INTERFACE_VERSION));
 
 	if (!g_pSteamGameServerUtils)
 		return false;
 
 	// Create game server app object
-	g_pSteamGameServerApps = g_pSteamClientGameServer->GetISteamApps(g_hSteamGameServerUser, g_hSteamGameServerPipe, STEAMAPPS_INTERFACE_VERSION);
+	g_pSteamGameServerApps = static_cast<ISteamApps*>(InterfaceCache_FindOrCreate(g_pSteamClientGameServer, g_hSteamGameServerUser, g_hSteamGameServerPipe, STEAMAPPS_INTERFACE_VERSION));
 
 	if (!g_pSteamGameServerApps)
 		return false;
 
 	// Create game server HTTP object
-	g_pSteamGameServerHTTP = g_pSteamClientGameServer->GetISteamHTTP(g_hSteamGameServerUser, g_hSteamGameServerPipe, STEAMHTTP_INTERFACE_VERSION);
+	g_pSteamGameServerHTTP = static_cast<ISteamHTTP*>(InterfaceCache_FindOrCreate(g_pSteamClientGameServer, g_hSteamGameServerUser, g_hSteamGameServerPipe, STEAMHTTP_INTERFACE_VERSION));
 
 	if (!g_pSteamGameServerHTTP)
 		return false;
@@ -332,13 +672,13 @@ bool SteamGameServer_Init_Internal(uint32 unIP, uint16 usSteamPort, uint32 usGam
 	if (bSafe != true)
 	{
 		// Create game server networking object
-		g_pSteamGameServerNetworking = g_pSteamClientGameServer->GetISteamNetworking(g_hSteamGameServerUser, g_hSteamGameServerPipe, STEAMNETWORKING_INTERFACE_VERSION);
+		g_pSteamGameServerNetworking = static_cast<ISteamNetworking*>(InterfaceCache_FindOrCreate(g_pSteamClientGameServer, g_hSteamGameServerUser, g_hSteamGameServerPipe, STEAMNETWORKING_INTERFACE_VERSION));
 
 		if (!g_pSteamGameServerNetworking)
 			return false;
 
 		// Create game server stats object
-		g_pSteamGameServerStats = g_pSteamClientGameServer->GetISteamGameServerStats(g_hSteamGameServerUser, g_hSteamGameServerPipe, STEAMGAMESERVERSTATS_INTERFACE_VERSION);
+		g_pSteamGameServerStats = static_cast<ISteamGameServerStats*>(InterfaceCache_FindOrCreate(g_pSteamClientGameServer, g_hSteamGameServerUser, g_hSteamGameServerPipe, STEAMGAMESERVERSTATS_INTERFACE_VERSION));
 
 		if (!g_pSteamGameServerStats)
 			return false;
@@ -375,6 +715,23 @@ bool SteamGameServer_Init_Internal(uint32 unIP, uint16 usSteamPort, uint32 usGam
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Setups connection to the game server. Initialitzes global data
+//			for the game server internal API.
+//-----------------------------------------------------------------------------
+bool SteamGameServer_Init_Internal(uint32 unIP, uint16 usSteamPort, uint32 usGamePort, int usQueryPort, EServerMode eServerMode, const char* pchVersionString, bool bSafe)
+{
+	bool	bInitialized;
+
+	bInitialized = SteamGameServer_Connect_Internal(unIP, usSteamPort, usGamePort, usQueryPort, eServerMode, pchVersionString, bSafe);
+
+	// Failed init changes the globals as well, the table must not keep 
+	// pointers of a previous server
+	SteamAPI_RefreshInterfaceTable_Internal();
+
+	return bInitialized;
+}
+
 //-----------------------------------------------------------------------------
 // 
 // Minidump internal API
@@ -391,6 +748,9 @@ void Steam_LoadMinidumpInterface()
 	pfnSteamMiniDumpInit_t			pfnSteamMiniDumpInit;
 	HMODULE							hSteamModule;
 
+	// Everything the dump writing needs is prepared here, not while crashing
+	Minidump_Init();
+
 	// Try this first for steamclient.dll and if we fail, try steam.dll
 	if (s_BreakpadInfo != STEAM_BREAKPAD_STEAM)
 	{
@@ -400,7 +760,7 @@ void Steam_LoadMinidumpInterface()
 		if (!hSteamModule)
 			return;
 
-		printf("Looking up breakpad interfaces from steamclient\n");
+		AsyncLog(k_ESteamAPILogInfo, "Looking up breakpad interfaces from steamclient\n");
 
 		// Breakpad_SteamWriteMiniDumpUsingExceptionInfoWithBuildId
 		s_pfnSteamMiniDumpFn = reinterpret_cast<pfnSteamMiniDumpFn_t>(GetProcAddress(hSteamModule, "Breakpad_SteamWriteMiniDumpUsingExceptionInfoWithBuildId"));
@@ -419,13 +779,18 @@ void Steam_LoadMinidumpInterface()
 
 		if (pfnSteamClientMiniDumpInit)
 		{
-			printf("Calling BreakpadMiniDumpSystemInit\n");
+			AsyncLog(k_ESteamAPILogInfo, "Calling BreakpadMiniDumpSystemInit\n");
+
+			// Full memory dump is replaced by our filtered one, see minidump.cpp
 			pfnSteamClientMiniDumpInit(g_BreakpadLastAppId,
 									   g_pchBreakpadVersion,
 									   g_szBreakpadTimestamp,
-									   g_bBreakpadFullMemoryDumps,
+									   g_bBreakpadFullMemoryDumps && !Minidump_IsFiltering(),
 									   g_pvBreakpadContext,
-									   g_pfnBreakpadPreMinidumpCallback);
+									   Minidump_PreMinidumpCallback);
+
+			// Filtered dumps and the helper need the exception
+			Minidump_HookExceptionFilter();
 
 			if (g_SteamMinidumpSID)
 				Steam_SetMinidumpSteamID(g_SteamMinidumpSID);
@@ -444,7 +809,7 @@ void Steam_LoadMinidumpInterface()
 		s_pfnSteamMiniDumpFn = reinterpret_cast<pfnSteamMiniDumpFn_t>(GetProcAddress(hSteamModule, "SteamWriteMiniDumpUsingExceptionInfoWithBuildId"));
 
 		// SteamWriteMiniDumpSetComment
-		s_pfnSteamWriteMiniDumpSetComment = reinterpret_cast<pfnSteamWriteMiniDumpSetComment_t>(GetProcAddress(hSteamModule, "SteamWriteMiniDumpUsingExceptionInfoWithBuildId"));
+		s_pfnSteamWriteMiniDumpSetComment = reinterpret_cast<pfnSteamWriteMiniDumpSetComment_t>(GetProcAddress(hSteamModule, "SteamWriteMiniDumpSetComment"));
 
 		s_pfnSteamSetSteamID = nullptr;
 
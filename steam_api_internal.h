@@ -65,6 +65,9 @@ extern HMODULE			g_hSteamGameOverlayRendererModule;
 
 extern bool				g_bCatchExceptionsInCallbacks;
 
+extern bool				g_bSteamAPIReconnectMode;
+extern uint32			g_unSteamAPIGeneration;
+
 //-----------------------------------------------------------------------------
 // Purpose: Module names that the SteamAPI module accesses
 //-----------------------------------------------------------------------------
@@ -188,6 +191,49 @@ S_API ISteamPS3OverlayRender *S_CALLTYPE SteamPS3OverlayRender();
 
 S_API HSteamUser SteamAPI_GetHSteamUser();
 
+//-----------------------------------------------------------------------------
+// Purpose: Pipe reconnect API. When reconnect mode is enabled, loss of the
+//			steam pipe is detected while running callbacks and the pipe and
+//			user are re-established in place, without reloading steamclient.
+//			Registered callbacks are kept, outstanding call results are failed.
+//			The generation is bumped every time interface pointers are refreshed.
+//-----------------------------------------------------------------------------
+S_API void SteamAPI_SetReconnectMode(bool bEnabled);
+S_API bool SteamAPI_Reconnect();
+S_API uint32 SteamAPI_GetInterfaceGeneration();
+
+//-----------------------------------------------------------------------------
+// Purpose: Fast shutdown API. Pending call results are drained for at most
+//			the given time, the rest is failed. Users and pipes are released,
+//			but steamclient module isn't unloaded - these are meant to be
+//			called right before the process exits. Time spent in each phase
+//			is reported in microseconds.
+//-----------------------------------------------------------------------------
+struct SteamAPIShutdownTimings_t
+{
+	uint32	m_unDrainTime;
+	uint32	m_unLogOffTime;
+	uint32	m_unReleaseTime;
+	uint32	m_unTotalTime;
+	uint32	m_nCallResultsDrained;	// Completed by steam while draining
+	uint32	m_nCallResultsFailed;	// Still pending after the deadline
+};
+
+// Drain for the time set by shutdown_drain_ms in steam_api.cfg
+#define STEAMAPI_SHUTDOWN_DRAIN_DEFAULT		0xFFFFFFFF
+
+S_API void SteamAPI_ShutdownFast(uint32 unDrainTimeoutMS, SteamAPIShutdownTimings_t *pTimings);
+S_API void SteamGameServer_ShutdownFast(uint32 unDrainTimeoutMS, SteamAPIShutdownTimings_t *pTimings);
+
+//-----------------------------------------------------------------------------
+// Purpose: Interface cache API. Interfaces are looked up by version string on
+//			given pipe and fetched over IPC only once, no matter which module
+//			or API context asks for them. Cached entries are dropped when the
+//			pipe is released.
+//-----------------------------------------------------------------------------
+S_API void* SteamAPI_FindOrCreateInterface(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion);
+S_API void SteamAPI_GetInterfaceCacheStats(uint32 *pnHits, uint32 *pnMisses);
+
 //-----------------------------------------------------------------------------
 // Purpose: 
 //-----------------------------------------------------------------------------
@@ -234,7 +280,8 @@ inline void CSteamAPIContext::Clear()
 
 //-----------------------------------------------------------------------------
 // Purpose: This function must be inlined so the module using steam_api.dll 
-//			gets the version names they want.
+//			gets the version names they want. Interfaces come from the cache,
+//			so only the first context asking for a version pays for the IPC.
 //-----------------------------------------------------------------------------
 inline bool CSteamAPIContext::Init()
 {
@@ -244,47 +291,47 @@ inline bool CSteamAPIContext::Init()
 	HSteamUser hSteamUser = SteamAPI_GetHSteamUser();
 	HSteamPipe hSteamPipe = SteamAPI_GetHSteamPipe();
 
-	m_pSteamUser = SteamClient()->GetISteamUser(hSteamUser, hSteamPipe, STEAMUSER_INTERFACE_VERSION);
+	m_pSteamUser = static_cast<ISteamUser*>(SteamAPI_FindOrCreateInterface(hSteamUser, hSteamPipe, STEAMUSER_INTERFACE_VERSION));
 	if (!m_pSteamUser)
 		return false;
 
-	m_pSteamFriends = SteamClient()->GetISteamFriends(hSteamUser, hSteamPipe, STEAMFRIENDS_INTERFACE_VERSION);
+	m_pSteamFriends = static_cast<ISteamFriends*>(SteamAPI_FindOrCreateInterface(hSteamUser, hSteamPipe, STEAMFRIENDS_INTERFACE_VERSION));
 	if (!m_pSteamFriends)
 		return false;
 
-	m_pSteamUtils = SteamClient()->GetISteamUtils(hSteamPipe, STEAMUTILS_INTERFACE_VERSION);
+	m_pSteamUtils = static_cast<ISteamUtils*>(SteamAPI_FindOrCreateInterface(0, hSteamPipe, STEAMUTILS_INTERFACE_VERSION));
 	if (!m_pSteamUtils)
 		return false;
 
-	m_pSteamMatchmaking = SteamClient()->GetISteamMatchmaking(hSteamUser, hSteamPipe, STEAMMATCHMAKING_INTERFACE_VERSION);
+	m_pSteamMatchmaking = static_cast<ISteamMatchmaking*>(SteamAPI_FindOrCreateInterface(hSteamUser, hSteamPipe, STEAMMATCHMAKING_INTERFACE_VERSION));
 	if (!m_pSteamMatchmaking)
 		return false;
 
-	m_pSteamMatchmakingServers = SteamClient()->GetISteamMatchmakingServers(hSteamUser, hSteamPipe, STEAMMATCHMAKINGSERVERS_INTERFACE_VERSION);
+	m_pSteamMatchmakingServers = static_cast<ISteamMatchmakingServers*>(SteamAPI_FindOrCreateInterface(hSteamUser, hSteamPipe, STEAMMATCHMAKINGSERVERS_INTERFACE_VERSION));
 	if (!m_pSteamMatchmakingServers)
 		return false;
 
-	m_pSteamUserStats = SteamClient()->GetISteamUserStats(hSteamUser, hSteamPipe, STEAMUSERSTATS_INTERFACE_VERSION);
+	m_pSteamUserStats = static_cast<ISteamUserStats*>(SteamAPI_FindOrCreateInterface(hSteamUser, hSteamPipe, STEAMUSERSTATS_INTERFACE_VERSION));
 	if (!m_pSteamUserStats)
 		return false;
 
-	m_pSteamApps = SteamClient()->GetISteamApps(hSteamUser, hSteamPipe, STEAMAPPS_INTERFACE_VERSION);
+	m_pSteamApps = static_cast<ISteamApps*>(SteamAPI_FindOrCreateInterface(hSteamUser, hSteamPipe, STEAMAPPS_INTERFACE_VERSION));
 	if (!m_pSteamApps)
 		return false;
 
-	m_pSteamNetworking = SteamClient()->GetISteamNetworking(hSteamUser, hSteamPipe, STEAMNETWORKING_INTERFACE_VERSION);
+	m_pSteamNetworking = static_cast<ISteamNetworking*>(SteamAPI_FindOrCreateInterface(hSteamUser, hSteamPipe, STEAMNETWORKING_INTERFACE_VERSION));
 	if (!m_pSteamNetworking)
 		return false;
 
-	m_pSteamRemoteStorage = SteamClient()->GetISteamRemoteStorage(hSteamUser, hSteamPipe, STEAMREMOTESTORAGE_INTERFACE_VERSION);
+	m_pSteamRemoteStorage = static_cast<ISteamRemoteStorage*>(SteamAPI_FindOrCreateInterface(hSteamUser, hSteamPipe, STEAMREMOTESTORAGE_INTERFACE_VERSION));
 	if (!m_pSteamRemoteStorage)
 		return false;
 
-	m_pSteamScreenshots = SteamClient()->GetISteamScreenshots(hSteamUser, hSteamPipe, STEAMSCREENSHOTS_INTERFACE_VERSION);
+	m_pSteamScreenshots = static_cast<ISteamScreenshots*>(SteamAPI_FindOrCreateInterface(hSteamUser, hSteamPipe, STEAMSCREENSHOTS_INTERFACE_VERSION));
 	if (!m_pSteamScreenshots)
 		return false;
 
-	m_pSteamHTTP = SteamClient()->GetISteamHTTP(hSteamUser, hSteamPipe, STEAMHTTP_INTERFACE_VERSION);
+	m_pSteamHTTP = static_cast<ISteamHTTP*>(SteamAPI_FindOrCreateInterface(hSteamUser, hSteamPipe, STEAMHTTP_INTERFACE_VERSION));
 	if (!m_pSteamHTTP)
 		return false;
 
@@ -408,8 +455,16 @@ inline bool CSteamGameServerAPIContext::Init()
 //-----------------------------------------------------------------------------
 
 extern bool SteamAPI_InitInternal(bool safe);
+extern void SteamAPI_ApplyStartupConfig_Internal();
 extern ISteamClient* SteamAPI_Init_Internal(HMODULE* SteamModule, bool TryLocal);
 extern void SteamAPI_Shutdown_Internal(HMODULE hSteamServerModule);
+extern bool SteamAPI_Reconnect_Internal();
+extern void SteamAPI_RefreshInterfaceTable_Internal();
+extern void SteamAPI_CheckPipe_Internal();
+extern uint64 Steam_GetMicroseconds();
+extern HSteamPipe SteamAPI_GetCallPipe_Internal(SteamAPICall_t hAPICall);
+extern void SteamAPI_DrainCallResults_Internal(HSteamPipe hSteamPipe, bool bGameServerCallbacks, uint32 unTimeoutMS, SteamAPIShutdownTimings_t *pTimings);
+extern void SteamAPI_ReportShutdownTimings_Internal(const char *pszWhich, const SteamAPIShutdownTimings_t *pTimings);
 
 //-----------------------------------------------------------------------------
 // 
@@ -6,6 +6,7 @@
 //=============================================================================
 
 #include "steam_api_pch.h"
+#include "interfacecache.h"
 
 //-----------------------------------------------------------------------------
 // 
@@ -35,14 +36,14 @@ bool SteamContentServer_Init(uint32 uContentServerID, uint32 unIP, uint16 usPort
 		return false;
 
 	// Create content server object for us
-	g_pSteamContentServer = reinterpret_cast<ISteamContentServer*>(g_pSteamContentServerClient->GetISteamGenericInterface(
+	g_pSteamContentServer = reinterpret_cast<ISteamContentServer*>(InterfaceCache_FindOrCreate(g_pSteamContentServerClient,
 		g_hSteamContentServerUser, g_hSteamContentServerPipe, STEAMCONTENTSERVER_INTERFACE_VERSION));
 
 	if (!g_pSteamContentServer)
 		return false;
 
 	// Create content server utility object
-	g_pSteamContentServerUtils = g_pSteamContentServerClient->GetISteamUtils(g_hSteamContentServerPipe, STEAMUTILS_INTERFACE_VERSION);
+	g_pSteamContentServerUtils = static_cast<ISteamUtils*>(InterfaceCache_FindOrCreate(g_pSteamContentServerClient, 0, g_hSteamContentServerPipe, STEAMUTILS_INTERFACE_VERSION));
 
 	if (!g_pSteamContentServerUtils)
 		return false;
@@ -72,6 +73,8 @@ void SteamContentServer_Shutdown()
 
 	g_pSteamContentServer = nullptr;
 
+	InterfaceCache_InvalidatePipe(g_hSteamContentServerPipe);
+
 	if (g_hSteamContentServerPipe)
 		g_pSteamContentServerClient->BReleaseSteamPipe(g_hSteamContentServerPipe);
 
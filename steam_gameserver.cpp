@@ -6,6 +6,8 @@
 //=============================================================================
 
 #include "steam_api_pch.h"
+#include "interfacecache.h"
+#include "apiconfig.h"
 
 //-----------------------------------------------------------------------------
 // 
@@ -13,6 +15,24 @@
 // 
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+// Purpose: Forgets every interface of the released pipe before the interface
+//			table is refreshed, so it doesn't publish them again.
+//-----------------------------------------------------------------------------
+static void SteamGameServer_ClearInterfaces()
+{
+	g_pSteamGameServer = nullptr;
+	g_pSteamGameServerUtils = nullptr;
+	g_pSteamGameServerApps = nullptr;
+	g_pSteamGameServerNetworking = nullptr;
+	g_pSteamGameServerStats = nullptr;
+	g_pSteamGameServerHTTP = nullptr;
+
+	g_hSteamGameServerPipe = NULL;
+	g_hSteamGameServerUser = NULL;
+	g_pSteamClientGameServer = nullptr;
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Setups game server API and data in a 'safe' way.
 //-----------------------------------------------------------------------------
@@ -43,17 +63,15 @@ void SteamGameServer_Shutdown()
 	if (g_hSteamGameServerPipe && g_hSteamGameServerUser)
 		g_pSteamClientGameServer->ReleaseUser(g_hSteamGameServerPipe, g_hSteamGameServerUser);
 
-	g_pSteamGameServer = nullptr;
+	InterfaceCache_InvalidatePipe(g_hSteamGameServerPipe);
 
 	if (g_hSteamGameServerPipe)
 		g_pSteamClientGameServer->BReleaseSteamPipe(g_hSteamGameServerPipe);
 
-	g_hSteamGameServerPipe = NULL;
+	g_pSteamClientGameServer->BShutdownIfAllPipesClosed();
 
-	if (g_pSteamClientGameServer)
-		g_pSteamClientGameServer->BShutdownIfAllPipesClosed();
-
-	g_pSteamClientGameServer = nullptr;
+	SteamGameServer_ClearInterfaces();
+	SteamAPI_RefreshInterfaceTable_Internal();
 
 	if (g_hSteamGameServerModule)
 		SteamAPI_Shutdown_Internal(g_hSteamGameServerModule);
@@ -61,6 +79,61 @@ void SteamGameServer_Shutdown()
 	g_hSteamGameServerModule = nullptr;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Shutsdown gameserver API within a bounded time. Pending call results
+//			get at most unDrainTimeoutMS to complete, the server module stays
+//			loaded until process exit.
+//-----------------------------------------------------------------------------
+void SteamGameServer_ShutdownFast(uint32 unDrainTimeoutMS, SteamAPIShutdownTimings_t *pTimings)
+{
+	SteamAPIShutdownTimings_t	Timings;
+	uint64						ullStartTime, ullPhaseTime;
+
+	memset(&Timings, 0, sizeof(Timings));
+	ullStartTime = Steam_GetMicroseconds();
+
+	// Drain phase
+	SteamAPI_DrainCallResults_Internal(g_hSteamGameServerPipe, true, unDrainTimeoutMS, &Timings);
+
+	// Log off phase
+	ullPhaseTime = Steam_GetMicroseconds();
+
+	if (g_pSteamGameServer && g_pSteamGameServer->BLoggedOn())
+		g_pSteamGameServer->LogOff();
+
+	Timings.m_unLogOffTime = (uint32)(Steam_GetMicroseconds() - ullPhaseTime);
+
+	// Release phase
+	ullPhaseTime = Steam_GetMicroseconds();
+
+	if (g_pSteamClientGameServer)
+	{
+		if (g_hSteamGameServerPipe && g_hSteamGameServerUser)
+			g_pSteamClientGameServer->ReleaseUser(g_hSteamGameServerPipe, g_hSteamGameServerUser);
+
+		InterfaceCache_InvalidatePipe(g_hSteamGameServerPipe);
+
+		if (g_hSteamGameServerPipe)
+			g_pSteamClientGameServer->BReleaseSteamPipe(g_hSteamGameServerPipe);
+
+		g_pSteamClientGameServer->BShutdownIfAllPipesClosed();
+	}
+
+	SteamGameServer_ClearInterfaces();
+	SteamAPI_RefreshInterfaceTable_Internal();
+
+	// Process is about to exit, the loader will take care of the module
+	g_hSteamGameServerModule = nullptr;
+
+	Timings.m_unReleaseTime = (uint32)(Steam_GetMicroseconds() - ullPhaseTime);
+	Timings.m_unTotalTime = (uint32)(Steam_GetMicroseconds() - ullStartTime);
+
+	SteamAPI_ReportShutdownTimings_Internal("SteamGameServer", &Timings);
+
+	if (pTimings)
+		*pTimings = Timings;
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Returns false if the server is initialized with no authentication.
 //-----------------------------------------------------------------------------
@@ -115,4 +188,6 @@ void SteamGameServer_RunCallbacks()
 {
 	if (g_hSteamGameServerPipe)
 		Steam_RunCallbacks(g_hSteamGameServerPipe, true);
+
+	Config_CheckForChanges();
 }
@@ -0,0 +1,299 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: Top-like viewer of steam_api live stats. Attaches read-only to
+//			the stats segment of every process on the host that has one.
+//
+//			steamapistat [-i <interval ms>] [-n <iterations>] [-p <pid>]
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include <windows.h>
+#include <tlhelp32.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LIVESTATS_VIEWER
+#include "../livestats.h"
+
+#define STEAMAPISTAT_MAX_PROCESSES		64
+
+//-----------------------------------------------------------------------------
+// Purpose: Attached process and its previous sample, for the rates.
+//-----------------------------------------------------------------------------
+struct StatProcess_t
+{
+	DWORD			m_dwProcessId;
+	char			m_szName[MAX_PATH];
+	HANDLE			m_hMapping;
+	const LiveStats_t*	m_pShared;
+	LiveStats_t		m_Previous;
+	LiveStats_t		m_Current;
+	bool			m_bHavePrevious;
+	bool			m_bSeen;
+};
+
+static StatProcess_t	s_Processes[STEAMAPISTAT_MAX_PROCESSES];
+static int				s_nProcesses = 0;
+
+//-----------------------------------------------------------------------------
+// Purpose: Attaches to segments of new processes, detaches from those gone.
+//-----------------------------------------------------------------------------
+static void Stat_RefreshProcesses(DWORD dwOnlyProcessId)
+{
+	PROCESSENTRY32	Entry;
+	StatProcess_t	*pProcess;
+	HANDLE			hSnapshot, hMapping;
+	char			szName[64];
+	BOOL			bEntry;
+	int				i;
+
+	for (i = 0; i < s_nProcesses; i++)
+		s_Processes[i].m_bSeen = false;
+
+	hSnapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+
+	if (hSnapshot == INVALID_HANDLE_VALUE)
+		return;
+
+	Entry.dwSize = sizeof(Entry);
+
+	for (bEntry = Process32First(hSnapshot, &Entry); bEntry; bEntry = Process32Next(hSnapshot, &Entry))
+	{
+		if (dwOnlyProcessId && Entry.th32ProcessID != dwOnlyProcessId)
+			continue;
+
+		for (i = 0; i < s_nProcesses; i++)
+		{
+			if (s_Processes[i].m_dwProcessId == Entry.th32ProcessID)
+				break;
+		}
+
+		if (i < s_nProcesses)
+		{
+			s_Processes[i].m_bSeen = true;
+			continue;
+		}
+
+		if (s_nProcesses == STEAMAPISTAT_MAX_PROCESSES)
+			continue;
+
+		_snprintf(szName, sizeof(szName), LIVESTATS_MAPPING_NAME, Entry.th32ProcessID);
+		szName[sizeof(szName) - 1] = '\0';
+
+		hMapping = OpenFileMappingA(FILE_MAP_READ, FALSE, szName);
+
+		if (!hMapping)
+			continue;
+
+		pProcess = &s_Processes[s_nProcesses];
+
+		memset(pProcess, 0, sizeof(StatProcess_t));
+		pProcess->m_pShared = reinterpret_cast<const LiveStats_t*>(MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, sizeof(LiveStats_t)));
+
+		if (!pProcess->m_pShared || pProcess->m_pShared->m_unVersion != LIVESTATS_VERSION)
+		{
+			if (pProcess->m_pShared)
+				UnmapViewOfFile(pProcess->m_pShared);
+
+			CloseHandle(hMapping);
+			continue;
+		}
+
+		pProcess->m_dwProcessId = Entry.th32ProcessID;
+		pProcess->m_hMapping = hMapping;
+		pProcess->m_bSeen = true;
+		strncpy(pProcess->m_szName, Entry.szExeFile, sizeof(pProcess->m_szName) - 1);
+
+		s_nProcesses++;
+	}
+
+	CloseHandle(hSnapshot);
+
+	// Forget processes that exited
+	for (i = 0; i < s_nProcesses; )
+	{
+		if (s_Processes[i].m_bSeen)
+		{
+			i++;
+			continue;
+		}
+
+		UnmapViewOfFile(s_Processes[i].m_pShared);
+		CloseHandle(s_Processes[i].m_hMapping);
+
+		s_Processes[i] = s_Processes[--s_nProcesses];
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Rate of the counter per second between two samples.
+//-----------------------------------------------------------------------------
+static double Stat_Rate(ULONG64 ullCurrent, ULONG64 ullPrevious, DWORD dwElapsed)
+{
+	if (!dwElapsed)
+		return 0.0;
+
+	return (double)(ullCurrent - ullPrevious) * 1000.0 / dwElapsed;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Draws one screen.
+//-----------------------------------------------------------------------------
+static void Stat_Render()
+{
+	const StatProcess_t			*pProcess;
+	const LiveStats_t			*pCur, *pPrev;
+	const LiveStatsCallback_t	*pCallback;
+	const LiveStatsLatency_t	*pLatency;
+	HANDLE						hConsole;
+	COORD						Origin = { 0, 0 };
+	bool						bPrinted[LIVESTATS_MAX_CALLBACKS];
+	double						flAverage, flSlowest;
+	DWORD						dwElapsed, nPrinted, j;
+	int							i, iSlowest;
+
+	hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
+	SetConsoleCursorPosition(hConsole, Origin);
+
+	printf("steamapistat - %d process(es)%-40s\n\n", s_nProcesses, "");
+	printf("%-7s %-18s %7s %9s %8s %7s %8s %8s %7s %5s %7s %7s %5s\n", 
+		   "PID", "NAME", "APPID", "MSG/S", "PUMP/S", "CUT/S", "PUMP US", "MAX US", "PEND", "GEN", "IPC/S", "HTTP/S", "IPCF");
+
+	for (i = 0; i < s_nProcesses; i++)
+	{
+		pProcess = &s_Processes[i];
+		pCur = &pProcess->m_Current;
+		pPrev = pProcess->m_bHavePrevious ? &pProcess->m_Previous : pCur;
+
+		dwElapsed = pCur->m_dwUpdateTime - pPrev->m_dwUpdateTime;
+
+		printf("%-7u %-18.18s %7u %9.1f %8.1f %7.1f %8u %8u %7u %5u %7.1f %7.1f %5u\n",
+			   pProcess->m_dwProcessId, pProcess->m_szName, pCur->m_unAppId,
+			   Stat_Rate(pCur->m_ullMessages, pPrev->m_ullMessages, dwElapsed),
+			   Stat_Rate(pCur->m_ullPumps, pPrev->m_ullPumps, dwElapsed),
+			   Stat_Rate(pCur->m_ullPumpCutoffs, pPrev->m_ullPumpCutoffs, dwElapsed),
+			   pCur->m_unLastPumpTime, pCur->m_unMaxPumpTime,
+			   pCur->m_unCallResultsPending, pCur->m_unGeneration,
+			   Stat_Rate(pCur->m_ullIPCGetCallback + pCur->m_ullIPCGetAPICallResult, pPrev->m_ullIPCGetCallback + pPrev->m_ullIPCGetAPICallResult, dwElapsed),
+			   Stat_Rate(pCur->m_ullHTTPCompleted, pPrev->m_ullHTTPCompleted, dwElapsed),
+			   pCur->m_unIPCFailures);
+	}
+
+	// Handler times of every process, slowest average first
+	printf("\n%-7s %8s %10s %10s %10s %10s%-20s\n", "PID", "CALLBACK", "COUNT", "AVG US", "MAX US", "LAST US", "");
+
+	for (i = 0; i < s_nProcesses; i++)
+	{
+		pCur = &s_Processes[i].m_Current;
+		memset(bPrinted, 0, sizeof(bPrinted));
+
+		for (nPrinted = 0; nPrinted < pCur->m_nCallbacks && nPrinted < LIVESTATS_MAX_CALLBACKS; nPrinted++)
+		{
+			iSlowest = -1;
+			flSlowest = -1.0;
+
+			for (j = 0; j < pCur->m_nCallbacks && j < LIVESTATS_MAX_CALLBACKS; j++)
+			{
+				pCallback = &pCur->m_Callbacks[j];
+				flAverage = pCallback->m_unCount ? (double)pCallback->m_ullTotalTime / pCallback->m_unCount : 0.0;
+
+				if (!bPrinted[j] && flAverage > flSlowest)
+				{
+					iSlowest = (int)j;
+					flSlowest = flAverage;
+				}
+			}
+
+			bPrinted[iSlowest] = true;
+
+			printf("%-7u %8d %10u %10.1f %10u %10u\n", s_Processes[i].m_dwProcessId,
+				   pCur->m_Callbacks[iSlowest].m_iCallback, pCur->m_Callbacks[iSlowest].m_unCount, flSlowest,
+				   pCur->m_Callbacks[iSlowest].m_unMaxTime, pCur->m_Callbacks[iSlowest].m_unLastTime);
+		}
+	}
+
+	printf("\n%-7s %8s %10s %10s %10s %10s%-20s\n", "PID", "CALL CB", "COMPLETED", "P50 US", "P99 US", "MAX US", "");
+
+	for (i = 0; i < s_nProcesses; i++)
+	{
+		pCur = &s_Processes[i].m_Current;
+
+		for (j = 0; j < pCur->m_nLatencies && j < LIVESTATS_MAX_LATENCIES; j++)
+		{
+			pLatency = &pCur->m_Latencies[j];
+
+			printf("%-7u %8d %10u %10u %10u %10u\n", s_Processes[i].m_dwProcessId,
+				   pLatency->m_iCallback, pLatency->m_unCount, pLatency->m_unP50, pLatency->m_unP99, pLatency->m_unMax);
+		}
+	}
+
+	printf("\n%-7s %8s %10s %10s %10s %10s %10s %6s\n", "PID", "ENTRIES", "REG KB", "POOL KB", "POOL RES", "TRACE KB", "TOTAL KB", "COMPCT");
+
+	for (i = 0; i < s_nProcesses; i++)
+	{
+		pCur = &s_Processes[i].m_Current;
+
+		printf("%-7u %8u %10.1f %10.1f %10.1f %10.1f %10.1f %6u\n", s_Processes[i].m_dwProcessId, pCur->m_unRegistryEntries,
+			   pCur->m_cubRegistries / 1024.0, pCur->m_cubResultPoolUsed / 1024.0, pCur->m_cubResultPoolReserved / 1024.0,
+			   pCur->m_cubTraceBuffers / 1024.0, pCur->m_cubTotalReserved / 1024.0, pCur->m_unCompactions);
+	}
+
+	// Clear leftovers of a longer previous screen
+	printf("%-79s\n%-79s\n%-79s\n", "", "", "");
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Entry point
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+	StatProcess_t	*pProcess;
+	LiveStats_t		Sample;
+	DWORD			dwInterval, dwOnlyProcessId;
+	int				nIterations, nIteration;
+	int				i;
+
+	dwInterval = 1000;
+	dwOnlyProcessId = 0;
+	nIterations = 0;
+
+	for (i = 1; i + 1 < argc; i += 2)
+	{
+		if (!strcmp(argv[i], "-i"))
+			dwInterval = strtoul(argv[i + 1], nullptr, 0);
+		else if (!strcmp(argv[i], "-n"))
+			nIterations = atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "-p"))
+			dwOnlyProcessId = strtoul(argv[i + 1], nullptr, 0);
+	}
+
+	system("cls");
+
+	for (nIteration = 0; !nIterations || nIteration < nIterations; nIteration++)
+	{
+		Stat_RefreshProcesses(dwOnlyProcessId);
+
+		for (i = 0; i < s_nProcesses; i++)
+		{
+			pProcess = &s_Processes[i];
+
+			if (!LiveStats_Read(pProcess->m_pShared, &Sample))
+				continue;
+
+			// Process hasn't published since the last look
+			if (pProcess->m_bHavePrevious && Sample.m_dwUpdateTime == pProcess->m_Current.m_dwUpdateTime)
+				continue;
+
+			pProcess->m_Previous = pProcess->m_Current;
+			pProcess->m_bHavePrevious = pProcess->m_Current.m_unVersion != 0;
+			pProcess->m_Current = Sample;
+		}
+
+		Stat_Render();
+		Sleep(dwInterval);
+	}
+
+	return 0;
+}
@@ -0,0 +1,757 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: Client library of the steamclient emulator. Built as 
+//			steamclient.dll and loaded by steam_api through the 
+//			steamclient_path configuration key. Implements the exports and
+//			interfaces steam_api uses, every call goes to steamclientemud
+//			over the shared segment.
+//
+//			Interfaces are laid out by hand in the order of the versioned
+//			interfaces they stand for, the SDK headers are not needed.
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include <windows.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "steamclientemu.h"
+
+#define EMU_EXPORT				extern "C" __declspec(dllexport)
+
+typedef LONG					HSteamPipe;
+typedef LONG					HSteamUser;
+typedef ULONG64					SteamAPICall_t;
+typedef DWORD					HTTPRequestHandle;
+
+// Spins before the client sleeps on a reply
+#define EMU_REPLY_SPINS			2000
+
+//-----------------------------------------------------------------------------
+// Purpose: Layouts shared with steam_api, same as in the SDK.
+//-----------------------------------------------------------------------------
+struct EmuCallbackMsg_t
+{
+	HSteamUser		m_hSteamUser;
+	int				m_iCallback;
+	BYTE*			m_pubParam;
+	int				m_cubParam;
+};
+
+struct EmuSteamID_t
+{
+	ULONG64			m_ullSteamID;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Process side state of a pipe. The lock serializes writers of the
+//			request ring and the reply slot. The callback lock is held from
+//			Steam_BGetCallback() till Steam_FreeLastCallback(), as steamclient
+//			does, so several threads may pump the pipe.
+//-----------------------------------------------------------------------------
+struct EmuClientPipe_t
+{
+	SRWLOCK				m_Lock;
+	CRITICAL_SECTION	m_CallbackLock;
+	DWORD				m_dwCallbackOwner;
+	HANDLE			m_hEvent;
+	LONG			m_nSequence;
+	HSteamUser		m_hSteamUser;
+	bool			m_bOpen;
+};
+
+static SteamClientEmuShared_t*	s_pShared = nullptr;
+static HANDLE					s_hDaemonEvent = NULL;
+static EmuClientPipe_t			s_Pipes[STEAMCLIENTEMU_MAX_PIPES];
+static LARGE_INTEGER			s_CounterFrequency;
+static SteamClientEmuStats_t	s_Stats;
+static SRWLOCK					s_StatsLock = SRWLOCK_INIT;
+
+//-----------------------------------------------------------------------------
+// Purpose: Maps the daemon's segment, fails if the daemon isn't running.
+//-----------------------------------------------------------------------------
+static bool EmuClient_Attach()
+{
+	HANDLE hMapping;
+
+	if (s_pShared)
+		return true;
+
+	hMapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, STEAMCLIENTEMU_MAPPING_NAME);
+
+	if (!hMapping)
+		return false;
+
+	s_pShared = reinterpret_cast<SteamClientEmuShared_t*>(MapViewOfFile(hMapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SteamClientEmuShared_t)));
+	CloseHandle(hMapping);
+
+	if (!s_pShared)
+		return false;
+
+	if (s_pShared->m_unMagic != STEAMCLIENTEMU_MAGIC || s_pShared->m_unVersion != STEAMCLIENTEMU_VERSION)
+	{
+		UnmapViewOfFile(s_pShared);
+		s_pShared = nullptr;
+		return false;
+	}
+
+	s_hDaemonEvent = OpenEventA(EVENT_MODIFY_STATE, FALSE, STEAMCLIENTEMU_DAEMON_EVENT);
+	QueryPerformanceFrequency(&s_CounterFrequency);
+
+	for (int i = 0; i < STEAMCLIENTEMU_MAX_PIPES; i++)
+	{
+		InitializeSRWLock(&s_Pipes[i].m_Lock);
+		InitializeCriticalSection(&s_Pipes[i].m_CallbackLock);
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Microseconds since the QPC time.
+//-----------------------------------------------------------------------------
+static DWORD EmuClient_MicrosecondsSince(LONGLONG llTime)
+{
+	LARGE_INTEGER Counter;
+
+	QueryPerformanceCounter(&Counter);
+	return (DWORD)min((Counter.QuadPart - llTime) * 1000000 / s_CounterFrequency.QuadPart, (LONGLONG)0xFFFFFFFF);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns process state of an open pipe.
+//-----------------------------------------------------------------------------
+static EmuClientPipe_t* EmuClient_GetPipe(HSteamPipe hSteamPipe)
+{
+	if (!s_pShared || hSteamPipe <= 0 || hSteamPipe > STEAMCLIENTEMU_MAX_PIPES)
+		return nullptr;
+
+	if (!s_Pipes[hSteamPipe - 1].m_bOpen)
+		return nullptr;
+
+	return &s_Pipes[hSteamPipe - 1];
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Sends request to the daemon. With pReply, blocks till the daemon
+//			answers: spins first, then sleeps on the pipe event.
+//-----------------------------------------------------------------------------
+static bool EmuClient_Request(HSteamPipe hSteamPipe, LONG eType, LONG nArg, ULONG64 ullArg, const void *pvPayload, int cubPayload, EmuMessage_t *pReply)
+{
+	EmuClientPipe_t*	pClientPipe;
+	EmuPipe_t*			pPipe;
+	EmuMessage_t*		pRequest;
+	LARGE_INTEGER		StartTime;
+	LONG				nSequence;
+	DWORD				dwStartTick, unTime;
+	bool				bWoken, bAnswered;
+
+	pClientPipe = EmuClient_GetPipe(hSteamPipe);
+
+	if (!pClientPipe || cubPayload > STEAMCLIENTEMU_MAX_PAYLOAD)
+		return false;
+
+	pPipe = &s_pShared->m_Pipes[hSteamPipe - 1];
+	QueryPerformanceCounter(&StartTime);
+
+	AcquireSRWLockExclusive(&pClientPipe->m_Lock);
+
+	// Daemon is behind, give it time to drain
+	while ((pRequest = EmuRing_BeginWrite(&pPipe->m_Requests)) == nullptr)
+	{
+		if (s_hDaemonEvent)
+			SetEvent(s_hDaemonEvent);
+
+		Sleep(0);
+	}
+
+	nSequence = ++pClientPipe->m_nSequence;
+
+	pRequest->m_eType = eType;
+	pRequest->m_nSequence = nSequence;
+	pRequest->m_nArg = nArg;
+	pRequest->m_cubPayload = cubPayload;
+	pRequest->m_ullArg = ullArg;
+	pRequest->m_llPostTime = StartTime.QuadPart;
+
+	if (cubPayload)
+		memcpy(pRequest->m_Payload, pvPayload, cubPayload);
+
+	EmuRing_EndWrite(&pPipe->m_Requests);
+
+	// Only enter the kernel when the daemon sleeps
+	bWoken = false;
+	MemoryBarrier();
+
+	if (s_pShared->m_nDaemonWaiters && s_hDaemonEvent)
+	{
+		SetEvent(s_hDaemonEvent);
+		bWoken = true;
+	}
+
+	bAnswered = true;
+
+	if (pReply)
+	{
+		for (int i = 0; i < EMU_REPLY_SPINS && pPipe->m_nReplySequence != nSequence; i++)
+			YieldProcessor();
+
+		dwStartTick = GetTickCount();
+
+		while (pPipe->m_nReplySequence != nSequence)
+		{
+			if (GetTickCount() - dwStartTick >= STEAMCLIENTEMU_REPLY_TIMEOUT || !pClientPipe->m_hEvent)
+			{
+				bAnswered = false;
+				break;
+			}
+
+			InterlockedIncrement(&pPipe->m_nReplyWaiters);
+
+			if (pPipe->m_nReplySequence != nSequence)
+				WaitForSingleObject(pClientPipe->m_hEvent, 100);
+
+			InterlockedDecrement(&pPipe->m_nReplyWaiters);
+		}
+
+		_ReadBarrier();
+
+		if (bAnswered)
+			memcpy(pReply, &pPipe->m_Reply, sizeof(EmuMessage_t));
+	}
+
+	ReleaseSRWLockExclusive(&pClientPipe->m_Lock);
+
+	unTime = EmuClient_MicrosecondsSince(StartTime.QuadPart);
+
+	AcquireSRWLockExclusive(&s_StatsLock);
+
+	s_Stats.m_ullRequests++;
+	s_Stats.m_nDaemonWakeups += bWoken;
+
+	if (pReply && bAnswered)
+	{
+		s_Stats.m_ullRoundTrips++;
+		s_Stats.m_ullRoundTripTime += unTime;
+		s_Stats.m_unMaxRoundTripTime = max(s_Stats.m_unMaxRoundTripTime, unTime);
+	}
+
+	ReleaseSRWLockExclusive(&s_StatsLock);
+
+	return bAnswered;
+}
+
+//-----------------------------------------------------------------------------
+// 
+// ISteamUser
+// 
+//-----------------------------------------------------------------------------
+
+class CEmuSteamUser
+{
+public:
+	virtual HSteamUser GetHSteamUser()			{ return m_hSteamUser; }
+	virtual bool BLoggedOn()					{ return true; }
+	virtual EmuSteamID_t GetSteamID()			{ EmuSteamID_t SteamID = { 0x0110000100000000ull + (ULONG64)m_hSteamUser }; return SteamID; }
+
+public:
+	HSteamUser	m_hSteamUser;
+};
+
+//-----------------------------------------------------------------------------
+// 
+// ISteamUtils
+// 
+//-----------------------------------------------------------------------------
+
+class CEmuSteamUtils
+{
+public:
+	virtual DWORD GetSecondsSinceAppActive()								{ return GetTickCount() / 1000; }
+	virtual DWORD GetSecondsSinceComputerActive()							{ return GetTickCount() / 1000; }
+	virtual int GetConnectedUniverse()										{ return 1; }
+	virtual DWORD GetServerRealTime()										{ return (DWORD)time(nullptr); }
+	virtual const char* GetIPCountry()										{ return "US"; }
+	virtual bool GetImageSize(int iImage, DWORD *pnWidth, DWORD *pnHeight)	{ return false; }
+	virtual bool GetImageRGBA(int iImage, BYTE *pubDest, int cubDest)		{ return false; }
+	virtual bool GetCSERIPPort(DWORD *unIP, WORD *usPort)					{ return false; }
+	virtual BYTE GetCurrentBatteryPower()									{ return 255; }
+	virtual DWORD GetAppID()												{ return s_pShared->m_unAppId; }
+	virtual void SetOverlayNotificationPosition(int eNotificationPosition)	{ }
+
+	virtual bool IsAPICallCompleted(SteamAPICall_t hSteamAPICall, bool *pbFailed);
+	virtual int GetAPICallFailureReason(SteamAPICall_t hSteamAPICall)		{ return -1; }
+	virtual bool GetAPICallResult(SteamAPICall_t hSteamAPICall, void *pCallback, int cubCallback, int iCallbackExpected, bool *pbFailed);
+
+	virtual void RunFrame()													{ }
+	virtual DWORD GetIPCCallCount()											{ return (DWORD)s_Stats.m_ullRequests; }
+	virtual void SetWarningMessageHook(void *pFunction)						{ }
+	virtual bool IsOverlayEnabled()											{ return false; }
+	virtual bool BOverlayNeedsPresent()										{ return false; }
+
+public:
+	HSteamPipe	m_hSteamPipe;
+};
+
+//-----------------------------------------------------------------------------
+// 
+// ISteamHTTP
+// 
+//	Bodies are not sent over the segment, the daemon only tells the size.
+//	The data is filled with a pattern here.
+// 
+//-----------------------------------------------------------------------------
+
+class CEmuSteamHTTP
+{
+public:
+	virtual HTTPRequestHandle CreateHTTPRequest(int eHTTPRequestMethod, const char *pchAbsoluteURL);
+	virtual bool SetHTTPRequestContextValue(HTTPRequestHandle hRequest, ULONG64 ulContextValue);
+	virtual bool SetHTTPRequestNetworkActivityTimeout(HTTPRequestHandle hRequest, DWORD unTimeoutSeconds)							{ return true; }
+	virtual bool SetHTTPRequestHeaderValue(HTTPRequestHandle hRequest, const char *pchHeaderName, const char *pchHeaderValue)		{ return true; }
+	virtual bool SetHTTPRequestGetOrPostParameter(HTTPRequestHandle hRequest, const char *pchParamName, const char *pchParamValue)	{ return true; }
+	virtual bool SendHTTPRequest(HTTPRequestHandle hRequest, SteamAPICall_t *pCallHandle);
+	virtual bool DeferHTTPRequest(HTTPRequestHandle hRequest)																		{ return true; }
+	virtual bool PrioritizeHTTPRequest(HTTPRequestHandle hRequest)																	{ return true; }
+	virtual bool GetHTTPResponseHeaderSize(HTTPRequestHandle hRequest, const char *pchHeaderName, DWORD *unResponseHeaderSize)		{ return false; }
+	virtual bool GetHTTPResponseHeaderValue(HTTPRequestHandle hRequest, const char *pchHeaderName, BYTE *pHeaderValueBuffer, DWORD unBufferSize)	{ return false; }
+	virtual bool GetHTTPResponseBodySize(HTTPRequestHandle hRequest, DWORD *unBodySize);
+	virtual bool GetHTTPResponseBodyData(HTTPRequestHandle hRequest, BYTE *pBodyDataBuffer, DWORD unBufferSize);
+	virtual bool ReleaseHTTPRequest(HTTPRequestHandle hRequest);
+	virtual bool GetHTTPDownloadProgressPct(HTTPRequestHandle hRequest, float *pflPercentOut)										{ return false; }
+	virtual bool SetHTTPRequestRawPostBody(HTTPRequestHandle hRequest, const char *pchContentType, BYTE *pubBody, DWORD unBodyLen)	{ return true; }
+
+public:
+	HSteamPipe	m_hSteamPipe;
+
+	// Context values are set before sending, kept until then
+	ULONG64		m_ullContext[1024];
+};
+
+//-----------------------------------------------------------------------------
+// 
+// ISteamClient
+// 
+//-----------------------------------------------------------------------------
+
+class CEmuSteamClient
+{
+public:
+	virtual HSteamPipe CreateSteamPipe();
+	virtual bool BReleaseSteamPipe(HSteamPipe hSteamPipe);
+	virtual HSteamUser ConnectToGlobalUser(HSteamPipe hSteamPipe);
+	virtual HSteamUser CreateLocalUser(HSteamPipe *phSteamPipe, int eAccountType);
+	virtual void ReleaseUser(HSteamPipe hSteamPipe, HSteamUser hUser);
+	virtual void* GetISteamUser(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion);
+	virtual void* GetISteamGameServer(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion)				{ return nullptr; }
+	virtual void SetLocalIPBinding(DWORD unIP, WORD usPort)																{ }
+	virtual void* GetISteamFriends(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion)				{ return nullptr; }
+	virtual void* GetISteamUtils(HSteamPipe hSteamPipe, const char *pchVersion);
+	virtual void* GetISteamMatchmaking(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion)			{ return nullptr; }
+	virtual void* GetISteamMatchmakingServers(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion)		{ return nullptr; }
+	virtual void* GetISteamGenericInterface(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion);
+	virtual void* GetISteamUserStats(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion)				{ return nullptr; }
+	virtual void* GetISteamGameServerStats(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion)		{ return nullptr; }
+	virtual void* GetISteamApps(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion)					{ return nullptr; }
+	virtual void* GetISteamNetworking(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion)				{ return nullptr; }
+	virtual void* GetISteamRemoteStorage(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion)			{ return nullptr; }
+	virtual void* GetISteamScreenshots(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion)			{ return nullptr; }
+	virtual void RunFrame()																								{ }
+	virtual DWORD GetIPCCallCount()																						{ return (DWORD)s_Stats.m_ullRequests; }
+	virtual void SetWarningMessageHook(void *pFunction)																	{ }
+	virtual bool BShutdownIfAllPipesClosed()																			{ return false; }
+	virtual void* GetISteamHTTP(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion);
+};
+
+// Interface objects of each pipe
+static CEmuSteamUser		s_SteamUsers[STEAMCLIENTEMU_MAX_PIPES];
+static CEmuSteamUtils		s_SteamUtils[STEAMCLIENTEMU_MAX_PIPES];
+static CEmuSteamHTTP		s_SteamHTTP[STEAMCLIENTEMU_MAX_PIPES];
+static CEmuSteamClient		s_SteamClient;
+
+//-----------------------------------------------------------------------------
+// Purpose: Claims a free pipe of the segment.
+//-----------------------------------------------------------------------------
+HSteamPipe CEmuSteamClient::CreateSteamPipe()
+{
+	EmuClientPipe_t*	pClientPipe;
+	char				szName[64];
+
+	if (!EmuClient_Attach())
+		return 0;
+
+	for (int i = 0; i < STEAMCLIENTEMU_MAX_PIPES; i++)
+	{
+		if (InterlockedCompareExchange(&s_pShared->m_Pipes[i].m_bInUse, TRUE, FALSE) != FALSE)
+			continue;
+
+		s_pShared->m_Pipes[i].m_dwClientPid = GetCurrentProcessId();
+
+		pClientPipe = &s_Pipes[i];
+		_snprintf(szName, sizeof(szName), STEAMCLIENTEMU_PIPE_EVENT, i + 1);
+
+		pClientPipe->m_hEvent = OpenEventA(SYNCHRONIZE, FALSE, szName);
+		pClientPipe->m_nSequence = s_pShared->m_Pipes[i].m_nReplySequence;
+		pClientPipe->m_hSteamUser = 0;
+		pClientPipe->m_bOpen = true;
+
+		s_SteamUsers[i].m_hSteamUser = 0;
+		s_SteamUtils[i].m_hSteamPipe = i + 1;
+		s_SteamHTTP[i].m_hSteamPipe = i + 1;
+
+		return i + 1;
+	}
+
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Lets the daemon release the pipe, it's unusable right away.
+//-----------------------------------------------------------------------------
+bool CEmuSteamClient::BReleaseSteamPipe(HSteamPipe hSteamPipe)
+{
+	EmuClientPipe_t* pClientPipe = EmuClient_GetPipe(hSteamPipe);
+
+	if (!pClientPipe)
+		return false;
+
+	EmuClient_Request(hSteamPipe, k_EEmuRequestReleasePipe, 0, 0, nullptr, 0, nullptr);
+
+	AcquireSRWLockExclusive(&pClientPipe->m_Lock);
+
+	pClientPipe->m_bOpen = false;
+
+	if (pClientPipe->m_hEvent)
+		CloseHandle(pClientPipe->m_hEvent);
+
+	pClientPipe->m_hEvent = NULL;
+
+	ReleaseSRWLockExclusive(&pClientPipe->m_Lock);
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Users are handed out by the daemon.
+//-----------------------------------------------------------------------------
+HSteamUser CEmuSteamClient::ConnectToGlobalUser(HSteamPipe hSteamPipe)
+{
+	EmuMessage_t Reply;
+
+	if (!EmuClient_Request(hSteamPipe, k_EEmuRequestConnectGlobalUser, 0, 0, nullptr, 0, &Reply))
+		return 0;
+
+	s_Pipes[hSteamPipe - 1].m_hSteamUser = Reply.m_nArg;
+	s_SteamUsers[hSteamPipe - 1].m_hSteamUser = Reply.m_nArg;
+
+	return Reply.m_nArg;
+}
+
+HSteamUser CEmuSteamClient::CreateLocalUser(HSteamPipe *phSteamPipe, int eAccountType)
+{
+	EmuMessage_t Reply;
+
+	if (!*phSteamPipe)
+		*phSteamPipe = CreateSteamPipe();
+
+	if (!EmuClient_Request(*phSteamPipe, k_EEmuRequestCreateLocalUser, eAccountType, 0, nullptr, 0, &Reply))
+		return 0;
+
+	s_Pipes[*phSteamPipe - 1].m_hSteamUser = Reply.m_nArg;
+	s_SteamUsers[*phSteamPipe - 1].m_hSteamUser = Reply.m_nArg;
+
+	return Reply.m_nArg;
+}
+
+void CEmuSteamClient::ReleaseUser(HSteamPipe hSteamPipe, HSteamUser hUser)
+{
+	EmuClient_Request(hSteamPipe, k_EEmuRequestReleaseUser, hUser, 0, nullptr, 0, nullptr);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Interfaces, any version is served by the same object.
+//-----------------------------------------------------------------------------
+void* CEmuSteamClient::GetISteamUser(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion)
+{
+	return EmuClient_GetPipe(hSteamPipe) ? &s_SteamUsers[hSteamPipe - 1] : nullptr;
+}
+
+void* CEmuSteamClient::GetISteamUtils(HSteamPipe hSteamPipe, const char *pchVersion)
+{
+	return EmuClient_GetPipe(hSteamPipe) ? &s_SteamUtils[hSteamPipe - 1] : nullptr;
+}
+
+void* CEmuSteamClient::GetISteamHTTP(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion)
+{
+	return EmuClient_GetPipe(hSteamPipe) ? &s_SteamHTTP[hSteamPipe - 1] : nullptr;
+}
+
+void* CEmuSteamClient::GetISteamGenericInterface(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion)
+{
+	if (!pchVersion)
+		return nullptr;
+
+	if (!strncmp(pchVersion, "SteamUser0", 10))
+		return GetISteamUser(hSteamUser, hSteamPipe, pchVersion);
+
+	if (!strncmp(pchVersion, "SteamUtils0", 11))
+		return GetISteamUtils(hSteamPipe, pchVersion);
+
+	if (!strncmp(pchVersion, "STEAMHTTP_INTERFACE_VERSION", 27))
+		return GetISteamHTTP(hSteamUser, hSteamPipe, pchVersion);
+
+	return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Finds completed result of the pipe. Results are written by the
+//			daemon and freed by the client.
+//-----------------------------------------------------------------------------
+static EmuAPICallResult_t* EmuClient_FindResult(HSteamPipe hSteamPipe, SteamAPICall_t hSteamAPICall)
+{
+	EmuAPICallResult_t* pResult;
+
+	if (!EmuClient_GetPipe(hSteamPipe) || !hSteamAPICall)
+		return nullptr;
+
+	for (int i = 0; i < STEAMCLIENTEMU_MAX_RESULTS; i++)
+	{
+		pResult = &s_pShared->m_Pipes[hSteamPipe - 1].m_Results[i];
+
+		if ((SteamAPICall_t)pResult->m_hAPICall == hSteamAPICall)
+		{
+			_ReadBarrier();
+			return pResult;
+		}
+	}
+
+	return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Copies the result out and frees its slot.
+//-----------------------------------------------------------------------------
+static bool EmuClient_GetAPICallResult(HSteamPipe hSteamPipe, SteamAPICall_t hSteamAPICall, void *pCallback, int cubCallback, int iCallbackExpected, bool *pbFailed)
+{
+	EmuAPICallResult_t* pResult = EmuClient_FindResult(hSteamPipe, hSteamAPICall);
+
+	if (!pResult)
+		return false;
+
+	*pbFailed = pResult->m_bFailed || pResult->m_iCallback != iCallbackExpected;
+
+	if (pResult->m_iCallback == iCallbackExpected)
+		memcpy(pCallback, pResult->m_Result, min(cubCallback, pResult->m_cubResult));
+
+	InterlockedExchange64(&pResult->m_hAPICall, 0);
+	return true;
+}
+
+bool CEmuSteamUtils::IsAPICallCompleted(SteamAPICall_t hSteamAPICall, bool *pbFailed)
+{
+	EmuAPICallResult_t* pResult = EmuClient_FindResult(m_hSteamPipe, hSteamAPICall);
+
+	if (pbFailed)
+		*pbFailed = pResult && pResult->m_bFailed;
+
+	return pResult != nullptr;
+}
+
+bool CEmuSteamUtils::GetAPICallResult(SteamAPICall_t hSteamAPICall, void *pCallback, int cubCallback, int iCallbackExpected, bool *pbFailed)
+{
+	return EmuClient_GetAPICallResult(m_hSteamPipe, hSteamAPICall, pCallback, cubCallback, iCallbackExpected, pbFailed);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: HTTP requests are simulated by the daemon.
+//-----------------------------------------------------------------------------
+HTTPRequestHandle CEmuSteamHTTP::CreateHTTPRequest(int eHTTPRequestMethod, const char *pchAbsoluteURL)
+{
+	EmuMessage_t Reply;
+
+	if (!pchAbsoluteURL || !EmuClient_Request(m_hSteamPipe, k_EEmuRequestHTTPCreate, eHTTPRequestMethod, 0, pchAbsoluteURL, (int)min(strlen(pchAbsoluteURL), (size_t)STEAMCLIENTEMU_MAX_PAYLOAD), &Reply))
+		return 0;
+
+	if (Reply.m_nArg > 0 && Reply.m_nArg <= ARRAYSIZE(m_ullContext))
+		m_ullContext[Reply.m_nArg - 1] = 0;
+
+	return Reply.m_nArg;
+}
+
+bool CEmuSteamHTTP::SetHTTPRequestContextValue(HTTPRequestHandle hRequest, ULONG64 ulContextValue)
+{
+	if (!hRequest || hRequest > ARRAYSIZE(m_ullContext))
+		return false;
+
+	m_ullContext[hRequest - 1] = ulContextValue;
+	return true;
+}
+
+bool CEmuSteamHTTP::SendHTTPRequest(HTTPRequestHandle hRequest, SteamAPICall_t *pCallHandle)
+{
+	EmuMessage_t Reply;
+
+	if (!hRequest || hRequest > ARRAYSIZE(m_ullContext))
+		return false;
+
+	if (!EmuClient_Request(m_hSteamPipe, k_EEmuRequestHTTPSend, hRequest, m_ullContext[hRequest - 1], nullptr, 0, &Reply) || !Reply.m_nArg)
+		return false;
+
+	if (pCallHandle)
+		*pCallHandle = Reply.m_ullArg;
+
+	return true;
+}
+
+bool CEmuSteamHTTP::GetHTTPResponseBodySize(HTTPRequestHandle hRequest, DWORD *unBodySize)
+{
+	EmuMessage_t Reply;
+
+	if (!EmuClient_Request(m_hSteamPipe, k_EEmuRequestHTTPBodySize, hRequest, 0, nullptr, 0, &Reply) || Reply.m_nArg < 0)
+		return false;
+
+	*unBodySize = Reply.m_nArg;
+	return true;
+}
+
+bool CEmuSteamHTTP::GetHTTPResponseBodyData(HTTPRequestHandle hRequest, BYTE *pBodyDataBuffer, DWORD unBufferSize)
+{
+	DWORD cubBody;
+
+	if (!GetHTTPResponseBodySize(hRequest, &cubBody) || unBufferSize < cubBody)
+		return false;
+
+	for (DWORD i = 0; i < cubBody; i++)
+		pBodyDataBuffer[i] = (BYTE)(i * 31 + hRequest);
+
+	return true;
+}
+
+bool CEmuSteamHTTP::ReleaseHTTPRequest(HTTPRequestHandle hRequest)
+{
+	return EmuClient_Request(m_hSteamPipe, k_EEmuRequestHTTPRelease, hRequest, 0, nullptr, 0, nullptr);
+}
+
+//-----------------------------------------------------------------------------
+// 
+// Exports used by steam_api
+// 
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Purpose: Interface factory, only the client interface is created here.
+//-----------------------------------------------------------------------------
+EMU_EXPORT void* CreateInterface(const char *pName, int *pReturnCode)
+{
+	if (pName && !strcmp(pName, "SteamClient012") && EmuClient_Attach())
+	{
+		if (pReturnCode)
+			*pReturnCode = 0;
+
+		return &s_SteamClient;
+	}
+
+	if (pReturnCode)
+		*pReturnCode = 1;
+
+	return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Hands out the next callback of the pipe. The parameter points into
+//			the segment, it stays valid till Steam_FreeLastCallback().
+//-----------------------------------------------------------------------------
+EMU_EXPORT bool Steam_BGetCallback(HSteamPipe hSteamPipe, EmuCallbackMsg_t *pCallbackMsg)
+{
+	EmuClientPipe_t*	pClientPipe;
+	EmuMessage_t*		pMessage;
+	DWORD				unLatency;
+
+	pClientPipe = EmuClient_GetPipe(hSteamPipe);
+
+	if (!pClientPipe)
+		return false;
+
+	EnterCriticalSection(&pClientPipe->m_CallbackLock);
+
+	pMessage = EmuRing_Peek(&s_pShared->m_Pipes[hSteamPipe - 1].m_Callbacks);
+
+	if (!pMessage)
+	{
+		LeaveCriticalSection(&pClientPipe->m_CallbackLock);
+		return false;
+	}
+
+	// Kept till the message is freed
+	pClientPipe->m_dwCallbackOwner = GetCurrentThreadId();
+
+	pCallbackMsg->m_hSteamUser = s_Pipes[hSteamPipe - 1].m_hSteamUser;
+	pCallbackMsg->m_iCallback = pMessage->m_eType;
+	pCallbackMsg->m_pubParam = pMessage->m_Payload;
+	pCallbackMsg->m_cubParam = pMessage->m_cubPayload;
+
+	unLatency = EmuClient_MicrosecondsSince(pMessage->m_llPostTime);
+
+	AcquireSRWLockExclusive(&s_StatsLock);
+
+	s_Stats.m_ullCallbacks++;
+	s_Stats.m_ullCallbackLatency += unLatency;
+	s_Stats.m_unMaxCallbackLatency = max(s_Stats.m_unMaxCallbackLatency, unLatency);
+
+	ReleaseSRWLockExclusive(&s_StatsLock);
+
+	return true;
+}
+
+EMU_EXPORT void Steam_FreeLastCallback(HSteamPipe hSteamPipe)
+{
+	EmuClientPipe_t* pClientPipe;
+
+	pClientPipe = EmuClient_GetPipe(hSteamPipe);
+
+	// Only the thread that got the message frees it
+	if (!pClientPipe || pClientPipe->m_dwCallbackOwner != GetCurrentThreadId())
+		return;
+
+	if (EmuRing_Peek(&s_pShared->m_Pipes[hSteamPipe - 1].m_Callbacks))
+		EmuRing_Pop(&s_pShared->m_Pipes[hSteamPipe - 1].m_Callbacks);
+
+	pClientPipe->m_dwCallbackOwner = 0;
+	LeaveCriticalSection(&pClientPipe->m_CallbackLock);
+}
+
+EMU_EXPORT bool Steam_GetAPICallResult(HSteamPipe hSteamPipe, SteamAPICall_t hSteamAPICall, void *pCallback, int cubCallback, int iCallbackExpected, bool *pbFailed)
+{
+	return EmuClient_GetAPICallResult(hSteamPipe, hSteamAPICall, pCallback, cubCallback, iCallbackExpected, pbFailed);
+}
+
+//-----------------------------------------------------------------------------
+// 
+// Emulator exports, for benchmarks
+// 
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Purpose: Has the daemon post the callback back to the pipe, measures the
+//			full round through the segment and the pump.
+//-----------------------------------------------------------------------------
+EMU_EXPORT bool SteamClientEmu_PostCallback(HSteamPipe hSteamPipe, int iCallback, const void *pvParam, int cubParam)
+{
+	return EmuClient_Request(hSteamPipe, k_EEmuRequestPostCallback, iCallback, 0, pvParam, cubParam, nullptr);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Copies the counters, optionally resets them.
+//-----------------------------------------------------------------------------
+EMU_EXPORT void SteamClientEmu_GetStats(SteamClientEmuStats_t *pStats, bool bReset)
+{
+	AcquireSRWLockExclusive(&s_StatsLock);
+
+	memcpy(pStats, &s_Stats, sizeof(SteamClientEmuStats_t));
+
+	if (bReset)
+		memset(&s_Stats, 0, sizeof(SteamClientEmuStats_t));
+
+	ReleaseSRWLockExclusive(&s_StatsLock);
+}
@@ -0,0 +1,190 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: Memory shared between the steamclient emulator daemon and its 
+//			client library. Included by both sides, so only Windows types 
+//			are used.
+//
+// $NoKeywords: $
+//=============================================================================
+#ifndef STEAMCLIENT_EMU_H
+#define STEAMCLIENT_EMU_H
+#pragma once
+
+#define STEAMCLIENTEMU_VERSION			1
+#define STEAMCLIENTEMU_MAGIC			0x554D4553	// 'SEMU'
+
+//-----------------------------------------------------------------------------
+// Purpose: Object names. Pipe events are formatted with the pipe index.
+//-----------------------------------------------------------------------------
+#define STEAMCLIENTEMU_MAPPING_NAME		"Local\\SteamClientEmu"
+#define STEAMCLIENTEMU_DAEMON_EVENT		"Local\\SteamClientEmuDaemon"
+#define STEAMCLIENTEMU_PIPE_EVENT		"Local\\SteamClientEmuPipe_%u"
+
+//-----------------------------------------------------------------------------
+// Purpose: Limits. Ring sizes have to be powers of two.
+//-----------------------------------------------------------------------------
+#define STEAMCLIENTEMU_MAX_PIPES		64
+#define STEAMCLIENTEMU_RING_SLOTS		256
+#define STEAMCLIENTEMU_MAX_RESULTS		256
+#define STEAMCLIENTEMU_MAX_PAYLOAD		464
+#define STEAMCLIENTEMU_MAX_RESULT		256
+
+// How long a client waits for the daemon to answer a request, in milliseconds
+#define STEAMCLIENTEMU_REPLY_TIMEOUT	5000
+
+// Callback ids the daemon posts, same as in the SDK
+#define STEAMCLIENTEMU_CALLBACK_APICALLCOMPLETED	703
+#define STEAMCLIENTEMU_CALLBACK_HTTPCOMPLETED		2101
+
+//-----------------------------------------------------------------------------
+// Purpose: Requests from the client to the daemon. Those marked with reply
+//			block the caller until the daemon answers.
+//-----------------------------------------------------------------------------
+enum EEmuRequest
+{
+	k_EEmuRequestConnectGlobalUser = 1,	// reply: m_nArg user
+	k_EEmuRequestCreateLocalUser,		// reply: m_nArg user
+	k_EEmuRequestReleaseUser,
+	k_EEmuRequestReleasePipe,
+	k_EEmuRequestHTTPCreate,			// payload: url, reply: m_nArg request
+	k_EEmuRequestHTTPSend,				// m_nArg request, m_ullArg context, reply: m_ullArg api call
+	k_EEmuRequestHTTPBodySize,			// m_nArg request, reply: m_nArg size or -1
+	k_EEmuRequestHTTPRelease,			// m_nArg request
+	k_EEmuRequestPostCallback,			// m_nArg callback, payload: posted back as is
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Ring slot. Callbacks carry the QPC time of posting, so clients can
+//			measure the cross-process latency.
+//-----------------------------------------------------------------------------
+struct EmuMessage_t
+{
+	LONG				m_eType;			// EEmuRequest, or callback id
+	LONG				m_nSequence;		// Request number, echoed in the reply
+	LONG				m_nArg;
+	LONG				m_cubPayload;
+	ULONG64				m_ullArg;
+	LONG64				m_llPostTime;
+	BYTE				m_Payload[STEAMCLIENTEMU_MAX_PAYLOAD];
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Single producer, single consumer ring. Counters only grow. 
+//			Neither side sleeps on the ring itself, the daemon is woken for
+//			requests through its event, see m_nDaemonWaiters, and callbacks
+//			are polled by the client's pump. Client side consumers take the
+//			pipe's callback lock.
+//-----------------------------------------------------------------------------
+struct EmuRing_t
+{
+	volatile LONG		m_unHead;
+	volatile LONG		m_unTail;
+	EmuMessage_t		m_Slots[STEAMCLIENTEMU_RING_SLOTS];
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Completed API call waiting for Steam_GetAPICallResult(), handle
+//			is zero when the slot is free.
+//-----------------------------------------------------------------------------
+struct EmuAPICallResult_t
+{
+	volatile LONG64		m_hAPICall;
+	LONG				m_iCallback;
+	LONG				m_cubResult;
+	LONG				m_bFailed;
+	LONG				m_unPad;
+	BYTE				m_Result[STEAMCLIENTEMU_MAX_RESULT];
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: One steam pipe. Claimed by the client, released by the daemon once
+//			the release request has been processed or the client died.
+//-----------------------------------------------------------------------------
+struct EmuPipe_t
+{
+	volatile LONG		m_bInUse;
+	DWORD				m_dwClientPid;
+
+	// Client sleeps on the pipe event while waiting for the reply
+	volatile LONG		m_nReplySequence;
+	volatile LONG		m_nReplyWaiters;
+	EmuMessage_t		m_Reply;
+
+	EmuRing_t			m_Requests;
+	EmuRing_t			m_Callbacks;
+
+	EmuAPICallResult_t	m_Results[STEAMCLIENTEMU_MAX_RESULTS];
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: The segment, created by the daemon.
+//-----------------------------------------------------------------------------
+struct SteamClientEmuShared_t
+{
+	DWORD				m_unMagic;
+	DWORD				m_unVersion;
+	DWORD				m_dwDaemonPid;
+	DWORD				m_unAppId;
+
+	// Daemon sleeps on its event when every request ring is empty
+	volatile LONG		m_nDaemonWaiters;
+	volatile LONG		m_nNextUser;
+	volatile LONG64		m_hNextAPICall;
+
+	EmuPipe_t			m_Pipes[STEAMCLIENTEMU_MAX_PIPES];
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Counters of the client library, see SteamClientEmu_GetStats().
+//			Times are in microseconds.
+//-----------------------------------------------------------------------------
+struct SteamClientEmuStats_t
+{
+	// Requests written and those the caller waited on
+	ULONG64				m_ullRequests;
+	ULONG64				m_ullRoundTrips;
+	ULONG64				m_ullRoundTripTime;
+	DWORD				m_unMaxRoundTripTime;
+
+	// Times the daemon had to be woken up
+	DWORD				m_nDaemonWakeups;
+
+	// Callbacks handed to Steam_BGetCallback() and the time from posting
+	ULONG64				m_ullCallbacks;
+	ULONG64				m_ullCallbackLatency;
+	DWORD				m_unMaxCallbackLatency;
+	DWORD				m_unPad;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Ring helpers, the caller owns the producing or consuming side.
+//-----------------------------------------------------------------------------
+inline EmuMessage_t* EmuRing_BeginWrite(EmuRing_t *pRing)
+{
+	if (pRing->m_unHead - pRing->m_unTail >= STEAMCLIENTEMU_RING_SLOTS)
+		return nullptr;
+
+	return &pRing->m_Slots[pRing->m_unHead & (STEAMCLIENTEMU_RING_SLOTS - 1)];
+}
+
+inline void EmuRing_EndWrite(EmuRing_t *pRing)
+{
+	_WriteBarrier();
+	InterlockedIncrement(&pRing->m_unHead);
+}
+
+inline EmuMessage_t* EmuRing_Peek(EmuRing_t *pRing)
+{
+	if (pRing->m_unTail == pRing->m_unHead)
+		return nullptr;
+
+	_ReadBarrier();
+	return &pRing->m_Slots[pRing->m_unTail & (STEAMCLIENTEMU_RING_SLOTS - 1)];
+}
+
+inline void EmuRing_Pop(EmuRing_t *pRing)
+{
+	InterlockedIncrement(&pRing->m_unTail);
+}
+
+#endif
@@ -0,0 +1,573 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: Local steamclient emulator daemon. Owns the shared segment, serves
+//			requests of every client process and posts callbacks and API
+//			call results back, so pipe IPC can be measured without Steam.
+//
+//			HTTP requests are simulated, the URL tells the body size and the
+//			time to complete, e.g. http://emu/file?size=65536&ms=40
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "steamclientemu.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: Simulated HTTP request, handle is index + 1.
+//-----------------------------------------------------------------------------
+#define EMU_MAX_HTTP_REQUESTS			1024
+
+struct EmuHTTPRequest_t
+{
+	bool				m_bInUse;
+	bool				m_bSent;
+	bool				m_bCompleted;
+	int					m_iPipe;
+	DWORD				m_cubBody;
+	DWORD				m_unTime;
+	ULONG64				m_ullContext;
+	LONG64				m_hAPICall;
+	LONGLONG			m_llDueTime;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Layouts of the callbacks posted, same as in the SDK.
+//-----------------------------------------------------------------------------
+#pragma pack(push, 8)
+struct EmuAPICallCompleted_t
+{
+	ULONG64				m_hAsyncCall;
+	int					m_iCallback;
+	DWORD				m_cubParam;
+};
+
+struct EmuHTTPRequestCompleted_t
+{
+	DWORD				m_hRequest;
+	ULONG64				m_ulContextValue;
+	bool				m_bRequestSuccessful;
+	int					m_eStatusCode;
+};
+#pragma pack(pop)
+
+static SteamClientEmuShared_t*	s_pShared = nullptr;
+static HANDLE					s_hDaemonEvent = NULL;
+static HANDLE					s_hPipeEvents[STEAMCLIENTEMU_MAX_PIPES];
+
+static EmuHTTPRequest_t			s_HTTPRequests[EMU_MAX_HTTP_REQUESTS];
+static LARGE_INTEGER			s_CounterFrequency;
+
+static volatile bool			s_bQuit = false;
+
+// Results stored while the callback ring was full, their completion is
+// posted once the client has pumped
+static bool						s_bCompletionPending[STEAMCLIENTEMU_MAX_PIPES][STEAMCLIENTEMU_MAX_RESULTS];
+static int						s_nCompletionsPending = 0;
+
+//-----------------------------------------------------------------------------
+// Purpose: Current QPC time.
+//-----------------------------------------------------------------------------
+static LONGLONG Emu_GetCounter()
+{
+	LARGE_INTEGER Counter;
+
+	QueryPerformanceCounter(&Counter);
+	return Counter.QuadPart;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Reads numeric query parameter from the url, e.g. "size=".
+//-----------------------------------------------------------------------------
+static DWORD Emu_GetURLParam(const char *pszURL, const char *pszName, DWORD unDefault)
+{
+	const char*	pszParam;
+	size_t		cchName;
+
+	cchName = strlen(pszName);
+	pszParam = strchr(pszURL, '?');
+
+	while (pszParam)
+	{
+		pszParam++;
+
+		if (!strncmp(pszParam, pszName, cchName) && pszParam[cchName] == '=')
+			return strtoul(pszParam + cchName + 1, nullptr, 10);
+
+		pszParam = strchr(pszParam, '&');
+	}
+
+	return unDefault;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Answers the request the client is blocked on.
+//-----------------------------------------------------------------------------
+static void Emu_Reply(int iPipe, const EmuMessage_t *pRequest, LONG nArg, ULONG64 ullArg)
+{
+	EmuPipe_t* pPipe = &s_pShared->m_Pipes[iPipe];
+
+	pPipe->m_Reply.m_eType = pRequest->m_eType;
+	pPipe->m_Reply.m_nSequence = pRequest->m_nSequence;
+	pPipe->m_Reply.m_nArg = nArg;
+	pPipe->m_Reply.m_ullArg = ullArg;
+	pPipe->m_Reply.m_cubPayload = 0;
+	pPipe->m_Reply.m_llPostTime = Emu_GetCounter();
+
+	_WriteBarrier();
+	InterlockedExchange(&pPipe->m_nReplySequence, pRequest->m_nSequence);
+
+	if (pPipe->m_nReplyWaiters)
+		SetEvent(s_hPipeEvents[iPipe]);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Posts callback to the pipe, dropped when the client doesn't pump.
+//-----------------------------------------------------------------------------
+static bool Emu_PostCallback(int iPipe, int iCallback, const void *pvParam, int cubParam)
+{
+	EmuRing_t*		pRing;
+	EmuMessage_t*	pMessage;
+
+	pRing = &s_pShared->m_Pipes[iPipe].m_Callbacks;
+	pMessage = EmuRing_BeginWrite(pRing);
+
+	if (!pMessage || cubParam > STEAMCLIENTEMU_MAX_PAYLOAD)
+		return false;
+
+	pMessage->m_eType = iCallback;
+	pMessage->m_nSequence = 0;
+	pMessage->m_nArg = 0;
+	pMessage->m_cubPayload = cubParam;
+	pMessage->m_ullArg = 0;
+	memcpy(pMessage->m_Payload, pvParam, cubParam);
+	pMessage->m_llPostTime = Emu_GetCounter();
+
+	EmuRing_EndWrite(pRing);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Posts completion callback of the stored result, returns false if
+//			the callback ring is full.
+//-----------------------------------------------------------------------------
+static bool Emu_PostCompletion(int iPipe, const EmuAPICallResult_t *pResult)
+{
+	EmuAPICallCompleted_t Completed;
+
+	Completed.m_hAsyncCall = pResult->m_hAPICall;
+	Completed.m_iCallback = pResult->m_iCallback;
+	Completed.m_cubParam = pResult->m_cubResult;
+
+	return Emu_PostCallback(iPipe, STEAMCLIENTEMU_CALLBACK_APICALLCOMPLETED, &Completed, sizeof(Completed));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Retries completions that didn't fit into the callback ring. The
+//			client would wait for them forever otherwise.
+//-----------------------------------------------------------------------------
+static void Emu_PostPendingCompletions(int iPipe)
+{
+	for (int i = 0; i < STEAMCLIENTEMU_MAX_RESULTS && s_nCompletionsPending; i++)
+	{
+		if (!s_bCompletionPending[iPipe][i])
+			continue;
+
+		if (!Emu_PostCompletion(iPipe, &s_pShared->m_Pipes[iPipe].m_Results[i]))
+			return;
+
+		s_bCompletionPending[iPipe][i] = false;
+		s_nCompletionsPending--;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Stores the result and lets the client know with a completion
+//			callback, later if the callback ring is full.
+//-----------------------------------------------------------------------------
+static void Emu_CompleteAPICall(int iPipe, LONG64 hAPICall, int iCallback, const void *pvResult, int cubResult, bool bFailed)
+{
+	EmuAPICallResult_t* pResult;
+
+	for (int i = 0; i < STEAMCLIENTEMU_MAX_RESULTS; i++)
+	{
+		pResult = &s_pShared->m_Pipes[iPipe].m_Results[i];
+
+		if (pResult->m_hAPICall)
+			continue;
+
+		pResult->m_iCallback = iCallback;
+		pResult->m_cubResult = cubResult;
+		pResult->m_bFailed = bFailed;
+		memcpy(pResult->m_Result, pvResult, cubResult);
+
+		_WriteBarrier();
+		pResult->m_hAPICall = hAPICall;
+
+		// Older completions go first
+		Emu_PostPendingCompletions(iPipe);
+
+		if (!Emu_PostCompletion(iPipe, pResult))
+		{
+			s_bCompletionPending[iPipe][i] = true;
+			s_nCompletionsPending++;
+		}
+
+		return;
+	}
+
+	fprintf(stderr, "steamclientemud: result table of pipe %d is full, dropping call %lld\n", iPipe + 1, hAPICall);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Frees everything the pipe holds and gives the slot back.
+//-----------------------------------------------------------------------------
+static void Emu_ReleasePipe(int iPipe)
+{
+	EmuPipe_t* pPipe = &s_pShared->m_Pipes[iPipe];
+
+	for (int i = 0; i < EMU_MAX_HTTP_REQUESTS; i++)
+	{
+		if (s_HTTPRequests[i].m_bInUse && s_HTTPRequests[i].m_iPipe == iPipe)
+			s_HTTPRequests[i].m_bInUse = false;
+	}
+
+	for (int i = 0; i < STEAMCLIENTEMU_MAX_RESULTS; i++)
+	{
+		if (s_bCompletionPending[iPipe][i])
+			s_nCompletionsPending--;
+
+		s_bCompletionPending[iPipe][i] = false;
+	}
+
+	memset(pPipe->m_Results, 0, sizeof(pPipe->m_Results));
+	pPipe->m_Requests.m_unHead = pPipe->m_Requests.m_unTail = 0;
+	pPipe->m_Callbacks.m_unHead = pPipe->m_Callbacks.m_unTail = 0;
+	pPipe->m_nReplySequence = 0;
+	pPipe->m_dwClientPid = 0;
+
+	_WriteBarrier();
+	InterlockedExchange(&pPipe->m_bInUse, FALSE);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Looks up the simulated request of the pipe by its handle.
+//-----------------------------------------------------------------------------
+static EmuHTTPRequest_t* Emu_FindHTTPRequest(int iPipe, LONG hRequest)
+{
+	if (hRequest <= 0 || hRequest > EMU_MAX_HTTP_REQUESTS)
+		return nullptr;
+
+	if (!s_HTTPRequests[hRequest - 1].m_bInUse || s_HTTPRequests[hRequest - 1].m_iPipe != iPipe)
+		return nullptr;
+
+	return &s_HTTPRequests[hRequest - 1];
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Handles one request of the pipe. Returns false once the pipe is
+//			released.
+//-----------------------------------------------------------------------------
+static bool Emu_HandleRequest(int iPipe, const EmuMessage_t *pRequest)
+{
+	EmuHTTPRequest_t*	pHTTPRequest;
+	char				szURL[STEAMCLIENTEMU_MAX_PAYLOAD + 1];
+	LONG64				hAPICall;
+
+	switch (pRequest->m_eType)
+	{
+		case k_EEmuRequestConnectGlobalUser:
+			Emu_Reply(iPipe, pRequest, 1, 0);
+			break;
+
+		case k_EEmuRequestCreateLocalUser:
+			Emu_Reply(iPipe, pRequest, InterlockedIncrement(&s_pShared->m_nNextUser), 0);
+			break;
+
+		case k_EEmuRequestReleaseUser:
+			break;
+
+		case k_EEmuRequestReleasePipe:
+			Emu_ReleasePipe(iPipe);
+			return false;
+
+		case k_EEmuRequestHTTPCreate:
+			memcpy(szURL, pRequest->m_Payload, min(pRequest->m_cubPayload, STEAMCLIENTEMU_MAX_PAYLOAD));
+			szURL[min(pRequest->m_cubPayload, STEAMCLIENTEMU_MAX_PAYLOAD)] = '\0';
+
+			for (int i = 0; i < EMU_MAX_HTTP_REQUESTS; i++)
+			{
+				pHTTPRequest = &s_HTTPRequests[i];
+
+				if (pHTTPRequest->m_bInUse)
+					continue;
+
+				memset(pHTTPRequest, 0, sizeof(EmuHTTPRequest_t));
+				pHTTPRequest->m_bInUse = true;
+				pHTTPRequest->m_iPipe = iPipe;
+				pHTTPRequest->m_cubBody = Emu_GetURLParam(szURL, "size", 1024);
+				pHTTPRequest->m_unTime = Emu_GetURLParam(szURL, "ms", 20);
+
+				Emu_Reply(iPipe, pRequest, i + 1, 0);
+				return true;
+			}
+
+			Emu_Reply(iPipe, pRequest, 0, 0);
+			break;
+
+		case k_EEmuRequestHTTPSend:
+			pHTTPRequest = Emu_FindHTTPRequest(iPipe, pRequest->m_nArg);
+
+			if (!pHTTPRequest || pHTTPRequest->m_bSent)
+			{
+				Emu_Reply(iPipe, pRequest, 0, 0);
+				break;
+			}
+
+			hAPICall = InterlockedIncrement64(&s_pShared->m_hNextAPICall);
+
+			pHTTPRequest->m_bSent = true;
+			pHTTPRequest->m_ullContext = pRequest->m_ullArg;
+			pHTTPRequest->m_hAPICall = hAPICall;
+			pHTTPRequest->m_llDueTime = Emu_GetCounter() + pHTTPRequest->m_unTime * s_CounterFrequency.QuadPart / 1000;
+
+			Emu_Reply(iPipe, pRequest, 1, hAPICall);
+			break;
+
+		case k_EEmuRequestHTTPBodySize:
+			pHTTPRequest = Emu_FindHTTPRequest(iPipe, pRequest->m_nArg);
+			Emu_Reply(iPipe, pRequest, pHTTPRequest && pHTTPRequest->m_bCompleted ? (LONG)pHTTPRequest->m_cubBody : -1, 0);
+			break;
+
+		case k_EEmuRequestHTTPRelease:
+			pHTTPRequest = Emu_FindHTTPRequest(iPipe, pRequest->m_nArg);
+
+			if (pHTTPRequest)
+				pHTTPRequest->m_bInUse = false;
+			break;
+
+		case k_EEmuRequestPostCallback:
+			Emu_PostCallback(iPipe, pRequest->m_nArg, pRequest->m_Payload, min(pRequest->m_cubPayload, STEAMCLIENTEMU_MAX_PAYLOAD));
+			break;
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Completes simulated requests that are due, returns milliseconds
+//			till the next one.
+//-----------------------------------------------------------------------------
+static DWORD Emu_RunHTTPRequests()
+{
+	EmuHTTPRequestCompleted_t	Completed;
+	EmuHTTPRequest_t*			pHTTPRequest;
+	LONGLONG					llNow, llNextDue;
+
+	llNow = Emu_GetCounter();
+	llNextDue = MAXLONGLONG;
+
+	for (int i = 0; i < EMU_MAX_HTTP_REQUESTS; i++)
+	{
+		pHTTPRequest = &s_HTTPRequests[i];
+
+		if (!pHTTPRequest->m_bInUse || !pHTTPRequest->m_bSent || pHTTPRequest->m_bCompleted)
+			continue;
+
+		if (pHTTPRequest->m_llDueTime > llNow)
+		{
+			llNextDue = min(llNextDue, pHTTPRequest->m_llDueTime);
+			continue;
+		}
+
+		pHTTPRequest->m_bCompleted = true;
+
+		memset(&Completed, 0, sizeof(Completed));
+		Completed.m_hRequest = i + 1;
+		Completed.m_ulContextValue = pHTTPRequest->m_ullContext;
+		Completed.m_bRequestSuccessful = true;
+		Completed.m_eStatusCode = 200;
+
+		Emu_CompleteAPICall(pHTTPRequest->m_iPipe, pHTTPRequest->m_hAPICall, STEAMCLIENTEMU_CALLBACK_HTTPCOMPLETED, &Completed, sizeof(Completed), false);
+	}
+
+	if (llNextDue == MAXLONGLONG)
+		return 100;
+
+	return (DWORD)((llNextDue - llNow) * 1000 / s_CounterFrequency.QuadPart);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Releases pipes of client processes that exited without doing so.
+//-----------------------------------------------------------------------------
+static void Emu_ReapDeadClients()
+{
+	HANDLE	hProcess;
+	bool	bAlive;
+
+	for (int i = 0; i < STEAMCLIENTEMU_MAX_PIPES; i++)
+	{
+		if (!s_pShared->m_Pipes[i].m_bInUse || !s_pShared->m_Pipes[i].m_dwClientPid)
+			continue;
+
+		hProcess = OpenProcess(SYNCHRONIZE, FALSE, s_pShared->m_Pipes[i].m_dwClientPid);
+		bAlive = hProcess && WaitForSingleObject(hProcess, 0) == WAIT_TIMEOUT;
+
+		if (hProcess)
+			CloseHandle(hProcess);
+
+		if (!bAlive)
+		{
+			printf("steamclientemud: client %u of pipe %d is gone, releasing it\n", s_pShared->m_Pipes[i].m_dwClientPid, i + 1);
+			Emu_ReleasePipe(i);
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Drains request rings of every pipe, returns true if any request
+//			was handled.
+//-----------------------------------------------------------------------------
+static bool Emu_RunPipes()
+{
+	EmuMessage_t*	pRequest;
+	EmuPipe_t*		pPipe;
+	bool			bWork;
+
+	bWork = false;
+
+	for (int i = 0; i < STEAMCLIENTEMU_MAX_PIPES; i++)
+	{
+		pPipe = &s_pShared->m_Pipes[i];
+
+		if (!pPipe->m_bInUse)
+			continue;
+
+		Emu_PostPendingCompletions(i);
+
+		while ((pRequest = EmuRing_Peek(&pPipe->m_Requests)) != nullptr)
+		{
+			bWork = true;
+
+			if (!Emu_HandleRequest(i, pRequest))
+				break;
+
+			EmuRing_Pop(&pPipe->m_Requests);
+		}
+	}
+
+	return bWork;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Whenever any request ring has something in it.
+//-----------------------------------------------------------------------------
+static bool Emu_HaveRequests()
+{
+	for (int i = 0; i < STEAMCLIENTEMU_MAX_PIPES; i++)
+	{
+		if (s_pShared->m_Pipes[i].m_bInUse && s_pShared->m_Pipes[i].m_Requests.m_unHead != s_pShared->m_Pipes[i].m_Requests.m_unTail)
+			return true;
+	}
+
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Stops the loop on Ctrl+C.
+//-----------------------------------------------------------------------------
+static BOOL WINAPI Emu_ConsoleHandler(DWORD dwCtrlType)
+{
+	s_bQuit = true;
+	SetEvent(s_hDaemonEvent);
+	return TRUE;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Entry point
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+	HANDLE	hMapping;
+	char	szName[64];
+	DWORD	dwNextReap, dwTimeout;
+	bool	bWork;
+
+	hMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(SteamClientEmuShared_t), STEAMCLIENTEMU_MAPPING_NAME);
+
+	if (!hMapping || GetLastError() == ERROR_ALREADY_EXISTS)
+	{
+		fprintf(stderr, "steamclientemud: another instance is already running\n");
+		return 1;
+	}
+
+	s_pShared = reinterpret_cast<SteamClientEmuShared_t*>(MapViewOfFile(hMapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SteamClientEmuShared_t)));
+	s_hDaemonEvent = CreateEventA(NULL, FALSE, FALSE, STEAMCLIENTEMU_DAEMON_EVENT);
+
+	if (!s_pShared || !s_hDaemonEvent)
+	{
+		fprintf(stderr, "steamclientemud: failed to create shared objects (%u)\n", GetLastError());
+		return 1;
+	}
+
+	for (int i = 0; i < STEAMCLIENTEMU_MAX_PIPES; i++)
+	{
+		_snprintf(szName, sizeof(szName), STEAMCLIENTEMU_PIPE_EVENT, i + 1);
+		s_hPipeEvents[i] = CreateEventA(NULL, FALSE, FALSE, szName);
+	}
+
+	QueryPerformanceFrequency(&s_CounterFrequency);
+
+	s_pShared->m_unVersion = STEAMCLIENTEMU_VERSION;
+	s_pShared->m_dwDaemonPid = GetCurrentProcessId();
+	s_pShared->m_unAppId = argc > 1 ? strtoul(argv[1], nullptr, 10) : 480;
+	s_pShared->m_nNextUser = 1;
+	s_pShared->m_hNextAPICall = 0;
+
+	// Clients check the magic last
+	_WriteBarrier();
+	s_pShared->m_unMagic = STEAMCLIENTEMU_MAGIC;
+
+	SetConsoleCtrlHandler(Emu_ConsoleHandler, TRUE);
+	printf("steamclientemud: serving appid %u, Ctrl+C to quit\n", s_pShared->m_unAppId);
+
+	dwNextReap = GetTickCount() + 1000;
+
+	while (!s_bQuit)
+	{
+		bWork = Emu_RunPipes();
+		dwTimeout = Emu_RunHTTPRequests();
+
+		if ((LONG)(GetTickCount() - dwNextReap) >= 0)
+		{
+			Emu_ReapDeadClients();
+			dwNextReap = GetTickCount() + 1000;
+		}
+
+		if (bWork)
+			continue;
+
+		// Come back soon for completions the clients have no room for yet
+		if (s_nCompletionsPending)
+			dwTimeout = min(dwTimeout, (DWORD)1);
+
+		// Announce that we are going to sleep, then look once more, so a
+		// request written in between isn't missed
+		InterlockedIncrement(&s_pShared->m_nDaemonWaiters);
+
+		if (!Emu_HaveRequests())
+			WaitForSingleObject(s_hDaemonEvent, min(dwTimeout, (DWORD)1000));
+
+		InterlockedDecrement(&s_pShared->m_nDaemonWaiters);
+	}
+
+	s_pShared->m_unMagic = 0;
+
+	UnmapViewOfFile(s_pShared);
+	CloseHandle(hMapping);
+
+	return 0;
+}
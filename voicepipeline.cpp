@@ -0,0 +1,960 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "steam_api_pch.h"
+#include <emmintrin.h>
+#include "voicepipeline.h"
+#include "interfacecache.h"
+#include "asynclog.h"
+
+//-----------------------------------------------------------------------------
+// 
+// Voice pipeline
+// 
+//	Capture polling and decompression are IPC calls to steamclient, with a
+//	full server talking they take a good part of the frame. The worker does
+//	them instead. Packets travel in single producer, single consumer rings
+//	of fixed slots, allocated along with every other buffer when the
+//	pipeline starts, so nothing is allocated while voice flows.
+// 
+//	Each speaker has a ring of samples at the output rate. Mixing takes
+//	what the speakers have, up to the output latency, and publishes it to
+//	the ring the audio thread reads from.
+// 
+//-----------------------------------------------------------------------------
+
+// Worker wakes up this often
+#define VOICE_TICK_MS				5
+
+// Mixed samples kept ahead of the audio thread
+#define VOICE_OUTPUT_LATENCY_MS		60
+
+#define VOICE_MAX_SPEAKERS			64
+#define VOICE_SPEAKER_TIMEOUT_MS	1000
+
+// Packet rings, slot counts have to be powers of two. Steam recommends
+// 8 KB for GetVoice(), received packets are much smaller.
+#define VOICE_CAPTURE_SLOTS			32
+#define VOICE_CAPTURE_PACKET_SIZE	8192
+#define VOICE_INCOMING_SLOTS		128
+#define VOICE_INCOMING_PACKET_SIZE	2048
+
+// Sample rings, powers of two as well
+#define VOICE_SPEAKER_RING_SIZE		16384
+#define VOICE_OUTPUT_RING_SIZE		16384
+
+// Decompressed samples of one packet, they are resampled in blocks
+#define VOICE_DECODE_MAX_SAMPLES	16384
+#define VOICE_RESAMPLE_BLOCK		1024
+
+// Output may be at most this many times the decode rate, so a resampled
+// block always fits
+#define VOICE_MAX_RATE_RATIO		7
+#define VOICE_RESAMPLE_MAX_OUTPUT	(VOICE_RESAMPLE_BLOCK * VOICE_MAX_RATE_RATIO + 8)
+
+// Largest mix done at once
+#define VOICE_MIX_BLOCK				4096
+
+//-----------------------------------------------------------------------------
+// Purpose: Ring of fixed size packet slots, one thread pushes, one pops.
+//-----------------------------------------------------------------------------
+struct VoicePacketRing_t
+{
+	volatile uint32		m_unHead;
+	volatile uint32		m_unTail;
+	uint32				m_nSlots;
+	uint32				m_cubSlotData;
+	uint8*				m_pubSlots;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Header of a slot, data follows
+//-----------------------------------------------------------------------------
+struct VoicePacket_t
+{
+	uint64				m_ulSteamID;
+	uint32				m_cubData;
+	uint32				m_unPad;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Speaker state, only the worker touches it
+//-----------------------------------------------------------------------------
+struct VoiceSpeaker_t
+{
+	uint64				m_ulSteamID;
+	DWORD				m_dwLastHeard;
+
+	// Resampled samples waiting to be mixed
+	int16*				m_psRing;
+	uint32				m_unHead;
+	uint32				m_unTail;
+
+	// Resampler position between packets, past the last input sample
+	float				m_flPhase;
+	int16				m_sLastSample;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns slot for the producer to fill, null if the ring is full.
+//-----------------------------------------------------------------------------
+static VoicePacket_t* VoiceRing_BeginPush(VoicePacketRing_t *pRing)
+{
+	uint32 unHead;
+
+	unHead = pRing->m_unHead;
+
+	if (unHead - pRing->m_unTail >= pRing->m_nSlots)
+		return nullptr;
+
+	return (VoicePacket_t*)(pRing->m_pubSlots + (unHead & (pRing->m_nSlots - 1)) * (sizeof(VoicePacket_t) + pRing->m_cubSlotData));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Publishes the slot filled by the producer
+//-----------------------------------------------------------------------------
+static void VoiceRing_EndPush(VoicePacketRing_t *pRing)
+{
+	MemoryBarrier();
+	pRing->m_unHead = pRing->m_unHead + 1;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns oldest slot for the consumer, null if the ring is empty.
+//-----------------------------------------------------------------------------
+static VoicePacket_t* VoiceRing_BeginPop(VoicePacketRing_t *pRing)
+{
+	uint32 unTail;
+
+	unTail = pRing->m_unTail;
+
+	if (unTail == pRing->m_unHead)
+		return nullptr;
+
+	MemoryBarrier();
+
+	return (VoicePacket_t*)(pRing->m_pubSlots + (unTail & (pRing->m_nSlots - 1)) * (sizeof(VoicePacket_t) + pRing->m_cubSlotData));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Gives the slot back to the producer
+//-----------------------------------------------------------------------------
+static void VoiceRing_EndPop(VoicePacketRing_t *pRing)
+{
+	MemoryBarrier();
+	pRing->m_unTail = pRing->m_unTail + 1;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Linear resampler. Input is preceded by the last sample of the
+//			previous packet at psIn[-1], so the first output interpolates
+//			across the packet boundary. Four outputs are interpolated at once,
+//			only the fetch of their neighbours is scalar.
+//-----------------------------------------------------------------------------
+static uint32 Voice_Resample(const int16 *psIn, uint32 nIn, int16 *psOut, float flStep, float *pflPhase)
+{
+	__declspec(align(16)) int32	nIndex[4];
+	__m128i		vIndex, vSamples;
+	__m128		vPos, vFrac, vA, vB, vStep4;
+	const int16	*psBase;
+	float		flPos;
+	uint32		nOut, i, k;
+
+	psBase = psIn - 1;
+	flPos = *pflPhase;
+
+	// Outputs whose position falls before the end of the input
+	nOut = (flPos < (float)nIn) ? (uint32)(((float)nIn - flPos) / flStep) + 1 : 0;
+
+	while (nOut && flPos + (nOut - 1) * flStep >= (float)nIn)
+		nOut--;
+
+	vPos = _mm_setr_ps(flPos, flPos + flStep, flPos + 2 * flStep, flPos + 3 * flStep);
+	vStep4 = _mm_set1_ps(flStep * 4);
+
+	for (i = 0; i + 4 <= nOut; i += 4)
+	{
+		vIndex = _mm_cvttps_epi32(vPos);
+		vFrac = _mm_sub_ps(vPos, _mm_cvtepi32_ps(vIndex));
+		_mm_store_si128((__m128i*)nIndex, vIndex);
+
+		vA = _mm_setr_ps(psBase[nIndex[0]], psBase[nIndex[1]], psBase[nIndex[2]], psBase[nIndex[3]]);
+		vB = _mm_setr_ps(psBase[nIndex[0] + 1], psBase[nIndex[1] + 1], psBase[nIndex[2] + 1], psBase[nIndex[3] + 1]);
+
+		vA = _mm_add_ps(vA, _mm_mul_ps(_mm_sub_ps(vB, vA), vFrac));
+
+		vSamples = _mm_cvtps_epi32(vA);
+		vSamples = _mm_packs_epi32(vSamples, vSamples);
+		_mm_storel_epi64((__m128i*)&psOut[i], vSamples);
+
+		vPos = _mm_add_ps(vPos, vStep4);
+	}
+
+	for (; i < nOut; i++)
+	{
+		float flSamplePos = flPos + i * flStep;
+
+		k = (uint32)flSamplePos;
+		psOut[i] = (int16)(psBase[k] + (psBase[k + 1] - psBase[k]) * (flSamplePos - k));
+	}
+
+	*pflPhase = flPos + nOut * flStep - (float)nIn;
+
+	return nOut;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Adds samples with saturation, eight at a time
+//-----------------------------------------------------------------------------
+static void Voice_MixSamples(int16 *psDest, const int16 *psSource, uint32 nSamples)
+{
+	__m128i	vDest, vSource;
+	int32	nSample;
+	uint32	i;
+
+	for (i = 0; i + 8 <= nSamples; i += 8)
+	{
+		vDest = _mm_loadu_si128((const __m128i*)&psDest[i]);
+		vSource = _mm_loadu_si128((const __m128i*)&psSource[i]);
+		_mm_storeu_si128((__m128i*)&psDest[i], _mm_adds_epi16(vDest, vSource));
+	}
+
+	for (; i < nSamples; i++)
+	{
+		nSample = psDest[i] + psSource[i];
+		psDest[i] = (int16)max(-32768, min(32767, nSample));
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Voice pipeline class
+//-----------------------------------------------------------------------------
+class CVoicePipeline
+{
+public:
+	CVoicePipeline();
+
+public:
+	bool Start(ISteamUser *pSteamUser, uint32 unOutputSampleRate);
+	void StopWorker();
+	void Stop();
+	void SetCapture(bool bCapture);
+	uint32 ReadCaptured(void *pDest, uint32 cubDest);
+	bool Submit(uint64 ulSpeakerSteamID, const void *pData, uint32 cubData);
+	uint32 ReadSamples(int16 *psSamples, uint32 nSamples);
+
+private:
+	bool AllocBuffers();
+	static DWORD WINAPI WorkerThread(LPVOID pvParam);
+	void RunWorker();
+	void Capture();
+	void Decode(VoicePacket_t *pPacket);
+	void Mix();
+	VoiceSpeaker_t* FindSpeaker(uint64 ulSteamID);
+
+public:
+	ISteamUser*				m_pSteamUser;
+	HANDLE					m_hWorkerThread;
+	HANDLE					m_hStopEvent;
+	volatile bool			m_bCapture;
+
+	uint32					m_unDecodeSampleRate;
+	uint32					m_unOutputSampleRate;
+	float					m_flResampleStep;
+
+	// Every buffer below lives in this one allocation, it outlives the
+	// worker as the game and audio threads may still be in them
+	uint8*					m_pubMemory;
+	uint32					m_cubMemory;
+
+	VoicePacketRing_t		m_CaptureRing;
+	VoicePacketRing_t		m_IncomingRing;
+
+	VoiceSpeaker_t			m_Speakers[VOICE_MAX_SPEAKERS];
+
+	// Mixed samples for the audio thread
+	int16*					m_psOutput;
+	volatile uint32			m_unOutputHead;
+	volatile uint32			m_unOutputTail;
+
+	// Worker scratch buffers
+	int16*					m_psDecoded;
+	int16*					m_psResampleIn;
+	int16*					m_psResampled;
+	int16*					m_psMix;
+
+	SteamAPIVoiceStats_t	m_Stats;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Constructor
+//-----------------------------------------------------------------------------
+CVoicePipeline::CVoicePipeline() :
+	m_pSteamUser(nullptr),
+	m_hWorkerThread(NULL),
+	m_hStopEvent(NULL),
+	m_bCapture(false),
+	m_unDecodeSampleRate(0),
+	m_unOutputSampleRate(0),
+	m_flResampleStep(1.0f),
+	m_pubMemory(nullptr),
+	m_cubMemory(0),
+	m_psOutput(nullptr),
+	m_unOutputHead(0),
+	m_unOutputTail(0),
+	m_psDecoded(nullptr),
+	m_psResampleIn(nullptr),
+	m_psResampled(nullptr),
+	m_psMix(nullptr)
+{
+	memset(&m_CaptureRing, 0, sizeof(m_CaptureRing));
+	memset(&m_IncomingRing, 0, sizeof(m_IncomingRing));
+	memset(m_Speakers, 0, sizeof(m_Speakers));
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Allocates every buffer and lays out the rings
+//-----------------------------------------------------------------------------
+bool CVoicePipeline::AllocBuffers()
+{
+	uint32	cubCapture, cubIncoming, cubSpeakers;
+	uint8	*pubMemory;
+	uint32	i;
+
+	cubCapture = VOICE_CAPTURE_SLOTS * (sizeof(VoicePacket_t) + VOICE_CAPTURE_PACKET_SIZE);
+	cubIncoming = VOICE_INCOMING_SLOTS * (sizeof(VoicePacket_t) + VOICE_INCOMING_PACKET_SIZE);
+	cubSpeakers = VOICE_MAX_SPEAKERS * VOICE_SPEAKER_RING_SIZE * sizeof(int16);
+
+	m_cubMemory = cubCapture + cubIncoming + cubSpeakers;
+	m_cubMemory += (VOICE_OUTPUT_RING_SIZE + VOICE_DECODE_MAX_SAMPLES + VOICE_RESAMPLE_BLOCK + 8 + VOICE_RESAMPLE_MAX_OUTPUT + VOICE_MIX_BLOCK) * sizeof(int16);
+
+	m_pubMemory = (uint8*)VirtualAlloc(NULL, m_cubMemory, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+
+	if (!m_pubMemory)
+		return false;
+
+	pubMemory = m_pubMemory;
+
+	m_CaptureRing.m_unHead = m_CaptureRing.m_unTail = 0;
+	m_CaptureRing.m_nSlots = VOICE_CAPTURE_SLOTS;
+	m_CaptureRing.m_cubSlotData = VOICE_CAPTURE_PACKET_SIZE;
+	m_CaptureRing.m_pubSlots = pubMemory;
+	pubMemory += cubCapture;
+
+	m_IncomingRing.m_unHead = m_IncomingRing.m_unTail = 0;
+	m_IncomingRing.m_nSlots = VOICE_INCOMING_SLOTS;
+	m_IncomingRing.m_cubSlotData = VOICE_INCOMING_PACKET_SIZE;
+	m_IncomingRing.m_pubSlots = pubMemory;
+	pubMemory += cubIncoming;
+
+	memset(m_Speakers, 0, sizeof(m_Speakers));
+
+	for (i = 0; i < VOICE_MAX_SPEAKERS; i++)
+	{
+		m_Speakers[i].m_psRing = (int16*)pubMemory;
+		pubMemory += VOICE_SPEAKER_RING_SIZE * sizeof(int16);
+	}
+
+	m_psOutput = (int16*)pubMemory;
+	m_unOutputHead = m_unOutputTail = 0;
+
+	m_psDecoded = m_psOutput + VOICE_OUTPUT_RING_SIZE;
+	m_psResampleIn = m_psDecoded + VOICE_DECODE_MAX_SAMPLES;
+	m_psResampled = m_psResampleIn + VOICE_RESAMPLE_BLOCK + 8;
+	m_psMix = m_psResampled + VOICE_RESAMPLE_MAX_OUTPUT;
+
+	memset(&m_Stats, 0, sizeof(m_Stats));
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Starts the worker, buffers are allocated the first time. Voice
+//			queued while the worker was suspended is kept.
+//-----------------------------------------------------------------------------
+bool CVoicePipeline::Start(ISteamUser *pSteamUser, uint32 unOutputSampleRate)
+{
+	uint32 unDecodeSampleRate;
+
+	if (m_hWorkerThread || !pSteamUser)
+		return false;
+
+	unDecodeSampleRate = pSteamUser->GetVoiceOptimalSampleRate();
+
+	if (!unDecodeSampleRate || !unOutputSampleRate || unOutputSampleRate > unDecodeSampleRate * VOICE_MAX_RATE_RATIO)
+	{
+		AsyncLog(k_ESteamAPILogError, "[S_API] Voice can't be resampled from %u Hz to %u Hz.\n", unDecodeSampleRate, unOutputSampleRate);
+		return false;
+	}
+
+	if (!m_pubMemory && !AllocBuffers())
+		return false;
+
+	m_pSteamUser = pSteamUser;
+	m_unDecodeSampleRate = unDecodeSampleRate;
+	m_unOutputSampleRate = unOutputSampleRate;
+	m_flResampleStep = (float)m_unDecodeSampleRate / (float)unOutputSampleRate;
+
+	m_hStopEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+	m_hWorkerThread = m_hStopEvent ? CreateThread(NULL, 0, WorkerThread, this, 0, NULL) : NULL;
+
+	if (!m_hWorkerThread)
+	{
+		StopWorker();
+		return false;
+	}
+
+	SetThreadPriority(m_hWorkerThread, THREAD_PRIORITY_ABOVE_NORMAL);
+
+	AsyncLog(k_ESteamAPILogInfo, "[S_API] Voice pipeline started, %u Hz decode, %u Hz output.\n", m_unDecodeSampleRate, unOutputSampleRate);
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Stops the worker and lets go of the user, buffers stay so the
+//			game and audio threads can't be caught in them.
+//-----------------------------------------------------------------------------
+void CVoicePipeline::StopWorker()
+{
+	if (m_hWorkerThread)
+	{
+		SetEvent(m_hStopEvent);
+		WaitForSingleObject(m_hWorkerThread, INFINITE);
+		CloseHandle(m_hWorkerThread);
+	}
+
+	if (m_hStopEvent)
+		CloseHandle(m_hStopEvent);
+
+	m_hWorkerThread = NULL;
+	m_hStopEvent = NULL;
+
+	if (m_bCapture && m_pSteamUser)
+		m_pSteamUser->StopVoiceRecording();
+
+	m_bCapture = false;
+	m_pSteamUser = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Stops the worker and frees every buffer. Readers must be done.
+//-----------------------------------------------------------------------------
+void CVoicePipeline::Stop()
+{
+	StopWorker();
+
+	if (m_pubMemory)
+		VirtualFree(m_pubMemory, 0, MEM_RELEASE);
+
+	m_pubMemory = nullptr;
+	m_cubMemory = 0;
+
+	memset(&m_CaptureRing, 0, sizeof(m_CaptureRing));
+	memset(&m_IncomingRing, 0, sizeof(m_IncomingRing));
+	memset(m_Speakers, 0, sizeof(m_Speakers));
+	m_psOutput = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Starts or stops recording, packets are polled by the worker
+//-----------------------------------------------------------------------------
+void CVoicePipeline::SetCapture(bool bCapture)
+{
+	if (!m_hWorkerThread || m_bCapture == bCapture)
+		return;
+
+	if (bCapture)
+		m_pSteamUser->StartVoiceRecording();
+	else
+		m_pSteamUser->StopVoiceRecording();
+
+	m_bCapture = bCapture;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Pops one captured packet, returns its size or 0 if there is none.
+//			Packets that don't fit the buffer are dropped.
+//-----------------------------------------------------------------------------
+uint32 CVoicePipeline::ReadCaptured(void *pDest, uint32 cubDest)
+{
+	VoicePacket_t	*pPacket;
+	uint32			cubData;
+
+	if (!m_hWorkerThread)
+		return 0;
+
+	pPacket = VoiceRing_BeginPop(&m_CaptureRing);
+
+	if (!pPacket)
+		return 0;
+
+	cubData = pPacket->m_cubData;
+
+	if (cubData <= cubDest)
+		memcpy(pDest, pPacket + 1, cubData);
+	else
+		InterlockedIncrement((volatile LONG*)&m_Stats.m_nPacketsDropped);
+
+	VoiceRing_EndPop(&m_CaptureRing);
+
+	return (cubData <= cubDest) ? cubData : 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Queues a received packet for the worker
+//-----------------------------------------------------------------------------
+bool CVoicePipeline::Submit(uint64 ulSpeakerSteamID, const void *pData, uint32 cubData)
+{
+	VoicePacket_t *pPacket;
+
+	if (!m_hWorkerThread)
+		return false;
+
+	pPacket = (cubData <= VOICE_INCOMING_PACKET_SIZE) ? VoiceRing_BeginPush(&m_IncomingRing) : nullptr;
+
+	if (!pPacket)
+	{
+		InterlockedIncrement((volatile LONG*)&m_Stats.m_nPacketsDropped);
+		return false;
+	}
+
+	pPacket->m_ulSteamID = ulSpeakerSteamID;
+	pPacket->m_cubData = cubData;
+	memcpy(pPacket + 1, pData, cubData);
+
+	VoiceRing_EndPush(&m_IncomingRing);
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Copies mixed samples, silence fills what isn't there yet. Returns
+//			number of samples that were voice.
+//-----------------------------------------------------------------------------
+uint32 CVoicePipeline::ReadSamples(int16 *psSamples, uint32 nSamples)
+{
+	uint32	unTail, nAvailable, nCopy, nFirst;
+
+	if (!m_hWorkerThread)
+	{
+		memset(psSamples, 0, nSamples * sizeof(int16));
+		return 0;
+	}
+
+	unTail = m_unOutputTail;
+	nAvailable = m_unOutputHead - unTail;
+	MemoryBarrier();
+
+	nCopy = min(nAvailable, nSamples);
+	nFirst = min(nCopy, VOICE_OUTPUT_RING_SIZE - (unTail & (VOICE_OUTPUT_RING_SIZE - 1)));
+
+	memcpy(psSamples, &m_psOutput[unTail & (VOICE_OUTPUT_RING_SIZE - 1)], nFirst * sizeof(int16));
+	memcpy(psSamples + nFirst, m_psOutput, (nCopy - nFirst) * sizeof(int16));
+
+	if (nCopy < nSamples)
+	{
+		memset(psSamples + nCopy, 0, (nSamples - nCopy) * sizeof(int16));
+
+		// Running dry in the middle of speech
+		if (nCopy)
+			InterlockedIncrement((volatile LONG*)&m_Stats.m_nUnderruns);
+	}
+
+	MemoryBarrier();
+	m_unOutputTail = unTail + nCopy;
+
+	return nCopy;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns state of the speaker, a slot of a quiet one is reused if
+//			it's heard for the first time. Null if every slot is talking.
+//-----------------------------------------------------------------------------
+VoiceSpeaker_t* CVoicePipeline::FindSpeaker(uint64 ulSteamID)
+{
+	VoiceSpeaker_t	*pFree;
+	DWORD			dwTime;
+	int16			*psRing;
+	int				i;
+
+	pFree = nullptr;
+	dwTime = GetTickCount();
+
+	for (i = 0; i < VOICE_MAX_SPEAKERS; i++)
+	{
+		if (m_Speakers[i].m_ulSteamID == ulSteamID)
+			return &m_Speakers[i];
+
+		if (!pFree && (!m_Speakers[i].m_ulSteamID || dwTime - m_Speakers[i].m_dwLastHeard > VOICE_SPEAKER_TIMEOUT_MS))
+			pFree = &m_Speakers[i];
+	}
+
+	if (!pFree)
+		return nullptr;
+
+	psRing = pFree->m_psRing;
+	memset(pFree, 0, sizeof(VoiceSpeaker_t));
+
+	pFree->m_ulSteamID = ulSteamID;
+	pFree->m_psRing = psRing;
+
+	return pFree;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Moves everything steam has recorded into the capture ring
+//-----------------------------------------------------------------------------
+void CVoicePipeline::Capture()
+{
+	VoicePacket_t	*pPacket;
+	uint32			cubCompressed, cubWritten;
+
+	while (m_bCapture)
+	{
+		cubCompressed = 0;
+
+		if (m_pSteamUser->GetAvailableVoice(&cubCompressed, nullptr, 0) != k_EVoiceResultOK || !cubCompressed)
+			break;
+
+		pPacket = VoiceRing_BeginPush(&m_CaptureRing);
+
+		// The game isn't reading, new voice is left with steam, which
+		// drops it once its own buffer is full
+		if (!pPacket)
+		{
+			InterlockedIncrement((volatile LONG*)&m_Stats.m_nPacketsDropped);
+			break;
+		}
+
+		if (m_pSteamUser->GetVoice(true, pPacket + 1, VOICE_CAPTURE_PACKET_SIZE, &cubWritten, false, nullptr, 0, nullptr, 0) != k_EVoiceResultOK || !cubWritten)
+			break;
+
+		pPacket->m_ulSteamID = 0;
+		pPacket->m_cubData = cubWritten;
+
+		VoiceRing_EndPush(&m_CaptureRing);
+
+		m_Stats.m_nPacketsCaptured++;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Decompresses the packet and appends it to the speaker's ring at
+//			the output rate
+//-----------------------------------------------------------------------------
+void CVoicePipeline::Decode(VoicePacket_t *pPacket)
+{
+	VoiceSpeaker_t	*pSpeaker;
+	uint32			cubWritten, nDecoded, nBlock, nOut;
+	uint32			i, j, nFirst;
+
+	pSpeaker = FindSpeaker(pPacket->m_ulSteamID);
+
+	if (!pSpeaker)
+	{
+		InterlockedIncrement((volatile LONG*)&m_Stats.m_nPacketsDropped);
+		return;
+	}
+
+	if (m_pSteamUser->DecompressVoice(pPacket + 1, pPacket->m_cubData, m_psDecoded, VOICE_DECODE_MAX_SAMPLES * sizeof(int16), &cubWritten, m_unDecodeSampleRate) != k_EVoiceResultOK)
+	{
+		InterlockedIncrement((volatile LONG*)&m_Stats.m_nPacketsDropped);
+		return;
+	}
+
+	pSpeaker->m_dwLastHeard = GetTickCount();
+	nDecoded = cubWritten / sizeof(int16);
+
+	for (i = 0; i < nDecoded; i += nBlock)
+	{
+		nBlock = min(nDecoded - i, (uint32)VOICE_RESAMPLE_BLOCK);
+
+		// Block is preceded by the sample the previous one ended with
+		m_psResampleIn[0] = pSpeaker->m_sLastSample;
+		memcpy(&m_psResampleIn[1], &m_psDecoded[i], nBlock * sizeof(int16));
+
+		nOut = Voice_Resample(&m_psResampleIn[1], nBlock, m_psResampled, m_flResampleStep, &pSpeaker->m_flPhase);
+		pSpeaker->m_sLastSample = m_psDecoded[i + nBlock - 1];
+
+		// Speaker's ring is full, the mix is behind, drop the oldest samples
+		if (pSpeaker->m_unHead - pSpeaker->m_unTail + nOut > VOICE_SPEAKER_RING_SIZE)
+			pSpeaker->m_unTail = pSpeaker->m_unHead + nOut - VOICE_SPEAKER_RING_SIZE;
+
+		j = pSpeaker->m_unHead & (VOICE_SPEAKER_RING_SIZE - 1);
+		nFirst = min(nOut, VOICE_SPEAKER_RING_SIZE - j);
+
+		memcpy(&pSpeaker->m_psRing[j], m_psResampled, nFirst * sizeof(int16));
+		memcpy(pSpeaker->m_psRing, &m_psResampled[nFirst], (nOut - nFirst) * sizeof(int16));
+
+		pSpeaker->m_unHead += nOut;
+	}
+
+	m_Stats.m_nPacketsDecoded++;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Mixes speakers into the output ring, up to the output latency
+//			ahead of the audio thread
+//-----------------------------------------------------------------------------
+void CVoicePipeline::Mix()
+{
+	VoiceSpeaker_t	*pSpeaker;
+	uint32			nTarget, nFill, nMix, nSpeaker, nAvailable;
+	uint32			unHead, j, nFirst;
+	uint32			nSpeakers;
+	DWORD			dwTime;
+	int				i;
+
+	nTarget = m_unOutputSampleRate * VOICE_OUTPUT_LATENCY_MS / 1000;
+	nFill = m_unOutputHead - m_unOutputTail;
+
+	if (nFill >= nTarget)
+		return;
+
+	nMix = 0;
+	nSpeakers = 0;
+	dwTime = GetTickCount();
+
+	for (i = 0; i < VOICE_MAX_SPEAKERS; i++)
+	{
+		pSpeaker = &m_Speakers[i];
+
+		if (pSpeaker->m_ulSteamID && dwTime - pSpeaker->m_dwLastHeard <= VOICE_SPEAKER_TIMEOUT_MS)
+			nSpeakers++;
+
+		nMix = max(nMix, pSpeaker->m_unHead - pSpeaker->m_unTail);
+	}
+
+	m_Stats.m_nSpeakers = nSpeakers;
+
+	// Nobody talks, the audio thread plays silence on its own
+	nMix = min(min(nMix, nTarget - nFill), (uint32)VOICE_MIX_BLOCK);
+
+	if (!nMix)
+		return;
+
+	memset(m_psMix, 0, nMix * sizeof(int16));
+
+	for (i = 0; i < VOICE_MAX_SPEAKERS; i++)
+	{
+		pSpeaker = &m_Speakers[i];
+		nAvailable = pSpeaker->m_unHead - pSpeaker->m_unTail;
+
+		if (!nAvailable)
+			continue;
+
+		nSpeaker = min(nAvailable, nMix);
+		j = pSpeaker->m_unTail & (VOICE_SPEAKER_RING_SIZE - 1);
+		nFirst = min(nSpeaker, VOICE_SPEAKER_RING_SIZE - j);
+
+		Voice_MixSamples(m_psMix, &pSpeaker->m_psRing[j], nFirst);
+		Voice_MixSamples(m_psMix + nFirst, pSpeaker->m_psRing, nSpeaker - nFirst);
+
+		pSpeaker->m_unTail += nSpeaker;
+	}
+
+	unHead = m_unOutputHead;
+	j = unHead & (VOICE_OUTPUT_RING_SIZE - 1);
+	nFirst = min(nMix, VOICE_OUTPUT_RING_SIZE - j);
+
+	memcpy(&m_psOutput[j], m_psMix, nFirst * sizeof(int16));
+	memcpy(m_psOutput, &m_psMix[nFirst], (nMix - nFirst) * sizeof(int16));
+
+	MemoryBarrier();
+	m_unOutputHead = unHead + nMix;
+
+	m_Stats.m_nSamplesMixed += nMix;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Worker loop
+//-----------------------------------------------------------------------------
+void CVoicePipeline::RunWorker()
+{
+	VoicePacket_t	*pPacket;
+	uint64			ullStartTime;
+
+	while (WaitForSingleObject(m_hStopEvent, VOICE_TICK_MS) == WAIT_TIMEOUT)
+	{
+		Capture();
+
+		ullStartTime = Steam_GetMicroseconds();
+
+		while ((pPacket = VoiceRing_BeginPop(&m_IncomingRing)) != nullptr)
+		{
+			Decode(pPacket);
+			VoiceRing_EndPop(&m_IncomingRing);
+		}
+
+		m_Stats.m_ullDecodeTime += Steam_GetMicroseconds() - ullStartTime;
+		ullStartTime = Steam_GetMicroseconds();
+
+		Mix();
+
+		m_Stats.m_ullMixTime += Steam_GetMicroseconds() - ullStartTime;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Worker thread entry point
+//-----------------------------------------------------------------------------
+DWORD WINAPI CVoicePipeline::WorkerThread(LPVOID pvParam)
+{
+	reinterpret_cast<CVoicePipeline*>(pvParam)->RunWorker();
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// 
+// Voice pipeline C interface
+// 
+//-----------------------------------------------------------------------------
+
+// Pipeline stopped while the pipe is re-established, and its settings
+static bool		s_bVoiceSuspended = false;
+static uint32	s_unVoiceSuspendedRate = 0;
+static bool		s_bVoiceSuspendedCapture = false;
+
+//-----------------------------------------------------------------------------
+// Purpose: Singleton access
+//-----------------------------------------------------------------------------
+static CVoicePipeline *GVoicePipeline()
+{
+	static CVoicePipeline VoicePipeline;
+	return &VoicePipeline;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Stops the worker before the pipe is torn down for reconnect, the
+//			user interface it holds is about to go away. Buffers are kept,
+//			the audio thread doesn't know about the reconnect.
+//-----------------------------------------------------------------------------
+void VoicePipeline_Suspend()
+{
+	CVoicePipeline *pPipeline;
+
+	pPipeline = GVoicePipeline();
+
+	if (!pPipeline->m_hWorkerThread)
+		return;
+
+	s_bVoiceSuspended = true;
+	s_unVoiceSuspendedRate = pPipeline->m_unOutputSampleRate;
+	s_bVoiceSuspendedCapture = pPipeline->m_bCapture;
+
+	pPipeline->StopWorker();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Starts the worker again on the new pipe. Buffers are freed only
+//			by shutdown, or when the game stops the pipeline.
+//-----------------------------------------------------------------------------
+void VoicePipeline_Resume()
+{
+	if (!s_bVoiceSuspended)
+		return;
+
+	s_bVoiceSuspended = false;
+
+	if (!SteamAPI_StartVoicePipeline(s_unVoiceSuspendedRate))
+		return;
+
+	GVoicePipeline()->SetCapture(s_bVoiceSuspendedCapture);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The worker uses the pipe, it has to be gone before the pipe is.
+//-----------------------------------------------------------------------------
+void VoicePipeline_Shutdown()
+{
+	s_bVoiceSuspended = false;
+
+	GVoicePipeline()->Stop();
+}
+
+//-----------------------------------------------------------------------------
+// 
+// Voice pipeline interface
+// 
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Purpose: Starts the worker, mixed samples will be at the given rate.
+//-----------------------------------------------------------------------------
+bool SteamAPI_StartVoicePipeline(uint32 unOutputSampleRate)
+{
+	ISteamUser *pSteamUser;
+
+	pSteamUser = static_cast<ISteamUser*>(InterfaceCache_FindOrCreate(g_pSteamClient, g_hSteamUser, g_hSteamPipe, STEAMUSER_INTERFACE_VERSION));
+
+	return GVoicePipeline()->Start(pSteamUser, unOutputSampleRate);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Stops the worker, nothing may be reading or submitting anymore.
+//-----------------------------------------------------------------------------
+void SteamAPI_StopVoicePipeline()
+{
+	GVoicePipeline()->Stop();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Starts or stops recording the local user
+//-----------------------------------------------------------------------------
+void SteamAPI_SetVoiceCapture(bool bCapture)
+{
+	GVoicePipeline()->SetCapture(bCapture);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Pops one compressed packet to send, returns its size or 0. Buffer
+//			should be 8 KB, packets that don't fit are dropped.
+//-----------------------------------------------------------------------------
+uint32 SteamAPI_ReadCapturedVoice(void *pDest, uint32 cubDest)
+{
+	if (!pDest)
+		return 0;
+
+	return GVoicePipeline()->ReadCaptured(pDest, cubDest);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Queues a compressed packet received from the speaker. Fails if
+//			the queue is full or the packet is too large.
+//-----------------------------------------------------------------------------
+bool SteamAPI_SubmitVoicePacket(uint64 ulSpeakerSteamID, const void *pData, uint32 cubData)
+{
+	if (!pData || !cubData || !ulSpeakerSteamID)
+		return false;
+
+	return GVoicePipeline()->Submit(ulSpeakerSteamID, pData, cubData);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Fills the buffer with mixed mono samples, called from the audio
+//			thread. Returns number of samples that weren't silence padding.
+//-----------------------------------------------------------------------------
+uint32 SteamAPI_ReadVoiceSamples(int16 *psSamples, uint32 nSamples)
+{
+	if (!psSamples || !nSamples)
+		return 0;
+
+	return GVoicePipeline()->ReadSamples(psSamples, nSamples);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Counters since the pipeline started
+//-----------------------------------------------------------------------------
+void SteamAPI_GetVoiceStats(SteamAPIVoiceStats_t *pStats)
+{
+	if (!pStats)
+		return;
+
+	*pStats = GVoicePipeline()->m_Stats;
+}
@@ -0,0 +1,54 @@
+//========= Copyright � 1996-2001, Valve LLC, All rights reserved. ============
+//
+// Purpose: 
+//
+// $NoKeywords: $
+//=============================================================================
+#ifndef VOICE_PIPELINE_H
+#define VOICE_PIPELINE_H
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Purpose: Counters of the voice pipeline, times are in microseconds.
+//-----------------------------------------------------------------------------
+struct SteamAPIVoiceStats_t
+{
+	uint32		m_nSpeakers;			// Speakers heard within the last second
+	uint32		m_nPacketsCaptured;
+	uint32		m_nPacketsDecoded;
+	uint32		m_nPacketsDropped;		// Queue full, too large or failed to decode
+	uint32		m_nSamplesMixed;
+	uint32		m_nUnderruns;			// Reads that got less than they asked for
+	uint64		m_ullDecodeTime;
+	uint64		m_ullMixTime;
+};
+
+//-----------------------------------------------------------------------------
+// 
+// Voice pipeline C interface
+// 
+//-----------------------------------------------------------------------------
+
+extern void VoicePipeline_Suspend();
+extern void VoicePipeline_Resume();
+extern void VoicePipeline_Shutdown();
+
+//-----------------------------------------------------------------------------
+// Purpose: Voice pipeline API. A worker thread polls the microphone,
+//			decompresses packets of every speaker, resamples them to the
+//			output rate and mixes them into one mono 16-bit stream.
+// 
+//			The game thread reads captured packets to send and submits
+//			received ones, the engine audio thread reads mixed samples.
+//			Each of them is a single producer or consumer of a lock-free
+//			queue, none of them waits for the worker or for steamclient.
+//-----------------------------------------------------------------------------
+S_API bool SteamAPI_StartVoicePipeline(uint32 unOutputSampleRate);
+S_API void SteamAPI_StopVoicePipeline();
+S_API void SteamAPI_SetVoiceCapture(bool bCapture);
+S_API uint32 SteamAPI_ReadCapturedVoice(void *pDest, uint32 cubDest);
+S_API bool SteamAPI_SubmitVoicePacket(uint64 ulSpeakerSteamID, const void *pData, uint32 cubData);
+S_API uint32 SteamAPI_ReadVoiceSamples(int16 *psSamples, uint32 nSamples);
+S_API void SteamAPI_GetVoiceStats(SteamAPIVoiceStats_t *pStats);
+
+#endif